@@ -0,0 +1,157 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the fifo.
+ *
+ * The fifo is used to send messages between threads. These benchmarks
+ * measure the throughput (messages per second) and the latency (time
+ * between the push_back() and the pop_front() returning that message)
+ * with various numbers of producers and consumers.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/fifo.h>
+
+
+// C++
+//
+#include    <atomic>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+struct message_t
+{
+    std::uint64_t       f_timestamp = 0;
+};
+
+
+typedef cppthread::fifo<message_t>      fifo_t;
+
+
+cppthread_bench::registrar g_fifo_single_thread(
+      "fifo.single_thread"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(2'000'000));
+        fifo_t f;
+        message_t msg;
+
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            f.push_back(msg);
+            f.pop_front(msg, 0);
+        }
+        cppthread_bench::result r;
+        r.f_name = "push_pop";
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+cppthread_bench::registrar g_fifo_producers_consumers(
+      "fifo.threads"
+    , [](cppthread_bench::context & ctx)
+    {
+        struct setup_t
+        {
+            std::size_t     f_producers = 1;
+            std::size_t     f_consumers = 1;
+        };
+        setup_t const setups[] =
+        {
+            { 1, 1 },
+            { 1, 4 },
+            { 4, 1 },
+            { 2, 2 },
+            { 4, 4 },
+        };
+
+        std::uint64_t const count(ctx.iterations(500'000));
+        for(auto const & s : setups)
+        {
+            fifo_t f;
+            std::atomic<std::size_t> producers_done(0);
+            std::uint64_t const per_producer(count / s.f_producers);
+            std::vector<cppthread_bench::samples_t> latencies(s.f_consumers);
+
+            cppthread_bench::result r;
+            r.f_name = "push_pop";
+            r.f_parameters["producers"] = s.f_producers;
+            r.f_parameters["consumers"] = s.f_consumers;
+            r.f_operations = per_producer * s.f_producers;
+            r.f_elapsed_ns = cppthread_bench::run_in_threads(
+                  s.f_producers + s.f_consumers
+                , [&](std::size_t idx)
+                {
+                    if(idx < s.f_producers)
+                    {
+                        message_t msg;
+                        for(std::uint64_t i(0); i < per_producer; ++i)
+                        {
+                            msg.f_timestamp = cppthread_bench::now_ns();
+                            f.push_back(msg);
+                        }
+                        if(++producers_done == s.f_producers)
+                        {
+                            f.done(false);
+                        }
+                    }
+                    else
+                    {
+                        cppthread_bench::samples_t & samples(latencies[idx - s.f_producers]);
+                        samples.reserve(per_producer * s.f_producers / s.f_consumers);
+                        message_t msg;
+                        while(f.pop_front(msg, -1))
+                        {
+                            samples.push_back(cppthread_bench::now_ns() - msg.f_timestamp);
+                        }
+                    }
+                });
+
+            for(auto const & l : latencies)
+            {
+                r.f_latencies.insert(r.f_latencies.end(), l.begin(), l.end());
+            }
+            ctx.report(r);
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
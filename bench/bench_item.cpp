@@ -0,0 +1,131 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the item_with_predicate class.
+ *
+ * Each item embeds a mutex, so these benchmarks show the cost of creating
+ * a large number of mutexes and of locking mutexes spread all over the
+ * memory. The heap usage per item is reported as the "heap_bytes_per_item"
+ * parameter of the create_destroy benchmark.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/item_with_predicate.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <random>
+
+
+// C
+//
+#include    <malloc.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+typedef std::vector<cppthread::item_with_predicate::pointer_t>  items_t;
+
+
+cppthread_bench::registrar g_item_create_destroy(
+      "item_with_predicate.create_destroy"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(1'000'000));
+
+        items_t items;
+        items.reserve(count);
+
+        std::size_t const heap_before(mallinfo2().uordblks);
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            items.push_back(std::make_shared<cppthread::item_with_predicate>());
+        }
+        std::size_t const heap_after(mallinfo2().uordblks);
+        items.clear();
+
+        cppthread_bench::result r;
+        r.f_parameters["heap_bytes_per_item"] = (heap_after - heap_before) / count;
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+cppthread_bench::registrar g_item_valid_workload(
+      "item_with_predicate.valid_workload"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(1'000'000));
+
+        items_t items;
+        items.reserve(count);
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            items.push_back(std::make_shared<cppthread::item_with_predicate>());
+        }
+
+        // visit the items in random order so the mutexes are not in cache
+        //
+        std::vector<std::uint32_t> order(count);
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(5));
+
+        std::uint64_t valid(0);
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(auto const idx : order)
+        {
+            if(items[idx]->valid_workload())
+            {
+                ++valid;
+            }
+        }
+
+        cppthread_bench::result r;
+        r.f_operations = valid;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,165 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks comparing the mutex, spinlock, and ticket_lock.
+ *
+ * The critical section is tiny: one increment in a small map, the kind
+ * of work for which the spinning locks were added. Each lock is used
+ * through a guard so the numbers include the virtual calls of the
+ * lockable interface.
+ *
+ * The "hold" variants keep the lock for about one microsecond, which is
+ * where the spinning locks start losing against the mutex, especially
+ * when there are more threads than processors.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/spinlock.h>
+
+
+// C++
+//
+#include    <map>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+typedef std::map<int, std::uint64_t>    counters_t;
+
+
+void busy_wait(std::uint64_t ns)
+{
+    std::uint64_t const end(cppthread_bench::now_ns() + ns);
+    while(cppthread_bench::now_ns() < end)
+    {
+    }
+}
+
+
+void run_lock(
+      cppthread_bench::context & ctx
+    , std::string const & name
+    , cppthread::lockable & l)
+{
+    {
+        std::uint64_t const count(ctx.iterations(10'000'000));
+        counters_t counters;
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            cppthread::guard lock(l);
+            ++counters[i & 7];
+        }
+
+        cppthread_bench::result r;
+        r.f_name = name + ".uncontended";
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    }
+
+    std::vector<std::size_t> threads(cppthread_bench::thread_counts());
+    threads.push_back(threads.back() * 2);
+    for(auto const t : threads)
+    {
+        std::uint64_t const count(ctx.iterations(2'000'000));
+        std::uint64_t const per_thread(count / t);
+        counters_t counters;
+
+        cppthread_bench::result r;
+        r.f_name = name + ".contended";
+        r.f_parameters["threads"] = t;
+        r.f_operations = per_thread * t;
+        r.f_elapsed_ns = cppthread_bench::run_in_threads(
+              t
+            , [&l, &counters, per_thread](std::size_t idx)
+            {
+                for(std::uint64_t i(0); i < per_thread; ++i)
+                {
+                    cppthread::guard lock(l);
+                    ++counters[(i + idx) & 7];
+                }
+            });
+        ctx.report(r);
+    }
+
+    for(auto const t : threads)
+    {
+        std::uint64_t const count(ctx.iterations(20'000));
+        std::uint64_t const per_thread(count / t);
+
+        cppthread_bench::result r;
+        r.f_name = name + ".hold_1us";
+        r.f_parameters["threads"] = t;
+        r.f_operations = per_thread * t;
+        r.f_elapsed_ns = cppthread_bench::run_in_threads(
+              t
+            , [&l, per_thread](std::size_t)
+            {
+                for(std::uint64_t i(0); i < per_thread; ++i)
+                {
+                    cppthread::guard lock(l);
+                    busy_wait(1'000);
+                }
+            });
+        ctx.report(r);
+    }
+}
+
+
+cppthread_bench::registrar g_lock(
+      "lock"
+    , [](cppthread_bench::context & ctx)
+    {
+        {
+            cppthread::mutex m;
+            run_lock(ctx, "mutex", m);
+        }
+        {
+            cppthread::spinlock s;
+            run_lock(ctx, "spinlock", s);
+        }
+        {
+            cppthread::ticket_lock t;
+            run_lock(ctx, "ticket_lock", t);
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,139 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the logger.
+ *
+ * The main() function installs a callback which drops the messages so
+ * these benchmarks measure the cost of building and dispatching a
+ * message, not the cost of writing it to the console.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/fast_log.h>
+#include    <cppthread/log.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+void log_messages(std::uint64_t count)
+{
+    for(std::uint64_t i(0); i < count; ++i)
+    {
+        cppthread::log << cppthread::log_level_t::debug
+                       << "benchmark message #"
+                       << i
+                       << " with a string \""
+                       << "some data"
+                       << "\" and a double "
+                       << 3.14159
+                       << cppthread::end;
+    }
+}
+
+
+cppthread_bench::registrar g_log_single_thread(
+      "log.single_thread"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(500'000));
+
+        cppthread_bench::result r;
+        std::uint64_t const start(cppthread_bench::now_ns());
+        log_messages(count);
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+cppthread_bench::registrar g_log_threads(
+      "log.threads"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(500'000));
+        for(auto const threads : cppthread_bench::thread_counts())
+        {
+            std::uint64_t const per_thread(count / threads);
+
+            cppthread_bench::result r;
+            r.f_parameters["threads"] = threads;
+            r.f_operations = per_thread * threads;
+            r.f_elapsed_ns = cppthread_bench::run_in_threads(
+                  threads
+                , [per_thread](std::size_t)
+                {
+                    log_messages(per_thread);
+                });
+            ctx.report(r);
+        }
+    });
+
+
+
+cppthread_bench::registrar g_log_fast(
+      "log.fast"
+    , [](cppthread_bench::context & ctx)
+    {
+        static cppthread::fast_log_site const site(
+                  cppthread::log_level_t::debug
+                , "benchmark message #{} with a string \"{}\" and a double {}");
+
+        std::uint64_t const count(ctx.iterations(500'000));
+        constexpr std::uint64_t const BATCH = 500;
+
+        // only the calls to fast_log() are timed; the batches are small
+        // enough to fit in the ring and get flushed in between
+        //
+        cppthread_bench::result r;
+        std::uint64_t const dropped(cppthread::fast_log_dropped());
+        for(std::uint64_t i(0); i < count; i += BATCH)
+        {
+            std::uint64_t const start(cppthread_bench::now_ns());
+            for(std::uint64_t j(i); j < i + BATCH; ++j)
+            {
+                cppthread::fast_log(site, j, "some data", 3.14159);
+            }
+            r.f_elapsed_ns += cppthread_bench::now_ns() - start;
+            r.f_operations += BATCH;
+            cppthread::fast_log_flush();
+        }
+        r.f_parameters["dropped"] = cppthread::fast_log_dropped() - dropped;
+        ctx.report(r);
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,599 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Main function of the cppthread benchmarks.
+ *
+ * This file implements the small framework used by the benchmarks and
+ * the main() function which runs them and outputs the results in JSON.
+ *
+ * The output is meant to be saved by the release process and compared
+ * against the previous release to detect regressions. Each entry includes
+ * the name of the benchmark, its parameters (i.e. number of threads), the
+ * number of operations, the total time and, when available, a latency
+ * distribution.
+ *
+ * \code
+ *     cppthread-bench --output bench-1.1.16.json
+ *     cppthread-bench --filter fifo --scale 0.1
+ * \endcode
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/log.h>
+#include    <cppthread/thread.h>
+#include    <cppthread/version.h>
+
+
+// libexcept
+//
+#include    <libexcept/file_inheritance.h>
+
+
+// snapdev
+//
+#include    <snapdev/not_used.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <chrono>
+#include    <fstream>
+#include    <iomanip>
+#include    <iostream>
+#include    <memory>
+#include    <sstream>
+
+
+// C
+//
+#include    <string.h>
+#include    <time.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread_bench
+{
+
+
+
+namespace
+{
+
+
+
+struct benchmark_entry_t
+{
+    std::string     f_name = std::string();
+    benchmark_t     f_func = benchmark_t();
+};
+
+
+typedef std::vector<benchmark_entry_t>      benchmarks_t;
+
+
+/** \brief Retrieve the list of registered benchmarks.
+ *
+ * The benchmarks register themselves using static registrar objects.
+ * Since the order in which globals get initialized between compilation
+ * units is not defined, the list is created on the first call.
+ *
+ * \return A reference to the list of benchmarks.
+ */
+benchmarks_t & get_benchmarks()
+{
+    static benchmarks_t benchmarks;
+    return benchmarks;
+}
+
+
+/** \brief Escape a string for JSON.
+ *
+ * Our names are plain ASCII, but just in case, this function escapes
+ * the characters that JSON does not accept as is.
+ *
+ * \param[in] s  The string to escape.
+ *
+ * \return The escaped string, including the double quotes.
+ */
+std::string json_string(std::string const & s)
+{
+    std::stringstream ss;
+    ss << '"';
+    for(auto const c : s)
+    {
+        switch(c)
+        {
+        case '"':
+            ss << "\\\"";
+            break;
+
+        case '\\':
+            ss << "\\\\";
+            break;
+
+        case '\n':
+            ss << "\\n";
+            break;
+
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                ss << "\\u"
+                   << std::hex << std::setw(4) << std::setfill('0')
+                   << static_cast<int>(c)
+                   << std::dec;
+            }
+            else
+            {
+                ss << c;
+            }
+            break;
+
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+
+/** \brief Get a percentile from a sorted set of samples.
+ *
+ * \param[in] samples  The sorted samples.
+ * \param[in] percent  The percentile to retrieve (0.0 to 100.0).
+ *
+ * \return The sample at that percentile.
+ */
+std::uint64_t percentile(samples_t const & samples, double percent)
+{
+    std::size_t idx(static_cast<std::size_t>(
+                    static_cast<double>(samples.size() - 1) * percent / 100.0 + 0.5));
+    return samples[std::min(idx, samples.size() - 1)];
+}
+
+
+void write_result(std::ostream & out, result const & r)
+{
+    out << "    {\n"
+        << "      \"name\": " << json_string(r.f_name) << ",\n"
+        << "      \"parameters\": {";
+    char const * sep("");
+    for(auto const & p : r.f_parameters)
+    {
+        out << sep << json_string(p.first) << ": " << p.second;
+        sep = ", ";
+    }
+    double const ns_per_op(r.f_operations == 0
+                ? 0.0
+                : static_cast<double>(r.f_elapsed_ns) / static_cast<double>(r.f_operations));
+    double const ops_per_sec(r.f_elapsed_ns == 0
+                ? 0.0
+                : static_cast<double>(r.f_operations) * 1.0e9 / static_cast<double>(r.f_elapsed_ns));
+    out << "},\n"
+        << "      \"operations\": " << r.f_operations << ",\n"
+        << "      \"elapsed_ns\": " << r.f_elapsed_ns << ",\n"
+        << std::fixed << std::setprecision(3)
+        << "      \"ns_per_op\": " << ns_per_op << ",\n"
+        << "      \"ops_per_sec\": " << ops_per_sec;
+    if(!r.f_latencies.empty())
+    {
+        samples_t samples(r.f_latencies);
+        std::sort(samples.begin(), samples.end());
+        out << ",\n"
+            << "      \"latency_ns\": {"
+               "\"samples\": " << samples.size()
+            << ", \"min\": " << samples.front()
+            << ", \"p50\": " << percentile(samples, 50.0)
+            << ", \"p90\": " << percentile(samples, 90.0)
+            << ", \"p99\": " << percentile(samples, 99.0)
+            << ", \"max\": " << samples.back()
+            << "}";
+    }
+    out << "\n    }";
+}
+
+
+void write_results(std::ostream & out, std::vector<result> const & results)
+{
+    time_t const now(time(nullptr));
+    struct tm t;
+    gmtime_r(&now, &t);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &t);
+
+    out << "{\n"
+        << "  \"library\": \"cppthread\",\n"
+        << "  \"version\": " << json_string(CPPTHREAD_VERSION_STRING) << ",\n"
+        << "  \"date\": " << json_string(date) << ",\n"
+        << "  \"processors\": " << cppthread::get_number_of_available_processors() << ",\n"
+        << "  \"vdso\": " << (cppthread::is_using_vdso() ? "true" : "false") << ",\n"
+        << "  \"results\": [\n";
+    char const * sep("");
+    for(auto const & r : results)
+    {
+        out << sep;
+        write_result(out, r);
+        sep = ",\n";
+    }
+    out << "\n  ]\n"
+        << "}\n";
+}
+
+
+/** \brief Drop the log messages.
+ *
+ * The benchmarks do not want the logger to write to std::cerr since that
+ * would time the console instead of the library.
+ *
+ * \param[in] level  The level of the message.
+ * \param[in] message  The message.
+ */
+void null_log_callback(cppthread::log_level_t level, std::string const & message)
+{
+    snapdev::NOT_USED(level, message);
+}
+
+
+void usage(char const * progname)
+{
+    std::cout << "Usage: " << progname << " [-opts]\n"
+                 "where -opts is one or more of:\n"
+                 "  --filter <name>   only run benchmarks which name includes <name>\n"
+                 "  -h | --help       print out this help screen\n"
+                 "  --list            list the available benchmarks and exit\n"
+                 "  --output <file>   save the JSON results in <file> instead of stdout\n"
+                 "  --scale <factor>  multiply the number of iterations by <factor>\n"
+                 "  -v | --verbose    print the name of each benchmark as it runs\n";
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a benchmark context.
+ *
+ * The context is passed to each benchmark. It is used to compute the
+ * number of iterations to run and to save the results.
+ *
+ * \param[in] name  The name of the benchmark.
+ * \param[in] scale  The factor applied to the number of iterations.
+ */
+context::context(std::string const & name, double scale)
+    : f_name(name)
+    , f_scale(scale)
+{
+}
+
+
+std::string const & context::name() const
+{
+    return f_name;
+}
+
+
+/** \brief Compute the number of iterations.
+ *
+ * Each benchmark has a default number of iterations. The user can change
+ * that number with the --scale command line option. This function returns
+ * the scaled number, at least 1.
+ *
+ * \param[in] base  The default number of iterations.
+ *
+ * \return The number of iterations to run.
+ */
+std::uint64_t context::iterations(std::uint64_t base) const
+{
+    return std::max(
+              static_cast<std::uint64_t>(1)
+            , static_cast<std::uint64_t>(static_cast<double>(base) * f_scale));
+}
+
+
+/** \brief Save a result.
+ *
+ * The result name is prefixed with the name of the benchmark. If the
+ * result name is empty, the name of the benchmark is used as is.
+ *
+ * \param[in,out] r  The result to save. The latencies get moved out.
+ */
+void context::report(result & r)
+{
+    result copy;
+    copy.f_name = r.f_name.empty() ? f_name : f_name + "." + r.f_name;
+    copy.f_parameters = r.f_parameters;
+    copy.f_operations = r.f_operations;
+    copy.f_elapsed_ns = r.f_elapsed_ns;
+    copy.f_latencies.swap(r.f_latencies);
+    f_results.push_back(copy);
+}
+
+
+std::vector<result> const & context::results() const
+{
+    return f_results;
+}
+
+
+/** \brief Register a benchmark.
+ *
+ * Declare a static registrar object with the name of your benchmark
+ * and the function to run it.
+ *
+ * \param[in] name  The name of the benchmark.
+ * \param[in] func  The function implementing the benchmark.
+ */
+registrar::registrar(std::string const & name, benchmark_t func)
+{
+    get_benchmarks().push_back({ name, func });
+}
+
+
+/** \brief A runner which executes a function.
+ *
+ * The benchmarks create many threads and a runner class for each case
+ * would be tedious. This runner just calls the function it receives.
+ *
+ * The enter() and leave() functions are overridden so the benchmarks
+ * do not measure the logger.
+ *
+ * \param[in] name  The name of the runner.
+ * \param[in] func  The function to execute in the thread.
+ */
+lambda_runner::lambda_runner(std::string const & name, func_t func)
+    : runner(name)
+    , f_func(func)
+{
+}
+
+
+void lambda_runner::enter()
+{
+}
+
+
+void lambda_runner::run()
+{
+    f_func();
+}
+
+
+void lambda_runner::leave(cppthread::leave_status_t status)
+{
+    snapdev::NOT_USED(status);
+}
+
+
+/** \brief Get the current time in nanoseconds.
+ *
+ * \return The monotonic time in nanoseconds.
+ */
+std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/** \brief Return the list of thread counts to test with.
+ *
+ * The contended benchmarks run with 2, 4, 8... threads up to the number
+ * of available processors (and always at least 2 and 4 so results
+ * are comparable between computers).
+ *
+ * \return The list of thread counts.
+ */
+std::vector<std::size_t> thread_counts()
+{
+    std::size_t const max(std::max(4, cppthread::get_number_of_available_processors()));
+    std::vector<std::size_t> counts;
+    for(std::size_t c(2); c <= max; c *= 2)
+    {
+        counts.push_back(c);
+    }
+    return counts;
+}
+
+
+/** \brief Run a function in \p count threads simultaneously.
+ *
+ * This function creates \p count threads. Each thread waits for all the
+ * others to be started and then calls \p func with its index.
+ *
+ * \param[in] count  The number of threads to create.
+ * \param[in] func  The function each thread runs.
+ *
+ * \return The time it took, in nanoseconds, from the moment the threads
+ * were released to the moment the last one returned.
+ */
+std::uint64_t run_in_threads(std::size_t count, std::function<void(std::size_t)> func)
+{
+    std::atomic<std::size_t> ready(0);
+    std::atomic<bool> go(false);
+
+    std::vector<std::shared_ptr<lambda_runner>> runners;
+    std::vector<cppthread::thread::pointer_t> threads;
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        runners.push_back(std::make_shared<lambda_runner>(
+                  "bench-" + std::to_string(idx)
+                , [idx, &ready, &go, &func]()
+                {
+                    ++ready;
+                    while(!go.load(std::memory_order_acquire))
+                    {
+                    }
+                    func(idx);
+                }));
+        threads.push_back(std::make_shared<cppthread::thread>(
+                  runners.back()->get_name()
+                , runners.back()));
+        threads.back()->start();
+    }
+    while(ready.load() != count)
+    {
+    }
+
+    std::uint64_t const start(now_ns());
+    go.store(true, std::memory_order_release);
+    for(auto & t : threads)
+    {
+        t->stop();
+    }
+    std::uint64_t const elapsed(now_ns() - start);
+
+    threads.clear();
+    return elapsed;
+}
+
+
+
+} // namespace cppthread_bench
+
+
+
+int main(int argc, char * argv[])
+{
+    libexcept::verify_inherited_files();
+
+    std::string filter;
+    std::string output;
+    double scale(1.0);
+    bool list(false);
+    bool verbose(false);
+    for(int i(1); i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-h") == 0
+        || strcmp(argv[i], "--help") == 0)
+        {
+            cppthread_bench::usage(argv[0]);
+            return 1;
+        }
+        else if(strcmp(argv[i], "--filter") == 0
+             && i + 1 < argc)
+        {
+            ++i;
+            filter = argv[i];
+        }
+        else if(strcmp(argv[i], "--list") == 0)
+        {
+            list = true;
+        }
+        else if(strcmp(argv[i], "--output") == 0
+             && i + 1 < argc)
+        {
+            ++i;
+            output = argv[i];
+        }
+        else if(strcmp(argv[i], "--scale") == 0
+             && i + 1 < argc)
+        {
+            ++i;
+            scale = std::stod(argv[i]);
+            if(scale <= 0.0)
+            {
+                std::cerr << "error: --scale must be a positive number." << std::endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-v") == 0
+             || strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            std::cerr << "error: unsupported command line option \""
+                      << argv[i]
+                      << "\"."
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    cppthread_bench::benchmarks_t benchmarks(cppthread_bench::get_benchmarks());
+    std::sort(
+          benchmarks.begin()
+        , benchmarks.end()
+        , [](auto const & lhs, auto const & rhs)
+        {
+            return lhs.f_name < rhs.f_name;
+        });
+
+    if(list)
+    {
+        for(auto const & b : benchmarks)
+        {
+            std::cout << b.f_name << "\n";
+        }
+        return 0;
+    }
+
+    cppthread::set_log_callback(cppthread_bench::null_log_callback);
+
+    std::vector<cppthread_bench::result> results;
+    for(auto const & b : benchmarks)
+    {
+        if(!filter.empty()
+        && b.f_name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        if(verbose)
+        {
+            std::cerr << "running " << b.f_name << "..." << std::endl;
+        }
+        cppthread_bench::context ctx(b.f_name, scale);
+        b.f_func(ctx);
+        results.insert(results.end(), ctx.results().begin(), ctx.results().end());
+    }
+
+    if(output.empty())
+    {
+        cppthread_bench::write_results(std::cout, results);
+    }
+    else
+    {
+        std::ofstream out(output);
+        if(!out)
+        {
+            std::cerr << "error: could not create \"" << output << "\"." << std::endl;
+            return 1;
+        }
+        cppthread_bench::write_results(out, results);
+    }
+
+    return 0;
+}
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,120 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Declarations of the cppthread benchmark framework.
+ *
+ * The benchmarks are small functions registered with a name. Each one
+ * runs a number of operations, measures the time it took and reports
+ * one or more results. The main() function collects all the results and
+ * writes them out as JSON so they can be compared between releases.
+ */
+
+// cppthread
+//
+#include    <cppthread/runner.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <functional>
+#include    <map>
+#include    <string>
+#include    <vector>
+
+
+
+namespace cppthread_bench
+{
+
+
+
+typedef std::vector<std::uint64_t>              samples_t;
+typedef std::map<std::string, std::int64_t>     parameters_t;
+
+
+struct result
+{
+    std::string         f_name = std::string();
+    parameters_t        f_parameters = parameters_t();
+    std::uint64_t       f_operations = 0;
+    std::uint64_t       f_elapsed_ns = 0;
+    samples_t           f_latencies = samples_t();
+};
+
+
+class context
+{
+public:
+                        context(std::string const & name, double scale);
+
+    std::string const & name() const;
+    std::uint64_t       iterations(std::uint64_t base) const;
+    void                report(result & r);
+
+    std::vector<result> const &
+                        results() const;
+
+private:
+    std::string const   f_name;
+    double const        f_scale = 1.0;
+    std::vector<result> f_results = std::vector<result>();
+};
+
+
+typedef std::function<void(context &)>          benchmark_t;
+
+
+class registrar
+{
+public:
+                        registrar(std::string const & name, benchmark_t func);
+};
+
+
+class lambda_runner
+    : public cppthread::runner
+{
+public:
+    typedef std::function<void()>   func_t;
+
+                        lambda_runner(std::string const & name, func_t func);
+
+    virtual void        enter() override;
+    virtual void        run() override;
+    virtual void        leave(cppthread::leave_status_t status) override;
+
+private:
+    func_t              f_func = func_t();
+};
+
+
+std::uint64_t           now_ns();
+std::vector<std::size_t>
+                        thread_counts();
+std::uint64_t           run_in_threads(
+                              std::size_t count
+                            , std::function<void(std::size_t)> func);
+
+
+
+} // namespace cppthread_bench
+// vim: ts=4 sw=4 et
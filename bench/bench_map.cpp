@@ -0,0 +1,229 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the concurrent_map against a locked unordered_map.
+ *
+ * Several threads search a table of sessions, and now and then insert
+ * or erase one, like a service sharing its session map between workers.
+ * The same work is done with an std::unordered_map protected by one
+ * mutex and with the concurrent_map using a mutex or a spinlock per
+ * shard.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/concurrent_map.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/spinlock.h>
+
+
+// C++
+//
+#include    <unordered_map>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint64_t const   KEYS = 10'000;
+
+
+/** \brief Pick the next key.
+ *
+ * A small linear congruential generator per thread so the benchmark
+ * does not measure the cost of a shared random generator.
+ */
+std::uint64_t next_key(std::uint64_t & state)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (state >> 33) % KEYS;
+}
+
+
+/** \brief Run the workload against one type of map.
+ *
+ * 90% of the operations are searches, 5% inserts and 5% erases.
+ */
+template<class F, class I, class E>
+void run_workload(
+      cppthread_bench::context & ctx
+    , std::string const & name
+    , std::size_t threads
+    , std::uint64_t per_thread
+    , F find
+    , I insert
+    , E erase)
+{
+    cppthread_bench::result r;
+    r.f_name = name;
+    r.f_parameters["threads"] = threads;
+    r.f_operations = per_thread * threads;
+    r.f_elapsed_ns = cppthread_bench::run_in_threads(
+          threads
+        , [&find, &insert, &erase, per_thread](std::size_t idx)
+        {
+            std::uint64_t state(idx + 1);
+            for(std::uint64_t i(0); i < per_thread; ++i)
+            {
+                std::uint64_t const key(next_key(state));
+                std::uint64_t const op(i % 20);
+                if(op == 0)
+                {
+                    insert(key);
+                }
+                else if(op == 1)
+                {
+                    erase(key);
+                }
+                else
+                {
+                    find(key);
+                }
+            }
+        });
+    ctx.report(r);
+}
+
+
+cppthread_bench::registrar g_map_mixed(
+      "map.mixed"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(2'000'000));
+        for(auto const threads : cppthread_bench::thread_counts())
+        {
+            std::uint64_t const per_thread(count / threads);
+
+            {
+                cppthread::mutex m;
+                std::unordered_map<std::uint64_t, std::uint64_t> map;
+                for(std::uint64_t k(0); k < KEYS; k += 2)
+                {
+                    map[k] = k;
+                }
+                std::atomic<std::uint64_t> found(0);
+
+                run_workload(
+                      ctx
+                    , "unordered_map"
+                    , threads
+                    , per_thread
+                    , [&m, &map, &found](std::uint64_t key)
+                    {
+                        cppthread::guard lock(m);
+                        if(map.find(key) != map.end())
+                        {
+                            found.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    , [&m, &map](std::uint64_t key)
+                    {
+                        cppthread::guard lock(m);
+                        map.emplace(key, key);
+                    }
+                    , [&m, &map](std::uint64_t key)
+                    {
+                        cppthread::guard lock(m);
+                        map.erase(key);
+                    });
+            }
+
+            {
+                cppthread::concurrent_map<std::uint64_t, std::uint64_t> map;
+                for(std::uint64_t k(0); k < KEYS; k += 2)
+                {
+                    map.insert(k, k);
+                }
+                std::atomic<std::uint64_t> found(0);
+
+                run_workload(
+                      ctx
+                    , "concurrent_map.mutex"
+                    , threads
+                    , per_thread
+                    , [&map, &found](std::uint64_t key)
+                    {
+                        std::uint64_t value(0);
+                        if(map.find(key, value))
+                        {
+                            found.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    , [&map](std::uint64_t key)
+                    {
+                        map.insert(key, key);
+                    }
+                    , [&map](std::uint64_t key)
+                    {
+                        map.erase(key);
+                    });
+            }
+
+            {
+                cppthread::concurrent_map<std::uint64_t, std::uint64_t, cppthread::spinlock> map;
+                for(std::uint64_t k(0); k < KEYS; k += 2)
+                {
+                    map.insert(k, k);
+                }
+                std::atomic<std::uint64_t> found(0);
+
+                run_workload(
+                      ctx
+                    , "concurrent_map.spinlock"
+                    , threads
+                    , per_thread
+                    , [&map, &found](std::uint64_t key)
+                    {
+                        std::uint64_t value(0);
+                        if(map.find(key, value))
+                        {
+                            found.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    , [&map](std::uint64_t key)
+                    {
+                        map.insert(key, key);
+                    }
+                    , [&map](std::uint64_t key)
+                    {
+                        map.erase(key);
+                    });
+            }
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,134 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the mutex and guard.
+ *
+ * The uncontended cases measure the raw cost of a lock/unlock pair. The
+ * contended cases have several threads incrementing one counter protected
+ * by a single mutex.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+cppthread_bench::registrar g_mutex_uncontended(
+      "mutex.uncontended"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(10'000'000));
+        cppthread::mutex m;
+
+        {
+            std::uint64_t const start(cppthread_bench::now_ns());
+            for(std::uint64_t i(0); i < count; ++i)
+            {
+                m.lock();
+                m.unlock();
+            }
+            cppthread_bench::result r;
+            r.f_name = "lock_unlock";
+            r.f_operations = count;
+            r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+            ctx.report(r);
+        }
+
+        {
+            std::uint64_t const start(cppthread_bench::now_ns());
+            for(std::uint64_t i(0); i < count; ++i)
+            {
+                if(m.try_lock())
+                {
+                    m.unlock();
+                }
+            }
+            cppthread_bench::result r;
+            r.f_name = "try_lock_unlock";
+            r.f_operations = count;
+            r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+            ctx.report(r);
+        }
+
+        {
+            std::uint64_t const start(cppthread_bench::now_ns());
+            for(std::uint64_t i(0); i < count; ++i)
+            {
+                cppthread::guard lock(m);
+            }
+            cppthread_bench::result r;
+            r.f_name = "guard";
+            r.f_operations = count;
+            r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+            ctx.report(r);
+        }
+    });
+
+
+cppthread_bench::registrar g_mutex_contended(
+      "mutex.contended"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(2'000'000));
+        for(auto const threads : cppthread_bench::thread_counts())
+        {
+            cppthread::mutex m;
+            std::uint64_t counter(0);
+            std::uint64_t const per_thread(count / threads);
+
+            cppthread_bench::result r;
+            r.f_name = "guard";
+            r.f_parameters["threads"] = threads;
+            r.f_operations = per_thread * threads;
+            r.f_elapsed_ns = cppthread_bench::run_in_threads(
+                  threads
+                , [&m, &counter, per_thread](std::size_t)
+                {
+                    for(std::uint64_t i(0); i < per_thread; ++i)
+                    {
+                        cppthread::guard lock(m);
+                        ++counter;
+                    }
+                });
+            ctx.report(r);
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
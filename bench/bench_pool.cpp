@@ -0,0 +1,150 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the pool of workers.
+ *
+ * The workers do nothing. What gets measured is the time it takes for a
+ * workload to go through the input fifo, a worker and the output fifo.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/pool.h>
+#include    <cppthread/worker.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+struct workload_t
+{
+    std::uint64_t       f_timestamp = 0;
+};
+
+
+class null_worker
+    : public cppthread::worker<workload_t>
+{
+public:
+    null_worker(
+              std::string const & name
+            , std::size_t position
+            , typename cppthread::fifo<workload_t>::pointer_t in
+            , typename cppthread::fifo<workload_t>::pointer_t out)
+        : worker<workload_t>(name, position, in, out)
+    {
+    }
+
+    virtual void enter() override
+    {
+    }
+
+    virtual void leave(cppthread::leave_status_t) override
+    {
+    }
+
+    virtual bool do_work() override
+    {
+        return true;
+    }
+};
+
+
+typedef cppthread::pool<null_worker>    pool_t;
+
+
+cppthread_bench::registrar g_pool_dispatch(
+      "pool.dispatch"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(200'000));
+        for(std::size_t const size : { 1, 2, 4 })
+        {
+            pool_t p(
+                  "bench-pool"
+                , size
+                , std::make_shared<pool_t::worker_fifo_t>()
+                , std::make_shared<pool_t::worker_fifo_t>());
+
+            // round trip: one workload at a time, this is the latency
+            //
+            {
+                std::uint64_t const round_trips(count / 10);
+                cppthread_bench::result r;
+                r.f_name = "round_trip";
+                r.f_parameters["workers"] = size;
+                r.f_operations = round_trips;
+                r.f_latencies.reserve(round_trips);
+                std::uint64_t const start(cppthread_bench::now_ns());
+                for(std::uint64_t i(0); i < round_trips; ++i)
+                {
+                    workload_t w;
+                    w.f_timestamp = cppthread_bench::now_ns();
+                    p.push_back(w);
+                    p.pop_front(w, -1);
+                    r.f_latencies.push_back(cppthread_bench::now_ns() - w.f_timestamp);
+                }
+                r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+                ctx.report(r);
+            }
+
+            // throughput: push everything, then retrieve everything
+            //
+            {
+                cppthread_bench::result r;
+                r.f_name = "throughput";
+                r.f_parameters["workers"] = size;
+                r.f_operations = count;
+                std::uint64_t const start(cppthread_bench::now_ns());
+                workload_t w;
+                for(std::uint64_t i(0); i < count; ++i)
+                {
+                    p.push_back(w);
+                }
+                for(std::uint64_t i(0); i < count; ++i)
+                {
+                    p.pop_front(w, -1);
+                }
+                r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+                ctx.report(r);
+            }
+
+            p.stop(false);
+            p.wait();
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,118 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the /proc helper functions.
+ *
+ * Several of the thread.h helper functions read files under /proc. These
+ * are system calls and string parsing so they are much slower than the
+ * other primitives. It is still useful to know how slow.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/thread.h>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+void time_function(
+      cppthread_bench::context & ctx
+    , std::string const & name
+    , std::uint64_t count
+    , std::function<void()> func)
+{
+    cppthread_bench::result r;
+    r.f_name = name;
+    std::uint64_t const start(cppthread_bench::now_ns());
+    for(std::uint64_t i(0); i < count; ++i)
+    {
+        func();
+    }
+    r.f_operations = count;
+    r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+    ctx.report(r);
+}
+
+
+cppthread_bench::registrar g_proc(
+      "proc"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(20'000));
+        pid_t const pid(getpid());
+        pid_t const tid(cppthread::gettid());
+
+        time_function(ctx, "gettid", count * 10, []()
+            {
+                cppthread::gettid();
+            });
+        time_function(ctx, "get_number_of_available_processors", count, []()
+            {
+                cppthread::get_number_of_available_processors();
+            });
+        time_function(ctx, "get_pid_max", count * 10, []()
+            {
+                cppthread::get_pid_max();
+            });
+        time_function(ctx, "get_thread_ids", count, []()
+            {
+                cppthread::get_thread_ids();
+            });
+        time_function(ctx, "get_thread_count", count, []()
+            {
+                cppthread::get_thread_count();
+            });
+        time_function(ctx, "is_process_running", count, [pid]()
+            {
+                cppthread::is_process_running(pid + 1);
+            });
+        time_function(ctx, "get_boot_id", count, []()
+            {
+                cppthread::get_boot_id();
+            });
+        time_function(ctx, "get_thread_name", count, [tid]()
+            {
+                cppthread::get_thread_name(tid);
+            });
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
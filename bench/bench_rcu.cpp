@@ -0,0 +1,138 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the rcu_ptr against a mutex.
+ *
+ * Several threads read a configuration while one thread updates it
+ * now and then. The same work is done with a mutex and with an rcu_ptr.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/rcu.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+struct config_t
+{
+    std::uint64_t       f_max_requests = 100;
+    std::uint64_t       f_period_ms = 1'000;
+    std::uint64_t       f_burst = 10;
+    std::string         f_name = "default";
+};
+
+
+cppthread_bench::registrar g_rcu_read(
+      "rcu.read"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(5'000'000));
+        for(auto const threads : cppthread_bench::thread_counts())
+        {
+            std::uint64_t const per_thread(count / threads);
+
+            {
+                cppthread::mutex m;
+                std::shared_ptr<config_t> config(std::make_shared<config_t>());
+                std::atomic<std::uint64_t> sum(0);
+
+                cppthread_bench::result r;
+                r.f_name = "mutex";
+                r.f_parameters["threads"] = threads;
+                r.f_operations = per_thread * threads;
+                r.f_elapsed_ns = cppthread_bench::run_in_threads(
+                      threads
+                    , [&m, &config, &sum, per_thread](std::size_t idx)
+                    {
+                        std::uint64_t total(0);
+                        for(std::uint64_t i(0); i < per_thread; ++i)
+                        {
+                            if(idx == 0 && (i & 1023) == 0)
+                            {
+                                std::shared_ptr<config_t> c(std::make_shared<config_t>());
+                                cppthread::guard lock(m);
+                                c->f_max_requests = config->f_max_requests + 1;
+                                config = c;
+                            }
+                            else
+                            {
+                                cppthread::guard lock(m);
+                                total += config->f_max_requests;
+                            }
+                        }
+                        sum += total;
+                    });
+                ctx.report(r);
+            }
+
+            {
+                cppthread::rcu_ptr<config_t> config(new config_t);
+                std::atomic<std::uint64_t> sum(0);
+
+                cppthread_bench::result r;
+                r.f_name = "rcu_ptr";
+                r.f_parameters["threads"] = threads;
+                r.f_operations = per_thread * threads;
+                r.f_elapsed_ns = cppthread_bench::run_in_threads(
+                      threads
+                    , [&config, &sum, per_thread](std::size_t idx)
+                    {
+                        std::uint64_t total(0);
+                        for(std::uint64_t i(0); i < per_thread; ++i)
+                        {
+                            if(idx == 0 && (i & 1023) == 0)
+                            {
+                                config.update([](config_t & c) { ++c.f_max_requests; });
+                            }
+                            else
+                            {
+                                cppthread::rcu_read_guard read_section;
+                                total += config->f_max_requests;
+                            }
+                        }
+                        sum += total;
+                    });
+                cppthread::rcu_synchronize();
+                ctx.report(r);
+            }
+        }
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
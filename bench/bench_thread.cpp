@@ -0,0 +1,96 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmarks of the thread start() and stop() functions.
+ *
+ * The runner returns immediately so what gets measured is the creation
+ * of the system thread, the renaming of the thread, and the join.
+ */
+
+// self
+//
+#include    "bench_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/thread.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+cppthread_bench::registrar g_thread_start_stop(
+      "thread.start_stop"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(2'000));
+
+        cppthread_bench::lambda_runner runner("bench-thread", []() {});
+        cppthread::thread t("bench-thread", &runner);
+
+        cppthread_bench::result r;
+        r.f_latencies.reserve(count);
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            std::uint64_t const s(cppthread_bench::now_ns());
+            t.start();
+            t.stop();
+            r.f_latencies.push_back(cppthread_bench::now_ns() - s);
+        }
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+cppthread_bench::registrar g_thread_create(
+      "thread.create_start_stop_destroy"
+    , [](cppthread_bench::context & ctx)
+    {
+        std::uint64_t const count(ctx.iterations(2'000));
+
+        cppthread_bench::lambda_runner runner("bench-thread", []() {});
+
+        cppthread_bench::result r;
+        std::uint64_t const start(cppthread_bench::now_ns());
+        for(std::uint64_t i(0); i < count; ++i)
+        {
+            cppthread::thread t("bench-thread", &runner);
+            t.start();
+        }
+        r.f_operations = count;
+        r.f_elapsed_ns = cppthread_bench::now_ns() - start;
+        ctx.report(r);
+    });
+
+
+
+} // no name namespace
+// vim: ts=4 sw=4 et
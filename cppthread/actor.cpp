@@ -0,0 +1,354 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the actor system.
+ *
+ * An actor is a component with its own state and a mailbox. Instead of
+ * giving each actor a thread, the actors with messages are pushed in
+ * the ready queue of a pool and one worker handles a batch of their
+ * messages.
+ */
+
+
+// self
+//
+#include    "cppthread/actor.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class actor_base
+ * \brief The base class of all the actors.
+ *
+ * This class holds what the actor_system needs to know about an actor:
+ * whether it is already scheduled and how to process its mailbox. The
+ * mailbox itself is typed and defined in the actor template.
+ *
+ * Actors must be allocated with std::make_shared<>() since they get
+ * scheduled using shared_from_this().
+ */
+
+
+/** \brief Initialize the actor.
+ *
+ * \param[in] system  The actor system running this actor.
+ */
+actor_base::actor_base(actor_system & system)
+    : f_system(system)
+{
+}
+
+
+/** \brief Clean up the actor.
+ */
+actor_base::~actor_base()
+{
+}
+
+
+/** \brief Get the actor system running this actor.
+ *
+ * \return A reference to the actor system.
+ */
+actor_system & actor_base::get_system() const
+{
+    return f_system;
+}
+
+
+/** \fn actor_base::process()
+ * \brief Handle the next messages of the mailbox.
+ *
+ * This function is called by one worker of the actor system. It is
+ * never called by two workers at the same time for the same actor.
+ */
+
+
+/** \brief Push this actor in the ready queue of its actor system.
+ *
+ * The caller must have set f_scheduled to true first, so the actor is
+ * never queued twice.
+ */
+void actor_base::schedule()
+{
+    f_system.schedule(shared_from_this());
+}
+
+
+
+/** \class actor_worker
+ * \brief The worker of the actor system pool.
+ *
+ * The work loads are the actors with pending messages.
+ */
+
+
+/** \brief Initialize the actor worker.
+ *
+ * \param[in] name  The name of the worker.
+ * \param[in] position  The position of the worker in the pool.
+ * \param[in] in  The ready queue of the actor system.
+ * \param[in] out  The output FIFO, always nullptr.
+ */
+actor_worker::actor_worker(
+          std::string const & name
+        , std::size_t position
+        , fifo<actor_base::pointer_t>::pointer_t in
+        , fifo<actor_base::pointer_t>::pointer_t out)
+    : worker<actor_base::pointer_t>(name, position, in, out)
+{
+}
+
+
+/** \brief Process one actor.
+ *
+ * \return Always false since the actors are not forwarded anywhere.
+ */
+bool actor_worker::do_work()
+{
+    f_workload->process();
+
+    // do not keep the actor alive until the next work load
+    //
+    f_workload.reset();
+
+    return false;
+}
+
+
+
+/** \class actor_system
+ * \brief Run many actors on a few threads.
+ *
+ * The actor system owns a pool of workers. When an actor receives a
+ * message while it is idle, it gets pushed in the ready queue of the
+ * pool. A worker then calls its process() function which handles up to
+ * actor_base::BATCH_SIZE messages. If more messages are waiting, the
+ * actor goes back at the end of the ready queue so the other actors get
+ * a turn.
+ *
+ * Since an actor is in the ready queue at most once, only one worker
+ * processes its mailbox at a time, so its handle() function does not
+ * need any lock to access the actor state.
+ *
+ * \code
+ *     class counter
+ *         : public cppthread::actor<int>
+ *     {
+ *     public:
+ *         counter(cppthread::actor_system & s) : actor<int>(s) {}
+ *
+ *         virtual void handle(int & n) override
+ *         {
+ *             f_total += n;
+ *         }
+ *
+ *     private:
+ *         std::int64_t f_total = 0;
+ *     };
+ *
+ *     cppthread::actor_system system("actors", 4);
+ *     auto c(std::make_shared<counter>(system));
+ *     c->send(5);
+ * \endcode
+ *
+ * An idle actor costs no thread and no queue entry, only its memory, so
+ * tens of thousands of actors can share a handful of workers.
+ */
+
+
+/** \brief Start the workers of the actor system.
+ *
+ * \param[in] name  The name of the pool.
+ * \param[in] workers  The number of worker threads.
+ */
+actor_system::actor_system(std::string const & name, std::size_t workers)
+    : f_ready(std::make_shared<actor_pool_t::worker_fifo_t>())
+    , f_pool(name, workers, f_ready, nullptr)
+{
+}
+
+
+/** \brief Stop the actor system.
+ *
+ * The actors already in the ready queue get processed once more, then
+ * the workers exit. Messages sent afterward are never handled.
+ */
+actor_system::~actor_system()
+{
+}
+
+
+/** \brief Queue an actor with pending messages.
+ *
+ * This function is called by the actors themselves.
+ *
+ * \param[in] a  The actor to queue.
+ */
+void actor_system::schedule(actor_base::pointer_t a)
+{
+    f_pool.push_back(a);
+}
+
+
+/** \brief Wait until all the mailboxes are empty.
+ *
+ * \param[in] usecs  The maximum number of microseconds to wait, -1 to
+ * wait forever.
+ *
+ * \return true if no actor has pending messages.
+ *
+ * \sa pool::drain()
+ */
+bool actor_system::drain(int64_t usecs)
+{
+    return f_pool.drain(usecs);
+}
+
+
+/** \brief Get the number of worker threads.
+ *
+ * \return The size of the pool.
+ */
+std::size_t actor_system::size() const
+{
+    return f_pool.size();
+}
+
+
+/** \typedef actor_system::actor_pool_t
+ * \brief The type of the pool running the actors.
+ */
+
+
+/** \var actor_system::f_ready
+ * \brief The queue of actors with pending messages.
+ */
+
+
+/** \var actor_system::f_pool
+ * \brief The workers processing the actors.
+ */
+
+
+/** \var actor_base::BATCH_SIZE
+ * \brief The maximum number of messages handled per turn.
+ */
+
+
+/** \var actor_base::f_lock
+ * \brief The lock protecting the mailbox and f_scheduled.
+ */
+
+
+/** \var actor_base::f_scheduled
+ * \brief Whether the actor is in the ready queue or being processed.
+ */
+
+
+/** \var actor_base::f_system
+ * \brief The actor system running this actor.
+ */
+
+
+
+/** \class actor
+ * \brief An actor receiving messages of type M.
+ *
+ * Derive from this class and implement handle(). Other threads and
+ * actors call send() to post messages. The messages are handled in the
+ * order they were sent, one at a time.
+ *
+ * \tparam M  The type of the messages.
+ */
+
+
+/** \fn actor::actor(actor_system & system)
+ * \brief Initialize the actor.
+ *
+ * \param[in] system  The actor system running this actor.
+ */
+
+
+/** \fn actor::send(M const & msg)
+ * \brief Post a message to this actor.
+ *
+ * The message is added to the mailbox. If the actor was idle, it gets
+ * pushed in the ready queue of its actor system.
+ *
+ * \param[in] msg  The message to post.
+ */
+
+
+/** \fn actor::mailbox_size() const
+ * \brief Get the number of messages waiting in the mailbox.
+ *
+ * \return The number of messages not yet handled.
+ */
+
+
+/** \fn actor::handle(M & msg)
+ * \brief Handle one message.
+ *
+ * This function is called by a worker of the actor system. Only one
+ * worker calls it at a time for a given actor, although not always the
+ * same one. Any exception escaping this function, including the ones
+ * not derived from std::exception, is logged and the next message gets
+ * handled.
+ *
+ * \param[in] msg  The message to handle.
+ */
+
+
+/** \fn actor::process()
+ * \brief Handle a batch of messages.
+ *
+ * The function handles up to BATCH_SIZE messages. If more are waiting,
+ * the actor is scheduled again; otherwise it becomes idle.
+ */
+
+
+/** \typedef actor::message_type
+ * \brief The type of the messages of this actor.
+ */
+
+
+/** \typedef actor::pointer_t
+ * \brief A shared pointer to this actor.
+ */
+
+
+/** \var actor::f_mailbox
+ * \brief The messages not yet handled.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
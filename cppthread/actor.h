@@ -0,0 +1,211 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Actors multiplexed on a pool.
+ *
+ * This file declares the actor_system, which owns a pool of workers, and
+ * the actor template, an object with a mailbox processed by one worker
+ * at a time.
+ */
+
+
+// self
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/log.h>
+#include    <cppthread/pool.h>
+#include    <cppthread/spinlock.h>
+#include    <cppthread/worker.h>
+
+
+// C++
+//
+#include    <deque>
+#include    <memory>
+#include    <string>
+
+
+
+namespace cppthread
+{
+
+
+
+class actor_system;
+
+
+class actor_base
+    : public std::enable_shared_from_this<actor_base>
+{
+public:
+    typedef std::shared_ptr<actor_base>     pointer_t;
+
+    static constexpr std::size_t const      BATCH_SIZE = 32;
+
+                        actor_base(actor_system & system);
+                        actor_base(actor_base const & rhs) = delete;
+    virtual             ~actor_base();
+
+    actor_base &        operator = (actor_base const & rhs) = delete;
+
+    actor_system &      get_system() const;
+    virtual void        process() = 0;
+
+protected:
+    void                schedule();
+
+    mutable spinlock    f_lock = spinlock();
+    bool                f_scheduled = false;
+
+private:
+    actor_system &      f_system;
+};
+
+
+class actor_worker
+    : public worker<actor_base::pointer_t>
+{
+public:
+                        actor_worker(
+                              std::string const & name
+                            , std::size_t position
+                            , fifo<actor_base::pointer_t>::pointer_t in
+                            , fifo<actor_base::pointer_t>::pointer_t out);
+
+    virtual bool        do_work() override;
+};
+
+
+class actor_system
+{
+public:
+    typedef pool<actor_worker>              actor_pool_t;
+
+                        actor_system(std::string const & name, std::size_t workers);
+                        actor_system(actor_system const & rhs) = delete;
+                        ~actor_system();
+
+    actor_system &      operator = (actor_system const & rhs) = delete;
+
+    void                schedule(actor_base::pointer_t a);
+    bool                drain(int64_t usecs = -1);
+    std::size_t         size() const;
+
+private:
+    actor_pool_t::worker_fifo_t::pointer_t
+                        f_ready;
+    actor_pool_t        f_pool;
+};
+
+
+template<class M>
+class actor
+    : public actor_base
+{
+public:
+    typedef M                               message_type;
+    typedef std::shared_ptr<actor<M>>       pointer_t;
+
+    actor(actor_system & system)
+        : actor_base(system)
+    {
+    }
+
+    void send(M const & msg)
+    {
+        {
+            guard lock(f_lock);
+            f_mailbox.push_back(msg);
+            if(f_scheduled)
+            {
+                return;
+            }
+            f_scheduled = true;
+        }
+        schedule();
+    }
+
+    std::size_t mailbox_size() const
+    {
+        guard lock(f_lock);
+        return f_mailbox.size();
+    }
+
+    virtual void handle(M & msg) = 0;
+
+    virtual void process() override
+    {
+        for(std::size_t count(0); count < BATCH_SIZE; ++count)
+        {
+            M msg;
+            {
+                guard lock(f_lock);
+                if(f_mailbox.empty())
+                {
+                    f_scheduled = false;
+                    return;
+                }
+                msg = std::move(f_mailbox.front());
+                f_mailbox.pop_front();
+            }
+            try
+            {
+                handle(msg);
+            }
+            catch(std::exception const & e)
+            {
+                log << log_level_t::error
+                    << "actor::handle() exited with an exception: "
+                    << e.what()
+                    << end;
+            }
+            catch(...)
+            {
+                // f_scheduled must be reset before leaving or the actor
+                // would never be scheduled again
+                //
+                log << log_level_t::error
+                    << "actor::handle() exited with an unknown exception (a.k.a. non-std::exception)."
+                    << end;
+            }
+        }
+
+        // give the other actors a chance before handling more messages
+        //
+        {
+            guard lock(f_lock);
+            if(f_mailbox.empty())
+            {
+                f_scheduled = false;
+                return;
+            }
+        }
+        schedule();
+    }
+
+private:
+    std::deque<M>       f_mailbox = std::deque<M>();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
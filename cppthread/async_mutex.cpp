@@ -0,0 +1,310 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the async_mutex.
+ *
+ * The async_mutex queues its waiters instead of blocking their thread.
+ * The unlock() function hands the mutex over to the first waiter.
+ */
+
+
+// self
+//
+#include    "cppthread/async_mutex.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/guard.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class async_mutex
+ * \brief A mutex which coroutines can wait on without blocking a thread.
+ *
+ * When the mutex is already locked, the coroutine trying to lock it is
+ * suspended and added to a queue. The unlock() function hands the mutex
+ * over to the first coroutine in that queue and pushes it back in its
+ * pool. The mutex is therefore fair: the coroutines get it in the order
+ * in which they asked for it.
+ *
+ * Contrary to a pthread mutex, the async_mutex is not owned by a thread
+ * so a coroutine can keep it locked across a `co_await` and unlock it
+ * from another worker.
+ *
+ * \code
+ *     cppthread::async_mutex g_cache_mutex;
+ *
+ *     cppthread::task<> refresh(cppthread::coroutine_pool & p)
+ *     {
+ *         cppthread::async_guard lock(co_await cppthread::async_scoped_lock(p, g_cache_mutex));
+ *         co_await load_cache(p);
+ *     }
+ * \endcode
+ *
+ * The waiter queue is protected by a spinlock held for a few
+ * instructions only.
+ *
+ * \warning
+ * The async_mutex is not recursive.
+ */
+
+
+/** \class async_mutex::waiter
+ * \brief The base class of the objects waiting on an async_mutex.
+ *
+ * The coroutine awaiters derive from this class. The ready() function
+ * is called once the waiter owns the mutex.
+ */
+
+
+/** \brief Clean up the waiter.
+ */
+async_mutex::waiter::~waiter()
+{
+}
+
+
+/** \fn async_mutex::waiter::ready()
+ * \brief Called when the mutex was handed over to this waiter.
+ *
+ * The function is called by the thread calling unlock(). It is expected
+ * to schedule the coroutine, not to run it.
+ */
+
+
+
+/** \brief Initialize the mutex.
+ *
+ * The mutex starts unlocked.
+ */
+async_mutex::async_mutex()
+{
+}
+
+
+/** \brief Lock the mutex if it is available.
+ *
+ * \return true if the mutex is now locked by the caller.
+ */
+bool async_mutex::try_lock()
+{
+    guard lock(f_lock);
+    if(f_locked)
+    {
+        return false;
+    }
+    f_locked = true;
+    return true;
+}
+
+
+/** \brief Lock the mutex or add \p w to the queue.
+ *
+ * If the mutex is available, it gets locked and the function returns
+ * true. Otherwise \p w is added at the end of the queue and the function
+ * returns false. Its ready() function gets called once it owns the mutex.
+ *
+ * \param[in] w  The waiter to queue.
+ *
+ * \return true if the mutex was locked immediately.
+ */
+bool async_mutex::lock_or_wait(waiter & w)
+{
+    guard lock(f_lock);
+    if(!f_locked)
+    {
+        f_locked = true;
+        return true;
+    }
+
+    w.f_next = nullptr;
+    if(f_tail == nullptr)
+    {
+        f_head = &w;
+    }
+    else
+    {
+        f_tail->f_next = &w;
+    }
+    f_tail = &w;
+    return false;
+}
+
+
+/** \brief Unlock the mutex.
+ *
+ * If a waiter is queued, the mutex remains locked and ownership goes to
+ * that waiter. This is what prevents a new caller from getting the mutex
+ * ahead of the queued waiters.
+ *
+ * \exception logic_error
+ * The mutex is not locked.
+ */
+void async_mutex::unlock()
+{
+    waiter * w(nullptr);
+    {
+        guard lock(f_lock);
+        if(!f_locked)
+        {
+            throw logic_error("async_mutex::unlock() called on an unlocked mutex.");
+        }
+        w = f_head;
+        if(w == nullptr)
+        {
+            f_locked = false;
+        }
+        else
+        {
+            f_head = w->f_next;
+            if(f_head == nullptr)
+            {
+                f_tail = nullptr;
+            }
+        }
+    }
+
+    if(w != nullptr)
+    {
+        w->ready();
+    }
+}
+
+
+/** \brief Check whether the mutex is locked.
+ *
+ * The value may already be out of date by the time the function returns.
+ *
+ * \return true if the mutex is locked.
+ */
+bool async_mutex::is_locked() const
+{
+    guard lock(f_lock);
+    return f_locked;
+}
+
+
+
+/** \class async_guard
+ * \brief Unlock an async_mutex on destruction.
+ *
+ * The guard is created by the async_scoped_lock() awaitable once the
+ * mutex is locked. It can be moved, for example out of a task.
+ */
+
+
+/** \brief Take over a locked mutex.
+ *
+ * The mutex must already be locked by the caller.
+ *
+ * \param[in] m  The locked mutex.
+ */
+async_guard::async_guard(async_mutex & m)
+    : f_mutex(&m)
+{
+}
+
+
+/** \brief Move the lock to a new guard.
+ *
+ * \param[in] rhs  The guard losing the lock.
+ */
+async_guard::async_guard(async_guard && rhs)
+    : f_mutex(rhs.f_mutex)
+{
+    rhs.f_mutex = nullptr;
+}
+
+
+/** \brief Unlock the mutex if still locked.
+ */
+async_guard::~async_guard()
+{
+    unlock();
+}
+
+
+/** \brief Unlock the mutex early.
+ *
+ * Calling this function more than once is fine.
+ */
+void async_guard::unlock()
+{
+    if(f_mutex != nullptr)
+    {
+        async_mutex * m(f_mutex);
+        f_mutex = nullptr;
+        m->unlock();
+    }
+}
+
+
+/** \brief Check whether this guard still holds the mutex.
+ *
+ * \return true until unlock() is called.
+ */
+bool async_guard::is_locked() const
+{
+    return f_mutex != nullptr;
+}
+
+
+/** \var async_mutex::waiter::f_next
+ * \brief The next waiter in the queue.
+ */
+
+
+/** \var async_mutex::f_lock
+ * \brief The spinlock protecting the other fields.
+ */
+
+
+/** \var async_mutex::f_locked
+ * \brief Whether the mutex is locked.
+ */
+
+
+/** \var async_mutex::f_head
+ * \brief The first waiter, the next owner of the mutex.
+ */
+
+
+/** \var async_mutex::f_tail
+ * \brief The last waiter, where new waiters get appended.
+ */
+
+
+/** \var async_guard::f_mutex
+ * \brief The locked mutex or nullptr once unlocked.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
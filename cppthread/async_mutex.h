@@ -0,0 +1,96 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Mutex for coroutines.
+ *
+ * This file declares the async_mutex and async_guard classes. The
+ * awaitables used to lock the mutex from a coroutine are found in
+ * coroutine.h.
+ */
+
+
+// self
+//
+#include    <cppthread/spinlock.h>
+
+
+
+namespace cppthread
+{
+
+
+
+class async_mutex
+{
+public:
+    class waiter
+    {
+    public:
+        virtual             ~waiter();
+
+        virtual void        ready() = 0;
+
+    private:
+        friend class async_mutex;
+
+        waiter *            f_next = nullptr;
+    };
+
+                        async_mutex();
+                        async_mutex(async_mutex const & rhs) = delete;
+
+    async_mutex &       operator = (async_mutex const & rhs) = delete;
+
+    bool                try_lock();
+    bool                lock_or_wait(waiter & w);
+    void                unlock();
+    bool                is_locked() const;
+
+private:
+    mutable spinlock    f_lock = spinlock();
+    bool                f_locked = false;
+    waiter *            f_head = nullptr;
+    waiter *            f_tail = nullptr;
+};
+
+
+
+class async_guard
+{
+public:
+                        async_guard(async_mutex & m);
+                        async_guard(async_guard && rhs);
+                        async_guard(async_guard const & rhs) = delete;
+                        ~async_guard();
+
+    async_guard &       operator = (async_guard const & rhs) = delete;
+
+    void                unlock();
+    bool                is_locked() const;
+
+private:
+    async_mutex *       f_mutex = nullptr;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
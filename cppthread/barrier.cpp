@@ -0,0 +1,229 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the barrier.
+ *
+ * The barrier blocks a group of threads until all of them reached the
+ * same point, then lets them all go and gets ready for the next phase.
+ */
+
+
+// self
+//
+#include    "cppthread/barrier.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/futex.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Decrement applied by one thread arriving at the barrier.
+ *
+ * The low 32 bits of the state are the number of threads which still
+ * have to arrive in this phase.
+ */
+constexpr std::uint64_t const   ARRIVE = 1;
+
+
+/** \brief Decrement applied by one thread leaving the group.
+ *
+ * The high 32 bits of the state are the number of threads expected in
+ * the following phases. Dropping out counts as an arrival and removes
+ * the thread from the group.
+ */
+constexpr std::uint64_t const   DROP = (static_cast<std::uint64_t>(1) << 32) + ARRIVE;
+
+
+std::uint64_t make_state(std::uint32_t count)
+{
+    return (static_cast<std::uint64_t>(count) << 32) | count;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class barrier
+ * \brief Synchronize a group of threads working in phases.
+ *
+ * A barrier is created with the number of threads in the group. Each
+ * thread calls arrive_and_wait() at the end of a phase. The call blocks
+ * until all the threads of the group arrived. Then the optional
+ * completion function is called once and all the threads are released
+ * at the same time. The barrier is then ready for the next phase.
+ *
+ * \code
+ *     cppthread::barrier sync(workers.size(), [&]() { swap_buffers(); });
+ *
+ *     // in each worker
+ *     for(;;)
+ *     {
+ *         compute_my_part();
+ *         sync.arrive_and_wait();
+ *     }
+ * \endcode
+ *
+ * Only the last thread to arrive calls the kernel to wake up the others.
+ */
+
+
+
+/** \brief Initialize the barrier.
+ *
+ * \exception invalid_error
+ * The count must be at least 1.
+ *
+ * \param[in] count  The number of threads in the group.
+ * \param[in] completion  A function called by the last thread arriving in
+ * each phase, before the other threads are released. It must not throw.
+ */
+barrier::barrier(std::uint32_t count, completion_t completion)
+    : f_state(make_state(count))
+    , f_completion(completion)
+{
+    if(count == 0)
+    {
+        throw invalid_error("a barrier must be created with a count of at least 1.");
+    }
+}
+
+
+/** \brief Arrive at the barrier and wait for the other threads.
+ *
+ * The function returns once all the threads of the group arrived and
+ * the completion function returned.
+ */
+void barrier::arrive_and_wait()
+{
+    std::uint32_t const phase(f_phase.load(std::memory_order_acquire));
+    if(arrive(ARRIVE))
+    {
+        return;
+    }
+
+    while(f_phase.load(std::memory_order_acquire) == phase)
+    {
+        detail::futex_wait(f_phase, phase);
+    }
+}
+
+
+/** \brief Arrive at the barrier and leave the group.
+ *
+ * The function does not wait. The other threads of the group no longer
+ * wait for this thread, starting with the current phase.
+ */
+void barrier::arrive_and_drop()
+{
+    arrive(DROP);
+}
+
+
+/** \brief Get the current phase.
+ *
+ * The phase is incremented each time all the threads arrived.
+ *
+ * \return The number of completed phases.
+ */
+std::uint32_t barrier::phase() const
+{
+    return f_phase.load(std::memory_order_acquire);
+}
+
+
+/** \brief Register the arrival of a thread.
+ *
+ * If the thread is the last one to arrive, it runs the completion
+ * function, resets the barrier, and wakes up the other threads.
+ *
+ * \param[in] decrement  ARRIVE or DROP.
+ *
+ * \return true if this thread completed the phase.
+ */
+bool barrier::arrive(std::uint64_t decrement)
+{
+    std::uint64_t const state(f_state.fetch_sub(decrement, std::memory_order_acq_rel) - decrement);
+    if(static_cast<std::uint32_t>(state) != 0)
+    {
+        return false;
+    }
+
+    if(f_completion != nullptr)
+    {
+        f_completion();
+    }
+
+    // nobody else can touch the state until the phase changes
+    //
+    f_state.store(make_state(static_cast<std::uint32_t>(state >> 32)), std::memory_order_relaxed);
+    f_phase.fetch_add(1, std::memory_order_release);
+    detail::futex_wake(f_phase);
+
+    return true;
+}
+
+
+/** \typedef barrier::completion_t
+ * \brief The type of the function called at the end of each phase.
+ */
+
+
+/** \var barrier::f_state
+ * \brief The number of expected and remaining threads.
+ *
+ * The high 32 bits are the number of threads in the group and the low
+ * 32 bits the number of threads which did not yet arrive in the current
+ * phase. Keeping both in one word lets arrive_and_drop() update them
+ * atomically.
+ */
+
+
+/** \var barrier::f_phase
+ * \brief The phase counter.
+ *
+ * This is also the word the waiting threads sleep on.
+ */
+
+
+/** \var barrier::f_completion
+ * \brief The function called at the end of each phase.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,68 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Reusable thread barrier.
+ *
+ * This file declares the barrier class.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+#include    <functional>
+
+
+
+namespace cppthread
+{
+
+
+
+class barrier
+{
+public:
+    typedef std::function<void()>   completion_t;
+
+                        barrier(std::uint32_t count, completion_t completion = completion_t());
+                        barrier(barrier const & rhs) = delete;
+
+    barrier &           operator = (barrier const & rhs) = delete;
+
+    void                arrive_and_wait();
+    void                arrive_and_drop();
+    std::uint32_t       phase() const;
+
+private:
+    bool                arrive(std::uint64_t decrement);
+
+    std::atomic<std::uint64_t>
+                        f_state;
+    std::atomic<std::uint32_t>
+                        f_phase = 0;
+    completion_t        f_completion = completion_t();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,169 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Documentation of the channel.h file.
+ *
+ * The channel.h file is a template so we document that template
+ * here.
+ *
+ * A runner consuming from several fifos used to poll each of them in
+ * turn. The select() function instead registers a waiter in each one
+ * and sleeps until the first one has an item.
+ */
+
+#error "Documentation only file, do not compile."
+
+namespace cppthread
+{
+
+
+
+/** \class channel
+ * \brief A typed channel.
+ *
+ * A channel is a fifo with names closer to the Go channels. Closing a
+ * channel is the same as calling fifo::done(false): nothing more can
+ * be sent and the receivers get the items already sent before they
+ * are told the channel is closed.
+ *
+ * Since a channel is a fifo, it can also be used as the input of a pool.
+ *
+ * \note
+ * The channel is not bounded; send() never blocks.
+ *
+ * \tparam T  The type of the items.
+ */
+
+
+/** \fn channel::send(T const & v)
+ * \brief Send an item.
+ *
+ * \param[in] v  The item to send.
+ *
+ * \return false if the channel is closed.
+ */
+
+
+/** \fn channel::receive(T & v, int64_t const usecs)
+ * \brief Receive an item.
+ *
+ * \param[out] v  The item received.
+ * \param[in] usecs  The number of microseconds to wait, -1 to wait forever.
+ *
+ * \return true if an item was received, false on a timeout or once the
+ * channel is closed and empty.
+ */
+
+
+/** \fn channel::close()
+ * \brief Close the channel.
+ *
+ * The receivers blocked in receive() or select() are woken up once the
+ * channel is empty.
+ */
+
+
+/** \fn channel::is_closed() const
+ * \brief Check whether the channel was closed.
+ *
+ * \return true once close() was called.
+ */
+
+
+/** \typedef channel::pointer_t
+ * \brief A shared pointer to a channel.
+ */
+
+
+/** \enum receive_status_t
+ * \brief The result of a non-blocking receive in select().
+ */
+
+
+/** \class select_status
+ * \brief The result of select().
+ *
+ * The index() is the position of the case which completed, starting at
+ * zero. It is -1 when select() timed out. If received() is false, that
+ * case's channel is closed and empty.
+ */
+
+
+/** \class receive_case
+ * \brief One receive case of a select().
+ *
+ * Create it with on_receive(). The case registers a waiter in its fifo
+ * while select() sleeps.
+ *
+ * \tparam T  The type of the items.
+ */
+
+
+/** \fn on_receive(fifo<T> & f, T & v)
+ * \brief Create a receive case for select().
+ *
+ * \param[in] f  The fifo or channel to receive from.
+ * \param[out] v  Where the item gets saved.
+ *
+ * \return The receive case.
+ */
+
+
+/** \fn select(int64_t usecs, C && ... cases)
+ * \brief Receive from whichever channel is ready first.
+ *
+ * The function first checks each case in order without waiting. If none
+ * is ready, it registers a waiter in each fifo. The waiters share one
+ * state and the first fifo to claim it hands over its item; the other
+ * fifos skip that waiter. So exactly one item is received and no item
+ * gets lost. Then the function removes the remaining waiters.
+ *
+ * \code
+ *     request r;
+ *     control c;
+ *     for(;;)
+ *     {
+ *         cppthread::select_status const s(cppthread::select(
+ *                   -1
+ *                 , cppthread::on_receive(requests, r)
+ *                 , cppthread::on_receive(controls, c)));
+ *         if(!s.received())
+ *         {
+ *             break;      // one channel was closed
+ *         }
+ *         ...
+ *     }
+ * \endcode
+ *
+ * Like with Go, a closed channel is always ready, so a caller which
+ * wants to continue with the other channels must stop including it.
+ * When several cases are ready at once, the first one wins.
+ *
+ * \param[in] usecs  The number of microseconds to wait: -1 waits forever
+ * and 0 does not wait.
+ * \param[in] cases  The receive cases created with on_receive().
+ *
+ * \return The index of the case which completed, or -1 on a timeout.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
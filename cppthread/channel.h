@@ -0,0 +1,357 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Typed channels and select().
+ *
+ * This file declares the channel template and the select() function
+ * which waits on several channels (or fifos) at once.
+ */
+
+
+// self
+//
+#include    <cppthread/fifo.h>
+#include    <cppthread/futex.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <memory>
+
+
+
+namespace cppthread
+{
+
+
+
+template<class T>
+class channel
+    : public fifo<T>
+{
+public:
+    typedef std::shared_ptr<channel<T>>     pointer_t;
+
+    bool send(T const & v)
+    {
+        return this->push_back(v);
+    }
+
+    bool receive(T & v, int64_t const usecs = -1)
+    {
+        return this->pop_front(v, usecs);
+    }
+
+    void close()
+    {
+        this->done(false);
+    }
+
+    bool is_closed() const
+    {
+        return this->is_done();
+    }
+};
+
+
+
+enum class receive_status_t
+{
+    RECEIVE_STATUS_EMPTY,
+    RECEIVE_STATUS_RECEIVED,
+    RECEIVE_STATUS_CLOSED,
+};
+
+
+class select_status
+{
+public:
+    select_status(int index = -1, bool received = false)
+        : f_index(index)
+        , f_received(received)
+    {
+    }
+
+    int index() const
+    {
+        return f_index;
+    }
+
+    bool received() const
+    {
+        return f_received;
+    }
+
+    bool timed_out() const
+    {
+        return f_index < 0;
+    }
+
+private:
+    int                 f_index = -1;
+    bool                f_received = false;
+};
+
+
+
+namespace detail
+{
+
+
+
+class select_state
+{
+public:
+    static constexpr int const  NO_WINNER = -1;
+    static constexpr int const  TIMED_OUT = -2;
+
+    bool claim(int index)
+    {
+        int expected(NO_WINNER);
+        return f_winner.compare_exchange_strong(expected, index, std::memory_order_acq_rel);
+    }
+
+    int winner() const
+    {
+        return f_winner.load(std::memory_order_acquire);
+    }
+
+    void ready()
+    {
+        f_ready.store(1, std::memory_order_release);
+        futex_wake(f_ready);
+    }
+
+    bool wait(std::chrono::steady_clock::time_point const * deadline)
+    {
+        while(f_ready.load(std::memory_order_acquire) == 0)
+        {
+            if(!futex_wait(f_ready, 0, deadline))
+            {
+                return f_ready.load(std::memory_order_acquire) != 0;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::atomic<int>    f_winner = NO_WINNER;
+    std::atomic<std::uint32_t>
+                        f_ready = 0;
+};
+
+
+class select_case
+{
+public:
+    virtual             ~select_case()
+    {
+    }
+
+    virtual receive_status_t
+                        try_receive() = 0;
+    virtual bool        start_wait(select_state & state, int index) = 0;
+    virtual void        cancel_wait() = 0;
+    virtual bool        finish_wait() = 0;
+};
+
+
+
+} // namespace detail
+
+
+
+template<class T>
+class receive_case
+    : public detail::select_case
+{
+public:
+    receive_case(fifo<T> & f, T & v)
+        : f_fifo(f)
+        , f_value(v)
+    {
+    }
+
+    virtual receive_status_t try_receive() override
+    {
+        if(f_fifo.pop_front(f_value, 0))
+        {
+            return receive_status_t::RECEIVE_STATUS_RECEIVED;
+        }
+        if(f_fifo.is_done())
+        {
+            return receive_status_t::RECEIVE_STATUS_CLOSED;
+        }
+        return receive_status_t::RECEIVE_STATUS_EMPTY;
+    }
+
+    virtual bool start_wait(detail::select_state & state, int index) override
+    {
+        f_waiter.set_state(&state, index);
+        f_registered = true;
+        return f_fifo.pop_front_or_wait(f_waiter);
+    }
+
+    virtual void cancel_wait() override
+    {
+        if(f_registered)
+        {
+            f_fifo.cancel_wait(f_waiter);
+        }
+    }
+
+    virtual bool finish_wait() override
+    {
+        return f_waiter.finish(f_value);
+    }
+
+private:
+    class waiter
+        : public fifo<T>::pop_waiter
+    {
+    public:
+        void set_state(detail::select_state * state, int index)
+        {
+            f_state = state;
+            f_index = index;
+        }
+
+        virtual bool claim() override
+        {
+            return f_state->claim(f_index);
+        }
+
+        virtual void ready() override
+        {
+            f_state->ready();
+        }
+
+        bool finish(T & v)
+        {
+            if(this->f_popped)
+            {
+                v = std::move(this->f_item);
+            }
+            return this->f_popped;
+        }
+
+    private:
+        detail::select_state *  f_state = nullptr;
+        int                     f_index = -1;
+    };
+
+    fifo<T> &           f_fifo;
+    T &                 f_value;
+    waiter              f_waiter = waiter();
+    bool                f_registered = false;
+};
+
+
+template<class T>
+receive_case<T> on_receive(fifo<T> & f, T & v)
+{
+    return receive_case<T>(f, v);
+}
+
+
+template<class ...C>
+select_status select(int64_t usecs, C && ... cases)
+{
+    static_assert(sizeof...(C) > 0, "select() needs at least one case.");
+
+    detail::select_case * list[] = { &cases... };
+    int const count(static_cast<int>(sizeof...(C)));
+
+    // first check whether a case is ready without registering anything
+    //
+    for(int idx(0); idx < count; ++idx)
+    {
+        switch(list[idx]->try_receive())
+        {
+        case receive_status_t::RECEIVE_STATUS_RECEIVED:
+            return select_status(idx, true);
+
+        case receive_status_t::RECEIVE_STATUS_CLOSED:
+            return select_status(idx, false);
+
+        case receive_status_t::RECEIVE_STATUS_EMPTY:
+            break;
+
+        }
+    }
+    if(usecs == 0)
+    {
+        return select_status();
+    }
+
+    std::chrono::steady_clock::time_point deadline;
+    if(usecs > 0)
+    {
+        deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(usecs);
+    }
+
+    // register one waiter per case; all share the same state so only
+    // the first case to become ready gets claimed
+    //
+    detail::select_state state;
+    int registered(0);
+    bool notified(true);
+    while(registered < count)
+    {
+        int const idx(registered);
+        ++registered;
+        if(list[idx]->start_wait(state, idx))
+        {
+            // if this case won right away, its fifo does not call ready()
+            //
+            notified = state.winner() != idx;
+            break;
+        }
+    }
+
+    if(notified
+    && !state.wait(usecs < 0 ? nullptr : &deadline)
+    && !state.claim(detail::select_state::TIMED_OUT))
+    {
+        // a case was claimed just as we timed out, wait for its ready()
+        //
+        state.wait(nullptr);
+    }
+
+    for(int idx(0); idx < registered; ++idx)
+    {
+        list[idx]->cancel_wait();
+    }
+
+    int const winner(state.winner());
+    if(winner < 0)
+    {
+        return select_status();
+    }
+    return select_status(winner, list[winner]->finish_wait());
+}
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
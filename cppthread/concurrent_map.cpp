@@ -0,0 +1,295 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Documentation of the concurrent_map.h file.
+ *
+ * The concurrent_map.h file is a template so we document that template
+ * here.
+ *
+ * A map shared between many threads and protected by a single mutex
+ * quickly becomes the main contention point of a process. The
+ * concurrent_map splits the map in shards, each with its own lock.
+ */
+
+#error "Documentation only file, do not compile."
+
+namespace cppthread
+{
+
+
+
+/** \class concurrent_map
+ * \brief A hash map which many threads can access at once.
+ *
+ * The map is split in a fixed number of shards. Each key belongs to one
+ * shard determined by its hash. A shard is an std::unordered_map with
+ * its own lock. Threads accessing keys in different shards do not
+ * contend with each other.
+ *
+ * Each shard grows on its own, so a rehash only blocks the threads
+ * accessing that one shard instead of the whole map.
+ *
+ * The functions lock the shard internally so the caller does not need
+ * any guard:
+ *
+ * \code
+ *     cppthread::concurrent_map<std::string, session::pointer_t> g_sessions;
+ *
+ *     g_sessions.insert(id, s);
+ *
+ *     session::pointer_t s;
+ *     if(g_sessions.find(id, s))
+ *     {
+ *         ...
+ *     }
+ *
+ *     g_sessions.upsert(ip, [](counter_t & c) { ++c.f_hits; });
+ * \endcode
+ *
+ * Since another thread may modify or erase an entry at any time, the
+ * map never returns a reference to a value. The find() function returns
+ * a copy and the update() and upsert() functions give access to the
+ * value while the shard is locked. The callbacks must be short and must
+ * not access the same map.
+ *
+ * The functions working on the whole map (size(), empty(), for_each(),
+ * clear(), reserve()) lock one shard at a time, so the result is not a
+ * snapshot of the map when other threads modify it at the same time.
+ *
+ * \tparam K  The type of the keys.
+ * \tparam V  The type of the values.
+ * \tparam L  The type of lock protecting each shard; it must derive from
+ * lockable. The spinlock is faster when values are cheap to copy.
+ * \tparam H  The hash function.
+ * \tparam E  The key comparison function.
+ */
+
+
+/** \fn concurrent_map::concurrent_map(std::size_t shards)
+ * \brief Initialize the map.
+ *
+ * The number of shards should be several times the number of threads
+ * accessing the map to keep the probability of contention low.
+ *
+ * \exception invalid_error
+ * The number of shards must be a power of two.
+ *
+ * \param[in] shards  The number of shards.
+ */
+
+
+/** \fn concurrent_map::concurrent_map(concurrent_map const & rhs)
+ * \brief The copy operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ */
+
+
+/** \fn concurrent_map & concurrent_map::operator = (concurrent_map const & rhs)
+ * \brief The assignment operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ *
+ * \return A reference to this object.
+ */
+
+
+/** \fn std::size_t concurrent_map::shards() const
+ * \brief Get the number of shards.
+ *
+ * \return The number of shards defined on construction.
+ */
+
+
+/** \fn bool concurrent_map::insert(K const & key, V const & value)
+ * \brief Insert a new entry.
+ *
+ * If the key already exists, the map is not modified.
+ *
+ * \param[in] key  The key of the new entry.
+ * \param[in] value  The value of the new entry.
+ *
+ * \return true if the entry was inserted.
+ */
+
+
+/** \fn bool concurrent_map::insert_or_assign(K const & key, V const & value)
+ * \brief Insert or replace an entry.
+ *
+ * \param[in] key  The key of the entry.
+ * \param[in] value  The new value.
+ *
+ * \return true if the entry was inserted, false if it was replaced.
+ */
+
+
+/** \fn bool concurrent_map::find(K const & key, V & value) const
+ * \brief Search for an entry.
+ *
+ * \param[in] key  The key to search.
+ * \param[out] value  A copy of the value if the key exists.
+ *
+ * \return true if the key was found and \p value set.
+ */
+
+
+/** \fn bool concurrent_map::contains(K const & key) const
+ * \brief Check whether an entry exists.
+ *
+ * \param[in] key  The key to search.
+ *
+ * \return true if the key exists.
+ */
+
+
+/** \fn bool concurrent_map::erase(K const & key)
+ * \brief Remove an entry.
+ *
+ * \param[in] key  The key of the entry to remove.
+ *
+ * \return true if an entry was removed.
+ */
+
+
+/** \fn bool concurrent_map::update(K const & key, F f)
+ * \brief Modify an existing entry in place.
+ *
+ * If the key exists, \p f is called with a reference to its value while
+ * the shard is locked.
+ *
+ * \tparam F  A function or lambda taking a V reference.
+ * \param[in] key  The key of the entry to modify.
+ * \param[in] f  The function modifying the value.
+ *
+ * \return true if the key exists and \p f was called.
+ */
+
+
+/** \fn void concurrent_map::upsert(K const & key, F f)
+ * \brief Modify an entry, creating it if necessary.
+ *
+ * If the key does not exist yet, it is inserted with a default value.
+ * Then \p f is called with a reference to the value while the shard is
+ * locked.
+ *
+ * \tparam F  A function or lambda taking a V reference.
+ * \param[in] key  The key of the entry to modify.
+ * \param[in] f  The function modifying the value.
+ */
+
+
+/** \fn void concurrent_map::for_each(F f) const
+ * \brief Call a function with each entry.
+ *
+ * The shards are locked one after the other while \p f is called with
+ * their entries.
+ *
+ * \tparam F  A function or lambda taking a key and a value.
+ * \param[in] f  The function to call.
+ */
+
+
+/** \fn std::size_t concurrent_map::size() const
+ * \brief Count the number of entries.
+ *
+ * \return The number of entries in all the shards.
+ */
+
+
+/** \fn bool concurrent_map::empty() const
+ * \brief Check whether the map is empty.
+ *
+ * \return true if no shard has any entry.
+ */
+
+
+/** \fn void concurrent_map::clear()
+ * \brief Remove all the entries.
+ */
+
+
+/** \fn void concurrent_map::reserve(std::size_t count)
+ * \brief Make room for a number of entries.
+ *
+ * Each shard reserves room for its share of \p count entries so it does
+ * not need to rehash while the map grows.
+ *
+ * \param[in] count  The expected number of entries.
+ */
+
+
+/** \fn concurrent_map::shard_t & concurrent_map::get_shard(K const & key) const
+ * \brief Find the shard of a key.
+ *
+ * The hash of the key is mixed so the shard uses different bits than the
+ * buckets of the shard's unordered_map.
+ *
+ * \param[in] key  The key to search.
+ *
+ * \return The shard of \p key.
+ */
+
+
+/** \typedef concurrent_map::key_t
+ * \brief The type of the keys.
+ */
+
+
+/** \typedef concurrent_map::value_t
+ * \brief The type of the values.
+ */
+
+
+/** \typedef concurrent_map::lock_t
+ * \brief The type of lock used in each shard.
+ */
+
+
+/** \typedef concurrent_map::map_t
+ * \brief The type of map used in each shard.
+ */
+
+
+/** \var concurrent_map::DEFAULT_SHARDS
+ * \brief The default number of shards.
+ */
+
+
+/** \var concurrent_map::f_shards
+ * \brief The array of shards.
+ *
+ * Each shard is aligned on a cache line so threads working on
+ * different shards do not share cache lines.
+ */
+
+
+/** \var concurrent_map::f_count
+ * \brief The number of shards.
+ */
+
+
+/** \var concurrent_map::f_shift_bits
+ * \brief The number of hash bits used to select a shard.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,241 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Hash map shared between threads.
+ *
+ * This file includes the declaration and implementation of the
+ * concurrent_map template. The documentation is found in
+ * concurrent_map.cpp.
+ */
+
+
+// self
+//
+#include    <cppthread/exception.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <functional>
+#include    <memory>
+#include    <type_traits>
+#include    <unordered_map>
+
+
+
+namespace cppthread
+{
+
+
+
+template<
+      class K
+    , class V
+    , class L = mutex
+    , class H = std::hash<K>
+    , class E = std::equal_to<K>>
+class concurrent_map
+{
+public:
+    static_assert(std::is_base_of_v<lockable, L>, "concurrent_map<K, V, L> requires a lockable type L.");
+
+    typedef K                   key_t;
+    typedef V                   value_t;
+    typedef L                   lock_t;
+
+    static constexpr std::size_t const  DEFAULT_SHARDS = 64;
+
+    concurrent_map(std::size_t shards = DEFAULT_SHARDS)
+    {
+        if(shards == 0 || (shards & (shards - 1)) != 0)
+        {
+            throw invalid_error("the number of shards in a concurrent_map must be a power of two.");
+        }
+        f_shards = std::make_unique<shard_t[]>(shards);
+        f_count = shards;
+        while((static_cast<std::size_t>(1) << f_shift_bits) < shards)
+        {
+            ++f_shift_bits;
+        }
+    }
+
+    concurrent_map(concurrent_map const & rhs) = delete;
+    concurrent_map & operator = (concurrent_map const & rhs) = delete;
+
+    std::size_t shards() const
+    {
+        return f_count;
+    }
+
+    bool insert(K const & key, V const & value)
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        return s.f_map.emplace(key, value).second;
+    }
+
+    bool insert_or_assign(K const & key, V const & value)
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        return s.f_map.insert_or_assign(key, value).second;
+    }
+
+    bool find(K const & key, V & value) const
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        auto const it(s.f_map.find(key));
+        if(it == s.f_map.end())
+        {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    bool contains(K const & key) const
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        return s.f_map.find(key) != s.f_map.end();
+    }
+
+    bool erase(K const & key)
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        return s.f_map.erase(key) != 0;
+    }
+
+    template<class F>
+    bool update(K const & key, F f)
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        auto it(s.f_map.find(key));
+        if(it == s.f_map.end())
+        {
+            return false;
+        }
+        f(it->second);
+        return true;
+    }
+
+    template<class F>
+    void upsert(K const & key, F f)
+    {
+        shard_t & s(get_shard(key));
+        guard lock(s.f_lock);
+        f(s.f_map[key]);
+    }
+
+    template<class F>
+    void for_each(F f) const
+    {
+        for(std::size_t idx(0); idx < f_count; ++idx)
+        {
+            shard_t & s(f_shards[idx]);
+            guard lock(s.f_lock);
+            for(auto const & it : s.f_map)
+            {
+                f(it.first, it.second);
+            }
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t result(0);
+        for(std::size_t idx(0); idx < f_count; ++idx)
+        {
+            shard_t & s(f_shards[idx]);
+            guard lock(s.f_lock);
+            result += s.f_map.size();
+        }
+        return result;
+    }
+
+    bool empty() const
+    {
+        for(std::size_t idx(0); idx < f_count; ++idx)
+        {
+            shard_t & s(f_shards[idx]);
+            guard lock(s.f_lock);
+            if(!s.f_map.empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        for(std::size_t idx(0); idx < f_count; ++idx)
+        {
+            shard_t & s(f_shards[idx]);
+            guard lock(s.f_lock);
+            s.f_map.clear();
+        }
+    }
+
+    void reserve(std::size_t count)
+    {
+        std::size_t const per_shard((count + f_count - 1) / f_count);
+        for(std::size_t idx(0); idx < f_count; ++idx)
+        {
+            shard_t & s(f_shards[idx]);
+            guard lock(s.f_lock);
+            s.f_map.reserve(per_shard);
+        }
+    }
+
+private:
+    typedef std::unordered_map<K, V, H, E>  map_t;
+
+    struct alignas(64) shard_t
+    {
+        L                       f_lock = L();
+        map_t                   f_map = map_t();
+    };
+
+    shard_t & get_shard(K const & key) const
+    {
+        // mix the hash so the shard does not depend on the same bits as
+        // the bucket within the shard's map
+        //
+        std::uint64_t const h(static_cast<std::uint64_t>(H()(key)) * 0x9E3779B97F4A7C15ULL);
+        return f_shards[f_shift_bits == 0 ? 0 : h >> (64 - f_shift_bits)];
+    }
+
+    std::unique_ptr<shard_t[]>  f_shards = std::unique_ptr<shard_t[]>();
+    std::size_t                 f_count = 0;
+    std::size_t                 f_shift_bits = 0;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,327 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Documentation of the coroutine.h file.
+ *
+ * The coroutine.h file is a template so we document that template
+ * here.
+ *
+ * A coroutine which waits for a timer, a fifo or a mutex suspends
+ * instead of blocking its thread. This lets a few pool workers run
+ * thousands of such operations at the same time.
+ */
+
+#error "Documentation only file, do not compile."
+
+namespace cppthread
+{
+
+
+
+/** \class task
+ * \brief A coroutine returning a value of type T.
+ *
+ * A function returning a task<T> is a coroutine. It does not start
+ * running until it gets awaited with `co_await`, passed to spawn(), or
+ * passed to sync_wait(). The awaiting coroutine is resumed when the task
+ * returns, on whatever thread the task was running at the time.
+ *
+ * \code
+ *     cppthread::task<std::string> load(cppthread::coroutine_pool & p, std::string key)
+ *     {
+ *         co_await cppthread::schedule_on(p);
+ *         ...
+ *         co_return value;
+ *     }
+ *
+ *     cppthread::task<> handle(cppthread::coroutine_pool & p, request r)
+ *     {
+ *         std::string const value(co_await load(p, r.key()));
+ *         ...
+ *     }
+ * \endcode
+ *
+ * An exception escaping the coroutine is saved and rethrown by the
+ * `co_await` expression (or the sync_wait() call) of the caller.
+ *
+ * The task object owns the coroutine frame. It must stay alive until
+ * the coroutine returned.
+ *
+ * \tparam T  The type of the value returned by the coroutine.
+ */
+
+
+/** \class task::awaiter
+ * \brief The object used by `co_await` to run a task.
+ *
+ * The awaiter starts the task with symmetric transfer and returns its
+ * result once it completed.
+ */
+
+
+/** \class task::ready_awaiter
+ * \brief An awaiter which only waits for the task to complete.
+ *
+ * Contrary to the awaiter, this one does not retrieve the result, so
+ * it never throws. Call task::result() later to get the result.
+ */
+
+
+/** \fn task::task(handle_t h)
+ * \brief Take ownership of a coroutine frame.
+ *
+ * \param[in] h  The handle of the coroutine.
+ */
+
+
+/** \fn task::is_ready() const
+ * \brief Check whether the coroutine returned.
+ *
+ * \return true if the coroutine completed or there is no coroutine.
+ */
+
+
+/** \fn task::operator co_await () const
+ * \brief Start the task and wait for its result.
+ *
+ * \return An awaiter returning the result of the coroutine.
+ */
+
+
+/** \fn task::when_ready() const
+ * \brief Start the task and wait for it to complete.
+ *
+ * \return An awaiter which does not return the result.
+ */
+
+
+/** \fn task::result()
+ * \brief Retrieve the result of a completed task.
+ *
+ * If the coroutine exited with an exception, it gets rethrown.
+ *
+ * \return The value returned by the coroutine.
+ */
+
+
+/** \var task::f_handle
+ * \brief The handle of the coroutine owned by this task.
+ */
+
+
+/** \fn spawn(task<void> && t)
+ * \brief Start a task without waiting for it.
+ *
+ * The task runs on the calling thread until its first suspension point,
+ * usually a `co_await schedule_on(pool)`. The coroutine frame is released
+ * once it completes. An exception escaping the coroutine gets logged.
+ *
+ * \param[in] t  The task to start.
+ */
+
+
+/** \fn sync_wait(task<T> && t)
+ * \brief Run a task and block until it completes.
+ *
+ * This is the bridge between regular code and coroutines. The calling
+ * thread blocks on a latch until the coroutine returned.
+ *
+ * \warning
+ * Do not call this function from a pool worker resuming coroutines; if
+ * the task needs that same worker, it never completes.
+ *
+ * \param[in] t  The task to run.
+ *
+ * \return The value returned by the coroutine.
+ */
+
+
+/** \class coroutine_worker
+ * \brief A worker resuming coroutines.
+ *
+ * The work loads of this worker are coroutine handles. Each do_work()
+ * resumes one coroutine until its next suspension point.
+ */
+
+
+/** \typedef coroutine_pool
+ * \brief A pool of workers resuming coroutines.
+ *
+ * This is the pool expected by schedule_on(), sleep_for() and the other
+ * awaitables. Any pool accepting `std::coroutine_handle<>` work loads
+ * can be used instead.
+ */
+
+
+/** \fn schedule_on(P & p)
+ * \brief Move the current coroutine to a pool worker.
+ *
+ * The coroutine is suspended and its handle is pushed in the pool. It
+ * gets resumed by the first available worker.
+ *
+ * \code
+ *     co_await cppthread::schedule_on(my_pool);
+ *     ...now running on a worker...
+ * \endcode
+ *
+ * \warning
+ * If the pool was stopped, the coroutine is never resumed.
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ *
+ * \return The awaitable.
+ */
+
+
+/** \fn sleep_until(P & p, std::chrono::steady_clock::time_point deadline, timer_queue & timers)
+ * \brief Suspend the current coroutine until \p deadline.
+ *
+ * The coroutine does not hold a worker while sleeping. The timer queue
+ * pushes it back in the pool once the deadline is reached.
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] deadline  When to resume the coroutine.
+ * \param[in] timers  The timer queue to use.
+ *
+ * \return The awaitable.
+ */
+
+
+/** \fn sleep_for(P & p, std::chrono::nanoseconds delay, timer_queue & timers)
+ * \brief Suspend the current coroutine for \p delay.
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] delay  How long to sleep.
+ * \param[in] timers  The timer queue to use.
+ *
+ * \return The awaitable.
+ *
+ * \sa sleep_until()
+ */
+
+
+/** \class fifo_pop_awaiter
+ * \brief The awaitable returned by async_pop_front().
+ *
+ * The awaiter registers itself with the fifo as a pop_waiter. When an
+ * item gets pushed, the fifo hands it directly to the first waiter and
+ * calls its ready() function which pushes the coroutine in its pool.
+ */
+
+
+/** \fn async_pop_front(P & p, fifo<T> & f, T & v)
+ * \brief Pop an item from a fifo without blocking the worker.
+ *
+ * When the fifo has no item ready, the coroutine is suspended and queued
+ * in the fifo. The waiting coroutines receive the items in the order in
+ * which they started waiting and are resumed in pool \p p. No thread
+ * blocks and nothing polls the fifo.
+ *
+ * \code
+ *     std::string msg;
+ *     while(co_await cppthread::async_pop_front(my_pool, my_fifo, msg))
+ *     {
+ *         ...handle msg...
+ *     }
+ * \endcode
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] f  The fifo to pop from.
+ * \param[out] v  The item popped.
+ *
+ * \return An awaitable returning true if an item was popped, false if
+ * the fifo is done and has no more items.
+ *
+ * \sa fifo::pop_front_or_wait()
+ */
+
+
+/** \fn async_lock(P & p, L & m)
+ * \brief Lock a spinlock or a ticket_lock without blocking the worker.
+ *
+ * While the lock is held by someone else, the coroutine sleeps with
+ * an exponential backoff before trying again. These locks do not
+ * tell us when they get unlocked, so this is the best we can do without
+ * blocking. Code written for coroutines should prefer an async_mutex.
+ *
+ * The coroutine may resume on a different worker than the one which
+ * took the lock, and unlock it there. This is why \p L is limited to
+ * the locks which are not bound to an owner thread. A cppthread::mutex
+ * (a pthread mutex) must be unlocked by the thread which locked it and
+ * does not compile here.
+ *
+ * \tparam L  The type of lock, spinlock or ticket_lock.
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] m  The lock to acquire.
+ *
+ * \return A task completing once the lock is held.
+ *
+ * \sa async_mutex
+ */
+
+
+/** \class async_mutex_awaiter
+ * \brief The awaitable returned by async_lock() for an async_mutex.
+ *
+ * If the mutex is locked, the awaiter is queued in the mutex and the
+ * coroutine is pushed back in its pool once unlock() hands the mutex
+ * over.
+ */
+
+
+/** \class async_guard_awaiter
+ * \brief The awaitable returned by async_scoped_lock().
+ *
+ * This is the same as the async_mutex_awaiter except that the result of
+ * the `co_await` is an async_guard which unlocks the mutex when it goes
+ * out of scope.
+ */
+
+
+/** \fn async_lock(P & p, async_mutex & m)
+ * \brief Lock an async_mutex.
+ *
+ * The coroutine is suspended until it owns the mutex. It then resumes
+ * in pool \p p. It must call async_mutex::unlock() once done.
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] m  The mutex to lock.
+ *
+ * \return The awaitable.
+ */
+
+
+/** \fn async_scoped_lock(P & p, async_mutex & m)
+ * \brief Lock an async_mutex and return a guard.
+ *
+ * \code
+ *     cppthread::async_guard lock(co_await cppthread::async_scoped_lock(p, m));
+ * \endcode
+ *
+ * \param[in] p  The pool where the coroutine resumes.
+ * \param[in] m  The mutex to lock.
+ *
+ * \return The awaitable returning an async_guard.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
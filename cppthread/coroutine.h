@@ -0,0 +1,661 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Coroutine tasks running on a pool.
+ *
+ * This file declares the task<T> coroutine type and the awaitables used
+ * to move a coroutine to a pool, sleep, pop from a fifo, and lock a mutex
+ * or an async_mutex without blocking a worker thread.
+ *
+ * This header requires C++20.
+ */
+
+#if !defined(__cpp_impl_coroutine)
+#error "cppthread/coroutine.h requires a C++20 compiler with coroutine support."
+#endif
+
+
+// self
+//
+#include    <cppthread/async_mutex.h>
+#include    <cppthread/fifo.h>
+#include    <cppthread/latch.h>
+#include    <cppthread/log.h>
+#include    <cppthread/pool.h>
+#include    <cppthread/spinlock.h>
+#include    <cppthread/timer_queue.h>
+#include    <cppthread/worker.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <chrono>
+#include    <coroutine>
+#include    <exception>
+#include    <optional>
+#include    <type_traits>
+#include    <utility>
+
+
+
+namespace cppthread
+{
+
+
+
+template<typename T = void>
+class task;
+
+
+namespace detail
+{
+
+
+
+constexpr std::chrono::microseconds const   COROUTINE_FIRST_BACKOFF = std::chrono::microseconds(10);
+constexpr std::chrono::microseconds const   COROUTINE_MAX_BACKOFF = std::chrono::microseconds(1'000);
+
+
+class task_promise_base
+{
+public:
+    class final_awaiter
+    {
+    public:
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> const continuation(h.promise().get_continuation());
+            if(continuation)
+            {
+                return continuation;
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return std::suspend_always();
+    }
+
+    final_awaiter final_suspend() const noexcept
+    {
+        return final_awaiter();
+    }
+
+    void unhandled_exception() noexcept
+    {
+        f_exception = std::current_exception();
+    }
+
+    void set_continuation(std::coroutine_handle<> continuation) noexcept
+    {
+        f_continuation = continuation;
+    }
+
+    std::coroutine_handle<> get_continuation() const noexcept
+    {
+        return f_continuation;
+    }
+
+protected:
+    void rethrow_if_failed()
+    {
+        if(f_exception != nullptr)
+        {
+            std::rethrow_exception(f_exception);
+        }
+    }
+
+private:
+    std::coroutine_handle<>     f_continuation = std::coroutine_handle<>();
+    std::exception_ptr          f_exception = std::exception_ptr();
+};
+
+
+template<typename T>
+class task_promise
+    : public task_promise_base
+{
+public:
+    task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U && value)
+    {
+        f_value.emplace(std::forward<U>(value));
+    }
+
+    T result()
+    {
+        rethrow_if_failed();
+        return std::move(*f_value);
+    }
+
+private:
+    std::optional<T>            f_value = std::optional<T>();
+};
+
+
+template<>
+class task_promise<void>
+    : public task_promise_base
+{
+public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {
+    }
+
+    void result()
+    {
+        rethrow_if_failed();
+    }
+};
+
+
+class detached_task
+{
+public:
+    class promise_type
+    {
+    public:
+        detached_task get_return_object() const noexcept
+        {
+            return detached_task();
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return std::suspend_never();
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return std::suspend_never();
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+
+
+} // namespace detail
+
+
+
+template<typename T>
+class task
+{
+public:
+    typedef detail::task_promise<T>             promise_type;
+    typedef std::coroutine_handle<promise_type> handle_t;
+
+    class awaiter
+    {
+    public:
+        awaiter(handle_t h)
+            : f_handle(h)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return f_handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+        {
+            f_handle.promise().set_continuation(continuation);
+            return f_handle;
+        }
+
+        T await_resume()
+        {
+            return f_handle.promise().result();
+        }
+
+    private:
+        handle_t                f_handle;
+    };
+
+    class ready_awaiter
+        : public awaiter
+    {
+    public:
+        ready_awaiter(handle_t h)
+            : awaiter(h)
+        {
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+                        task() = default;
+                        task(task const & rhs) = delete;
+
+    explicit task(handle_t h) noexcept
+        : f_handle(h)
+    {
+    }
+
+    task(task && rhs) noexcept
+        : f_handle(std::exchange(rhs.f_handle, handle_t()))
+    {
+    }
+
+    ~task()
+    {
+        if(f_handle)
+        {
+            f_handle.destroy();
+        }
+    }
+
+    task &              operator = (task const & rhs) = delete;
+
+    task & operator = (task && rhs) noexcept
+    {
+        if(this != &rhs)
+        {
+            if(f_handle)
+            {
+                f_handle.destroy();
+            }
+            f_handle = std::exchange(rhs.f_handle, handle_t());
+        }
+        return *this;
+    }
+
+    bool is_ready() const noexcept
+    {
+        return !f_handle || f_handle.done();
+    }
+
+    awaiter operator co_await () const noexcept
+    {
+        return awaiter(f_handle);
+    }
+
+    ready_awaiter when_ready() const noexcept
+    {
+        return ready_awaiter(f_handle);
+    }
+
+    T result()
+    {
+        return f_handle.promise().result();
+    }
+
+private:
+    handle_t            f_handle = handle_t();
+};
+
+
+namespace detail
+{
+
+
+template<typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+
+inline detached_task run_detached(task<void> t)
+{
+    try
+    {
+        co_await t;
+    }
+    catch(std::exception const & e)
+    {
+        log << log_level_t::error
+            << "a spawned coroutine exited with an exception: "
+            << e.what()
+            << end;
+    }
+    catch(...)
+    {
+        log << log_level_t::error
+            << "a spawned coroutine exited with an unknown exception."
+            << end;
+    }
+}
+
+
+template<typename T>
+detached_task count_down_when_ready(task<T> & t, latch & done)
+{
+    co_await t.when_ready();
+    done.count_down();
+}
+
+
+} // namespace detail
+
+
+
+inline void spawn(task<void> && t)
+{
+    detail::run_detached(std::move(t));
+}
+
+
+template<typename T>
+T sync_wait(task<T> && t)
+{
+    task<T> owned(std::move(t));
+    latch done(1);
+    detail::count_down_when_ready(owned, done);
+    done.wait();
+    return owned.result();
+}
+
+
+
+class coroutine_worker
+    : public worker<std::coroutine_handle<>>
+{
+public:
+    coroutine_worker(
+              std::string const & name
+            , std::size_t position
+            , fifo<std::coroutine_handle<>>::pointer_t in
+            , fifo<std::coroutine_handle<>>::pointer_t out)
+        : worker<std::coroutine_handle<>>(name, position, in, out)
+    {
+    }
+
+    virtual bool do_work() override
+    {
+        f_workload.resume();
+        return false;
+    }
+};
+
+
+typedef pool<coroutine_worker>      coroutine_pool;
+
+
+
+template<typename P>
+class schedule_awaiter
+{
+public:
+    explicit schedule_awaiter(P & p)
+        : f_pool(p)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        f_pool.push_back(h);
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    P &                 f_pool;
+};
+
+
+template<typename P>
+schedule_awaiter<P> schedule_on(P & p)
+{
+    return schedule_awaiter<P>(p);
+}
+
+
+template<typename P>
+class sleep_awaiter
+{
+public:
+    sleep_awaiter(P & p, std::chrono::steady_clock::time_point deadline, timer_queue & timers)
+        : f_pool(p)
+        , f_deadline(deadline)
+        , f_timers(timers)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return std::chrono::steady_clock::now() >= f_deadline;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        P * p(&f_pool);
+        f_timers.call_at(f_deadline, [p, h]()
+            {
+                p->push_back(h);
+            });
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    P &                 f_pool;
+    std::chrono::steady_clock::time_point const
+                        f_deadline;
+    timer_queue &       f_timers;
+};
+
+
+template<typename P>
+sleep_awaiter<P> sleep_until(
+          P & p
+        , std::chrono::steady_clock::time_point deadline
+        , timer_queue & timers = timer_queue::get_default())
+{
+    return sleep_awaiter<P>(p, deadline, timers);
+}
+
+
+template<typename P>
+sleep_awaiter<P> sleep_for(
+          P & p
+        , std::chrono::nanoseconds delay
+        , timer_queue & timers = timer_queue::get_default())
+{
+    return sleep_awaiter<P>(p, std::chrono::steady_clock::now() + delay, timers);
+}
+
+
+template<typename P, typename T>
+class fifo_pop_awaiter
+    : public fifo<T>::pop_waiter
+{
+public:
+    fifo_pop_awaiter(P & p, fifo<T> & f, T & v)
+        : f_pool(p)
+        , f_fifo(f)
+        , f_value(v)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        f_handle = h;
+        return !f_fifo.pop_front_or_wait(*this);
+    }
+
+    bool await_resume()
+    {
+        if(this->f_popped)
+        {
+            f_value = std::move(this->f_item);
+        }
+        return this->f_popped;
+    }
+
+    virtual void ready() override
+    {
+        f_pool.push_back(f_handle);
+    }
+
+private:
+    P &                 f_pool;
+    fifo<T> &           f_fifo;
+    T &                 f_value;
+    std::coroutine_handle<>
+                        f_handle = std::coroutine_handle<>();
+};
+
+
+template<typename P, typename T>
+fifo_pop_awaiter<P, T> async_pop_front(P & p, fifo<T> & f, T & v)
+{
+    return fifo_pop_awaiter<P, T>(p, f, v);
+}
+
+
+template<typename P>
+class async_mutex_awaiter
+    : public async_mutex::waiter
+{
+public:
+    async_mutex_awaiter(P & p, async_mutex & m)
+        : f_pool(p)
+        , f_mutex(m)
+    {
+    }
+
+    bool await_ready()
+    {
+        return f_mutex.try_lock();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        f_handle = h;
+        return !f_mutex.lock_or_wait(*this);
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+    virtual void ready() override
+    {
+        f_pool.push_back(f_handle);
+    }
+
+protected:
+    P &                 f_pool;
+    async_mutex &       f_mutex;
+    std::coroutine_handle<>
+                        f_handle = std::coroutine_handle<>();
+};
+
+
+template<typename P>
+class async_guard_awaiter
+    : public async_mutex_awaiter<P>
+{
+public:
+    async_guard_awaiter(P & p, async_mutex & m)
+        : async_mutex_awaiter<P>(p, m)
+    {
+    }
+
+    async_guard await_resume() const noexcept
+    {
+        return async_guard(this->f_mutex);
+    }
+};
+
+
+template<typename P>
+async_mutex_awaiter<P> async_lock(P & p, async_mutex & m)
+{
+    return async_mutex_awaiter<P>(p, m);
+}
+
+
+template<typename P>
+async_guard_awaiter<P> async_scoped_lock(P & p, async_mutex & m)
+{
+    return async_guard_awaiter<P>(p, m);
+}
+
+
+template<typename P, typename L>
+task<> async_lock(P & p, L & m)
+{
+    static_assert(std::is_same_v<L, spinlock> || std::is_same_v<L, ticket_lock>
+                , "async_lock() only accepts locks which any thread can unlock (spinlock, ticket_lock); use an async_mutex instead.");
+
+    std::chrono::microseconds delay(detail::COROUTINE_FIRST_BACKOFF);
+    while(!m.try_lock())
+    {
+        co_await sleep_for(p, delay);
+        delay = std::min(delay * 2, detail::COROUTINE_MAX_BACKOFF);
+    }
+}
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
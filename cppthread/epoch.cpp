@@ -0,0 +1,550 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the epoch based memory reclamation.
+ *
+ * A lock-free structure cannot delete a node as soon as it removes it
+ * since other threads may still be reading that node. Instead, the node
+ * is retired and deleted later, once no thread can have a pointer to it.
+ *
+ * The epoch based reclamation works with a global epoch counter. Each
+ * thread accessing shared memory does so in a critical section (see
+ * epoch_guard). On entry, the thread saves the global epoch it observed.
+ * A retired node is tagged with the global epoch at the time it was
+ * retired. The global epoch can only advance once all the threads in a
+ * critical section observed the current epoch. Therefore, once the
+ * global epoch is two ahead of the node's tag, all the threads which
+ * could see the node left their critical section and the node can be
+ * deleted.
+ *
+ * Each thread keeps its retired nodes in its own limbo list so retiring
+ * does not require any lock. The list is processed in batches: once it
+ * grows by RETIRE_BATCH_SIZE entries, the thread attempts to advance
+ * the epoch and deletes what it can.
+ *
+ * The cppthread::thread objects register their thread on startup and
+ * unregister it on exit. The entries still in the limbo list of an
+ * exiting thread are moved to a shared list processed by the other
+ * threads. Threads not created by cppthread get registered the first
+ * time they use these functions and unregistered when they exit.
+ */
+
+
+// self
+//
+#include    "cppthread/epoch.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/guard.h"
+#include    "cppthread/log.h"
+#include    "cppthread/mutex.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <deque>
+#include    <iterator>
+#include    <limits>
+#include    <memory>
+#include    <vector>
+
+
+// C
+//
+#include    <sched.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Number of retired entries processed in one batch.
+ *
+ * A thread attempts a reclaim each time its limbo list grew by this
+ * many entries.
+ */
+constexpr std::size_t const     RETIRE_BATCH_SIZE = 64;
+
+
+struct retired_t
+{
+    std::uint64_t               f_epoch = 0;
+    epoch_callback_t            f_callback = epoch_callback_t();
+};
+
+
+typedef std::deque<retired_t>   limbo_t;
+
+
+/** \brief The epoch state of one thread.
+ *
+ * The f_epoch field is read by the other threads. It is 0 while the
+ * thread is not in a critical section. The other fields are only used
+ * by the thread owning the record.
+ */
+struct epoch_thread_t
+{
+    std::atomic<std::uint64_t>  f_epoch = 0;
+    std::uint32_t               f_nesting = 0;
+    limbo_t                     f_limbo = limbo_t();
+    std::size_t                 f_next_reclaim = RETIRE_BATCH_SIZE;
+};
+
+
+typedef std::vector<epoch_thread_t *>   threads_t;
+
+
+/** \brief The global epoch state.
+ *
+ * The domain is allocated once and never deleted so it remains valid
+ * while threads exit at the time the process ends.
+ */
+struct epoch_domain_t
+{
+    std::atomic<std::uint64_t>  f_epoch = 1;
+    mutex                       f_mutex = mutex();
+    threads_t                   f_threads = threads_t();
+    limbo_t                     f_orphans = limbo_t();
+};
+
+
+epoch_domain_t & get_domain()
+{
+    static epoch_domain_t * domain(new epoch_domain_t);
+    return *domain;
+}
+
+
+thread_local epoch_thread_t *   g_thread = nullptr;
+
+
+/** \brief Unregister threads which were not unregistered explicitly.
+ *
+ * An instance of this class is created by epoch_register_thread(). Its
+ * destructor runs when the thread exits.
+ */
+class thread_cleanup
+{
+public:
+    ~thread_cleanup()
+    {
+        epoch_unregister_thread();
+    }
+};
+
+
+epoch_thread_t & get_thread()
+{
+    if(g_thread == nullptr)
+    {
+        epoch_register_thread();
+    }
+    return *g_thread;
+}
+
+
+/** \brief Move the global epoch forward by one if possible.
+ *
+ * The epoch advances only if all the threads currently in a critical
+ * section entered it in the current epoch.
+ *
+ * The function must be called with the domain mutex locked.
+ *
+ * \param[in] domain  The epoch domain.
+ *
+ * \return true if the epoch was incremented.
+ */
+bool try_advance(epoch_domain_t & domain)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::uint64_t const current(domain.f_epoch.load(std::memory_order_seq_cst));
+    for(auto const * t : domain.f_threads)
+    {
+        std::uint64_t const e(t->f_epoch.load(std::memory_order_acquire));
+        if(e != 0 && e != current)
+        {
+            return false;
+        }
+    }
+
+    domain.f_epoch.store(current + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+
+bool is_safe(retired_t const & r, std::uint64_t current)
+{
+    return r.f_epoch + 2 <= current;
+}
+
+
+std::size_t run_callbacks(limbo_t & ready)
+{
+    for(auto & r : ready)
+    {
+        r.f_callback();
+    }
+    return ready.size();
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class epoch_guard
+ * \brief Mark a critical section.
+ *
+ * While an epoch guard exists, the memory retired by any thread with
+ * epoch_retire() or epoch_delete() is not released. A lock-free structure
+ * creates a guard around each operation reading its nodes:
+ *
+ * \code
+ *     node * stack::pop()
+ *     {
+ *         cppthread::epoch_guard section;
+ *         node * n(f_head.load());
+ *         while(n != nullptr
+ *            && !f_head.compare_exchange_weak(n, n->f_next))
+ *         {
+ *         }
+ *         ...use `n`...
+ *         cppthread::epoch_delete(n);
+ *     }
+ * \endcode
+ *
+ * Guards can be nested. Only the outermost guard has a cost: one store
+ * and one memory fence.
+ *
+ * \warning
+ * Keep critical sections short. A thread staying in a critical section
+ * prevents the epoch from advancing and therefore the memory retired by
+ * all the other threads from being released.
+ */
+
+
+
+/** \brief Enter a critical section.
+ *
+ * The first time a thread enters a critical section, it gets registered,
+ * unless it was already registered with epoch_register_thread().
+ */
+epoch_guard::epoch_guard()
+{
+    epoch_thread_t & t(get_thread());
+    ++t.f_nesting;
+    if(t.f_nesting == 1)
+    {
+        t.f_epoch.store(get_domain().f_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+
+        // the other threads must see our epoch before we read any pointer
+        //
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+
+/** \brief Leave a critical section.
+ *
+ * When the outermost guard is destroyed, the thread does not access
+ * shared memory anymore and the epoch can advance.
+ */
+epoch_guard::~epoch_guard()
+{
+    epoch_thread_t * t(g_thread);
+    if(t == nullptr)
+    {
+        return;
+    }
+    --t->f_nesting;
+    if(t->f_nesting == 0)
+    {
+        t->f_epoch.store(0, std::memory_order_release);
+    }
+}
+
+
+/** \brief Register the calling thread.
+ *
+ * The cppthread::thread objects call this function when their thread
+ * starts. Other threads are registered the first time they use one of
+ * the epoch functions. Calling this function more than once is fine.
+ */
+void epoch_register_thread()
+{
+    if(g_thread != nullptr)
+    {
+        return;
+    }
+
+    thread_local thread_cleanup cleanup;
+
+    std::unique_ptr<epoch_thread_t> t(std::make_unique<epoch_thread_t>());
+    epoch_domain_t & domain(get_domain());
+    {
+        guard lock(domain.f_mutex);
+        domain.f_threads.push_back(t.get());
+    }
+    g_thread = t.release();
+}
+
+
+/** \brief Unregister the calling thread.
+ *
+ * The cppthread::thread objects call this function just before their
+ * thread exits. The memory retired by this thread and not yet released
+ * is handed to the other threads.
+ *
+ * Calling this function on a thread which is not registered does nothing.
+ */
+void epoch_unregister_thread()
+{
+    epoch_thread_t * t(g_thread);
+    if(t == nullptr)
+    {
+        return;
+    }
+
+    if(t->f_nesting != 0)
+    {
+        log << log_level_t::error
+            << "epoch_unregister_thread() called from within a critical section."
+            << end;
+        t->f_nesting = 0;
+        t->f_epoch.store(0, std::memory_order_release);
+    }
+
+    epoch_reclaim();
+
+    epoch_domain_t & domain(get_domain());
+    {
+        guard lock(domain.f_mutex);
+        domain.f_threads.erase(std::remove(domain.f_threads.begin(), domain.f_threads.end(), t), domain.f_threads.end());
+        std::move(t->f_limbo.begin(), t->f_limbo.end(), std::back_inserter(domain.f_orphans));
+    }
+
+    g_thread = nullptr;
+    delete t;
+}
+
+
+/** \brief Check whether this thread is in a critical section.
+ *
+ * \return true if at least one epoch_guard exists in this thread.
+ */
+bool epoch_in_critical_section()
+{
+    return g_thread != nullptr && g_thread->f_nesting != 0;
+}
+
+
+/** \brief Retrieve the global epoch.
+ *
+ * This value is mainly useful for debugging and tests.
+ *
+ * \return The current global epoch.
+ */
+std::uint64_t epoch_current()
+{
+    return get_domain().f_epoch.load(std::memory_order_acquire);
+}
+
+
+/** \brief Release memory once no thread can access it.
+ *
+ * The \p callback is saved in the limbo list of this thread and called
+ * once all the threads which were in a critical section at the time
+ * of the call left that section. The object must already be unreachable
+ * for threads entering a new critical section.
+ *
+ * The callback may be called by this thread in a later call to one of
+ * the epoch functions, or by another thread after this one exited. It
+ * must not throw.
+ *
+ * \param[in] callback  The function releasing the memory.
+ */
+void epoch_retire(epoch_callback_t && callback)
+{
+    epoch_thread_t & t(get_thread());
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    retired_t r;
+    r.f_epoch = get_domain().f_epoch.load(std::memory_order_seq_cst);
+    r.f_callback = std::move(callback);
+    t.f_limbo.push_back(std::move(r));
+
+    if(t.f_limbo.size() >= t.f_next_reclaim)
+    {
+        epoch_reclaim();
+    }
+}
+
+
+/** \brief Get the number of entries waiting in this thread's limbo list.
+ *
+ * \return The number of callbacks retired by this thread and not yet run.
+ */
+std::size_t epoch_pending()
+{
+    if(g_thread == nullptr)
+    {
+        return 0;
+    }
+    return g_thread->f_limbo.size();
+}
+
+
+/** \brief Release the memory which is now safe to release.
+ *
+ * This function attempts to advance the global epoch and runs the
+ * callbacks of this thread and of the exited threads which are now
+ * safe to run. It never waits on other threads.
+ *
+ * \return The number of callbacks which were run.
+ */
+std::size_t epoch_reclaim()
+{
+    epoch_thread_t & t(get_thread());
+    epoch_domain_t & domain(get_domain());
+
+    limbo_t ready;
+    {
+        guard lock(domain.f_mutex);
+
+        std::uint64_t oldest(std::numeric_limits<std::uint64_t>::max());
+        if(!t.f_limbo.empty())
+        {
+            oldest = t.f_limbo.front().f_epoch;
+        }
+        for(auto const & r : domain.f_orphans)
+        {
+            oldest = std::min(oldest, r.f_epoch);
+        }
+
+        // at most two steps are required to release everything
+        //
+        for(int step(0); step < 2; ++step)
+        {
+            if(oldest == std::numeric_limits<std::uint64_t>::max()
+            || oldest + 2 <= domain.f_epoch.load(std::memory_order_relaxed)
+            || !try_advance(domain))
+            {
+                break;
+            }
+        }
+
+        std::uint64_t const current(domain.f_epoch.load(std::memory_order_relaxed));
+        while(!t.f_limbo.empty() && is_safe(t.f_limbo.front(), current))
+        {
+            ready.push_back(std::move(t.f_limbo.front()));
+            t.f_limbo.pop_front();
+        }
+
+        auto const it(std::stable_partition(
+                  domain.f_orphans.begin()
+                , domain.f_orphans.end()
+                , [current](retired_t const & r) { return !is_safe(r, current); }));
+        std::move(it, domain.f_orphans.end(), std::back_inserter(ready));
+        domain.f_orphans.erase(it, domain.f_orphans.end());
+    }
+
+    t.f_next_reclaim = t.f_limbo.size() + RETIRE_BATCH_SIZE;
+
+    return run_callbacks(ready);
+}
+
+
+/** \brief Wait until all the current critical sections are done.
+ *
+ * This function blocks until all the threads which are currently in a
+ * critical section left that section. Then it releases the memory
+ * retired by this thread and by the exited threads.
+ *
+ * \exception logic_error
+ * The function cannot be called from within a critical section since
+ * it would wait on itself forever.
+ */
+void epoch_synchronize()
+{
+    if(epoch_in_critical_section())
+    {
+        throw logic_error("epoch_synchronize() called from within a critical section");
+    }
+
+    epoch_domain_t & domain(get_domain());
+
+    std::uint64_t const target(domain.f_epoch.load(std::memory_order_seq_cst) + 2);
+    for(;;)
+    {
+        {
+            guard lock(domain.f_mutex);
+            if(domain.f_epoch.load(std::memory_order_relaxed) < target)
+            {
+                try_advance(domain);
+            }
+            if(domain.f_epoch.load(std::memory_order_relaxed) >= target)
+            {
+                break;
+            }
+        }
+        sched_yield();
+    }
+
+    epoch_reclaim();
+}
+
+
+
+/** \typedef epoch_callback_t
+ * \brief The type of the functions passed to epoch_retire().
+ */
+
+
+/** \fn void epoch_delete(T * ptr)
+ * \brief Delete an object once no thread can access it.
+ *
+ * This function is a shortcut for epoch_retire() with a callback
+ * deleting \p ptr.
+ *
+ * \tparam T  The type of the object to delete.
+ * \param[in] ptr  The object to delete, may be nullptr.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,77 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Epoch based memory reclamation.
+ *
+ * This file declares the epoch guard and the functions used to retire
+ * memory which other threads may still be accessing.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <functional>
+
+
+
+namespace cppthread
+{
+
+
+
+typedef std::function<void()>   epoch_callback_t;
+
+
+class epoch_guard
+{
+public:
+                        epoch_guard();
+                        epoch_guard(epoch_guard const & rhs) = delete;
+                        ~epoch_guard();
+
+    epoch_guard &       operator = (epoch_guard const & rhs) = delete;
+};
+
+
+void                    epoch_register_thread();
+void                    epoch_unregister_thread();
+bool                    epoch_in_critical_section();
+std::uint64_t           epoch_current();
+void                    epoch_retire(epoch_callback_t && callback);
+std::size_t             epoch_pending();
+std::size_t             epoch_reclaim();
+void                    epoch_synchronize();
+
+
+template<class T>
+void epoch_delete(T * ptr)
+{
+    if(ptr != nullptr)
+    {
+        epoch_retire([ptr]() { delete ptr; });
+    }
+}
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,340 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the executor inbox.
+ *
+ * The inbox is a multiple producers, single consumer intrusive queue
+ * (Dmitry Vyukov's algorithm). Posting a function is one exchange and
+ * one store; no lock is ever taken.
+ */
+
+
+// self
+//
+#include    "cppthread/executor.h"
+
+#include    "cppthread/log.h"
+
+
+// C++
+//
+#include    <memory>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class executor
+ * \brief An inbox of functions to run on a given thread.
+ *
+ * A runner owning state which is not thread safe can derive from this
+ * class to let other threads run code on its thread instead of adding
+ * locks around that state:
+ *
+ * \code
+ *     class my_runner
+ *         : public cppthread::runner
+ *         , public cppthread::executor
+ *     {
+ *     public:
+ *         virtual void run() override
+ *         {
+ *             while(continue_running())
+ *             {
+ *                 ...wait for work or a wakeup()...
+ *                 ...do some work...
+ *
+ *                 // safe point: run what other threads posted
+ *                 //
+ *                 run_posted(100);
+ *             }
+ *         }
+ *
+ *         // overrides both runner::wakeup() and executor::wakeup()
+ *         //
+ *         virtual void wakeup() override
+ *         {
+ *             cppthread::guard lock(f_mutex);
+ *             f_mutex.signal();
+ *         }
+ *     };
+ *
+ *     // from any other thread
+ *     r->post([r]() { r->update_state(); });
+ * \endcode
+ *
+ * Any thread can call post(). Only the thread running the loop may call
+ * run_posted() and has_posted().
+ *
+ * The wakeup() function is called when a function gets posted while
+ * the inbox was drained. It must interrupt whatever the loop sleeps on:
+ * signal the runner's mutex, write to an eventfd, etc. Since both the
+ * runner and the executor declare the same wakeup() function, a runner
+ * deriving from both implements it once and thread::stop() uses it too.
+ *
+ * If the loop sleeps on f_mutex, it has to check has_posted() while
+ * holding the mutex before calling wait(), otherwise it could miss the
+ * signal.
+ */
+
+
+/** \brief Initialize an empty inbox.
+ */
+executor::executor()
+    : f_head(&f_stub)
+    , f_tail(&f_stub)
+{
+}
+
+
+/** \brief Release the functions which were never run.
+ *
+ * The functions still in the inbox are destroyed without being called.
+ */
+executor::~executor()
+{
+    for(node * n(pop()); n != nullptr; n = pop())
+    {
+        delete n;
+    }
+}
+
+
+/** \brief Post a function to run on the executor thread.
+ *
+ * The function is added to the inbox. If the executor had no pending
+ * wakeup, wakeup() gets called so the loop knows to call run_posted().
+ * A burst of posts therefore costs a single wakeup.
+ *
+ * The functions posted by one thread run in the order they were posted.
+ *
+ * \param[in] task  The function to run.
+ */
+void executor::post(task_t && task)
+{
+    node * n(new node);
+    n->f_task = std::move(task);
+    push(n);
+
+    if(!f_notified.exchange(true, std::memory_order_acq_rel))
+    {
+        wakeup();
+    }
+}
+
+
+/** \brief Run the posted functions.
+ *
+ * This function must be called by the thread running the executor loop
+ * at a point where the posted functions can safely access its state.
+ *
+ * The \p max parameter limits the number of functions run by this call
+ * so a flood of posts does not starve the rest of the loop. If functions
+ * remain, wakeup() gets called again so the loop comes back.
+ *
+ * An exception escaping a function, std::exception or not, is logged and
+ * the next function runs.
+ *
+ * \param[in] max  The maximum number of functions to run.
+ *
+ * \return The number of functions which were run.
+ */
+std::size_t executor::run_posted(std::size_t max)
+{
+    // reading the flag synchronizes with the posts which set it, so we
+    // see their nodes; any later post calls wakeup() again
+    //
+    f_notified.exchange(false, std::memory_order_acq_rel);
+
+    std::size_t count(0);
+    while(count < max)
+    {
+        std::unique_ptr<node> n(pop());
+        if(n == nullptr)
+        {
+            return count;
+        }
+        ++count;
+
+        try
+        {
+            n->f_task();
+        }
+        catch(std::exception const & e)
+        {
+            log << log_level_t::error
+                << "executor task exited with an exception: "
+                << e.what()
+                << end;
+        }
+        catch(...)
+        {
+            log << log_level_t::error
+                << "executor task exited with an unknown exception (a.k.a. non-std::exception)."
+                << end;
+        }
+    }
+
+    if(has_posted()
+    && !f_notified.exchange(true, std::memory_order_acq_rel))
+    {
+        wakeup();
+    }
+
+    return count;
+}
+
+
+/** \brief Check whether functions are waiting in the inbox.
+ *
+ * This function may return true while a post() is still in progress;
+ * run_posted() may then run nothing until that post() completes and
+ * calls wakeup().
+ *
+ * \return true if the inbox is not empty.
+ */
+bool executor::has_posted() const
+{
+    return f_tail != &f_stub
+        || f_head.load(std::memory_order_acquire) != &f_stub;
+}
+
+
+/** \fn executor::wakeup()
+ * \brief Wake up the executor loop.
+ *
+ * This function is called by post() and must make the thread running
+ * the loop call run_posted() soon.
+ */
+
+
+/** \brief Add a node at the head of the queue.
+ *
+ * \param[in] n  The node to add.
+ */
+void executor::push(node * n)
+{
+    n->f_next.store(nullptr, std::memory_order_relaxed);
+    node * previous(f_head.exchange(n, std::memory_order_acq_rel));
+
+    // between the exchange and this store the consumer sees the queue as
+    // empty past the previous node; it gets woken up after the store
+    //
+    previous->f_next.store(n, std::memory_order_release);
+}
+
+
+/** \brief Remove the node at the tail of the queue.
+ *
+ * The stub node stays in the queue so it is never empty, which is what
+ * lets push() avoid any test.
+ *
+ * \return The oldest node or nullptr if none is available.
+ */
+executor::node * executor::pop()
+{
+    node * tail(f_tail);
+    node * next(tail->f_next.load(std::memory_order_acquire));
+    if(tail == &f_stub)
+    {
+        if(next == nullptr)
+        {
+            return nullptr;
+        }
+        f_tail = next;
+        tail = next;
+        next = next->f_next.load(std::memory_order_acquire);
+    }
+    if(next != nullptr)
+    {
+        f_tail = next;
+        return tail;
+    }
+    if(tail != f_head.load(std::memory_order_acquire))
+    {
+        // a push() is in progress
+        //
+        return nullptr;
+    }
+
+    // tail is the last node; put the stub back behind it so tail can go
+    //
+    push(&f_stub);
+    next = tail->f_next.load(std::memory_order_acquire);
+    if(next != nullptr)
+    {
+        f_tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+
+/** \typedef executor::task_t
+ * \brief The type of the functions posted to an executor.
+ */
+
+
+/** \class executor::node
+ * \brief One entry of the inbox.
+ */
+
+
+/** \var executor::node::f_task
+ * \brief The posted function.
+ */
+
+
+/** \var executor::node::f_next
+ * \brief The next, more recent, node.
+ */
+
+
+/** \var executor::f_head
+ * \brief The most recently pushed node; updated by the producers.
+ */
+
+
+/** \var executor::f_tail
+ * \brief The oldest node; only used by the consumer.
+ */
+
+
+/** \var executor::f_stub
+ * \brief The node which keeps the queue from ever being empty.
+ */
+
+
+/** \var executor::f_notified
+ * \brief Whether a wakeup() is pending.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
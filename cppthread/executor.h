@@ -0,0 +1,79 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Post functions to be run by a specific thread.
+ *
+ * This file declares the executor class, a lock-free inbox of functions
+ * which a runner adds to its own loop.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <functional>
+#include    <limits>
+
+
+
+namespace cppthread
+{
+
+
+
+class executor
+{
+public:
+    typedef std::function<void()>           task_t;
+
+                        executor();
+                        executor(executor const & rhs) = delete;
+    virtual             ~executor();
+
+    executor &          operator = (executor const & rhs) = delete;
+
+    void                post(task_t && task);
+    std::size_t         run_posted(std::size_t max = std::numeric_limits<std::size_t>::max());
+    bool                has_posted() const;
+
+    virtual void        wakeup() = 0;
+
+private:
+    class node
+    {
+    public:
+        task_t                  f_task = task_t();
+        std::atomic<node *>     f_next = nullptr;
+    };
+
+    void                push(node * n);
+    node *              pop();
+
+    std::atomic<node *> f_head;
+    node *              f_tail;
+    node                f_stub = node();
+    std::atomic<bool>   f_notified = false;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,753 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the binary logs.
+ *
+ * The fast_log() template copies the arguments in a per thread ring.
+ * This file holds the registry of the call sites and of the rings, the
+ * code decoding and formatting the records, and the writer thread.
+ */
+
+
+// self
+//
+#include    "cppthread/fast_log.h"
+
+#include    "cppthread/guard.h"
+#include    "cppthread/mutex.h"
+#include    "cppthread/runner.h"
+
+
+// C++
+//
+#include    <iomanip>
+#include    <sstream>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The mutex protecting the registries.
+ *
+ * The registries are used by static constructors, so they are created
+ * on first use instead of being plain globals.
+ *
+ * \return A reference to the registry mutex.
+ */
+mutex & get_registry_mutex()
+{
+    static mutex g_registry_mutex;
+    return g_registry_mutex;
+}
+
+
+/** \brief The list of call sites, indexed by their identifier.
+ *
+ * A site which gets destroyed leaves a nullptr in its slot so the
+ * identifiers of the other sites do not change.
+ *
+ * \return A reference to the list of sites.
+ */
+std::vector<fast_log_site const *> & get_sites()
+{
+    static std::vector<fast_log_site const *> g_sites;
+    return g_sites;
+}
+
+
+/** \brief The list of all the rings, including those of dead threads.
+ *
+ * \return A reference to the list of rings.
+ */
+std::vector<detail::fast_log_ring::pointer_t> & get_rings()
+{
+    static std::vector<detail::fast_log_ring::pointer_t> g_rings;
+    return g_rings;
+}
+
+
+/** \brief The number of messages dropped by rings which were released.
+ */
+std::uint64_t g_released_dropped = 0;
+
+
+/** \brief Whether the ring owner of this thread was already destroyed.
+ *
+ * A fast_log() from a thread local destructor running after the owner
+ * gets a ring which stays registered until the process exits.
+ */
+thread_local bool g_ring_owner_released = false;
+
+
+/** \brief Keep the ring of a thread until that thread exits.
+ *
+ * The ring itself is shared with the registry so the messages written
+ * just before the thread exits still get formatted. The registry
+ * releases the ring once it is orphaned and empty.
+ */
+class ring_owner
+{
+public:
+    ~ring_owner()
+    {
+        if(f_ring != nullptr)
+        {
+            f_ring->orphan();
+        }
+        detail::g_fast_log_ring = nullptr;
+        g_ring_owner_released = true;
+    }
+
+    detail::fast_log_ring::pointer_t    f_ring = detail::fast_log_ring::pointer_t();
+};
+
+
+thread_local ring_owner g_ring_owner;
+
+
+/** \brief The mutex making sure only one thread reads the rings.
+ *
+ * The rings have a single consumer: fast_log_flush() calls are
+ * serialized with this mutex.
+ */
+mutex & get_flush_mutex()
+{
+    static mutex g_flush_mutex;
+    return g_flush_mutex;
+}
+
+
+/** \brief Read a value from a record.
+ *
+ * \param[in,out] p  The position in the record, moved past the value.
+ * \param[in] end  The end of the record.
+ * \param[out] v  The value read.
+ *
+ * \return false if the record is too short.
+ */
+template<class V>
+bool read_value(char const * & p, char const * end, V & v)
+{
+    if(static_cast<std::size_t>(end - p) < sizeof(v))
+    {
+        return false;
+    }
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+
+/** \brief Decode the next argument of a record and write it to \p out.
+ *
+ * \param[in,out] p  The position in the record, moved past the argument.
+ * \param[in] end  The end of the record.
+ * \param[in] out  The stream receiving the argument.
+ *
+ * \return false if no more arguments are available.
+ */
+bool format_argument(char const * & p, char const * end, std::ostream & out)
+{
+    if(p >= end)
+    {
+        return false;
+    }
+    detail::fast_log_type_t const type(static_cast<detail::fast_log_type_t>(*p));
+    ++p;
+    switch(type)
+    {
+    case detail::fast_log_type_t::FAST_LOG_TYPE_END:
+        return false;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_BOOL:
+        {
+            std::uint8_t v(0);
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << (v != 0 ? "true" : "false");
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_CHAR:
+        {
+            char v('\0');
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << v;
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_INT64:
+        {
+            std::int64_t v(0);
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << v;
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_UINT64:
+        {
+            std::uint64_t v(0);
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << v;
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_DOUBLE:
+        {
+            double v(0.0);
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << v;
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_STRING:
+        {
+            std::uint32_t length(0);
+            if(!read_value(p, end, length)
+            || static_cast<std::size_t>(end - p) < length)
+            {
+                return false;
+            }
+            out.write(p, length);
+            p += length;
+        }
+        return true;
+
+    case detail::fast_log_type_t::FAST_LOG_TYPE_POINTER:
+        {
+            std::uint64_t v(0);
+            if(!read_value(p, end, v))
+            {
+                return false;
+            }
+            out << "0x" << std::hex << v << std::dec;
+        }
+        return true;
+
+    }
+
+    return false;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class fast_log_site
+ * \brief The static description of a fast_log() call.
+ *
+ * Each place in the code calling fast_log() declares a static site
+ * holding the level and the format of the message. Only the site
+ * identifier and the raw arguments get saved in the ring; the format
+ * is only read when the message gets formatted by the writer.
+ *
+ * \code
+ *     static cppthread::fast_log_site const g_site(
+ *               cppthread::log_level_t::info
+ *             , "request {} took {} us"
+ *             , __FILE__
+ *             , __LINE__);
+ *
+ *     cppthread::fast_log(g_site, request_id, duration);
+ * \endcode
+ *
+ * Each "{}" in the format gets replaced by the next argument. Arguments
+ * left over once the format is exhausted are appended at the end,
+ * separated by spaces.
+ */
+
+
+/** \brief Register a new call site.
+ *
+ * The site gets the next identifier. The format, file name, and
+ * string pointers must remain valid as long as the site exists, which
+ * is the case with string literals.
+ *
+ * \param[in] level  The level of the messages sent from this site.
+ * \param[in] format  The format of the messages.
+ * \param[in] file  The name of the source file, may be nullptr.
+ * \param[in] line  The line in the source file.
+ */
+fast_log_site::fast_log_site(
+          log_level_t level
+        , char const * format
+        , char const * file
+        , int line)
+    : f_level(level)
+    , f_format(format == nullptr ? "" : format)
+    , f_file(file)
+    , f_line(line)
+{
+    guard lock(get_registry_mutex());
+    std::vector<fast_log_site const *> & sites(get_sites());
+    f_id = static_cast<std::uint32_t>(sites.size());
+    sites.push_back(this);
+}
+
+
+/** \brief Unregister the call site.
+ *
+ * Messages from this site still waiting in a ring are dropped by
+ * fast_log_flush() instead of being formatted.
+ */
+fast_log_site::~fast_log_site()
+{
+    guard lock(get_registry_mutex());
+    get_sites()[f_id] = nullptr;
+}
+
+
+/** \brief Get the identifier of this site.
+ *
+ * \return The identifier saved in the ring with each message.
+ */
+std::uint32_t fast_log_site::get_id() const
+{
+    return f_id;
+}
+
+
+/** \brief Get the level of the messages sent from this site.
+ *
+ * \return The log level.
+ */
+log_level_t fast_log_site::get_level() const
+{
+    return f_level;
+}
+
+
+/** \brief Get the format of the messages sent from this site.
+ *
+ * \return The format string.
+ */
+char const * fast_log_site::get_format() const
+{
+    return f_format;
+}
+
+
+/** \brief Get the name of the file declaring this site.
+ *
+ * \return The file name or nullptr.
+ */
+char const * fast_log_site::get_file() const
+{
+    return f_file;
+}
+
+
+/** \brief Get the line number of this site.
+ *
+ * \return The line number or 0.
+ */
+int fast_log_site::get_line() const
+{
+    return f_line;
+}
+
+
+/** \brief Search a site by identifier.
+ *
+ * \param[in] id  The identifier of the site.
+ *
+ * \return The site or nullptr if it does not exist (anymore).
+ */
+fast_log_site const * fast_log_site::get_site(std::uint32_t id)
+{
+    guard lock(get_registry_mutex());
+    std::vector<fast_log_site const *> const & sites(get_sites());
+    if(id >= sites.size())
+    {
+        return nullptr;
+    }
+    return sites[id];
+}
+
+
+
+namespace detail
+{
+
+
+
+/** \class fast_log_ring
+ * \brief The ring of one thread.
+ *
+ * The thread calling fast_log() is the only producer and the thread
+ * calling fast_log_flush() is the only consumer, so the ring only needs
+ * two counters. The producer never waits: when the ring is full the
+ * message is dropped and counted.
+ *
+ * A record starts with a fast_log_header and its size is a multiple
+ * of 8. A record never wraps; when it does not fit at the end of the
+ * buffer, the end gets filled with a padding record. Since the space
+ * left may be as small as 8 bytes, a padding record only includes the
+ * size and site fields of the header (PADDING_SIZE bytes).
+ *
+ * The header also holds the time at which fast_log() was called, in
+ * nanoseconds since the Unix epoch, so the formatted message shows
+ * when the event happened and not when the writer got to it.
+ */
+
+
+/** \brief Create the ring of the calling thread.
+ *
+ * This function is called the first time a thread calls fast_log().
+ * The ring gets added to the registry so fast_log_flush() sees it.
+ *
+ * \return The new ring, also saved in g_fast_log_ring.
+ */
+fast_log_ring * create_fast_log_ring()
+{
+    fast_log_ring::pointer_t ring(std::make_shared<fast_log_ring>());
+    {
+        guard lock(get_registry_mutex());
+        get_rings().push_back(ring);
+    }
+    if(!g_ring_owner_released)
+    {
+        g_ring_owner.f_ring = ring;
+    }
+    g_fast_log_ring = ring.get();
+    return g_fast_log_ring;
+}
+
+
+/** \brief Format one record.
+ *
+ * The message starts with the time at which fast_log() was called, as
+ * seconds and nanoseconds since the Unix epoch between square brackets.
+ * The log itself does not record a time and a sink which does (such as
+ * the mmap_log_sink) sees the time of the flush instead.
+ *
+ * \param[in] site  The site which sent the record.
+ * \param[in] time_ns  The time of the call, in nanoseconds since the epoch.
+ * \param[in] payload  The encoded arguments.
+ * \param[in] size  The size of the payload, including the alignment padding.
+ *
+ * \return The formatted message.
+ */
+std::string fast_log_format(
+      fast_log_site const & site
+    , std::uint64_t time_ns
+    , char const * payload
+    , std::size_t size)
+{
+    std::stringstream out;
+    out << '['
+        << time_ns / 1'000'000'000ULL
+        << '.'
+        << std::setw(9) << std::setfill('0') << time_ns % 1'000'000'000ULL
+        << std::setfill(' ')
+        << "] ";
+    char const * p(payload);
+    char const * const end(payload + size);
+    bool more(true);
+    for(char const * f(site.get_format()); *f != '\0'; ++f)
+    {
+        if(f[0] == '{' && f[1] == '}' && more)
+        {
+            more = format_argument(p, end, out);
+            if(more)
+            {
+                ++f;
+                continue;
+            }
+        }
+        out << *f;
+    }
+    while(more
+       && p < end
+       && static_cast<detail::fast_log_type_t>(*p) != detail::fast_log_type_t::FAST_LOG_TYPE_END)
+    {
+        out << ' ';
+        more = format_argument(p, end, out);
+    }
+    return out.str();
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Format and log all the messages waiting in the rings.
+ *
+ * Each message gets sent to the regular log, with the level of its site,
+ * so it ends up in the log callback or on std::cerr.
+ *
+ * The rings of threads which exited are released once empty.
+ *
+ * \return The number of messages which were logged.
+ */
+std::size_t fast_log_flush()
+{
+    guard flush_lock(get_flush_mutex());
+
+    std::vector<detail::fast_log_ring::pointer_t> rings;
+    {
+        guard lock(get_registry_mutex());
+        rings = get_rings();
+    }
+
+    std::size_t count(0);
+    for(auto const & r : rings)
+    {
+        count += r->consume([](
+                      std::uint32_t id
+                    , std::uint64_t time_ns
+                    , char const * payload
+                    , std::size_t size)
+            {
+                fast_log_site const * site(fast_log_site::get_site(id));
+                if(site != nullptr)
+                {
+                    log << site->get_level()
+                        << detail::fast_log_format(*site, time_ns, payload, size)
+                        << end;
+                }
+            });
+    }
+
+    guard lock(get_registry_mutex());
+    std::vector<detail::fast_log_ring::pointer_t> & all(get_rings());
+    for(auto it(all.begin()); it != all.end(); )
+    {
+        if((*it)->is_orphan() && (*it)->empty())
+        {
+            g_released_dropped += (*it)->get_dropped();
+            it = all.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return count;
+}
+
+
+/** \brief Get the number of messages dropped because a ring was full.
+ *
+ * A thread sending messages faster than the writer formats them fills
+ * its ring. The fast_log() function then drops the new messages instead
+ * of waiting. A non-zero value means the writer period is too long or
+ * the ring too small for the load.
+ *
+ * \return The total number of dropped messages.
+ */
+std::uint64_t fast_log_dropped()
+{
+    guard lock(get_registry_mutex());
+    std::uint64_t result(g_released_dropped);
+    for(auto const & r : get_rings())
+    {
+        result += r->get_dropped();
+    }
+    return result;
+}
+
+
+
+/** \brief The runner of the writer thread.
+ *
+ * The runner calls fast_log_flush() every period until stopped, then
+ * once more so the messages sent before the stop are not lost.
+ */
+class fast_log_writer::writer_runner
+    : public runner
+{
+public:
+    writer_runner(std::chrono::milliseconds period)
+        : runner("fast_log_writer")
+        , f_period(period)
+    {
+    }
+
+    virtual void wakeup() override
+    {
+        guard lock(f_mutex);
+        f_mutex.signal();
+    }
+
+    virtual void run() override
+    {
+        std::uint64_t const usecs(std::chrono::duration_cast<std::chrono::microseconds>(f_period).count());
+        for(;;)
+        {
+            {
+                guard lock(f_mutex);
+
+                // check under the lock so wakeup() cannot be missed
+                //
+                if(!continue_running())
+                {
+                    break;
+                }
+                f_mutex.timed_wait(usecs);
+            }
+
+            fast_log_flush();
+        }
+
+        fast_log_flush();
+    }
+
+private:
+    std::chrono::milliseconds const f_period;
+};
+
+
+
+/** \class fast_log_writer
+ * \brief The thread formatting the fast_log() messages.
+ *
+ * Create one writer in your process to have the messages sent with
+ * fast_log() formatted and logged in the background:
+ *
+ * \code
+ *     int main(int argc, char * argv[])
+ *     {
+ *         cppthread::fast_log_writer writer;
+ *         ...
+ *     }
+ * \endcode
+ *
+ * Without a writer, the messages stay in the rings until someone
+ * calls fast_log_flush().
+ */
+
+
+/** \brief Start the writer thread.
+ *
+ * \param[in] period  How often the rings get flushed.
+ */
+fast_log_writer::fast_log_writer(std::chrono::milliseconds period)
+    : f_runner(std::make_shared<writer_runner>(period))
+    , f_thread(std::make_shared<thread>("fast_log_writer", f_runner))
+{
+    f_thread->start();
+}
+
+
+/** \brief Stop the writer thread.
+ *
+ * The messages already in the rings get logged before the thread exits.
+ */
+fast_log_writer::~fast_log_writer()
+{
+    f_thread->stop();
+}
+
+
+/** \fn fast_log(fast_log_site const & site, A const & ... args)
+ * \brief Send a message without formatting it.
+ *
+ * This function saves the identifier of \p site and the raw values of
+ * \p args in the ring of the calling thread. No lock is taken and no
+ * memory is allocated except for the ring itself, on the first call.
+ *
+ * The arguments can be booleans, characters, integers, enumerations,
+ * floating points, strings, and pointers. Strings are copied since the
+ * formatting happens later.
+ *
+ * If the ring is full, the message is dropped; see fast_log_dropped().
+ *
+ * \param[in] site  The static description of the message.
+ * \param[in] args  The values to insert in the message.
+ */
+
+
+/** \var fast_log_writer::DEFAULT_PERIOD
+ * \brief The default period between two flushes.
+ */
+
+
+/** \var fast_log_writer::f_runner
+ * \brief The runner flushing the rings.
+ */
+
+
+/** \var fast_log_writer::f_thread
+ * \brief The thread running f_runner.
+ */
+
+
+/** \var fast_log_site::f_id
+ * \brief The identifier of the site, its index in the registry.
+ */
+
+
+/** \var fast_log_site::f_level
+ * \brief The level of the messages.
+ */
+
+
+/** \var fast_log_site::f_format
+ * \brief The format of the messages.
+ */
+
+
+/** \var fast_log_site::f_file
+ * \brief The file where the site is declared.
+ */
+
+
+/** \var fast_log_site::f_line
+ * \brief The line where the site is declared.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,386 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Binary logging with deferred formatting.
+ *
+ * This file declares the fast_log() function which copies its raw
+ * arguments in a per thread ring buffer. The messages get formatted
+ * later by the fast_log_writer thread, or by fast_log_flush().
+ */
+
+
+// self
+//
+#include    <cppthread/log.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <cstddef>
+#include    <cstdint>
+#include    <cstring>
+#include    <memory>
+#include    <string>
+#include    <string_view>
+#include    <type_traits>
+
+
+
+namespace cppthread
+{
+
+
+
+class fast_log_site
+{
+public:
+                        fast_log_site(
+                              log_level_t level
+                            , char const * format
+                            , char const * file = nullptr
+                            , int line = 0);
+                        fast_log_site(fast_log_site const & rhs) = delete;
+                        ~fast_log_site();
+
+    fast_log_site &     operator = (fast_log_site const & rhs) = delete;
+
+    std::uint32_t       get_id() const;
+    log_level_t         get_level() const;
+    char const *        get_format() const;
+    char const *        get_file() const;
+    int                 get_line() const;
+
+    static fast_log_site const *
+                        get_site(std::uint32_t id);
+
+private:
+    std::uint32_t       f_id = 0;
+    log_level_t const   f_level;
+    char const * const  f_format;
+    char const * const  f_file;
+    int const           f_line;
+};
+
+
+
+namespace detail
+{
+
+
+
+enum class fast_log_type_t : std::uint8_t
+{
+    FAST_LOG_TYPE_END,      // the zero padding at the end of a record
+    FAST_LOG_TYPE_BOOL,
+    FAST_LOG_TYPE_CHAR,
+    FAST_LOG_TYPE_INT64,
+    FAST_LOG_TYPE_UINT64,
+    FAST_LOG_TYPE_DOUBLE,
+    FAST_LOG_TYPE_STRING,
+    FAST_LOG_TYPE_POINTER,
+};
+
+
+struct fast_log_header
+{
+    std::uint32_t       f_size = 0;
+    std::uint32_t       f_site = 0;
+    std::uint64_t       f_time_ns = 0;
+};
+
+
+class fast_log_ring
+{
+public:
+    typedef std::shared_ptr<fast_log_ring>  pointer_t;
+
+    static constexpr std::size_t const      SIZE = 64 * 1024;
+    static constexpr std::uint32_t const    PADDING = static_cast<std::uint32_t>(-1);
+    static constexpr std::size_t const      PADDING_SIZE = offsetof(fast_log_header, f_time_ns);
+
+    char * reserve(std::size_t size)
+    {
+        std::uint64_t const head(f_head.load(std::memory_order_relaxed));
+        std::uint64_t const tail(f_tail.load(std::memory_order_acquire));
+        std::size_t const offset(head & (SIZE - 1));
+        std::size_t const contiguous(SIZE - offset);
+
+        // a record never wraps around, the end of the buffer gets
+        // skipped with a padding record instead
+        //
+        std::size_t const needed(size <= contiguous ? size : contiguous + size);
+        if(size > SIZE / 2
+        || head + needed - tail > SIZE)
+        {
+            f_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if(size <= contiguous)
+        {
+            return f_buffer + offset;
+        }
+
+        fast_log_header padding;
+        padding.f_size = static_cast<std::uint32_t>(contiguous);
+        padding.f_site = PADDING;
+        memcpy(f_buffer + offset, &padding, PADDING_SIZE);
+        f_head.store(head + contiguous, std::memory_order_release);
+        return f_buffer;
+    }
+
+    void commit(std::size_t size)
+    {
+        f_head.store(f_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    template<typename F>
+    std::size_t consume(F callback)
+    {
+        std::size_t count(0);
+        std::uint64_t tail(f_tail.load(std::memory_order_relaxed));
+        std::uint64_t const head(f_head.load(std::memory_order_acquire));
+        while(tail != head)
+        {
+            char const * record(f_buffer + (tail & (SIZE - 1)));
+            fast_log_header h;
+            memcpy(static_cast<void *>(&h), record, PADDING_SIZE);
+            if(h.f_site != PADDING)
+            {
+                memcpy(&h.f_time_ns, record + PADDING_SIZE, sizeof(h.f_time_ns));
+                callback(h.f_site, h.f_time_ns, record + sizeof(h), h.f_size - sizeof(h));
+                ++count;
+            }
+            tail += h.f_size;
+            f_tail.store(tail, std::memory_order_release);
+        }
+        return count;
+    }
+
+    bool empty() const
+    {
+        return f_head.load(std::memory_order_acquire) == f_tail.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t get_dropped() const
+    {
+        return f_dropped.load(std::memory_order_relaxed);
+    }
+
+    void orphan()
+    {
+        f_orphan.store(true, std::memory_order_release);
+    }
+
+    bool is_orphan() const
+    {
+        return f_orphan.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<std::uint64_t>
+                        f_head = 0;
+    std::atomic<std::uint64_t>
+                        f_dropped = 0;
+    std::atomic<bool>   f_orphan = false;
+    alignas(64) std::atomic<std::uint64_t>
+                        f_tail = 0;
+    alignas(64) char    f_buffer[SIZE] = {};
+};
+
+
+fast_log_ring *         create_fast_log_ring();
+
+inline thread_local fast_log_ring *     g_fast_log_ring = nullptr;
+
+
+template<class T>
+constexpr bool          fast_log_unsupported = false;
+
+
+inline std::string_view fast_log_string(std::string_view const & v)
+{
+    return v;
+}
+
+
+inline std::string_view fast_log_string(char const * v)
+{
+    return v == nullptr ? std::string_view("(null)") : std::string_view(v);
+}
+
+
+template<class T>
+std::size_t fast_log_size(T const & v)
+{
+    if constexpr (std::is_same_v<T, bool>
+               || std::is_same_v<T, char>)
+    {
+        return 1 + 1;
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return fast_log_size(static_cast<std::underlying_type_t<T>>(v));
+    }
+    else if constexpr (std::is_integral_v<T>
+                    || std::is_floating_point_v<T>)
+    {
+        return 1 + 8;
+    }
+    else if constexpr (std::is_convertible_v<T const &, std::string_view>
+                    || std::is_convertible_v<T const &, char const *>)
+    {
+        return 1 + 4 + fast_log_string(v).length();
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        return 1 + 8;
+    }
+    else
+    {
+        static_assert(fast_log_unsupported<T>, "fast_log() only accepts numbers, strings and pointers.");
+    }
+}
+
+
+template<class V>
+char * fast_log_put(char * p, fast_log_type_t type, V const & v)
+{
+    *p = static_cast<char>(type);
+    memcpy(p + 1, &v, sizeof(v));
+    return p + 1 + sizeof(v);
+}
+
+
+template<class T>
+char * fast_log_encode(char * p, T const & v)
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_BOOL, static_cast<std::uint8_t>(v ? 1 : 0));
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_CHAR, v);
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return fast_log_encode(p, static_cast<std::underlying_type_t<T>>(v));
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_INT64, static_cast<std::int64_t>(v));
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_UINT64, static_cast<std::uint64_t>(v));
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_DOUBLE, static_cast<double>(v));
+    }
+    else if constexpr (std::is_convertible_v<T const &, std::string_view>
+                    || std::is_convertible_v<T const &, char const *>)
+    {
+        std::string_view const s(fast_log_string(v));
+        p = fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_STRING, static_cast<std::uint32_t>(s.length()));
+        memcpy(p, s.data(), s.length());
+        return p + s.length();
+    }
+    else
+    {
+        return fast_log_put(p, fast_log_type_t::FAST_LOG_TYPE_POINTER, reinterpret_cast<std::uint64_t>(v));
+    }
+}
+
+
+std::string             fast_log_format(
+                              fast_log_site const & site
+                            , std::uint64_t time_ns
+                            , char const * payload
+                            , std::size_t size);
+
+
+
+} // namespace detail
+
+
+
+template<class ...A>
+void fast_log(fast_log_site const & site, A const & ... args)
+{
+    detail::fast_log_ring * ring(detail::g_fast_log_ring);
+    if(ring == nullptr)
+    {
+        ring = detail::create_fast_log_ring();
+    }
+
+    std::size_t const size((sizeof(detail::fast_log_header) + (detail::fast_log_size(args) + ... + 0) + 7) & ~static_cast<std::size_t>(7));
+    char * const start(ring->reserve(size));
+    if(start == nullptr)
+    {
+        return;
+    }
+
+    detail::fast_log_header h;
+    h.f_size = static_cast<std::uint32_t>(size);
+    h.f_site = site.get_id();
+    h.f_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    memcpy(start, &h, sizeof(h));
+    char * p(start + sizeof(h));
+    ((p = detail::fast_log_encode(p, args)), ...);
+    memset(p, 0, start + size - p);
+
+    ring->commit(size);
+}
+
+
+std::size_t             fast_log_flush();
+std::uint64_t           fast_log_dropped();
+
+
+class fast_log_writer
+{
+public:
+    static constexpr std::chrono::milliseconds const
+                        DEFAULT_PERIOD = std::chrono::milliseconds(10);
+
+                        fast_log_writer(std::chrono::milliseconds period = DEFAULT_PERIOD);
+                        fast_log_writer(fast_log_writer const & rhs) = delete;
+                        ~fast_log_writer();
+
+    fast_log_writer &   operator = (fast_log_writer const & rhs) = delete;
+
+private:
+    class writer_runner;
+
+    std::shared_ptr<writer_runner>
+                        f_runner = std::shared_ptr<writer_runner>();
+    thread::pointer_t   f_thread = thread::pointer_t();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
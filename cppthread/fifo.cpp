@@ -173,6 +173,102 @@ namespace cppthread
  * \return true if a value was popped, false otherwise.
  */
 
+/** \class fifo::pop_waiter
+ * \brief An object waiting for an item without blocking a thread.
+ *
+ * A pop_waiter registered with pop_front_or_wait() receives the next
+ * item pushed in the FIFO directly in its f_item field. Then its ready()
+ * function gets called. The coroutine awaiter returned by
+ * async_pop_front() is such a waiter.
+ */
+
+
+/** \fn fifo::pop_waiter::claim()
+ * \brief Check whether the waiter still wants an item.
+ *
+ * The FIFO calls this function, with its lock held, right before it
+ * hands an item to the waiter or releases it because the FIFO is done.
+ * If it returns false, the waiter is dropped and the item goes to the
+ * next waiter. This is how select() waits on several FIFOs at once yet
+ * only accepts one item.
+ *
+ * The default implementation always returns true.
+ *
+ * \return true if the waiter accepts the item.
+ */
+
+
+/** \fn fifo::pop_waiter::ready()
+ * \brief Called when the wait is over.
+ *
+ * The f_popped field tells whether f_item was set or the FIFO is done.
+ * The function is called without the FIFO lock held. It is expected to
+ * schedule the consumer, not to process the item.
+ */
+
+
+/** \var fifo::pop_waiter::f_item
+ * \brief The item popped for this waiter.
+ */
+
+
+/** \var fifo::pop_waiter::f_popped
+ * \brief Whether f_item was set.
+ *
+ * This is false when the FIFO was marked done before an item was
+ * available for this waiter.
+ */
+
+
+/** \var fifo::pop_waiter::f_next
+ * \brief The next waiter in the FIFO queue of waiters.
+ */
+
+
+/** \fn fifo::pop_front_or_wait(pop_waiter & w)
+ * \brief Pop an item or register a waiter.
+ *
+ * If an item can be popped, it is saved in the waiter and the function
+ * returns true. If the FIFO is done, f_popped is set to false and the
+ * function returns true. Otherwise the waiter is queued and the function
+ * returns false; the waiter's ready() function gets called later by
+ * push_back(), resume() or done().
+ *
+ * In the first two cases, the waiter's claim() function is called first.
+ * If it returns false, nothing is popped and the function still returns
+ * true.
+ *
+ * The waiters are served in order, so the first one to wait gets the
+ * next item. They get priority over threads blocked in pop_front().
+ *
+ * \note
+ * Items with a valid_workload() function returning false are only
+ * handed to waiters when another item is pushed or resume() is called.
+ *
+ * \note
+ * When the FIFO tracks unfinished items, an item handed to a waiter is
+ * considered finished right away. The consumers of select() and of the
+ * coroutine awaiters do not call task_done().
+ *
+ * \param[in] w  The waiter.
+ *
+ * \return true if the wait is already over.
+ */
+
+
+/** \fn fifo::cancel_wait(pop_waiter & w)
+ * \brief Remove a waiter from the queue.
+ *
+ * Once this function returns, the FIFO does not access \p w anymore,
+ * except for a ready() call already in progress for a waiter which was
+ * successfully claimed.
+ *
+ * \param[in] w  The waiter to remove.
+ *
+ * \return true if the waiter was still queued.
+ */
+
+
 /** \fn fifo::clear()
  * \brief Clear the current FIFO.
  *
@@ -188,6 +284,217 @@ namespace cppthread
  * \sa done()
  */
 
+/** \fn fifo::track_unfinished()
+ * \brief Count the items pushed and not yet processed.
+ *
+ * By default, a FIFO does not count its unfinished items so push_back()
+ * does not pay for it and the counter cannot wrap around on a FIFO
+ * whose consumers never call task_done().
+ *
+ * Once this function was called, the items pushed are counted as
+ * unfinished until:
+ *
+ * \li pop_front() returned the item and the consumer called task_done(),
+ * \li or the item was handed to a waiter (see pop_front_or_wait()),
+ * \li or the item was removed by clear() or done(true).
+ *
+ * The items already in the FIFO are counted. Call this function before
+ * any consumer starts popping items. The pool constructor calls it on
+ * its input FIFO so pool::wait_idle(), pool::drain() and pool::pause()
+ * work.
+ *
+ * \sa task_done()
+ * \sa wait_idle()
+ */
+
+
+/** \fn fifo::is_tracking_unfinished() const
+ * \brief Check whether the FIFO counts its unfinished items.
+ *
+ * \return true once track_unfinished() was called.
+ */
+
+
+/** \fn fifo::task_done()
+ * \brief Mark one item popped from the FIFO as processed.
+ *
+ * When tracking is on (see track_unfinished()), the FIFO counts the
+ * items pushed and not yet processed. An item remains unfinished after
+ * pop_front() returned it, until the consumer calls this function. The
+ * worker class calls it after each do_work().
+ *
+ * The threads blocked in wait_idle() or wait_processed() are woken up
+ * so they can check their condition again.
+ *
+ * When the FIFO does not track its unfinished items, the function does
+ * nothing, so a consumer such as the worker class can call it on any
+ * FIFO.
+ *
+ * \exception logic_error
+ * The function was called more times than items were pushed.
+ */
+
+
+/** \fn fifo::unfinished() const
+ * \brief Get the number of items not yet processed.
+ *
+ * This number includes the items in the FIFO and the items popped
+ * for which task_done() was not yet called. It is always zero when
+ * the FIFO does not track its unfinished items.
+ *
+ * \return The number of unfinished items.
+ */
+
+
+/** \fn fifo::wait_idle(int64_t const usecs)
+ * \brief Wait until all the items were processed.
+ *
+ * This function blocks until every item pushed in the FIFO was popped
+ * and marked done with task_done(). This is only useful on a FIFO which
+ * tracks its unfinished items (see track_unfinished()) and whose
+ * pop_front() consumers call task_done(), as the worker class does.
+ *
+ * The \p usecs parameter works like in pop_front(): -1 waits forever,
+ * 0 does not wait, and a positive number waits up to that many
+ * microseconds.
+ *
+ * \param[in] usecs  The number of microseconds to wait.
+ *
+ * \return true if all the items were processed.
+ */
+
+
+/** \fn fifo::wait_processed(int64_t const usecs)
+ * \brief Wait until all the popped items were processed.
+ *
+ * This function blocks until task_done() was called for every item
+ * returned by pop_front(). Items still in the FIFO are ignored. This is
+ * mainly useful after pause(), since no new items get popped in the
+ * meantime.
+ *
+ * The \p usecs parameter works like in wait_idle().
+ *
+ * \param[in] usecs  The number of microseconds to wait.
+ *
+ * \return true if no popped item remains to be processed.
+ *
+ * \sa pause()
+ */
+
+
+/** \fn fifo::pause()
+ * \brief Stop returning items from pop_front().
+ *
+ * While paused, the FIFO still accepts new items, but pop_front()
+ * behaves as if it were empty: it waits for resume() or returns false
+ * once its timeout is reached.
+ *
+ * Once done() was called, the pause is ignored so the consumers can
+ * process the remaining items and exit.
+ *
+ * \sa resume()
+ * \sa wait_processed()
+ */
+
+
+/** \fn fifo::resume()
+ * \brief Let pop_front() return items again.
+ *
+ * The consumers blocked in pop_front() are woken up.
+ *
+ * \sa pause()
+ */
+
+
+/** \fn fifo::is_paused() const
+ * \brief Check whether the FIFO is paused.
+ *
+ * \return true between calls to pause() and resume().
+ */
+
+
+/** \fn fifo::find_item()
+ * \brief Search the first item which can be processed.
+ *
+ * The FIFO lock must be held.
+ *
+ * \return An iterator to the item or f_queue.end().
+ */
+
+
+/** \fn fifo::take_item(T & v)
+ * \brief Remove the first item which can be processed.
+ *
+ * The FIFO lock must be held.
+ *
+ * \param[out] v  The item removed.
+ *
+ * \return true if an item was removed.
+ */
+
+
+/** \fn fifo::broadcast_if_drained()
+ * \brief Wake all the consumers once a done FIFO becomes empty.
+ */
+
+
+/** \fn fifo::unlink_waiter(pop_waiter * previous, pop_waiter * w)
+ * \brief Remove a waiter from the queue.
+ *
+ * \param[in] previous  The waiter before \p w or nullptr if \p w is first.
+ * \param[in] w  The waiter to remove.
+ */
+
+
+/** \fn fifo::serve_waiters()
+ * \brief Hand the available items to the queued waiters.
+ *
+ * The FIFO lock must be held. The served waiters are removed from the
+ * queue and returned as a list. The caller calls notify_waiters() on
+ * that list once it released the lock.
+ *
+ * \return The list of waiters which received an item.
+ */
+
+
+/** \fn fifo::notify_waiters(pop_waiter * w)
+ * \brief Call ready() on a list of waiters.
+ *
+ * \param[in] w  The first waiter of the list.
+ */
+
+
+/** \fn fifo::finished(std::size_t count)
+ * \brief Remove items which will never be processed.
+ *
+ * The clear() and done() functions call this function with the number
+ * of items they removed from the FIFO.
+ *
+ * \param[in] count  The number of items removed.
+ */
+
+
+/** \fn fifo::wake_idle_waiters()
+ * \brief Wake up the threads blocked in wait_idle() or wait_processed().
+ *
+ * The kernel is only called if a thread may be waiting.
+ */
+
+
+/** \fn fifo::wait_unfinished(F predicate, int64_t const usecs)
+ * \brief Wait until \p predicate returns true.
+ *
+ * The function sleeps on the f_unfinished counter and checks the
+ * predicate each time the counter changes.
+ *
+ * \tparam F  The type of the predicate.
+ * \param[in] predicate  The function checking the condition.
+ * \param[in] usecs  The number of microseconds to wait.
+ *
+ * \return true if the predicate returned true.
+ */
+
+
 /** \fn fifo::empty() const
  * \brief Test whether the FIFO is empty.
  *
@@ -242,6 +549,10 @@ namespace cppthread
  * If the FIFO is empty, this function also broadcasts a signal
  * to all the worker threads so that way they can exit.
  *
+ * \note
+ * The waiters registered with pop_front_or_wait() which do not get one
+ * of the remaining items are released with f_popped set to false.
+ *
  * \param[in] clear  Whether the function should also call clear()
  *
  * \sa clear()
@@ -283,6 +594,43 @@ namespace cppthread
  */
 
 
+/** \var fifo::f_paused
+ * \brief Whether pop_front() is currently blocked by pause().
+ */
+
+
+/** \var fifo::f_track_unfinished
+ * \brief Whether f_unfinished counts the items.
+ *
+ * The flag is atomic so task_done() can check it without the lock.
+ *
+ * \sa track_unfinished()
+ */
+
+
+/** \var fifo::f_waiters_head
+ * \brief The first waiter registered by pop_front_or_wait().
+ */
+
+
+/** \var fifo::f_waiters_tail
+ * \brief The last waiter registered by pop_front_or_wait().
+ */
+
+
+/** \var fifo::f_unfinished
+ * \brief The number of items pushed and not yet processed.
+ *
+ * This is also the futex word the wait_idle() and wait_processed()
+ * functions sleep on.
+ */
+
+
+/** \var fifo::f_idle_waiters
+ * \brief The number of threads blocked in wait_idle() or wait_processed().
+ */
+
+
 
 } // namespace cppthread
 // vim: ts=4 sw=4 et
@@ -31,6 +31,8 @@
 
 // self
 //
+#include    <cppthread/exception.h>
+#include    <cppthread/futex.h>
 #include    <cppthread/guard.h>
 #include    <cppthread/mutex.h>
 
@@ -42,6 +44,7 @@
 
 // C++
 //
+#include    <atomic>
 #include    <numeric>
 #include    <deque>
 
@@ -180,15 +183,51 @@ public:
     typedef fifo<value_type>                fifo_type;
     typedef std::shared_ptr<fifo_type>      pointer_t;
 
+    class pop_waiter
+    {
+    public:
+        virtual             ~pop_waiter()
+        {
+        }
+
+        virtual bool        claim()
+        {
+            return true;
+        }
+
+        virtual void        ready() = 0;
+
+    protected:
+        T                   f_item = T();
+        bool                f_popped = false;
+
+    private:
+        friend class fifo<T>;
+
+        pop_waiter *        f_next = nullptr;
+    };
+
     bool push_back(T const & v)
     {
-        guard lock(*this);
-        if(f_done)
+        pop_waiter * served(nullptr);
         {
-            return false;
+            guard lock(*this);
+            if(f_done)
+            {
+                return false;
+            }
+            f_queue.push_back(v);
+            if(f_track_unfinished.load(std::memory_order_relaxed))
+            {
+                f_unfinished.fetch_add(1, std::memory_order_relaxed);
+            }
+            served = serve_waiters();
+            if(served == nullptr)
+            {
+                signal();
+            }
         }
-        f_queue.push_back(v);
-        signal();
+        notify_waiters(served);
         return true;
     }
 
@@ -196,32 +235,12 @@ public:
     {
         guard lock(*this);
 
-        auto cleanup = [&]()
-            {
-                if(f_done && !f_broadcast && f_queue.empty())
-                {
-                    // make sure all the threads wake up on this new
-                    // "queue is empty" status
-                    //
-                    broadcast();
-                    f_broadcast = true;
-                }
-            };
-
         for(;;)
         {
-            // search for an item we can pop now
-            //
-            for(auto it(f_queue.begin()); it != f_queue.end(); ++it)
+            if(take_item(v))
             {
-                bool const result(validate_item<T>(*it));
-                if(result)
-                {
-                    v = *it;
-                    f_queue.erase(it);
-                    cleanup();
-                    return true;
-                }
+                broadcast_if_drained();
+                return true;
             }
 
             if(f_done)
@@ -252,7 +271,46 @@ public:
                 break;
             }
         }
-        cleanup();
+        broadcast_if_drained();
+        return false;
+    }
+
+    bool pop_front_or_wait(pop_waiter & w)
+    {
+        guard lock(*this);
+
+        auto it(find_item());
+        if(it != f_queue.end())
+        {
+            if(w.claim())
+            {
+                w.f_item = *it;
+                w.f_popped = true;
+                f_queue.erase(it);
+                finished(1);
+                broadcast_if_drained();
+            }
+            return true;
+        }
+        if(f_done)
+        {
+            if(w.claim())
+            {
+                w.f_popped = false;
+            }
+            return true;
+        }
+
+        w.f_next = nullptr;
+        if(f_waiters_tail == nullptr)
+        {
+            f_waiters_head = &w;
+        }
+        else
+        {
+            f_waiters_tail->f_next = &w;
+        }
+        f_waiters_tail = &w;
         return false;
     }
 
@@ -261,6 +319,112 @@ public:
         guard lock(*this);
         items_t empty;
         f_queue.swap(empty);
+        finished(empty.size());
+    }
+
+    void track_unfinished()
+    {
+        guard lock(*this);
+        if(!f_track_unfinished.load(std::memory_order_relaxed))
+        {
+            f_track_unfinished.store(true, std::memory_order_release);
+            f_unfinished.store(static_cast<std::uint32_t>(f_queue.size()), std::memory_order_release);
+        }
+    }
+
+    bool is_tracking_unfinished() const
+    {
+        return f_track_unfinished.load(std::memory_order_acquire);
+    }
+
+    void task_done()
+    {
+        if(!f_track_unfinished.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        std::uint32_t unfinished(f_unfinished.load(std::memory_order_relaxed));
+        do
+        {
+            if(unfinished == 0)
+            {
+                throw logic_error("fifo::task_done() called more times than items were pushed.");
+            }
+        }
+        while(!f_unfinished.compare_exchange_weak(unfinished, unfinished - 1, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+        wake_idle_waiters();
+    }
+
+    std::uint32_t unfinished() const
+    {
+        return f_unfinished.load(std::memory_order_acquire);
+    }
+
+    bool wait_idle(int64_t const usecs = -1)
+    {
+        return wait_unfinished(
+                  [this]()
+                  {
+                      return f_unfinished.load(std::memory_order_acquire) == 0;
+                  }
+                , usecs);
+    }
+
+    bool wait_processed(int64_t const usecs = -1)
+    {
+        return wait_unfinished(
+                  [this]()
+                  {
+                      guard lock(*this);
+                      return f_unfinished.load(std::memory_order_acquire) == f_queue.size();
+                  }
+                , usecs);
+    }
+
+    bool cancel_wait(pop_waiter & w)
+    {
+        guard lock(*this);
+
+        pop_waiter * previous(nullptr);
+        for(pop_waiter * p(f_waiters_head); p != nullptr; previous = p, p = p->f_next)
+        {
+            if(p == &w)
+            {
+                unlink_waiter(previous, p);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void pause()
+    {
+        guard lock(*this);
+        f_paused = true;
+    }
+
+    void resume()
+    {
+        pop_waiter * served(nullptr);
+        {
+            guard lock(*this);
+            if(!f_paused)
+            {
+                return;
+            }
+            f_paused = false;
+            served = serve_waiters();
+            broadcast();
+        }
+        notify_waiters(served);
+    }
+
+    bool is_paused() const
+    {
+        guard lock(const_cast<fifo &>(*this));
+        return f_paused;
     }
 
     bool empty() const
@@ -290,18 +454,50 @@ public:
 
     void done(bool clear)
     {
-        guard lock(*this);
-        f_done = true;
-        if(clear)
+        pop_waiter * served(nullptr);
+        pop_waiter * failed(nullptr);
         {
-            items_t empty;
-            f_queue.swap(empty);
-        }
-        if(f_queue.empty())
-        {
-            broadcast();
-            f_broadcast = true;
+            guard lock(*this);
+            f_done = true;
+            if(clear)
+            {
+                items_t empty;
+                f_queue.swap(empty);
+                finished(empty.size());
+            }
+
+            // waiters can still get the items left in a paused FIFO, the
+            // others will never receive anything
+            //
+            served = serve_waiters();
+            pop_waiter ** last(&failed);
+            while(f_waiters_head != nullptr)
+            {
+                pop_waiter * w(f_waiters_head);
+                unlink_waiter(nullptr, w);
+                if(w->claim())
+                {
+                    w->f_popped = false;
+                    *last = w;
+                    last = &w->f_next;
+                }
+            }
+
+            if(f_queue.empty())
+            {
+                broadcast();
+                f_broadcast = true;
+            }
+            else if(f_paused)
+            {
+                // the consumers sleeping on the pause must now process
+                // the remaining items
+                //
+                broadcast();
+            }
         }
+        notify_waiters(served);
+        notify_waiters(failed);
     }
 
     bool is_done() const
@@ -311,9 +507,176 @@ public:
     }
 
 private:
+    typename items_t::iterator find_item()
+    {
+        // search for an item we can pop now; a paused FIFO does not
+        // return items unless it is also done
+        //
+        if(f_paused && !f_done)
+        {
+            return f_queue.end();
+        }
+        for(auto it(f_queue.begin()); it != f_queue.end(); ++it)
+        {
+            if(validate_item<T>(*it))
+            {
+                return it;
+            }
+        }
+        return f_queue.end();
+    }
+
+    bool take_item(T & v)
+    {
+        auto it(find_item());
+        if(it == f_queue.end())
+        {
+            return false;
+        }
+        v = *it;
+        f_queue.erase(it);
+        return true;
+    }
+
+    void broadcast_if_drained()
+    {
+        if(f_done && !f_broadcast && f_queue.empty())
+        {
+            // make sure all the threads wake up on this new
+            // "queue is empty" status
+            //
+            broadcast();
+            f_broadcast = true;
+        }
+    }
+
+    void unlink_waiter(pop_waiter * previous, pop_waiter * w)
+    {
+        if(previous == nullptr)
+        {
+            f_waiters_head = w->f_next;
+        }
+        else
+        {
+            previous->f_next = w->f_next;
+        }
+        if(f_waiters_tail == w)
+        {
+            f_waiters_tail = previous;
+        }
+        w->f_next = nullptr;
+    }
+
+    pop_waiter * serve_waiters()
+    {
+        pop_waiter * served(nullptr);
+        pop_waiter ** last(&served);
+        while(f_waiters_head != nullptr)
+        {
+            auto it(find_item());
+            if(it == f_queue.end())
+            {
+                break;
+            }
+
+            // a waiter which cannot be claimed was already satisfied
+            // by another FIFO (see select()); just drop it
+            //
+            pop_waiter * w(f_waiters_head);
+            unlink_waiter(nullptr, w);
+            if(!w->claim())
+            {
+                continue;
+            }
+            w->f_item = *it;
+            w->f_popped = true;
+            f_queue.erase(it);
+            finished(1);
+            *last = w;
+            last = &w->f_next;
+        }
+        if(served != nullptr)
+        {
+            broadcast_if_drained();
+        }
+        return served;
+    }
+
+    static void notify_waiters(pop_waiter * w)
+    {
+        while(w != nullptr)
+        {
+            // the waiter may be gone once ready() returns
+            //
+            pop_waiter * next(w->f_next);
+            w->ready();
+            w = next;
+        }
+    }
+
+    void finished(std::size_t count)
+    {
+        if(count == 0
+        || !f_track_unfinished.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        f_unfinished.fetch_sub(static_cast<std::uint32_t>(count), std::memory_order_seq_cst);
+        wake_idle_waiters();
+    }
+
+    template<typename F>
+    bool wait_unfinished(F predicate, int64_t const usecs)
+    {
+        std::chrono::steady_clock::time_point deadline;
+        if(usecs >= 0)
+        {
+            deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(usecs);
+        }
+        for(;;)
+        {
+            // load the counter first so a change happening while we
+            // check the predicate prevents the futex from sleeping
+            //
+            std::uint32_t const unfinished(f_unfinished.load(std::memory_order_acquire));
+            if(predicate())
+            {
+                return true;
+            }
+            if(usecs == 0)
+            {
+                return false;
+            }
+
+            f_idle_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool const woken(detail::futex_wait(f_unfinished, unfinished, usecs < 0 ? nullptr : &deadline));
+            f_idle_waiters.fetch_sub(1, std::memory_order_relaxed);
+            if(!woken)
+            {
+                return predicate();
+            }
+        }
+    }
+
+    void wake_idle_waiters()
+    {
+        if(f_idle_waiters.load(std::memory_order_seq_cst) != 0)
+        {
+            detail::futex_wake(f_unfinished);
+        }
+    }
+
     items_t                 f_queue = items_t();
     bool                    f_done = false;
     bool                    f_broadcast = false;
+    bool                    f_paused = false;
+    std::atomic<bool>       f_track_unfinished = false;
+    pop_waiter *            f_waiters_head = nullptr;
+    pop_waiter *            f_waiters_tail = nullptr;
+    std::atomic<std::uint32_t>
+                            f_unfinished = 0;
+    std::atomic<std::uint32_t>
+                            f_idle_waiters = 0;
 };
 
 
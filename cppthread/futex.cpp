@@ -0,0 +1,138 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the futex wrappers.
+ *
+ * A futex lets a thread sleep in the kernel until the value of a word
+ * in memory changes. The fast paths of our synchronization primitives
+ * only use atomic operations on that word; the kernel is only called
+ * when a thread has to wait or when a thread may be waiting.
+ */
+
+
+// self
+//
+#include    "cppthread/futex.h"
+
+
+// C
+//
+#include    <errno.h>
+#include    <linux/futex.h>
+#include    <sys/syscall.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+namespace detail
+{
+
+
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t)
+            , "the futex functions require an std::atomic<std::uint32_t> to be a plain 32 bit word.");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free
+            , "the futex functions require a lock free std::atomic<std::uint32_t>.");
+
+
+
+/** \brief Sleep while a word has the expected value.
+ *
+ * If \p word is not equal to \p expected, the function returns
+ * immediately. Otherwise the thread sleeps until another thread calls
+ * futex_wake() on that word, the \p deadline is reached, or a signal
+ * is received.
+ *
+ * Like a condition, the function may return without the value having
+ * changed, so it has to be called in a loop checking the value.
+ *
+ * \param[in] word  The word to wait on.
+ * \param[in] expected  The value the word must have for the thread to
+ * go to sleep.
+ * \param[in] deadline  When to stop waiting, or nullptr to wait forever.
+ *
+ * \return false if the deadline was reached, true otherwise.
+ */
+bool futex_wait(
+      std::atomic<std::uint32_t> & word
+    , std::uint32_t expected
+    , std::chrono::steady_clock::time_point const * deadline)
+{
+    timespec abs_time = {};
+    timespec * timeout(nullptr);
+    if(deadline != nullptr)
+    {
+        if(*deadline <= std::chrono::steady_clock::now())
+        {
+            return false;
+        }
+
+        // FUTEX_WAIT_BITSET uses an absolute CLOCK_MONOTONIC time which
+        // is what the steady_clock uses under Linux
+        //
+        std::int64_t const ns(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        deadline->time_since_epoch()).count());
+        abs_time.tv_sec = ns / 1'000'000'000;
+        abs_time.tv_nsec = ns % 1'000'000'000;
+        timeout = &abs_time;
+    }
+
+    long const r(syscall(
+              SYS_futex
+            , reinterpret_cast<std::uint32_t *>(&word)
+            , FUTEX_WAIT_BITSET_PRIVATE
+            , expected
+            , timeout
+            , nullptr
+            , FUTEX_BITSET_MATCH_ANY));
+    return r == 0 || errno != ETIMEDOUT;
+}
+
+
+/** \brief Wake up threads sleeping on a word.
+ *
+ * \param[in] word  The word the threads are waiting on.
+ * \param[in] count  The maximum number of threads to wake up.
+ */
+void futex_wake(std::atomic<std::uint32_t> & word, int count)
+{
+    syscall(
+          SYS_futex
+        , reinterpret_cast<std::uint32_t *>(&word)
+        , FUTEX_WAKE_PRIVATE
+        , count
+        , nullptr
+        , nullptr
+        , 0);
+}
+
+
+
+} // namespace detail
+} // namespace cppthread
+// vim: ts=4 sw=4 et
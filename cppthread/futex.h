@@ -0,0 +1,57 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Thin wrappers around the Linux futex system call.
+ *
+ * The latch, barrier, and semaphore classes, as well as the pool
+ * templates, sleep on a 32 bit atomic word with these functions.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <cstdint>
+#include    <limits>
+
+
+
+namespace cppthread
+{
+namespace detail
+{
+
+
+
+bool                    futex_wait(
+                              std::atomic<std::uint32_t> & word
+                            , std::uint32_t expected
+                            , std::chrono::steady_clock::time_point const * deadline = nullptr);
+void                    futex_wake(
+                              std::atomic<std::uint32_t> & word
+                            , int count = std::numeric_limits<int>::max());
+
+
+
+} // namespace detail
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -29,6 +29,7 @@
 #include    "cppthread/guard.h"
 
 #include    "cppthread/exception.h"
+#include    "cppthread/lockable.h"
 #include    "cppthread/log.h"
 #include    "cppthread/mutex.h"
 
@@ -58,6 +59,9 @@ namespace cppthread
  *    }
  * \endcode
  *
+ * The guard works with any lockable object: mutex, spinlock, and
+ * ticket_lock.
+ *
  * \warning
  * This guard implementation assumes that the guard itself is used in one
  * single thread. In other words, even though you could add a guard inside
@@ -82,7 +86,7 @@ namespace cppthread
  *
  * \param[in] m  The Snap! mutex to lock.
  */
-guard::guard(mutex & m)
+guard::guard(lockable & m)
     : f_mutex(&m)
 {
     if(f_mutex == nullptr)
@@ -96,6 +100,41 @@ guard::guard(mutex & m)
 }
 
 
+/** \brief Lock a mutex with a timeout.
+ *
+ * This function tries to lock the specified mutex for up to \p timeout.
+ * If the lock is obtained, the guard behaves like a guard created
+ * without a timeout.
+ *
+ * If the mutex could not be locked in time, the guard is created in the
+ * "done" state: is_locked() returns false and lock() does nothing. This
+ * allows a request handler to fail fast instead of waiting on a stuck
+ * owner:
+ *
+ * \code
+ *     cppthread::guard lock(f_mutex, std::chrono::milliseconds(50));
+ *     if(!lock.is_locked())
+ *     {
+ *         return reply_busy();
+ *     }
+ *     ...
+ * \endcode
+ *
+ * \param[in] m  The Snap! mutex to lock.
+ * \param[in] timeout  The maximum amount of time to wait for the lock.
+ *
+ * \sa mutex::try_lock_for()
+ */
+guard::guard(mutex & m, std::chrono::nanoseconds const & timeout)
+{
+    if(m.try_lock_for(timeout))
+    {
+        f_mutex = &m;
+        f_locked = true;
+    }
+}
+
+
 /** \brief Ensure that the mutex was unlocked.
  *
  * The destructor ensures that the mutex gets unlocked. Note that it is
@@ -143,7 +182,7 @@ void guard::unlock(bool done)
 {
     if(f_locked)
     {
-        mutex * m(f_mutex);
+        lockable * m(f_mutex);
         f_locked = false;
         if(done)
         {
@@ -188,9 +227,10 @@ void guard::unlock(bool done)
  * is in a known state (i.e. unlocked when exiting the guarded block).
  *
  * \note
- * This implementation always attempts a mutex::lock(), checks whether it
- * was necessary (i.e. is the f_locked flag false?) and if not, it unlocks
- * the mutex (since the guard already had the lock to itself).
+ * The guard may be used with locks which are not recursive (see the
+ * spinlock and ticket_lock classes) so the function first checks the
+ * f_locked flag and only locks if the guard does not already hold
+ * the lock.
  *
  * \warning
  * It is not 100% safe to call this function when the guard::unlock()
@@ -202,21 +242,14 @@ void guard::unlock(bool done)
  */
 void guard::lock()
 {
-    if(f_mutex == nullptr)
+    if(f_mutex == nullptr
+    || f_locked)
     {
         return;
     }
 
     f_mutex->lock();
-
-    if(f_locked)
-    {
-        f_mutex->unlock();
-    }
-    else
-    {
-        f_locked = true;
-    }
+    f_locked = true;
 }
 
 
@@ -235,15 +268,7 @@ void guard::lock()
  */
 bool guard::is_locked() const
 {
-    bool result(f_mutex != nullptr);
-    if(result)
-    {
-        f_mutex->lock();
-        result = f_locked;
-        f_mutex->unlock();
-    }
-
-    return result;
+    return f_mutex != nullptr && f_locked;
 }
 
 
@@ -30,18 +30,25 @@
  */
 
 
+// C++
+//
+#include    <chrono>
+
+
 
 namespace cppthread
 {
 
 
+class lockable;
 class mutex;
 
 
 class guard
 {
 public:
-                        guard(mutex & m);
+                        guard(lockable & m);
+                        guard(mutex & m, std::chrono::nanoseconds const & timeout);
                         guard(guard const & rhs) = delete;
                         ~guard();
 
@@ -53,7 +60,7 @@ public:
 
 private:
     bool                f_locked = false;
-    mutex *             f_mutex = nullptr;
+    lockable *          f_mutex = nullptr;
 };
 
 
@@ -0,0 +1,966 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the asynchronous file I/O executor.
+ *
+ * The io_uring interface is used directly through its system calls so
+ * the library does not depend on liburing. Only the few operations we
+ * need are implemented: read, write and fsync.
+ */
+
+
+// self
+//
+#include    "cppthread/io_executor.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/log.h"
+#include    "cppthread/runner.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <vector>
+
+
+// C
+//
+#include    <errno.h>
+#include    <linux/io_uring.h>
+#include    <sys/eventfd.h>
+#include    <sys/mman.h>
+#include    <sys/syscall.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The largest transfer size accepted by read() and write().
+ *
+ * Linux limits a single read() or write() to this many bytes. We apply
+ * the same limit to the length of an io_uring request which is only
+ * 32 bits.
+ */
+constexpr std::size_t const         MAX_TRANSFER_SIZE = 0x7FFFF000;
+
+
+/** \brief The user data of the eventfd read request.
+ *
+ * The other requests use the index of their slot as their user data.
+ */
+constexpr std::uint64_t const       EVENTFD_USER_DATA = static_cast<std::uint64_t>(-1);
+
+
+
+} // no name namespace
+
+
+
+/** \brief The runner of the io_uring thread.
+ *
+ * The runner owns the ring. It pops requests from the executor fifo,
+ * adds them to the submission queue, and submits the whole batch with
+ * one io_uring_enter() call which also waits for at least one
+ * completion.
+ *
+ * A read on an eventfd is always pending in the ring. Writing to that
+ * eventfd wakes up the runner when new requests were added to the fifo
+ * or when the thread is asked to stop.
+ */
+class io_executor::uring_runner
+    : public runner
+{
+public:
+    uring_runner(
+              std::string const & name
+            , std::size_t queue_depth
+            , io_request::fifo_t::pointer_t requests)
+        : runner(name)
+        , f_requests(requests)
+    {
+        setup(queue_depth);
+    }
+
+    virtual ~uring_runner() override
+    {
+        // closing the ring first cancels the pending eventfd read
+        //
+        if(f_ring_fd != -1)
+        {
+            close(f_ring_fd);
+        }
+        if(f_sqes != MAP_FAILED)
+        {
+            munmap(f_sqes, f_sqes_size);
+        }
+        if(f_cq_ring != MAP_FAILED
+        && f_cq_ring != f_sq_ring)
+        {
+            munmap(f_cq_ring, f_cq_ring_size);
+        }
+        if(f_sq_ring != MAP_FAILED)
+        {
+            munmap(f_sq_ring, f_sq_ring_size);
+        }
+        if(f_event_fd != -1)
+        {
+            close(f_event_fd);
+        }
+    }
+
+    bool is_valid() const
+    {
+        return f_ring_fd != -1 && f_event_fd != -1;
+    }
+
+    virtual void wakeup() override
+    {
+        std::uint64_t const one(1);
+        while(::write(f_event_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+    }
+
+    void request_added()
+    {
+        // only the first request of a batch needs to wake the runner up
+        //
+        if(!f_wakeup_pending.exchange(true, std::memory_order_acq_rel))
+        {
+            wakeup();
+        }
+    }
+
+    virtual void run() override
+    {
+        arm_eventfd();
+
+        for(;;)
+        {
+            // clear the flag before popping so a request added after
+            // the last pop_front() writes to the eventfd again
+            //
+            f_wakeup_pending.store(false, std::memory_order_release);
+
+            io_request::pointer_t r;
+            while(f_in_flight < f_capacity
+               && f_requests->pop_front(r, 0))
+            {
+                start(r);
+            }
+
+            // on a stop, we still run all the requests already queued
+            //
+            if(f_in_flight == 0
+            && !continue_running()
+            && f_requests->empty())
+            {
+                return;
+            }
+
+            submit_and_wait(1);
+            reap();
+        }
+    }
+
+private:
+    void setup(std::size_t queue_depth)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        std::size_t const depth(std::clamp<std::size_t>(queue_depth, 2, 4096));
+        int const fd(syscall(__NR_io_uring_setup, static_cast<unsigned>(depth), &params));
+        if(fd < 0)
+        {
+            return;
+        }
+        f_ring_fd = fd;
+
+        // IORING_OP_READ and IORING_OP_WRITE appeared along this feature
+        // (Linux 5.6); older kernels use the thread pool
+        //
+        if((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+        {
+            close(f_ring_fd);
+            f_ring_fd = -1;
+            return;
+        }
+
+        f_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+        f_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool const single_mmap((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+        if(single_mmap)
+        {
+            f_sq_ring_size = std::max(f_sq_ring_size, f_cq_ring_size);
+        }
+        f_sq_ring = mmap(
+                  nullptr
+                , f_sq_ring_size
+                , PROT_READ | PROT_WRITE
+                , MAP_SHARED | MAP_POPULATE
+                , f_ring_fd
+                , IORING_OFF_SQ_RING);
+        if(f_sq_ring == MAP_FAILED)
+        {
+            close(f_ring_fd);
+            f_ring_fd = -1;
+            return;
+        }
+        if(single_mmap)
+        {
+            f_cq_ring = f_sq_ring;
+        }
+        else
+        {
+            f_cq_ring = mmap(
+                      nullptr
+                    , f_cq_ring_size
+                    , PROT_READ | PROT_WRITE
+                    , MAP_SHARED | MAP_POPULATE
+                    , f_ring_fd
+                    , IORING_OFF_CQ_RING);
+            if(f_cq_ring == MAP_FAILED)
+            {
+                close(f_ring_fd);
+                f_ring_fd = -1;
+                return;
+            }
+        }
+        f_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void * sqes(mmap(
+                  nullptr
+                , f_sqes_size
+                , PROT_READ | PROT_WRITE
+                , MAP_SHARED | MAP_POPULATE
+                , f_ring_fd
+                , IORING_OFF_SQES));
+        if(sqes == MAP_FAILED)
+        {
+            close(f_ring_fd);
+            f_ring_fd = -1;
+            return;
+        }
+        f_sqes = static_cast<io_uring_sqe *>(sqes);
+
+        char * sq(static_cast<char *>(f_sq_ring));
+        f_sq_tail = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.tail);
+        f_sq_mask = *reinterpret_cast<std::uint32_t *>(sq + params.sq_off.ring_mask);
+        f_sq_array = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.array);
+
+        char * cq(static_cast<char *>(f_cq_ring));
+        f_cq_head = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.head);
+        f_cq_tail = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.tail);
+        f_cq_mask = *reinterpret_cast<std::uint32_t *>(cq + params.cq_off.ring_mask);
+        f_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        // one entry is kept for the eventfd read; the completion queue
+        // is twice as large so it cannot overflow
+        //
+        f_capacity = params.sq_entries - 1;
+        f_slots.resize(f_capacity);
+        f_free_slots.reserve(f_capacity);
+        for(std::size_t idx(f_capacity); idx > 0; --idx)
+        {
+            f_free_slots.push_back(idx - 1);
+        }
+
+        f_event_fd = eventfd(0, EFD_CLOEXEC);
+    }
+
+    void push_sqe(
+              std::uint8_t opcode
+            , int fd
+            , void * buffer
+            , std::size_t size
+            , off_t offset
+            , std::uint64_t user_data)
+    {
+        // we are the only producer so our own tail needs no atomic load;
+        // the in-flight limit guarantees the submission queue has room
+        //
+        std::uint32_t const tail(*f_sq_tail);
+        std::uint32_t const idx(tail & f_sq_mask);
+        io_uring_sqe * sqe(f_sqes + idx);
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(buffer);
+        sqe->len = static_cast<std::uint32_t>(std::min(size, MAX_TRANSFER_SIZE));
+        sqe->off = static_cast<std::uint64_t>(offset);
+        sqe->user_data = user_data;
+        f_sq_array[idx] = idx;
+        __atomic_store_n(f_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++f_to_submit;
+    }
+
+    void arm_eventfd()
+    {
+        push_sqe(
+                  IORING_OP_READ
+                , f_event_fd
+                , &f_eventfd_value
+                , sizeof(f_eventfd_value)
+                , 0
+                , EVENTFD_USER_DATA);
+    }
+
+    void start(io_request::pointer_t r)
+    {
+        std::uint8_t opcode(IORING_OP_NOP);
+        switch(r->get_operation())
+        {
+        case io_operation_t::IO_OPERATION_READ:
+            opcode = IORING_OP_READ;
+            break;
+
+        case io_operation_t::IO_OPERATION_WRITE:
+            opcode = IORING_OP_WRITE;
+            break;
+
+        case io_operation_t::IO_OPERATION_FSYNC:
+            opcode = IORING_OP_FSYNC;
+            break;
+
+        }
+
+        std::size_t const slot(f_free_slots.back());
+        f_free_slots.pop_back();
+        f_slots[slot] = r;
+        ++f_in_flight;
+
+        push_sqe(
+                  opcode
+                , r->get_fd()
+                , r->get_buffer()
+                , r->get_size()
+                , r->get_offset()
+                , slot);
+    }
+
+    void submit_and_wait(std::uint32_t min_complete)
+    {
+        for(;;)
+        {
+            int const r(syscall(
+                      __NR_io_uring_enter
+                    , f_ring_fd
+                    , f_to_submit
+                    , min_complete
+                    , IORING_ENTER_GETEVENTS
+                    , nullptr
+                    , 0));
+            if(r >= 0)
+            {
+                f_to_submit -= std::min<std::uint32_t>(r, f_to_submit);
+                return;
+            }
+            int const e(errno);
+            if(e == EINTR)
+            {
+                continue;
+            }
+            if(e == EAGAIN
+            || e == EBUSY)
+            {
+                // the kernel is short on resources; what completed so
+                // far gets reaped and we try again on the next loop
+                //
+                return;
+            }
+            log << log_level_t::error
+                << "io_uring_enter() failed with error #"
+                << e
+                << " -- "
+                << strerror(e)
+                << end;
+            throw system_error("io_uring_enter() failed");
+        }
+    }
+
+    void reap()
+    {
+        std::uint32_t head(*f_cq_head);
+        std::uint32_t const tail(__atomic_load_n(f_cq_tail, __ATOMIC_ACQUIRE));
+        for(; head != tail; ++head)
+        {
+            io_uring_cqe const & cqe(f_cqes[head & f_cq_mask]);
+            if(cqe.user_data == EVENTFD_USER_DATA)
+            {
+                // a wakeup; the next loop pops the new requests
+                //
+                arm_eventfd();
+                continue;
+            }
+
+            std::size_t const slot(cqe.user_data);
+            io_request::pointer_t r(std::move(f_slots[slot]));
+            f_free_slots.push_back(slot);
+            --f_in_flight;
+
+            r->complete(cqe.res);
+            f_requests->task_done();
+        }
+        __atomic_store_n(f_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    io_request::fifo_t::pointer_t       f_requests = io_request::fifo_t::pointer_t();
+    int                                 f_ring_fd = -1;
+    int                                 f_event_fd = -1;
+    std::uint64_t                       f_eventfd_value = 0;
+    std::atomic<bool>                   f_wakeup_pending = false;
+    void *                              f_sq_ring = MAP_FAILED;
+    std::size_t                         f_sq_ring_size = 0;
+    void *                              f_cq_ring = MAP_FAILED;
+    std::size_t                         f_cq_ring_size = 0;
+    io_uring_sqe *                      f_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t                         f_sqes_size = 0;
+    std::uint32_t *                     f_sq_tail = nullptr;
+    std::uint32_t                       f_sq_mask = 0;
+    std::uint32_t *                     f_sq_array = nullptr;
+    std::uint32_t *                     f_cq_head = nullptr;
+    std::uint32_t *                     f_cq_tail = nullptr;
+    std::uint32_t                       f_cq_mask = 0;
+    io_uring_cqe *                      f_cqes = nullptr;
+    std::uint32_t                       f_to_submit = 0;
+    std::size_t                         f_capacity = 0;
+    std::size_t                         f_in_flight = 0;
+    std::vector<io_request::pointer_t>  f_slots = std::vector<io_request::pointer_t>();
+    std::vector<std::size_t>            f_free_slots = std::vector<std::size_t>();
+};
+
+
+
+/** \class io_request
+ * \brief One file I/O operation.
+ *
+ * A request describes a pread(), pwrite() or fsync() call. The buffer
+ * belongs to the caller and must remain valid until the request
+ * completed.
+ *
+ * Once the operation is done, the result is available with
+ * get_result(), through the future returned by get_future(), and the
+ * request is pushed in its completion fifo if one was specified.
+ */
+
+
+/** \brief Initialize an I/O request.
+ *
+ * \param[in] operation  The operation to run.
+ * \param[in] fd  The file descriptor.
+ * \param[in] buffer  The buffer to read into or write from.
+ * \param[in] size  The number of bytes to read or write.
+ * \param[in] offset  The position in the file.
+ */
+io_request::io_request(
+          io_operation_t operation
+        , int fd
+        , void * buffer
+        , std::size_t size
+        , off_t offset)
+    : f_operation(operation)
+    , f_fd(fd)
+    , f_buffer(buffer)
+    , f_size(size)
+    , f_offset(offset)
+{
+}
+
+
+/** \brief Get the operation of this request.
+ *
+ * \return The operation.
+ */
+io_operation_t io_request::get_operation() const
+{
+    return f_operation;
+}
+
+
+/** \brief Get the file descriptor.
+ *
+ * \return The file descriptor.
+ */
+int io_request::get_fd() const
+{
+    return f_fd;
+}
+
+
+/** \brief Get the buffer.
+ *
+ * \return The pointer to the caller's buffer.
+ */
+void * io_request::get_buffer() const
+{
+    return f_buffer;
+}
+
+
+/** \brief Get the number of bytes to transfer.
+ *
+ * \return The size of the buffer.
+ */
+std::size_t io_request::get_size() const
+{
+    return f_size;
+}
+
+
+/** \brief Get the offset in the file.
+ *
+ * \return The position where the transfer starts.
+ */
+off_t io_request::get_offset() const
+{
+    return f_offset;
+}
+
+
+/** \brief Set the fifo receiving this request once completed.
+ *
+ * This is useful when a worker handles the completions of many requests;
+ * it pops them from that fifo instead of waiting on each future.
+ *
+ * This function must be called before the request gets submitted.
+ *
+ * \param[in] completed  The fifo where the completed request is pushed.
+ */
+void io_request::set_completion_fifo(fifo_t::pointer_t completed)
+{
+    f_completed = completed;
+}
+
+
+/** \brief Get a future receiving the result.
+ *
+ * This function can be called only once per request.
+ *
+ * \return The future set to the result of the operation.
+ *
+ * \sa get_result()
+ */
+std::future<std::int64_t> io_request::get_future()
+{
+    return f_promise.get_future();
+}
+
+
+/** \brief Get the result of the operation.
+ *
+ * The result is the one of the corresponding system call: the number of
+ * bytes transferred or 0 for fsync(). On an error, the result is the
+ * negated errno.
+ *
+ * Like pread() and pwrite(), a transfer can be shorter than requested.
+ *
+ * \return The result or 0 if the request is not yet done.
+ */
+std::int64_t io_request::get_result() const
+{
+    return f_result.load(std::memory_order_acquire);
+}
+
+
+/** \brief Check whether the request completed.
+ *
+ * \return true once the result is available.
+ */
+bool io_request::is_done() const
+{
+    return f_done.load(std::memory_order_acquire);
+}
+
+
+/** \brief Run the operation with a blocking system call.
+ *
+ * This is used by the thread pool when io_uring is not available.
+ *
+ * \return The result of the system call or the negated errno.
+ */
+std::int64_t io_request::execute()
+{
+    for(;;)
+    {
+        ssize_t r(-1);
+        switch(f_operation)
+        {
+        case io_operation_t::IO_OPERATION_READ:
+            r = pread(f_fd, f_buffer, std::min(f_size, MAX_TRANSFER_SIZE), f_offset);
+            break;
+
+        case io_operation_t::IO_OPERATION_WRITE:
+            r = pwrite(f_fd, f_buffer, std::min(f_size, MAX_TRANSFER_SIZE), f_offset);
+            break;
+
+        case io_operation_t::IO_OPERATION_FSYNC:
+            r = ::fsync(f_fd);
+            break;
+
+        }
+        if(r >= 0)
+        {
+            return r;
+        }
+        if(errno != EINTR)
+        {
+            return -errno;
+        }
+    }
+}
+
+
+/** \brief Save the result and notify the caller.
+ *
+ * The future gets its value and the request is pushed in its
+ * completion fifo, if any.
+ *
+ * \param[in] result  The result of the operation.
+ */
+void io_request::complete(std::int64_t result)
+{
+    f_result.store(result, std::memory_order_release);
+    f_done.store(true, std::memory_order_release);
+    f_promise.set_value(result);
+    if(f_completed != nullptr)
+    {
+        f_completed->push_back(shared_from_this());
+    }
+}
+
+
+
+/** \class io_worker
+ * \brief The worker used when io_uring is not available.
+ *
+ * Each worker runs one blocking system call at a time.
+ */
+
+
+/** \brief Initialize the I/O worker.
+ *
+ * \param[in] name  The name of the worker.
+ * \param[in] position  The position of the worker in the pool.
+ * \param[in] in  The fifo of requests.
+ * \param[in] out  The output fifo, always nullptr.
+ */
+io_worker::io_worker(
+          std::string const & name
+        , std::size_t position
+        , io_request::fifo_t::pointer_t in
+        , io_request::fifo_t::pointer_t out)
+    : worker<io_request::pointer_t>(name, position, in, out)
+{
+}
+
+
+/** \brief Run one request.
+ *
+ * \return Always false; the completion fifo is part of the request.
+ */
+bool io_worker::do_work()
+{
+    f_workload->complete(f_workload->execute());
+    f_workload.reset();
+    return false;
+}
+
+
+
+/** \class io_executor
+ * \brief Run file I/O without blocking the workers.
+ *
+ * A pool worker blocked in a read() on a local file is a worker not
+ * doing anything else, so disk heavy stages need many threads. The
+ * executor runs the reads, writes and fsyncs on its own instead.
+ *
+ * With io_uring, one thread handles all the requests. The requests
+ * pushed while it waits are added to the ring together and submitted
+ * with a single system call, which also waits for the completions.
+ *
+ * When io_uring is not available (older kernel, disabled by the
+ * administrator or by a seccomp filter), the executor uses a pool of
+ * io_worker threads running the usual blocking system calls. The
+ * interface is the same either way.
+ *
+ * \code
+ *     cppthread::io_executor io("disk");
+ *     std::vector<char> buffer(4096);
+ *     std::future<std::int64_t> r(io.read(fd, buffer.data(), buffer.size(), 0));
+ *     ...do something else...
+ *     std::int64_t const size(r.get());
+ *     if(size < 0)
+ *     {
+ *         ...handle error -size...
+ *     }
+ * \endcode
+ */
+
+
+/** \brief Start the executor.
+ *
+ * \param[in] name  The name of the thread(s).
+ * \param[in] queue_depth  The maximum number of requests in flight with
+ * io_uring.
+ * \param[in] fallback_workers  The number of threads used when io_uring
+ * is not available.
+ * \param[in] use_io_uring  Whether to try io_uring; set to false to
+ * always use the thread pool.
+ */
+io_executor::io_executor(
+          std::string const & name
+        , std::size_t queue_depth
+        , std::size_t fallback_workers
+        , bool use_io_uring)
+    : f_requests(std::make_shared<io_request::fifo_t>())
+{
+    // both runners call task_done() once a request completed
+    //
+    f_requests->track_unfinished();
+
+    if(use_io_uring)
+    {
+        std::shared_ptr<uring_runner> r(std::make_shared<uring_runner>(name, queue_depth, f_requests));
+        if(r->is_valid())
+        {
+            f_runner = r;
+            f_thread = std::make_shared<thread>(name, f_runner);
+            f_thread->start();
+            return;
+        }
+    }
+
+    f_pool = std::make_unique<io_pool_t>(name, fallback_workers, f_requests, nullptr);
+}
+
+
+/** \brief Stop the executor.
+ *
+ * The requests already submitted are run before the thread(s) exit.
+ */
+io_executor::~io_executor()
+{
+    if(f_thread != nullptr)
+    {
+        f_thread->stop();
+    }
+    f_pool.reset();
+}
+
+
+/** \brief Check which backend is in use.
+ *
+ * \return true if the requests run with io_uring, false if they run on
+ * the thread pool.
+ */
+bool io_executor::is_io_uring() const
+{
+    return f_runner != nullptr;
+}
+
+
+/** \brief Submit a request.
+ *
+ * The request is queued and this function returns immediately. Its
+ * future and completion fifo, if any, get notified once it is done.
+ *
+ * \param[in] request  The request to run.
+ */
+void io_executor::submit(io_request::pointer_t request)
+{
+    f_requests->push_back(request);
+    if(f_runner != nullptr)
+    {
+        f_runner->request_added();
+    }
+}
+
+
+/** \brief Read from a file.
+ *
+ * \param[in] fd  The file descriptor.
+ * \param[in] buffer  The buffer receiving the data.
+ * \param[in] size  The size of the buffer.
+ * \param[in] offset  The position in the file.
+ *
+ * \return A future set to the number of bytes read or the negated errno.
+ */
+std::future<std::int64_t> io_executor::read(int fd, void * buffer, std::size_t size, off_t offset)
+{
+    io_request::pointer_t r(std::make_shared<io_request>(io_operation_t::IO_OPERATION_READ, fd, buffer, size, offset));
+    std::future<std::int64_t> result(r->get_future());
+    submit(r);
+    return result;
+}
+
+
+/** \brief Write to a file.
+ *
+ * \param[in] fd  The file descriptor.
+ * \param[in] buffer  The data to write.
+ * \param[in] size  The number of bytes to write.
+ * \param[in] offset  The position in the file.
+ *
+ * \return A future set to the number of bytes written or the negated
+ * errno.
+ */
+std::future<std::int64_t> io_executor::write(int fd, void const * buffer, std::size_t size, off_t offset)
+{
+    io_request::pointer_t r(std::make_shared<io_request>(io_operation_t::IO_OPERATION_WRITE, fd, const_cast<void *>(buffer), size, offset));
+    std::future<std::int64_t> result(r->get_future());
+    submit(r);
+    return result;
+}
+
+
+/** \brief Flush a file to disk.
+ *
+ * \param[in] fd  The file descriptor.
+ *
+ * \return A future set to 0 or the negated errno.
+ */
+std::future<std::int64_t> io_executor::fsync(int fd)
+{
+    io_request::pointer_t r(std::make_shared<io_request>(io_operation_t::IO_OPERATION_FSYNC, fd));
+    std::future<std::int64_t> result(r->get_future());
+    submit(r);
+    return result;
+}
+
+
+/** \brief Wait until all the submitted requests completed.
+ *
+ * \param[in] usecs  The maximum number of microseconds to wait, -1 to
+ * wait forever.
+ *
+ * \return true if no request is pending.
+ */
+bool io_executor::drain(int64_t usecs)
+{
+    return f_requests->wait_idle(usecs);
+}
+
+
+/** \typedef io_executor::io_pool_t
+ * \brief The pool used when io_uring is not available.
+ */
+
+
+/** \var io_executor::DEFAULT_QUEUE_DEPTH
+ * \brief The default maximum number of requests in the ring.
+ */
+
+
+/** \var io_executor::DEFAULT_FALLBACK_WORKERS
+ * \brief The default number of threads used without io_uring.
+ */
+
+
+/** \var io_executor::f_requests
+ * \brief The fifo of requests not yet started.
+ */
+
+
+/** \var io_executor::f_runner
+ * \brief The io_uring runner or nullptr when using the pool.
+ */
+
+
+/** \var io_executor::f_thread
+ * \brief The thread running f_runner.
+ */
+
+
+/** \var io_executor::f_pool
+ * \brief The pool of workers used when io_uring is not available.
+ */
+
+
+/** \typedef io_request::pointer_t
+ * \brief A shared pointer to an I/O request.
+ */
+
+
+/** \typedef io_request::fifo_t
+ * \brief A fifo of I/O requests.
+ */
+
+
+/** \var io_request::f_operation
+ * \brief The operation to run.
+ */
+
+
+/** \var io_request::f_fd
+ * \brief The file descriptor.
+ */
+
+
+/** \var io_request::f_buffer
+ * \brief The caller's buffer.
+ */
+
+
+/** \var io_request::f_size
+ * \brief The number of bytes to transfer.
+ */
+
+
+/** \var io_request::f_offset
+ * \brief The position in the file.
+ */
+
+
+/** \var io_request::f_completed
+ * \brief The fifo where the request is pushed once done.
+ */
+
+
+/** \var io_request::f_promise
+ * \brief The promise of the future returned by get_future().
+ */
+
+
+/** \var io_request::f_result
+ * \brief The result of the operation.
+ */
+
+
+/** \var io_request::f_done
+ * \brief Whether the operation completed.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
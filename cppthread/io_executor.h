@@ -0,0 +1,171 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Asynchronous file I/O.
+ *
+ * This file declares the io_executor class which runs file reads and
+ * writes with io_uring, or with a small pool of threads when io_uring
+ * is not available.
+ */
+
+
+// self
+//
+#include    <cppthread/fifo.h>
+#include    <cppthread/pool.h>
+#include    <cppthread/thread.h>
+#include    <cppthread/worker.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+#include    <future>
+#include    <memory>
+#include    <string>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+namespace cppthread
+{
+
+
+
+enum class io_operation_t
+{
+    IO_OPERATION_READ,
+    IO_OPERATION_WRITE,
+    IO_OPERATION_FSYNC,
+};
+
+
+class io_request
+    : public std::enable_shared_from_this<io_request>
+{
+public:
+    typedef std::shared_ptr<io_request>     pointer_t;
+    typedef fifo<pointer_t>                 fifo_t;
+
+                        io_request(
+                              io_operation_t operation
+                            , int fd
+                            , void * buffer = nullptr
+                            , std::size_t size = 0
+                            , off_t offset = 0);
+                        io_request(io_request const & rhs) = delete;
+
+    io_request &        operator = (io_request const & rhs) = delete;
+
+    io_operation_t      get_operation() const;
+    int                 get_fd() const;
+    void *              get_buffer() const;
+    std::size_t         get_size() const;
+    off_t               get_offset() const;
+
+    void                set_completion_fifo(fifo_t::pointer_t completed);
+    std::future<std::int64_t>
+                        get_future();
+    std::int64_t        get_result() const;
+    bool                is_done() const;
+
+    std::int64_t        execute();
+    void                complete(std::int64_t result);
+
+private:
+    io_operation_t const
+                        f_operation;
+    int const           f_fd;
+    void * const        f_buffer;
+    std::size_t const   f_size;
+    off_t const         f_offset;
+    fifo_t::pointer_t   f_completed = fifo_t::pointer_t();
+    std::promise<std::int64_t>
+                        f_promise = std::promise<std::int64_t>();
+    std::atomic<std::int64_t>
+                        f_result = 0;
+    std::atomic<bool>   f_done = false;
+};
+
+
+class io_worker
+    : public worker<io_request::pointer_t>
+{
+public:
+                        io_worker(
+                              std::string const & name
+                            , std::size_t position
+                            , io_request::fifo_t::pointer_t in
+                            , io_request::fifo_t::pointer_t out);
+
+    virtual bool        do_work() override;
+};
+
+
+class io_executor
+{
+public:
+    typedef pool<io_worker>                 io_pool_t;
+
+    static constexpr std::size_t const      DEFAULT_QUEUE_DEPTH = 64;
+    static constexpr std::size_t const      DEFAULT_FALLBACK_WORKERS = 4;
+
+                        io_executor(
+                              std::string const & name
+                            , std::size_t queue_depth = DEFAULT_QUEUE_DEPTH
+                            , std::size_t fallback_workers = DEFAULT_FALLBACK_WORKERS
+                            , bool use_io_uring = true);
+                        io_executor(io_executor const & rhs) = delete;
+                        ~io_executor();
+
+    io_executor &       operator = (io_executor const & rhs) = delete;
+
+    bool                is_io_uring() const;
+    void                submit(io_request::pointer_t request);
+    std::future<std::int64_t>
+                        read(int fd, void * buffer, std::size_t size, off_t offset);
+    std::future<std::int64_t>
+                        write(int fd, void const * buffer, std::size_t size, off_t offset);
+    std::future<std::int64_t>
+                        fsync(int fd);
+    bool                drain(int64_t usecs = -1);
+
+private:
+    class uring_runner;
+
+    io_request::fifo_t::pointer_t
+                        f_requests = io_request::fifo_t::pointer_t();
+    std::shared_ptr<uring_runner>
+                        f_runner = std::shared_ptr<uring_runner>();
+    thread::pointer_t   f_thread = thread::pointer_t();
+    std::unique_ptr<io_pool_t>
+                        f_pool = std::unique_ptr<io_pool_t>();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,200 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the latch.
+ *
+ * The latch is a counter which threads can wait on until it reaches zero.
+ */
+
+
+// self
+//
+#include    "cppthread/latch.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/futex.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class latch
+ * \brief Wait until a number of events happened.
+ *
+ * A latch is initialized with a count. Threads decrement that count with
+ * count_down() and other threads wait for it to reach zero. Once zero,
+ * the latch remains open: it cannot be reset.
+ *
+ * A typical use is to wait until a set of threads are done initializing:
+ *
+ * \code
+ *     cppthread::latch ready(workers.size());
+ *
+ *     // in each worker, once initialized
+ *     ready.count_down();
+ *
+ *     // in the main thread
+ *     ready.wait();
+ * \endcode
+ *
+ * Counting down and checking the latch only use atomic operations. The
+ * kernel is only called when a thread has to sleep, and once, when the
+ * count reaches zero, to wake up the sleeping threads.
+ */
+
+
+
+/** \brief Initialize the latch.
+ *
+ * \param[in] count  The number of count_down() required to open the latch.
+ * A count of zero creates a latch which is already open.
+ */
+latch::latch(std::uint32_t count)
+    : f_count(count)
+{
+}
+
+
+/** \brief Decrement the counter.
+ *
+ * When the counter reaches zero, all the threads waiting on the latch
+ * are woken up.
+ *
+ * A waiting thread may destroy the latch as soon as it sees the counter
+ * reach zero (i.e. sync_wait() keeps its latch on the stack). So once the
+ * last decrement happened, this function does not access the latch
+ * anymore: it wakes the waiters through the address of the counter
+ * saved beforehand, even if no thread is waiting. Waking a futex is
+ * harmless if the memory was released or reused since the waiters
+ * always check the counter again.
+ *
+ * \exception logic_error
+ * Decrementing the counter below zero is not allowed.
+ *
+ * \param[in] n  The number to subtract from the counter.
+ */
+void latch::count_down(std::uint32_t n)
+{
+    std::atomic<std::uint32_t> & word(f_count);
+    std::uint32_t count(word.load(std::memory_order_relaxed));
+    do
+    {
+        if(n > count)
+        {
+            throw logic_error("latch::count_down() called with a number larger than the current count.");
+        }
+    }
+    while(!word.compare_exchange_weak(count, count - n, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+    if(count == n
+    && n != 0)
+    {
+        // do not use `this` from here on
+        //
+        detail::futex_wake(word);
+    }
+}
+
+
+/** \brief Check whether the latch is open.
+ *
+ * \return true if the counter reached zero.
+ */
+bool latch::try_wait() const
+{
+    return f_count.load(std::memory_order_acquire) == 0;
+}
+
+
+/** \brief Wait until the counter reaches zero.
+ */
+void latch::wait() const
+{
+    wait_until(nullptr);
+}
+
+
+/** \brief Wait until the counter reaches zero or the timeout elapses.
+ *
+ * \param[in] timeout  The maximum amount of time to wait.
+ *
+ * \return true if the counter reached zero.
+ */
+bool latch::wait_for(std::chrono::nanoseconds timeout) const
+{
+    std::chrono::steady_clock::time_point const deadline(std::chrono::steady_clock::now() + timeout);
+    return wait_until(&deadline);
+}
+
+
+/** \brief Decrement the counter and wait for it to reach zero.
+ *
+ * \param[in] n  The number to subtract from the counter.
+ */
+void latch::arrive_and_wait(std::uint32_t n)
+{
+    count_down(n);
+    wait();
+}
+
+
+/** \brief Wait on the counter.
+ *
+ * \param[in] deadline  When to stop waiting, or nullptr to wait forever.
+ *
+ * \return true if the counter reached zero.
+ */
+bool latch::wait_until(std::chrono::steady_clock::time_point const * deadline) const
+{
+    for(;;)
+    {
+        std::uint32_t const count(f_count.load(std::memory_order_acquire));
+        if(count == 0)
+        {
+            return true;
+        }
+
+        bool const woken(detail::futex_wait(f_count, count, deadline));
+        if(!woken)
+        {
+            return try_wait();
+        }
+    }
+}
+
+
+/** \var latch::f_count
+ * \brief The number of count_down() still required.
+ *
+ * This is also the word the waiting threads sleep on.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
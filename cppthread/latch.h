@@ -0,0 +1,65 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Single use count down latch.
+ *
+ * This file declares the latch class.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <cstdint>
+
+
+
+namespace cppthread
+{
+
+
+
+class latch
+{
+public:
+                        latch(std::uint32_t count);
+                        latch(latch const & rhs) = delete;
+
+    latch &             operator = (latch const & rhs) = delete;
+
+    void                count_down(std::uint32_t n = 1);
+    bool                try_wait() const;
+    void                wait() const;
+    bool                wait_for(std::chrono::nanoseconds timeout) const;
+    void                arrive_and_wait(std::uint32_t n = 1);
+
+private:
+    bool                wait_until(std::chrono::steady_clock::time_point const * deadline) const;
+
+    mutable std::atomic<std::uint32_t>
+                        f_count;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,449 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the lock order checker.
+ *
+ * Two threads locking the same two mutexes in opposite order can deadlock.
+ * Such an inversion is difficult to reproduce since both threads need to
+ * lock their first mutex at about the same time. The checker detects the
+ * inversion as soon as both orders were used once, even if no deadlock
+ * happened.
+ *
+ * Each thread keeps a stack of the mutexes it currently holds. When it
+ * locks another mutex, an edge is added from each held mutex to the new
+ * one in a global lock order graph. If the new edge creates a cycle, the
+ * locks can deadlock and an error is logged with the names of all the
+ * mutexes found in the cycle (see mutex::set_name()).
+ *
+ * A successful try_lock() does not add edges since it cannot block.
+ * Recursive locks of the same mutex are ignored.
+ *
+ * The checker is only compiled in Debug builds when the
+ * CPPTHREAD_LOCK_ORDER_CHECK option is turned on:
+ *
+ * \code
+ *     cmake -DCMAKE_BUILD_TYPE=Debug -DCPPTHREAD_LOCK_ORDER_CHECK=ON ...
+ * \endcode
+ *
+ * In all other builds, this file is empty and the mutex does not call
+ * any of these functions.
+ */
+
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+
+// self
+//
+#include    "cppthread/lock_order.h"
+
+#include    "cppthread/log.h"
+#include    "cppthread/mutex.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstdint>
+#include    <map>
+#include    <set>
+#include    <sstream>
+#include    <vector>
+
+
+// C
+//
+#include    <pthread.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+typedef std::vector<mutex const *>                          held_locks_t;
+typedef std::pair<mutex const *, mutex const *>             edge_t;
+typedef std::set<edge_t>                                    edges_t;
+typedef std::set<mutex const *>                             successors_t;
+typedef std::map<mutex const *, successors_t>               lock_graph_t;
+
+
+/** \brief Whether the locks of this thread were destroyed.
+ *
+ * The thread local variables get destroyed before the static objects of
+ * the main thread. Static objects locking a mutex in their destructor
+ * would otherwise access a destroyed thread_locks object. This flag is
+ * trivially destructible so it remains valid until the thread is gone.
+ */
+thread_local bool           g_thread_locks_destroyed = false;
+
+
+/** \brief The lock order state of one thread.
+ *
+ * The f_held_locks vector lists the mutexes currently held by this thread.
+ * The most recently locked mutex is at the end of the vector.
+ *
+ * The f_known_edges set lists the edges this thread already verified.
+ * Most of the time, the same locks are taken in the same order. This
+ * cache avoids locking the global graph in that case.
+ *
+ * When a mutex gets destroyed, its address can be reused by a new mutex.
+ * The global generation is then incremented and each thread clears its
+ * cache the next time it locks a mutex; f_generation is the generation
+ * of f_known_edges.
+ */
+class thread_locks
+{
+public:
+    ~thread_locks()
+    {
+        g_thread_locks_destroyed = true;
+    }
+
+    held_locks_t            f_held_locks = held_locks_t();
+    edges_t                 f_known_edges = edges_t();
+    std::uint64_t           f_generation = 0;
+};
+
+
+thread_local thread_locks   g_thread_locks = thread_locks();
+std::atomic<std::uint64_t>  g_generation = 0;
+
+
+/** \brief Get the lock order state of the calling thread.
+ *
+ * \return The state or nullptr if it was already destroyed.
+ */
+thread_locks * get_thread_locks()
+{
+    if(g_thread_locks_destroyed)
+    {
+        return nullptr;
+    }
+    return &g_thread_locks;
+}
+
+
+/** \brief The mutex protecting the lock order graph.
+ *
+ * We cannot use a cppthread::mutex here since the mutex calls these
+ * functions.
+ */
+pthread_mutex_t             g_graph_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+lock_graph_t & get_graph()
+{
+    static lock_graph_t * graph(new lock_graph_t);
+    return *graph;
+}
+
+
+edges_t & get_reported()
+{
+    static edges_t * reported(new edges_t);
+    return *reported;
+}
+
+
+class graph_lock
+{
+public:
+    graph_lock()
+    {
+        pthread_mutex_lock(&g_graph_mutex);
+    }
+
+    graph_lock(graph_lock const &) = delete;
+    graph_lock & operator = (graph_lock const &) = delete;
+
+    ~graph_lock()
+    {
+        pthread_mutex_unlock(&g_graph_mutex);
+    }
+};
+
+
+std::string lock_name(mutex const * m)
+{
+    std::stringstream ss;
+    std::string const name(m->get_name());
+    if(name.empty())
+    {
+        ss << "mutex@" << static_cast<void const *>(m);
+    }
+    else
+    {
+        ss << '"' << name << "\" (" << static_cast<void const *>(m) << ')';
+    }
+    return ss.str();
+}
+
+
+/** \brief Search a path in the lock order graph.
+ *
+ * This function searches a path from \p from to \p to. If found, the
+ * path includes all the mutexes from \p from to \p to inclusive.
+ *
+ * \param[in] graph  The lock order graph.
+ * \param[in] from  The mutex where the search starts.
+ * \param[in] to  The mutex being searched.
+ * \param[in,out] visited  The mutexes already visited.
+ * \param[out] path  The path found.
+ *
+ * \return true if a path was found.
+ */
+bool find_path(
+      lock_graph_t const & graph
+    , mutex const * from
+    , mutex const * to
+    , std::set<mutex const *> & visited
+    , held_locks_t & path)
+{
+    path.push_back(from);
+    if(from == to)
+    {
+        return true;
+    }
+
+    if(visited.insert(from).second)
+    {
+        auto const it(graph.find(from));
+        if(it != graph.end())
+        {
+            for(auto const * next : it->second)
+            {
+                if(find_path(graph, next, to, visited, path))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    path.pop_back();
+    return false;
+}
+
+
+/** \brief Add an edge to the lock order graph.
+ *
+ * This function adds the edge \p held -> \p m to the graph. If a path
+ * from \p m to \p held already exists, the edge closes a cycle and the
+ * function returns a message describing that cycle. The edge is not
+ * added in that case so the graph never includes cycles.
+ *
+ * Each inversion is reported only once.
+ *
+ * \param[in] held  A mutex held by this thread.
+ * \param[in] m  The mutex being locked.
+ *
+ * \return An empty string or the error message to log.
+ */
+std::string add_edge(mutex const * held, mutex const * m)
+{
+    graph_lock lock;
+
+    lock_graph_t & graph(get_graph());
+    successors_t & successors(graph[held]);
+    if(successors.find(m) != successors.end())
+    {
+        return std::string();
+    }
+
+    std::set<mutex const *> visited;
+    held_locks_t path;
+    if(!find_path(graph, m, held, visited, path))
+    {
+        successors.insert(m);
+        return std::string();
+    }
+
+    if(!get_reported().insert(edge_t(held, m)).second)
+    {
+        return std::string();
+    }
+
+    std::stringstream ss;
+    ss << "lock order inversion: locking "
+       << lock_name(m)
+       << " while holding "
+       << lock_name(held)
+       << " can deadlock; cycle: "
+       << lock_name(held);
+    for(auto const * p : path)
+    {
+        ss << " -> " << lock_name(p);
+    }
+    return ss.str();
+}
+
+
+
+} // no name namespace
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Check the lock order before locking a mutex.
+ *
+ * This function is called just before the mutex \p m gets locked with
+ * a blocking call. It records the order in which this thread locks its
+ * mutexes and reports any inversion.
+ *
+ * \param[in] m  The mutex about to be locked.
+ */
+void lock_order_lock(mutex const * m)
+{
+    thread_locks * locks(get_thread_locks());
+    if(locks == nullptr
+    || locks->f_held_locks.empty()
+    || std::find(locks->f_held_locks.begin(), locks->f_held_locks.end(), m) != locks->f_held_locks.end())
+    {
+        return;
+    }
+
+    std::uint64_t const generation(g_generation.load(std::memory_order_acquire));
+    if(generation != locks->f_generation)
+    {
+        locks->f_known_edges.clear();
+        locks->f_generation = generation;
+    }
+
+    // the log below may lock mutexes, so iterate over a copy
+    //
+    held_locks_t const held_locks(locks->f_held_locks);
+    for(auto const * held : held_locks)
+    {
+        if(!locks->f_known_edges.insert(edge_t(held, m)).second)
+        {
+            continue;
+        }
+
+        std::string const msg(add_edge(held, m));
+        if(!msg.empty())
+        {
+            log << log_level_t::error
+                << msg
+                << end;
+        }
+    }
+}
+
+
+/** \brief Record that a mutex was locked.
+ *
+ * This function pushes \p m on the stack of mutexes held by this thread.
+ *
+ * \param[in] m  The mutex which was just locked.
+ */
+void lock_order_acquired(mutex const * m)
+{
+    thread_locks * locks(get_thread_locks());
+    if(locks != nullptr)
+    {
+        locks->f_held_locks.push_back(m);
+    }
+}
+
+
+/** \brief Record that a mutex was unlocked.
+ *
+ * Mutexes do not have to be unlocked in the reverse order they were
+ * locked, so the function removes the last instance of \p m wherever
+ * it is in the stack.
+ *
+ * \param[in] m  The mutex being unlocked.
+ */
+void lock_order_unlock(mutex const * m)
+{
+    thread_locks * locks(get_thread_locks());
+    if(locks == nullptr)
+    {
+        return;
+    }
+
+    auto const it(std::find(locks->f_held_locks.rbegin(), locks->f_held_locks.rend(), m));
+    if(it != locks->f_held_locks.rend())
+    {
+        locks->f_held_locks.erase(std::next(it).base());
+    }
+}
+
+
+/** \brief Remove a mutex from the lock order graph.
+ *
+ * When a mutex gets destroyed, its address may be reused by another
+ * mutex which has nothing to do with the previous one. This function
+ * removes all the edges referencing \p m.
+ *
+ * \param[in] m  The mutex being destroyed.
+ */
+void lock_order_forget(mutex const * m)
+{
+    graph_lock lock;
+
+    lock_graph_t & graph(get_graph());
+    graph.erase(m);
+    for(auto & n : graph)
+    {
+        n.second.erase(m);
+    }
+
+    edges_t & reported(get_reported());
+    for(auto it(reported.begin()); it != reported.end(); )
+    {
+        if(it->first == m || it->second == m)
+        {
+            it = reported.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    g_generation.fetch_add(1, std::memory_order_release);
+}
+
+
+
+} // namespace detail
+
+
+
+} // namespace cppthread
+
+#endif
+// vim: ts=4 sw=4 et
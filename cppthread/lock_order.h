@@ -0,0 +1,57 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Internal declarations of the lock order checker.
+ *
+ * This header is private to the library. The functions are only defined
+ * when the library is compiled in Debug mode with the
+ * CPPTHREAD_LOCK_ORDER_CHECK option turned on.
+ */
+
+
+
+namespace cppthread
+{
+
+
+
+class mutex;
+
+
+
+namespace detail
+{
+
+
+
+void                    lock_order_lock(mutex const * m);
+void                    lock_order_acquired(mutex const * m);
+void                    lock_order_unlock(mutex const * m);
+void                    lock_order_forget(mutex const * m);
+
+
+
+} // namespace detail
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,102 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the lockable interface.
+ *
+ * The interface has no implementation other than its destructor.
+ */
+
+
+// self
+//
+#include    "cppthread/lockable.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class lockable
+ * \brief The interface of all the cppthread locks.
+ *
+ * The mutex, spinlock, and ticket_lock classes derive from this interface.
+ * This is what allows the guard and multi_guard classes to work with any
+ * one of them:
+ *
+ * \code
+ *     cppthread::spinlock g_counters_lock;
+ *
+ *     void increment(std::string const & name)
+ *     {
+ *         cppthread::guard lock(g_counters_lock);
+ *         ++g_counters[name];
+ *     }
+ * \endcode
+ *
+ * Only the mutex is recursive. Locking a spinlock or a ticket_lock twice
+ * from the same thread deadlocks.
+ */
+
+
+
+/** \brief Clean up the lockable.
+ *
+ * The destructor is virtual so a lock can be destroyed through this
+ * interface.
+ */
+lockable::~lockable()
+{
+}
+
+
+
+/** \fn void lockable::lock()
+ * \brief Lock the object.
+ *
+ * This function blocks until the lock is obtained.
+ */
+
+
+/** \fn bool lockable::try_lock()
+ * \brief Try to lock the object.
+ *
+ * This function never blocks.
+ *
+ * \return true if the lock was obtained.
+ */
+
+
+/** \fn void lockable::unlock()
+ * \brief Unlock the object.
+ *
+ * This function must be called once per successful lock() or try_lock().
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,49 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief The lockable interface.
+ *
+ * This file declares the interface shared by all the locks of the
+ * cppthread library so they can all be used with the guard and
+ * multi_guard classes.
+ */
+
+
+
+namespace cppthread
+{
+
+
+
+class lockable
+{
+public:
+    virtual             ~lockable();
+
+    virtual void        lock() = 0;
+    virtual bool        try_lock() = 0;
+    virtual void        unlock() = 0;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
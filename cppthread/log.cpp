@@ -29,14 +29,10 @@
  * prints errors to std::cerr.
  *
  * \note
- * Note that the log facility is used only in extreme cases. It was made
- * fully thread safe, however, that implementation is considered slow.
- * Especially, if two different threads attempt to log a message
- * simultaneously, only one of them will be allowed to build their
- * message and the other one will be blocked for the entire time. Our
- * snaplogger, on the other hand, allows any number of threads to generate
- * errors in parallel, only the processing at the end, which can be done
- * asynchronously, requires serialization.
+ * Note that the log facility is used only in extreme cases. It is fully
+ * thread safe. Each thread builds its messages in its own buffer so any
+ * number of threads can generate messages in parallel; only the output
+ * of the final message, in end(), is serialized.
  */
 
 // self
@@ -48,8 +44,11 @@
 
 // C++
 //
+#include    <algorithm>
 #include    <cstring>
 #include    <iostream>
+#include    <memory>
+#include    <streambuf>
 
 
 // last include
@@ -96,14 +95,19 @@ namespace
 
 /** \brief The log callback function.
  *
- * If define (not nullptr), this callback gets called whenever a log
+ * If defined (not nullptr), this callback gets called whenever a log
  * message is generated.
  *
  * You are expected to log the message to a file, send over a network,
  * etc. The default (when the pointer is nullptr) is to send the
  * message to std::cerr.
+ *
+ * The callback is shared so a message being sent keeps it alive even
+ * if the callback itself calls set_log_callback(). The pointer is
+ * protected by the logger lock.
  */
-log_callback        g_log_callback = nullptr;
+std::shared_ptr<log_callback>
+                    g_log_callback = std::shared_ptr<log_callback>();
 
 
 /** \brief The mutex used to ensure proper synchronization.
@@ -115,15 +119,6 @@ log_callback        g_log_callback = nullptr;
 pthread_mutex_t     g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 
-/** \brief Whether the lock is currently active.
- *
- * This variable holds true or false. When false, no other thread holds
- * the lock so we are the only one logging data. Once true, we are the
- * one holding the lock if we pass through.
- */
-bool                g_log_locked = false;
-
-
 /** \brief Whether the g_log_recursive_mutex was initialized.
  *
  * Whenever a log message is to be sent, we need a recursive lock
@@ -150,6 +145,213 @@ bool                g_log_recursive_initialized = false;
 pthread_mutex_t     g_log_recursive_mutex;
 
 
+/** \brief A stream buffer appending to a string.
+ *
+ * Contrary to an std::stringbuf, clearing this buffer keeps the memory
+ * it allocated, so a thread which logs often does not reallocate its
+ * buffer for each message.
+ */
+class log_buffer
+    : public std::streambuf
+{
+public:
+    std::string & str()
+    {
+        return f_message;
+    }
+
+    void clear()
+    {
+        f_message.clear();
+    }
+
+protected:
+    virtual int_type overflow(int_type c) override
+    {
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            f_message += traits_type::to_char_type(c);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    virtual std::streamsize xsputn(char const * s, std::streamsize count) override
+    {
+        f_message.append(s, count);
+        return count;
+    }
+
+private:
+    std::string         f_message = std::string();
+};
+
+
+/** \brief The message being built by one thread.
+ *
+ * Each thread gets its own level and buffer so building a message
+ * requires no lock.
+ */
+class thread_message
+{
+public:
+    thread_message()
+        : f_stream(&f_buffer)
+    {
+    }
+
+    log_level_t         f_level = log_level_t::error;
+    log_callback        f_callback = log_callback();
+    log_limiter *       f_limiter = nullptr;
+    bool                f_rate_limited = false;
+    log_buffer          f_buffer = log_buffer();
+    std::ostream        f_stream;
+};
+
+
+/** \brief Delete the thread message when its thread exits.
+ *
+ * The message is allocated on the first use so threads which never
+ * log do not pay for it.
+ */
+class thread_message_owner
+{
+public:
+    ~thread_message_owner();
+
+    thread_message *    f_message = nullptr;
+};
+
+
+/** \brief The owner of the message of this thread.
+ */
+thread_local thread_message_owner   g_thread_message_owner;
+
+
+/** \brief Whether the owner of this thread message was destroyed.
+ *
+ * The destructor of another thread_local object may still log after
+ * the owner is gone. The message used in that case is leaked.
+ */
+thread_local bool                   g_thread_message_released = false;
+
+
+/** \brief The message used once the owner was destroyed.
+ */
+thread_local thread_message *       g_late_thread_message = nullptr;
+
+
+thread_message_owner::~thread_message_owner()
+{
+    delete f_message;
+    f_message = nullptr;
+    g_thread_message_released = true;
+}
+
+
+/** \brief Get the message of the calling thread.
+ *
+ * \return A reference to this thread's message.
+ */
+thread_message & get_thread_message()
+{
+    if(g_thread_message_released)
+    {
+        if(g_late_thread_message == nullptr)
+        {
+            g_late_thread_message = new thread_message;
+        }
+        return *g_late_thread_message;
+    }
+    if(g_thread_message_owner.f_message == nullptr)
+    {
+        g_thread_message_owner.f_message = new thread_message;
+    }
+    return *g_thread_message_owner.f_message;
+}
+
+
+/** \brief Whether identical consecutive messages get folded.
+ *
+ * Folding is off by default so the log callback sees every message.
+ */
+std::atomic<bool>   g_fold_repeated = false;
+
+
+/** \brief How long repeated messages can be folded.
+ *
+ * A message repeated for longer than this gets the "repeated" notice
+ * sent anyway so the output shows that the problem persists.
+ */
+constexpr std::chrono::seconds const    REPEAT_INTERVAL = std::chrono::seconds(30);
+
+
+/** \brief The last message sent out.
+ *
+ * This variable, and the following ones, are protected by the logger
+ * lock.
+ */
+std::string         g_last_message = std::string();
+
+
+/** \brief The level of the last message sent out.
+ */
+log_level_t         g_last_level = log_level_t::LOG_LEVEL_SIZE;
+
+
+/** \brief The number of times the last message was repeated and dropped.
+ */
+std::uint64_t       g_repeat_count = 0;
+
+
+/** \brief When the last message was first sent out.
+ */
+std::chrono::steady_clock::time_point
+                    g_repeat_start = std::chrono::steady_clock::time_point();
+
+
+/** \brief Send a message to the callback or std::cerr.
+ *
+ * The logger lock must be held.
+ *
+ * \param[in] level  The level of the message.
+ * \param[in] message  The message, which the callback may take over.
+ */
+void output(log_level_t level, std::string && message)
+{
+    std::shared_ptr<log_callback> callback(g_log_callback);
+    if(callback != nullptr)
+    {
+        (*callback)(level, std::move(message));
+    }
+    else if(level >= log_level_t::info)
+    {
+        std::cerr << to_string(level)
+                  << ": "
+                  << message
+                  << std::endl;
+    }
+}
+
+
+/** \brief Send the "repeated" notice of the last message, if any.
+ *
+ * The logger lock must be held.
+ */
+void output_repeated()
+{
+    if(g_repeat_count == 0)
+    {
+        return;
+    }
+    std::uint64_t const count(g_repeat_count);
+    g_repeat_count = 0;
+    output(g_last_level
+         , "last message repeated "
+         + std::to_string(count)
+         + (count == 1 ? " time." : " times."));
+}
+
+
 } // no name namespace
 
 
@@ -165,13 +367,66 @@ pthread_mutex_t     g_log_recursive_mutex;
  * the snaplogger, somehow. The snaplogger is a much more advanced
  * and better interface especially in a multithreaded application.
  *
- * \param[in] callback  The function to call whenever a log is generated.
+ * The callback can be any callable, such as a lambda capturing the
+ * state it needs:
+ *
+ * \code
+ *     cppthread::set_log_callback(
+ *         [&pipeline](cppthread::log_level_t level, std::string && message)
+ *         {
+ *             pipeline.push(level, std::move(message));
+ *         });
+ * \endcode
+ *
+ * The message is passed as an rvalue reference: the callback can move
+ * it to its own queue without copying it. A callback taking an
+ * `std::string const &` works too.
+ *
+ * The callbacks are called with the logger lock held, one at a time.
+ * Once this function returns, the previous callback is not running
+ * anymore and will not be called again, so the state it captured can
+ * be released.
+ *
+ * \param[in] callback  The function to call whenever a log is generated,
+ * or nullptr to send the logs to std::cerr.
+ *
+ * \sa set_thread_log_callback()
  */
 void set_log_callback(log_callback callback)
 {
-    pthread_mutex_lock(&g_log_mutex);
-    g_log_callback = callback;
-    pthread_mutex_unlock(&g_log_mutex);
+    std::shared_ptr<log_callback> c;
+    if(callback != nullptr)
+    {
+        c = std::make_shared<log_callback>(std::move(callback));
+    }
+
+    logger::lock();
+    g_log_callback.swap(c);
+    logger::unlock();
+
+    // the previous callback gets released here, outside of the lock
+}
+
+
+/** \brief Set the log callback of the calling thread.
+ *
+ * The messages of a thread with its own callback are sent to that
+ * callback instead of the global one. The callback is called directly
+ * from end(), without taking the logger lock and without folding
+ * repeated messages, since only this thread uses it. The log_limiter
+ * objects still apply.
+ *
+ * A message logged from within the thread callback is sent to the
+ * global callback.
+ *
+ * \param[in] callback  The function to call with the messages of this
+ * thread, or nullptr to go back to the global callback.
+ *
+ * \sa set_log_callback()
+ */
+void set_thread_log_callback(log_callback callback)
+{
+    get_thread_message().f_callback = std::move(callback);
 }
 
 
@@ -221,19 +476,11 @@ logger::logger()
 
 /** \brief Lock the system so a log can be emitted properly.
  *
- * This function allows the locking of the logger. This ensures that
- * we can use a simple object even in a multithread environment. The
- * only potential problem now is a deadlock.
- *
- * Note that you may call the lock() function any number of times. It
- * will not count the number of calls. It locks only once. If already
- * locked, it is like a passthrough. If another thread already acquired
- * the lock, then the function blocks until the other thread is done
- * with the logger.
+ * This function serializes the output of the messages. It is called by
+ * end() only; the messages themselves are built in a per thread buffer
+ * without any lock.
  *
- * \todo
- * This locking system is not exception safe. If one of the functions
- * called to generate the log message throws, then we will stay locked.
+ * The lock is recursive so a log callback can itself log a message.
  */
 void logger::lock()
 {
@@ -298,10 +545,6 @@ void logger::lock()
         std::terminate();
     }
 
-    // we have to lock only once so we use a flag to know whether we're
-    // already locked, if so, we unlock immediately (but we stil have
-    // one lock in place)
-    //
     err = pthread_mutex_lock(&g_log_recursive_mutex);
     if(err != 0)
     {
@@ -310,62 +553,41 @@ void logger::lock()
                   << std::endl;
         std::terminate();
     }
-
-    if(g_log_locked)
-    {
-        // it was already locked, so unlock (i.e. we only want to keep one
-        // lock turned on at a time)
-        //
-        err = pthread_mutex_unlock(&g_log_recursive_mutex);
-        if(err != 0)
-        {
-            std::cerr << "fatal: a mutex unlock generated error #"
-                      << err
-                      << std::endl;
-            std::terminate();
-        }
-    }
-    else
-    {
-        g_log_locked = true;
-    }
 }
 
 
-/** \brief Unlock the logger once we are done with it.
+/** \brief Unlock the logger once the message was sent.
  *
- * Whenever the end() function gets called, the logger reacts by sending
- * the collected message to the user defined callback or to std::cerr.
- *
- * Note that the number of calls to the lock are not limited. However,
- * the unlock() function is called only once in the end() function.
- * Attempting to unlock the logger more than once is a bug and undefined
- * behavior may ensue. The class tries to emit an error when that happens,
- * but it is unlikely to catch the error each time.
+ * This function is called by end() once the message was sent to the
+ * callback or std::cerr.
  */
 void logger::unlock()
 {
-    if(!g_log_locked)
-    {
-        std::cerr << "fatal: logger::unlock() called with g_log_locked == false"
-                  << std::endl;
-        std::terminate();
-    }
-
-    g_log_locked = false;
-
     int err(pthread_mutex_unlock(&g_log_recursive_mutex));
     if(err != 0)
     {
         std::cerr << "fatal: a mutex unlock generated error #"
                   << err
                   << std::endl;
-        pthread_mutex_unlock(&g_log_recursive_mutex);
         std::terminate();
     }
 }
 
 
+/** \brief Get the stream of the calling thread.
+ *
+ * Each thread writes its message in its own stream. The stream is
+ * created the first time a thread logs and reused for all its following
+ * messages.
+ *
+ * \return The output stream of this thread's message.
+ */
+std::ostream & logger::stream()
+{
+    return get_thread_message().f_stream;
+}
+
+
 /** \brief Save the level at which to log this message.
  *
  * This function gets called whenever you apply a level. This is expected
@@ -404,9 +626,7 @@ logger & logger::operator << (log_level_t const & level)
                     + ").");
     }
 
-    lock();
-    f_level = level;
-    ++f_counters[static_cast<int>(level)];
+    get_thread_message().f_level = level;
     return *this;
 }
 
@@ -424,40 +644,77 @@ logger & logger::operator << (log_level_t const & level)
  */
 logger & logger::operator << (logger & (*func)(logger &))
 {
-    lock();
     func(*this);
     return *this;
 }
 
 
+/** \brief Apply a rate limit to this message.
+ *
+ * The limiter is expected to be a static object at the place in your
+ * code generating the message so that place cannot flood the logs:
+ *
+ * \code
+ *     static cppthread::log_limiter limiter;
+ *
+ *     cppthread::log << limiter
+ *                    << cppthread::log_level_t::error
+ *                    << "read() failed: "
+ *                    << strerror(e)
+ *                    << cppthread::end;
+ * \endcode
+ *
+ * When the limiter refuses the message, the stream of this thread gets
+ * its bad bit set so the following values are not even formatted and
+ * end() drops the message. The next message accepted by the limiter
+ * says how many were suppressed in between.
+ *
+ * \param[in] limiter  The limiter of this call site.
+ *
+ * \return A reference to this logger.
+ */
+logger & logger::operator << (log_limiter & limiter)
+{
+    thread_message & msg(get_thread_message());
+    msg.f_limiter = &limiter;
+    if(!limiter.allow())
+    {
+        msg.f_rate_limited = true;
+        msg.f_stream.setstate(std::ios_base::badbit);
+    }
+    return *this;
+}
+
+
 /** \brief Reset all the log message counters to zero.
  *
  * This function resets all the log message counters to zero. This is useful
  * if you run in a server and want to count the logs for one run of a process
  * opposed to forever while running.
- *
- * \todo
- * The counter functions are not thread safe.
  */
 void logger::reset_counters()
 {
-    std::memset(f_counters, 0, sizeof(f_counters));
+    for(auto & c : f_counters)
+    {
+        c.store(0, std::memory_order_relaxed);
+    }
+    f_rate_limited.store(0, std::memory_order_relaxed);
+    f_repeated.store(0, std::memory_order_relaxed);
 }
 
 
 /** \brief Get one of the level counters.
  *
- * WHenever a log is sent to the cppthread logger, one of its counter
- * gets incremented by 1. This is useful if you want to know whether
+ * WHenever a log is sent out by the cppthread logger, one of its counter
+ * gets incremented by 1. Messages dropped by a log_limiter or folded
+ * as repetitions are not counted; see get_rate_limited() and
+ * get_repeated() for those. This is useful if you want to know whether
  * error messages were sent to the logger, see the get_errors() function
  * too as it includes a total of all the errors that happened.
  *
  * This function is useful to check the number of debug and info messages
  * that were processed.
  *
- * \todo
- * The counter functions are not thread safe.
- *
  * \param[in] level  The level to get the counter from.
  *
  * \return The number of times that level received a log message.
@@ -476,7 +733,7 @@ std::uint32_t logger::get_counter(log_level_t level) const
                     + ").");
     }
 
-    return f_counters[static_cast<int>(level)];
+    return f_counters[static_cast<int>(level)].load(std::memory_order_relaxed);
 }
 
 
@@ -485,9 +742,6 @@ std::uint32_t logger::get_counter(log_level_t level) const
  * This function returns the total number of errors and fatal errors that were
  * sent to the cppthread logger.
  *
- * \todo
- * The counter functions are not thread safe.
- *
  * \return The number of errors generated so far.
  *
  * \sa get_counter()
@@ -495,8 +749,8 @@ std::uint32_t logger::get_counter(log_level_t level) const
  */
 std::uint32_t logger::get_errors() const
 {
-    return f_counters[static_cast<int>(log_level_t::error)]
-         + f_counters[static_cast<int>(log_level_t::fatal)];
+    return f_counters[static_cast<int>(log_level_t::error)].load(std::memory_order_relaxed)
+         + f_counters[static_cast<int>(log_level_t::fatal)].load(std::memory_order_relaxed);
 }
 
 
@@ -505,9 +759,6 @@ std::uint32_t logger::get_errors() const
  * This function returns the number of warnings that were sent to the
  * cppthread logger.
  *
- * \todo
- * The counter functions are not thread safe.
- *
  * \return The number of warnings generated so far.
  *
  * \sa get_counter()
@@ -515,7 +766,53 @@ std::uint32_t logger::get_errors() const
  */
 std::uint32_t logger::get_warnings() const
 {
-    return f_counters[static_cast<int>(log_level_t::warning)];
+    return f_counters[static_cast<int>(log_level_t::warning)].load(std::memory_order_relaxed);
+}
+
+
+/** \brief Get the number of messages dropped by a log_limiter.
+ *
+ * The level counters do not include these messages.
+ *
+ * \return The number of rate limited messages.
+ *
+ * \sa get_repeated()
+ */
+std::uint64_t logger::get_rate_limited() const
+{
+    return f_rate_limited.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Get the number of repeated messages which were folded.
+ *
+ * \return The number of messages dropped because they were identical
+ * to the previous message.
+ *
+ * \sa get_rate_limited()
+ * \sa set_fold_repeated()
+ */
+std::uint64_t logger::get_repeated() const
+{
+    return f_repeated.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Choose whether identical consecutive messages get folded.
+ *
+ * By default, every message gets sent out. When folding is turned on,
+ * a message identical to the previous one is not sent again; instead
+ * the logger sends "last message repeated N times" once a different
+ * message comes in.
+ *
+ * Messages sent to a thread callback (see set_thread_log_callback())
+ * are never folded.
+ *
+ * \param[in] fold  Whether to fold repeated messages.
+ */
+void logger::set_fold_repeated(bool fold)
+{
+    g_fold_repeated.store(fold, std::memory_order_relaxed);
 }
 
 
@@ -530,44 +827,216 @@ std::uint32_t logger::get_warnings() const
  * messages and prints out the other messages to std::cerr.
  *
  * \note
- * The log system has a lock in place whenever you start sending log
- * data. This function unlocks the logger before returning. It is
- * also exception safe.
+ * The message was built in the calling thread's buffer without any
+ * lock. This function takes the log lock only to send it out so
+ * messages from different threads do not criss-cross each other. It is
+ * exception safe.
+ *
+ * A message refused by its log_limiter is dropped before the lock is
+ * taken. When folding is turned on, a message identical to the previous
+ * one (same level and text) is dropped and counted instead of being sent
+ * again; the count is sent as "last message repeated N times" along the
+ * next different message, or after 30 seconds of repetitions. See
+ * set_fold_repeated().
+ *
+ * Only the messages which get sent out increment the level counters.
+ *
+ * The message string is swapped out of the thread buffer and handed to
+ * the callback as an rvalue, so it never gets copied. If the callback
+ * does not take it, its memory goes back to the thread buffer.
  *
  * \return A reference to the logger object.
  */
 logger & logger::end()
 {
-    // the std::cerr requires a lock so we keep the logger locked
-    //
-    try
+    thread_message & msg(get_thread_message());
+    log_level_t const level(msg.f_level);
+    log_limiter * limiter(msg.f_limiter);
+    bool const rate_limited(msg.f_rate_limited);
+    msg.f_limiter = nullptr;
+    msg.f_rate_limited = false;
+    if(rate_limited)
+    {
+        msg.f_buffer.clear();
+        msg.f_stream.clear();
+        f_rate_limited.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+    std::string message;
+    message.swap(msg.f_buffer.str());
+    msg.f_stream.clear();
+
+    if(limiter != nullptr)
+    {
+        std::uint64_t const suppressed(limiter->take_pending());
+        if(suppressed != 0)
+        {
+            message += " ("
+                     + std::to_string(suppressed)
+                     + (suppressed == 1 ? " similar message suppressed)" : " similar messages suppressed)");
+        }
+    }
+
+    if(msg.f_callback != nullptr)
     {
-        if(g_log_callback != nullptr)
+        // the callback is moved out while it runs so a message it logs
+        // goes to the global callback instead of recursing
+        //
+        log_callback callback(std::move(msg.f_callback));
+        msg.f_callback = log_callback();
+        f_counters[static_cast<int>(level)].fetch_add(1, std::memory_order_relaxed);
+        try
         {
-            g_log_callback(f_level, f_log.str());
+            callback(level, std::move(message));
         }
-        else if(f_level >= log_level_t::info)
+        catch(...)
         {
-            std::cerr << to_string(f_level)
-                      << ": "
-                      << f_log.str()
-                      << std::endl;
+            if(msg.f_callback == nullptr)
+            {
+                msg.f_callback = std::move(callback);
+            }
+            throw;
+        }
+        if(msg.f_callback == nullptr)
+        {
+            msg.f_callback = std::move(callback);
         }
-
-        f_log.str(std::string());
     }
-    catch(...)
+    else
     {
+        lock();
+        try
+        {
+            std::chrono::steady_clock::time_point const now(std::chrono::steady_clock::now());
+            if(g_fold_repeated.load(std::memory_order_relaxed)
+            && level == g_last_level
+            && message == g_last_message)
+            {
+                ++g_repeat_count;
+                f_repeated.fetch_add(1, std::memory_order_relaxed);
+                if(now - g_repeat_start >= REPEAT_INTERVAL)
+                {
+                    output_repeated();
+                    g_repeat_start = now;
+                }
+            }
+            else
+            {
+                output_repeated();
+                g_last_level = level;
+                g_last_message.assign(message);
+                g_repeat_start = now;
+                f_counters[static_cast<int>(level)].fetch_add(1, std::memory_order_relaxed);
+                output(level, std::move(message));
+            }
+        }
+        catch(...)
+        {
+            unlock();
+            throw;
+        }
+
         unlock();
-        throw;
     }
 
-    unlock();
+    // if the callback did not take the message, give its memory back to
+    // the thread buffer for the next message
+    //
+    if(message.capacity() > msg.f_buffer.str().capacity())
+    {
+        message.clear();
+        message.swap(msg.f_buffer.str());
+    }
+    msg.f_buffer.clear();
 
     return *this;
 }
 
 
+/** \class log_limiter
+ * \brief A token bucket limiting the messages of one call site.
+ *
+ * The limiter accepts \em rate messages per \em period on average with
+ * bursts of up to \em burst messages. It is implemented with a single
+ * atomic timestamp (the theoretical arrival time of the generic cell
+ * rate algorithm) so checking it takes no lock.
+ *
+ * \sa logger::operator << (log_limiter & limiter)
+ */
+
+
+/** \brief Initialize a limiter.
+ *
+ * \exception invalid_error
+ * The rate must be at least 1.
+ *
+ * \param[in] rate  The number of messages accepted per period.
+ * \param[in] period  The period over which \p rate messages are accepted.
+ * \param[in] burst  The number of messages accepted at once; 0 means
+ * \p rate.
+ */
+log_limiter::log_limiter(
+          std::uint32_t rate
+        , std::chrono::nanoseconds period
+        , std::uint32_t burst)
+    : f_interval(rate == 0 ? 0 : std::max<std::int64_t>(period.count() / rate, 1))
+    , f_tolerance(f_interval * (burst == 0 ? rate : burst))
+{
+    if(rate == 0)
+    {
+        throw invalid_error("log_limiter: the rate must be at least 1.");
+    }
+}
+
+
+/** \brief Take a token.
+ *
+ * If no token is available, the suppressed counters get incremented.
+ *
+ * \return true if the message can be sent.
+ */
+bool log_limiter::allow()
+{
+    std::int64_t const now(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+    std::int64_t tat(f_tat.load(std::memory_order_relaxed));
+    for(;;)
+    {
+        std::int64_t const next(std::max(tat, now) + f_interval);
+        if(next - now > f_tolerance)
+        {
+            f_pending.fetch_add(1, std::memory_order_relaxed);
+            f_suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if(f_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+}
+
+
+/** \brief Get and reset the number of messages suppressed lately.
+ *
+ * \return The number of messages suppressed since the last call.
+ */
+std::uint64_t log_limiter::take_pending()
+{
+    return f_pending.exchange(0, std::memory_order_relaxed);
+}
+
+
+/** \brief Get the total number of messages suppressed by this limiter.
+ *
+ * \return The number of suppressed messages.
+ */
+std::uint64_t log_limiter::get_suppressed() const
+{
+    return f_suppressed.load(std::memory_order_relaxed);
+}
+
+
 /** \brief Convert a log level to a string.
  *
  * This function transforms a log_level_t value to a string which can then
@@ -616,9 +1085,8 @@ std::string to_string(log_level_t level)
  *
  * This operator allows to send data of type T to the logger.
  *
- * The logger makes use of a stringstream to generate the final message.
- * The type T must be a type that the stringstream supports. In most
- * cases, these are the types that the iostream supports.
+ * The value is written to the calling thread's own stream, so no lock
+ * is required. The type T must be a type that an std::ostream supports.
  *
  * \param[in] v  The value to be output to this log message.
  *
@@ -638,31 +1106,51 @@ std::string to_string(log_level_t level)
  */
 
 
-/** \var logger::f_level
- * \brief The level of this message.
- *
- * This variable member holds the level of the message. The level can
- * be specified within the set of `<<` operators.
- *
- * The default is to display informational, warning, error, and fatal
- * error messages to the error output (stderr). Other messages (debug)
- * get dropped. If you have a callback assigned (i.e. for example, if
- * you use snaplogger in your application), then all the messages get
- * redirected to that callback.
+/** \var log_limiter::DEFAULT_RATE
+ * \brief The default number of messages accepted per period.
  */
 
 
-/** \var logger::f_log
- * \brief The log message.
- *
- * This variable member is a stringstream which holds the current message.
- * Once the end() is sent, it outputs the f_log.str() message.
+/** \var log_limiter::f_interval
+ * \brief The number of nanoseconds one token represents.
+ */
+
+
+/** \var log_limiter::f_tolerance
+ * \brief How far ahead of now the arrival time may go: burst * interval.
+ */
+
+
+/** \var log_limiter::f_tat
+ * \brief The theoretical arrival time of the next message.
+ */
+
+
+/** \var log_limiter::f_pending
+ * \brief The messages suppressed since the last accepted message.
+ */
+
+
+/** \var log_limiter::f_suppressed
+ * \brief The total number of suppressed messages.
+ */
+
+
+/** \var logger::f_rate_limited
+ * \brief The number of messages dropped by a log_limiter.
+ */
+
+
+/** \var logger::f_repeated
+ * \brief The number of repeated messages which were folded.
+ */
+
+
+/** \var logger::f_counters
+ * \brief The number of messages sent out at each level.
  *
- * \note
- * In order for messages to not criss-cross each other, the implementation
- * makes use of a global lock. That means only one thread can be sending
- * a log message at a time. The unlock() happens when the end() function
- * gets called.
+ * The counters are atomic since any number of threads may log at the
+ * same time.
  */
 
 
@@ -694,7 +1182,8 @@ std::string to_string(log_level_t level)
  *
  * By default, log messages will be sent to your console using std::cerr.
  * By setting up a log_callback function instead, it will be sent to
- * your function.
+ * your function. Any callable works, including lambdas with captures.
+ * The callback may move the message.
  *
  * \param[in] level  The level (severity) of this log message.
  * \param[in] message  The message to be logged.
@@ -27,7 +27,10 @@
 
 // C++
 //
+#include    <atomic>
+#include    <chrono>
 #include    <cstdint>
+#include    <functional>
 #include    <iostream>
 #include    <sstream>
 
@@ -50,9 +53,39 @@ enum class log_level_t
 std::string to_string(log_level_t level);
 
 
-typedef void (*log_callback)(log_level_t level, std::string const & message);
+typedef std::function<void(log_level_t level, std::string && message)> log_callback;
 
 void set_log_callback(log_callback callback);
+void set_thread_log_callback(log_callback callback);
+
+
+class log_limiter
+{
+public:
+    static constexpr std::uint32_t const    DEFAULT_RATE = 10;
+
+                        log_limiter(
+                              std::uint32_t rate = DEFAULT_RATE
+                            , std::chrono::nanoseconds period = std::chrono::seconds(1)
+                            , std::uint32_t burst = 0);
+                        log_limiter(log_limiter const & rhs) = delete;
+
+    log_limiter &       operator = (log_limiter const & rhs) = delete;
+
+    bool                allow();
+    std::uint64_t       take_pending();
+    std::uint64_t       get_suppressed() const;
+
+private:
+    std::int64_t const  f_interval;
+    std::int64_t const  f_tolerance;
+    std::atomic<std::int64_t>
+                        f_tat = 0;
+    std::atomic<std::uint64_t>
+                        f_pending = 0;
+    std::atomic<std::uint64_t>
+                        f_suppressed = 0;
+};
 
 
 class logger final
@@ -63,12 +96,12 @@ public:
     logger &            end();
     logger &            operator << (log_level_t const & level);
     logger &            operator << (logger & (*func)(logger &));
+    logger &            operator << (log_limiter & limiter);
 
     template<typename T>
     logger & operator << (T const & v)
     {
-        lock();
-        f_log << v;
+        stream() << v;
         return *this;
     }
 
@@ -76,14 +109,25 @@ public:
     std::uint32_t       get_counter(log_level_t level) const;
     std::uint32_t       get_errors() const;
     std::uint32_t       get_warnings() const;
+    std::uint64_t       get_rate_limited() const;
+    std::uint64_t       get_repeated() const;
+
+    static void         set_fold_repeated(bool fold);
 
 private:
+    friend void         set_log_callback(log_callback callback);
+
     static void         lock();
     static void         unlock();
-
-    log_level_t         f_level = log_level_t::error;
-    std::stringstream   f_log = std::stringstream();
-    std::uint32_t       f_counters[static_cast<int>(log_level_t::LOG_LEVEL_SIZE)] = {};
+    static std::ostream &
+                        stream();
+
+    std::atomic<std::uint32_t>
+                        f_counters[static_cast<int>(log_level_t::LOG_LEVEL_SIZE)] = {};
+    std::atomic<std::uint64_t>
+                        f_rate_limited = 0;
+    std::atomic<std::uint64_t>
+                        f_repeated = 0;
 };
 
 
@@ -0,0 +1,623 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the memory mapped log sink.
+ *
+ * The file starts with a header of one page followed by the ring. The
+ * ring is a power of two in size and its records are 8 bytes aligned.
+ * Each record starts with a record_header which includes the absolute
+ * position of the record, which is how the reader distinguishes records
+ * of the current lap from the leftovers of the previous one.
+ */
+
+
+// self
+//
+#include    "cppthread/mmap_log.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/thread.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstring>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <time.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+constexpr char const            g_magic[8] = { 'C', 'P', 'P', 'T', 'L', 'O', 'G', '1' };
+constexpr std::uint32_t const   VERSION = 1;
+constexpr std::size_t const     HEADER_SIZE = 4096;
+constexpr std::size_t const     MINIMUM_SIZE = 4096;
+constexpr std::uint32_t const   RECORD_COMMITTED = 0x4C4F4731;     // "LOG1"
+constexpr std::uint32_t const   RECORD_PADDING = 0x50414444;       // "PADD"
+
+
+/** \brief The header at the start of the file.
+ *
+ * The f_head counter is the total number of bytes ever reserved in the
+ * ring. It is shared by all the threads (and processes) appending to the
+ * file.
+ */
+struct file_header
+{
+    char                        f_magic[8];
+    std::uint32_t               f_version;
+    std::uint32_t               f_header_size;
+    std::uint64_t               f_data_size;
+    alignas(64) std::atomic<std::uint64_t>
+                                f_head;
+};
+
+static_assert(sizeof(file_header) <= HEADER_SIZE);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+
+/** \brief The header of each record.
+ *
+ * The f_state is set to RECORD_COMMITTED last, once the message was
+ * copied. A record with its position set and another state was being
+ * written when the process died.
+ */
+struct record_header
+{
+    std::atomic<std::uint32_t>  f_state;
+    std::uint32_t               f_size;
+    std::uint64_t               f_position;
+    std::uint64_t               f_time_ns;
+    std::int32_t                f_tid;
+    std::uint32_t               f_level;
+    std::uint32_t               f_length;
+    std::uint32_t               f_reserved;
+};
+
+static_assert(sizeof(record_header) % 8 == 0);
+
+
+/** \brief The sink receiving the logs through the log callback.
+ *
+ * This pointer is only used to know whether uninstall() has to reset
+ * the log callback.
+ */
+std::atomic<mmap_log_sink *>    g_installed_sink = nullptr;
+
+
+/** \brief Check whether \p header describes a valid log file.
+ *
+ * \param[in] header  The header to check.
+ * \param[in] file_size  The size of the file.
+ *
+ * \return true if the header is valid.
+ */
+bool valid_header(file_header const * header, std::size_t file_size)
+{
+    return memcmp(header->f_magic, g_magic, sizeof(g_magic)) == 0
+        && header->f_version == VERSION
+        && header->f_header_size == HEADER_SIZE
+        && header->f_data_size >= MINIMUM_SIZE
+        && (header->f_data_size & (header->f_data_size - 1)) == 0
+        && HEADER_SIZE + header->f_data_size == file_size;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class mmap_log_entry
+ * \brief One message read back from a memory mapped log file.
+ *
+ * The f_complete flag is false for a message which was being written
+ * when the process died; its text may be truncated or garbled.
+ */
+
+
+/** \class mmap_log_sink
+ * \brief Save log messages in a memory mapped ring.
+ *
+ * The messages are copied to a file mapped in memory. Since the pages
+ * belong to the kernel, the messages survive a crash of the process
+ * (but not of the system unless sync() was called). Once the ring is
+ * full, the oldest messages get overwritten.
+ *
+ * Appending a message is lock-free: a thread reserves space with a
+ * single fetch_add() on the head counter, copies its message, then
+ * marks the record as committed. Any number of threads can append at
+ * the same time.
+ *
+ * To send all the cppthread logs to the file:
+ *
+ * \code
+ *     cppthread::mmap_log_sink sink("/var/log/my-service/crash.log");
+ *     sink.install();
+ * \endcode
+ *
+ * After a crash, the mmap-log-dump tool or read_mmap_log() gives you
+ * the last messages.
+ *
+ * Opening an existing log file with the same size keeps its messages;
+ * the new messages get appended after them.
+ */
+
+
+/** \brief Open or create a memory mapped log file.
+ *
+ * \exception invalid_error
+ * The \p size must be a power of two of at least 4096.
+ *
+ * \exception system_error
+ * The file could not be created, resized, or mapped.
+ *
+ * \param[in] filename  The name of the log file.
+ * \param[in] size  The size of the ring, not including the file header.
+ */
+mmap_log_sink::mmap_log_sink(
+          std::string const & filename
+        , std::size_t size)
+    : f_filename(filename)
+    , f_size(size)
+    , f_map_size(HEADER_SIZE + size)
+{
+    if(size < MINIMUM_SIZE
+    || (size & (size - 1)) != 0)
+    {
+        throw invalid_error(
+                  "mmap_log_sink: the size ("
+                + std::to_string(size)
+                + ") must be a power of two of at least "
+                + std::to_string(MINIMUM_SIZE)
+                + ".");
+    }
+
+    f_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if(f_fd == -1)
+    {
+        throw system_error(
+                  "mmap_log_sink: could not open \""
+                + filename
+                + "\": "
+                + strerror(errno));
+    }
+
+    struct stat st = {};
+    if(fstat(f_fd, &st) != 0)
+    {
+        int const e(errno);
+        close(f_fd);
+        throw system_error("mmap_log_sink: fstat() failed: " + std::string(strerror(e)));
+    }
+
+    bool keep(false);
+    if(static_cast<std::size_t>(st.st_size) == f_map_size)
+    {
+        file_header header;
+        keep = pread(f_fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+            && valid_header(&header, f_map_size);
+    }
+    if(!keep)
+    {
+        // truncating first zeroes the whole file
+        //
+        if(ftruncate(f_fd, 0) != 0
+        || ftruncate(f_fd, f_map_size) != 0)
+        {
+            int const e(errno);
+            close(f_fd);
+            throw system_error(
+                      "mmap_log_sink: could not resize \""
+                    + filename
+                    + "\": "
+                    + strerror(e));
+        }
+    }
+
+    void * map(mmap(nullptr, f_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, f_fd, 0));
+    if(map == MAP_FAILED)
+    {
+        int const e(errno);
+        close(f_fd);
+        throw system_error("mmap_log_sink: mmap() failed: " + std::string(strerror(e)));
+    }
+    f_map = static_cast<char *>(map);
+
+    if(!keep)
+    {
+        file_header * header(reinterpret_cast<file_header *>(f_map));
+        header->f_version = VERSION;
+        header->f_header_size = HEADER_SIZE;
+        header->f_data_size = f_size;
+        header->f_head.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(header->f_magic, g_magic, sizeof(g_magic));
+    }
+}
+
+
+/** \brief Unmap and close the log file.
+ *
+ * If this sink was installed as the log callback, it gets uninstalled
+ * first; once set_log_callback() returns, the logger does not use this
+ * sink anymore. Make sure no other thread is still calling append()
+ * directly.
+ */
+mmap_log_sink::~mmap_log_sink()
+{
+    uninstall();
+    munmap(f_map, f_map_size);
+    close(f_fd);
+}
+
+
+/** \brief Get the name of the log file.
+ *
+ * \return The filename passed to the constructor.
+ */
+std::string const & mmap_log_sink::get_filename() const
+{
+    return f_filename;
+}
+
+
+/** \brief Get the size of the ring.
+ *
+ * \return The size of the ring in bytes.
+ */
+std::size_t mmap_log_sink::get_size() const
+{
+    return f_size;
+}
+
+
+/** \brief Append a message to the ring.
+ *
+ * This function never blocks. Messages larger than a quarter of the
+ * ring get truncated.
+ *
+ * \param[in] level  The level of the message.
+ * \param[in] message  The message to append.
+ */
+void mmap_log_sink::append(log_level_t level, std::string const & message)
+{
+    std::size_t const length(std::min(message.length(), f_size / 4 - sizeof(record_header)));
+    std::size_t const size((sizeof(record_header) + length + 7) & ~static_cast<std::size_t>(7));
+
+    timespec now = {};
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    file_header * header(reinterpret_cast<file_header *>(f_map));
+    char * data(f_map + HEADER_SIZE);
+    for(;;)
+    {
+        std::uint64_t const position(header->f_head.fetch_add(size, std::memory_order_acq_rel));
+        std::size_t const offset(position & (f_size - 1));
+        if(offset + size > f_size)
+        {
+            // a record never wraps around; pad both parts of the
+            // reserved space and try again
+            //
+            write_padding(position, f_size - offset);
+            write_padding(position + f_size - offset, offset + size - f_size);
+            continue;
+        }
+
+        record_header * record(reinterpret_cast<record_header *>(data + offset));
+        record->f_state.store(0, std::memory_order_relaxed);
+        record->f_size = static_cast<std::uint32_t>(size);
+        record->f_time_ns = now.tv_sec * 1'000'000'000ULL + now.tv_nsec;
+        record->f_tid = gettid();
+        record->f_level = static_cast<std::uint32_t>(level);
+        record->f_length = static_cast<std::uint32_t>(length);
+        record->f_reserved = 0;
+
+        // the position makes the record visible to the reader so it has
+        // to be saved after the size, even if we crash in between
+        //
+        std::atomic_signal_fence(std::memory_order_release);
+        record->f_position = position;
+        char * text(reinterpret_cast<char *>(record + 1));
+        memcpy(text, message.data(), length);
+        memset(text + length, 0, size - sizeof(record_header) - length);
+        record->f_state.store(RECORD_COMMITTED, std::memory_order_release);
+        return;
+    }
+}
+
+
+/** \brief Write a padding record.
+ *
+ * A space too small for a record header is left as is; the reader
+ * skips it by searching for the next valid record.
+ *
+ * \param[in] position  The absolute position of the padding.
+ * \param[in] size  The size of the padding.
+ */
+void mmap_log_sink::write_padding(std::uint64_t position, std::size_t size)
+{
+    if(size < sizeof(record_header))
+    {
+        return;
+    }
+
+    record_header * record(reinterpret_cast<record_header *>(f_map + HEADER_SIZE + (position & (f_size - 1))));
+    record->f_state.store(0, std::memory_order_relaxed);
+    record->f_size = static_cast<std::uint32_t>(size);
+    record->f_length = 0;
+    std::atomic_signal_fence(std::memory_order_release);
+    record->f_position = position;
+    record->f_state.store(RECORD_PADDING, std::memory_order_release);
+}
+
+
+/** \brief Flush the ring to disk.
+ *
+ * The messages survive a crash of the process without this call. Call
+ * sync() to also have them survive a crash of the system, for example
+ * before an abort().
+ *
+ * \exception system_error
+ * The msync() call failed.
+ */
+void mmap_log_sink::sync()
+{
+    if(msync(f_map, f_map_size, MS_SYNC) != 0)
+    {
+        throw system_error("mmap_log_sink: msync() failed: " + std::string(strerror(errno)));
+    }
+}
+
+
+/** \brief Send all the cppthread logs to this sink.
+ *
+ * This function replaces the log callback. Only one sink can be
+ * installed at a time.
+ *
+ * \sa set_log_callback()
+ */
+void mmap_log_sink::install()
+{
+    g_installed_sink.store(this, std::memory_order_release);
+    set_log_callback([this](log_level_t level, std::string && message)
+        {
+            append(level, message);
+        });
+}
+
+
+/** \brief Stop sending the cppthread logs to this sink.
+ *
+ * If this sink is the one currently installed, the log callback gets
+ * reset so the logs go to std::cerr again.
+ */
+void mmap_log_sink::uninstall()
+{
+    mmap_log_sink * expected(this);
+    if(g_installed_sink.compare_exchange_strong(expected, nullptr))
+    {
+        set_log_callback(nullptr);
+    }
+}
+
+
+/** \brief Read the messages of a memory mapped log file.
+ *
+ * The messages are returned from the oldest to the most recent. The
+ * file can be read while a process is still writing to it.
+ *
+ * \exception system_error
+ * The file could not be opened or read.
+ *
+ * \exception invalid_error
+ * The file is not a cppthread memory mapped log file.
+ *
+ * \param[in] filename  The name of the log file.
+ *
+ * \return The messages found in the file.
+ */
+mmap_log_entries_t read_mmap_log(std::string const & filename)
+{
+    int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd == -1)
+    {
+        throw system_error(
+                  "read_mmap_log: could not open \""
+                + filename
+                + "\": "
+                + strerror(errno));
+    }
+
+    struct stat st = {};
+    if(fstat(fd, &st) != 0
+    || static_cast<std::size_t>(st.st_size) < HEADER_SIZE)
+    {
+        close(fd);
+        throw invalid_error("read_mmap_log: \"" + filename + "\" is not a log file.");
+    }
+    std::size_t const file_size(st.st_size);
+
+    void * map(mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0));
+    int const e(errno);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        throw system_error("read_mmap_log: mmap() failed: " + std::string(strerror(e)));
+    }
+
+    char const * const base(static_cast<char const *>(map));
+    file_header const * header(reinterpret_cast<file_header const *>(base));
+    if(!valid_header(header, file_size))
+    {
+        munmap(map, file_size);
+        throw invalid_error("read_mmap_log: \"" + filename + "\" is not a log file.");
+    }
+
+    std::uint64_t const size(header->f_data_size);
+    std::uint64_t const head(header->f_head.load(std::memory_order_acquire));
+    char const * data(base + HEADER_SIZE);
+
+    mmap_log_entries_t result;
+    std::uint64_t position(head > size ? head - size : 0);
+    while(position + sizeof(record_header) <= head)
+    {
+        std::size_t const offset(position & (size - 1));
+        if(offset + sizeof(record_header) > size)
+        {
+            position += size - offset;
+            continue;
+        }
+
+        // the record at this position may be a leftover of the previous
+        // lap, the middle of a record, or space nobody wrote yet; in all
+        // those cases we search for the next valid record
+        //
+        record_header const * record(reinterpret_cast<record_header const *>(data + offset));
+        std::uint32_t const state(record->f_state.load(std::memory_order_acquire));
+        if(record->f_position != position
+        || record->f_size < sizeof(record_header)
+        || record->f_size % 8 != 0
+        || offset + record->f_size > size)
+        {
+            position += 8;
+            continue;
+        }
+
+        if(state != RECORD_PADDING)
+        {
+            mmap_log_entry entry;
+            entry.f_position = position;
+            entry.f_time_ns = record->f_time_ns;
+            entry.f_tid = record->f_tid;
+            entry.f_level = record->f_level < static_cast<std::uint32_t>(log_level_t::LOG_LEVEL_SIZE)
+                                ? static_cast<log_level_t>(record->f_level)
+                                : log_level_t::fatal;
+            entry.f_complete = state == RECORD_COMMITTED;
+            entry.f_message.assign(
+                      reinterpret_cast<char const *>(record + 1)
+                    , std::min<std::size_t>(record->f_length, record->f_size - sizeof(record_header)));
+            result.push_back(entry);
+        }
+        position += record->f_size;
+    }
+
+    munmap(map, file_size);
+
+    return result;
+}
+
+
+/** \typedef mmap_log_entries_t
+ * \brief A list of messages read from a memory mapped log file.
+ */
+
+
+/** \typedef mmap_log_sink::pointer_t
+ * \brief A shared pointer to a memory mapped log sink.
+ */
+
+
+/** \var mmap_log_sink::DEFAULT_SIZE
+ * \brief The default size of the ring.
+ */
+
+
+/** \var mmap_log_sink::f_filename
+ * \brief The name of the log file.
+ */
+
+
+/** \var mmap_log_sink::f_size
+ * \brief The size of the ring, a power of two.
+ */
+
+
+/** \var mmap_log_sink::f_fd
+ * \brief The file descriptor of the log file.
+ */
+
+
+/** \var mmap_log_sink::f_map
+ * \brief The address where the file is mapped.
+ */
+
+
+/** \var mmap_log_sink::f_map_size
+ * \brief The size of the mapping, header included.
+ */
+
+
+/** \var mmap_log_entry::f_position
+ * \brief The absolute position of the message in the ring.
+ */
+
+
+/** \var mmap_log_entry::f_time_ns
+ * \brief When the message was appended, in nanoseconds since the epoch.
+ */
+
+
+/** \var mmap_log_entry::f_tid
+ * \brief The identifier of the thread which appended the message.
+ */
+
+
+/** \var mmap_log_entry::f_level
+ * \brief The level of the message.
+ */
+
+
+/** \var mmap_log_entry::f_complete
+ * \brief Whether the message was completely written.
+ */
+
+
+/** \var mmap_log_entry::f_message
+ * \brief The message.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
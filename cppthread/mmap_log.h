@@ -0,0 +1,108 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief A log sink writing to a memory mapped file.
+ *
+ * This file declares the mmap_log_sink class which appends log messages
+ * to a ring saved in a memory mapped file, and the function reading such
+ * a file back.
+ */
+
+
+// self
+//
+#include    <cppthread/log.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <memory>
+#include    <string>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+namespace cppthread
+{
+
+
+
+class mmap_log_entry
+{
+public:
+    std::uint64_t       f_position = 0;
+    std::uint64_t       f_time_ns = 0;
+    pid_t               f_tid = 0;
+    log_level_t         f_level = log_level_t::info;
+    bool                f_complete = false;
+    std::string         f_message = std::string();
+};
+
+typedef std::vector<mmap_log_entry>     mmap_log_entries_t;
+
+
+class mmap_log_sink
+{
+public:
+    typedef std::shared_ptr<mmap_log_sink>  pointer_t;
+
+    static constexpr std::size_t const      DEFAULT_SIZE = 4 * 1024 * 1024;
+
+                        mmap_log_sink(
+                              std::string const & filename
+                            , std::size_t size = DEFAULT_SIZE);
+                        mmap_log_sink(mmap_log_sink const & rhs) = delete;
+                        ~mmap_log_sink();
+
+    mmap_log_sink &     operator = (mmap_log_sink const & rhs) = delete;
+
+    std::string const & get_filename() const;
+    std::size_t         get_size() const;
+
+    void                append(log_level_t level, std::string const & message);
+    void                sync();
+
+    void                install();
+    void                uninstall();
+
+private:
+    void                write_padding(std::uint64_t position, std::size_t size);
+
+    std::string const   f_filename;
+    std::size_t         f_size = 0;
+    int                 f_fd = -1;
+    char *              f_map = nullptr;
+    std::size_t         f_map_size = 0;
+};
+
+
+mmap_log_entries_t      read_mmap_log(std::string const & filename);
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,309 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the multi_guard class.
+ *
+ * The multi_guard locks several mutexes using the same algorithm as
+ * std::lock(): lock one mutex, try to lock the others, and on failure
+ * release everything and start again with the mutex which was busy.
+ */
+
+
+// self
+//
+#include    "cppthread/multi_guard.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/lockable.h"
+#include    "cppthread/log.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// C
+//
+#include    <sched.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class multi_guard
+ * \brief Lock several mutexes in an RAII manner.
+ *
+ * Code moving data between two objects, each protected by its own mutex,
+ * needs to lock both mutexes. Using two nested guards is a problem when
+ * another thread does the same in the opposite direction: each thread
+ * gets its first mutex and then waits forever on the other.
+ *
+ * The multi_guard locks all the mutexes or none. It blocks on one mutex
+ * and only uses try_lock() on the others. If one of them is busy,
+ * it releases all the mutexes it already obtained and restarts by
+ * blocking on the busy mutex. This is the algorithm used by std::lock().
+ * It cannot deadlock, whatever the order used by the other threads.
+ *
+ * \code
+ *    {
+ *        // f_input and f_output are cppthread::fifo objects
+ *        //
+ *        cppthread::multi_guard lock(f_input, f_output);
+ *        ... // atomic work on both objects
+ *    }
+ * \endcode
+ *
+ * All the mutexes get unlocked by the destructor.
+ *
+ * Any lockable object can be used (mutex, spinlock, ticket_lock).
+ *
+ * \warning
+ * Like the guard, this class is expected to be used on the stack of one
+ * thread.
+ */
+
+
+
+/** \brief Lock two mutexes.
+ *
+ * This is the most common case: moving something from one object to
+ * another. The function returns once both mutexes are locked.
+ *
+ * The two mutexes can be the same mutex.
+ *
+ * \param[in] m1  The first mutex to lock.
+ * \param[in] m2  The second mutex to lock.
+ */
+multi_guard::multi_guard(lockable & m1, lockable & m2)
+    : multi_guard(mutexes_t{ &m1, &m2 })
+{
+}
+
+
+/** \brief Lock a set of mutexes.
+ *
+ * This function locks all the specified mutexes. The order in the
+ * vector does not matter. If the same mutex appears more than once, it
+ * gets locked only once.
+ *
+ * \exception logic_error
+ * The vector cannot be empty or include a null pointer.
+ *
+ * \param[in] mutexes  The mutexes to lock.
+ */
+multi_guard::multi_guard(mutexes_t const & mutexes)
+    : f_mutexes(mutexes)
+{
+    if(f_mutexes.empty())
+    {
+        throw logic_error("multi_guard() requires at least one mutex");
+    }
+    if(std::find(f_mutexes.begin(), f_mutexes.end(), nullptr) != f_mutexes.end())
+    {
+        throw logic_error("mutex missing in multi_guard() constructor");
+    }
+
+    std::sort(f_mutexes.begin(), f_mutexes.end());
+    f_mutexes.erase(std::unique(f_mutexes.begin(), f_mutexes.end()), f_mutexes.end());
+
+    lock();
+}
+
+
+/** \brief Unlock all the mutexes.
+ *
+ * The destructor makes sure that all the mutexes get unlocked. If an
+ * unlock fails, the function calls std::terminate().
+ */
+multi_guard::~multi_guard()
+{
+    try
+    {
+        unlock();
+    }
+    catch(std::exception const & e)
+    {
+        log << log_level_t::fatal
+            << "mutex::unlock() threw an exception while in the ~multi_guard() function."
+            << end;
+        std::terminate();
+    }
+}
+
+
+/** \brief Unlock all the mutexes.
+ *
+ * This function unlocks all the mutexes. If the mutexes are not currently locked, nothing happens.
+ *
+ * \sa lock()
+ */
+void multi_guard::unlock()
+{
+    if(f_locked)
+    {
+        f_locked = false;
+        release(0, f_mutexes.size());
+    }
+}
+
+
+/** \brief Relock all the mutexes.
+ *
+ * The constructor locks all the mutexes. If you called unlock(), this
+ * function can be used to lock them all again. If the mutexes are
+ * already locked, nothing happens.
+ *
+ * The function uses the same algorithm as the constructor so it cannot
+ * deadlock with other threads locking the same mutexes.
+ *
+ * \sa unlock()
+ */
+void multi_guard::lock()
+{
+    if(f_locked)
+    {
+        return;
+    }
+
+    std::size_t const max(f_mutexes.size());
+    std::size_t first(0);
+    for(;;)
+    {
+        // block on the mutex which was busy last time
+        //
+        f_mutexes[first]->lock();
+
+        std::size_t count(1);
+        for(; count < max; ++count)
+        {
+            std::size_t const idx((first + count) % max);
+            bool busy(true);
+            try
+            {
+                busy = !f_mutexes[idx]->try_lock();
+            }
+            catch(...)
+            {
+                release(first, count);
+                throw;
+            }
+            if(busy)
+            {
+                // release everything and wait on the busy mutex
+                //
+                release(first, count);
+                first = idx;
+                sched_yield();
+                break;
+            }
+        }
+
+        if(count == max)
+        {
+            f_locked = true;
+            return;
+        }
+    }
+}
+
+
+/** \brief Check whether the guard currently holds the mutexes.
+ *
+ * \return true if all the mutexes are locked by this guard.
+ */
+bool multi_guard::is_locked() const
+{
+    return f_locked;
+}
+
+
+/** \brief Unlock \p count mutexes starting at \p first.
+ *
+ * The lock() function starts with any one of the mutexes and wraps
+ * around the end of the vector. This function unlocks the mutexes
+ * it obtained in the reverse order.
+ *
+ * \param[in] first  The index of the first mutex which was locked.
+ * \param[in] count  The number of mutexes to unlock.
+ */
+void multi_guard::release(std::size_t first, std::size_t count)
+{
+    std::size_t const max(f_mutexes.size());
+    for(std::size_t idx(count); idx > 0; --idx)
+    {
+        f_mutexes[(first + idx - 1) % max]->unlock();
+    }
+}
+
+
+
+
+/** \typedef multi_guard::mutexes_t
+ * \brief A list of mutexes to lock.
+ *
+ * The multi_guard keeps bare pointers to the mutexes. The mutexes must
+ * remain valid for the lifetime of the guard.
+ */
+
+
+/** \fn multi_guard::multi_guard(multi_guard const & rhs)
+ * \brief The copy operator is deleted.
+ *
+ * A copy would unlock the mutexes twice.
+ *
+ * \param[in] rhs  The right hand side.
+ */
+
+
+/** \fn multi_guard & multi_guard::operator = (multi_guard const & rhs)
+ * \brief The assignment operator is deleted.
+ *
+ * An assignment would unlock the mutexes twice.
+ *
+ * \param[in] rhs  The right hand side.
+ *
+ * \return A reference to this object.
+ */
+
+
+/** \var multi_guard::f_locked
+ * \brief Whether the mutexes are currently locked by this guard.
+ */
+
+
+/** \var multi_guard::f_mutexes
+ * \brief The mutexes handled by this guard.
+ *
+ * The constructor sorts the mutexes and removes duplicates.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,70 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Guard locking several mutexes at once.
+ *
+ * This file declares the multi_guard class which locks a set of mutexes
+ * without risking a deadlock with other threads locking the same mutexes
+ * in a different order.
+ */
+
+
+// C++
+//
+#include    <cstddef>
+#include    <vector>
+
+
+
+namespace cppthread
+{
+
+
+class lockable;
+
+
+class multi_guard
+{
+public:
+    typedef std::vector<lockable *> mutexes_t;
+
+                        multi_guard(lockable & m1, lockable & m2);
+                        multi_guard(mutexes_t const & mutexes);
+                        multi_guard(multi_guard const & rhs) = delete;
+                        ~multi_guard();
+
+    multi_guard &       operator = (multi_guard const & rhs) = delete;
+
+    void                unlock();
+    void                lock();
+    bool                is_locked() const;
+
+private:
+    void                release(std::size_t first, std::size_t count);
+
+    bool                f_locked = false;
+    mutexes_t           f_mutexes = mutexes_t();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -30,7 +30,9 @@
 
 #include    "cppthread/exception.h"
 #include    "cppthread/guard.h"
+#include    "cppthread/lock_order.h"
 #include    "cppthread/log.h"
+#include    "cppthread/mutex_profiler.h"
 
 
 // snapdev
@@ -38,6 +40,11 @@
 #include    <snapdev/timespec_ex.h>
 
 
+// C++
+//
+#include    <algorithm>
+
+
 // C
 //
 #include    <string.h>
@@ -56,57 +63,6 @@ namespace cppthread
 
 
 
-namespace detail
-{
-
-
-
-/** \brief The implementation of the mutex.
- *
- * We have an internal implementation of the mutex to avoid leaking the
- * pthread library to the outside.
- *
- * The class holds a mutex and a condition which we use to wait in various
- * circumstances such as when we pop items from a currently empty fifo.
- */
-class mutex_impl
-{
-public:
-    pthread_mutex_t     f_mutex = pthread_mutex_t();
-    pthread_cond_t      f_condition = pthread_cond_t();
-};
-
-
-/** \var pthread_mutex_t mutex_impl::f_mutex
- * \brief Mutex to support guards & signals.
- *
- * This is the actual system mutex. It is useful to protect areas of code
- * that only one thread is allowed to access at a time.
- *
- * The mutex also supports a condition that it can wait on and signal. This
- * is useful to signal a new state such as the end of FIFO as any thread
- * waiting on that FIFO now needs to wake up a give up (no more messages
- * will be sent to the FIFO).
- */
-
-
-/** \var pthread_mutex_t mutex_impl::f_condition
- * \brief Condition linked to the mutex to support signalling.
- *
- * We often have to signal that a thread is done in regard to something or
- * other. That will wake up another thread which can then take over the
- * next step of the work.
- *
- * The condition is used for that purpose as we can wait on it with the
- * attached mutex.
- */
-
-
-
-}
-
-
-
 /** \class mutex
  * \brief A mutex object to ensures atomicity.
  *
@@ -154,8 +110,12 @@ public:
  * The mutex copy and assignment operators are deleted. We do not allow you
  * to copy a mutex because that is not a good idea. You probably have an
  * issue in your code if you think you need to make a copy of a mutex.
- * (although that our implementation, because of the `f_impl`, would allow for
- * copies, it's still not a good idea.)
+ *
+ * \note
+ * The pthread mutex and condition are stored directly in the mutex object
+ * so creating a mutex does not allocate memory. This matters for objects
+ * such as the item_with_predicate which embed one mutex each and may be
+ * allocated by the million.
  */
 
 
@@ -227,7 +187,6 @@ public:
  * raised. The function also logs the error.
  */
 mutex::mutex()
-    : f_impl(std::make_shared<detail::mutex_impl>())
 {
     // initialize the mutex
     pthread_mutexattr_t mattr;
@@ -250,7 +209,7 @@ mutex::mutex()
         pthread_mutexattr_destroy(&mattr);
         throw invalid_error("pthread_muteattr_settype() failed");
     }
-    err = pthread_mutex_init(&f_impl->f_mutex, &mattr);
+    err = pthread_mutex_init(&f_mutex, &mattr);
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -267,7 +226,7 @@ mutex::mutex()
             << "a mutex attribute structure could not be destroyed, error #"
             << err
             << end;
-        pthread_mutex_destroy(&f_impl->f_mutex);
+        pthread_mutex_destroy(&f_mutex);
         throw invalid_error("pthread_mutexattr_destroy() failed");
     }
 
@@ -280,10 +239,10 @@ mutex::mutex()
             << "a mutex condition attribute structure could not be initialized, error #"
             << err
             << end;
-        pthread_mutex_destroy(&f_impl->f_mutex);
+        pthread_mutex_destroy(&f_mutex);
         throw invalid_error("pthread_condattr_init() failed");
     }
-    err = pthread_cond_init(&f_impl->f_condition, &cattr);
+    err = pthread_cond_init(&f_condition, &cattr);
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -291,7 +250,7 @@ mutex::mutex()
             << err
             << end;
         pthread_condattr_destroy(&cattr);
-        pthread_mutex_destroy(&f_impl->f_mutex);
+        pthread_mutex_destroy(&f_mutex);
         throw invalid_error("pthread_cond_init() failed");
     }
     err = pthread_condattr_destroy(&cattr);
@@ -301,7 +260,7 @@ mutex::mutex()
             << "a mutex condition attribute structure could not be destroyed, error #"
             << err
             << end;
-        pthread_mutex_destroy(&f_impl->f_mutex);
+        pthread_mutex_destroy(&f_mutex);
         throw invalid_error("pthread_condattr_destroy() failed");
     }
 }
@@ -334,7 +293,7 @@ mutex::~mutex()
             << end;
         std::terminate();
     }
-    int err(pthread_cond_destroy(&f_impl->f_condition));
+    int err(pthread_cond_destroy(&f_condition));
     if(err != 0)
     {
         log << log_level_t::error
@@ -342,7 +301,7 @@ mutex::~mutex()
             << err
             << end;
     }
-    err = pthread_mutex_destroy(&f_impl->f_mutex);
+    err = pthread_mutex_destroy(&f_mutex);
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -350,6 +309,59 @@ mutex::~mutex()
             << err
             << end;
     }
+    if(f_profile != nullptr)
+    {
+        detail::destroy_mutex_profile(f_profile);
+    }
+
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_forget(this);
+#endif
+}
+
+
+/** \brief Give a name to this mutex.
+ *
+ * Naming a mutex registers it with the lock contention profiler. Once
+ * the profiler is enabled (see enable_mutex_profiling()), the mutex
+ * records its number of acquisitions, the number of contended
+ * acquisitions, the time threads waited for it and the maximum time
+ * it was held.
+ *
+ * Several mutexes can share the same name.
+ *
+ * \param[in] name  The name of this mutex.
+ *
+ * \sa get_mutex_profiles()
+ */
+void mutex::set_name(std::string const & name)
+{
+    if(f_profile == nullptr)
+    {
+        f_profile = detail::create_mutex_profile(name);
+    }
+    else
+    {
+        detail::rename_mutex_profile(f_profile, name);
+    }
+}
+
+
+/** \brief Retrieve the name of this mutex.
+ *
+ * This function returns the name given to this mutex with set_name().
+ * By default, a mutex has no name and the function returns an empty
+ * string.
+ *
+ * \return The name of the mutex.
+ */
+std::string mutex::get_name() const
+{
+    if(f_profile == nullptr)
+    {
+        return std::string();
+    }
+    return detail::get_mutex_profile_name(f_profile);
 }
 
 
@@ -368,7 +380,31 @@ mutex::~mutex()
  */
 void mutex::lock()
 {
-    int const err(pthread_mutex_lock(&f_impl->f_mutex));
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_lock(this);
+#endif
+
+    int err(0);
+    if(detail::is_profiled(f_profile))
+    {
+        // try first to know whether another thread holds the lock
+        //
+        std::uint64_t const start(detail::profile_lock_start(f_profile));
+        err = pthread_mutex_trylock(&f_mutex);
+        bool const contended(err == EBUSY);
+        if(contended)
+        {
+            err = pthread_mutex_lock(&f_mutex);
+        }
+        if(err == 0)
+        {
+            detail::profile_lock_acquired(f_profile, start, contended);
+        }
+    }
+    else
+    {
+        err = pthread_mutex_lock(&f_mutex);
+    }
     if(err != 0)
     {
         log << log_level_t::error
@@ -380,6 +416,10 @@ void mutex::lock()
         throw invalid_error("pthread_mutex_lock() failed");
     }
 
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_acquired(this);
+#endif
+
     // note: we do not need an atomic call since we
     //       already know we are running alone here...
     ++f_reference_count;
@@ -399,9 +439,18 @@ void mutex::lock()
  */
 bool mutex::try_lock()
 {
-    int const err(pthread_mutex_trylock(&f_impl->f_mutex));
+    int const err(pthread_mutex_trylock(&f_mutex));
     if(err == 0)
     {
+        if(detail::is_profiled(f_profile))
+        {
+            detail::profile_lock_acquired(f_profile, 0, false);
+        }
+
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+        detail::lock_order_acquired(this);
+#endif
+
         // note: we do not need an atomic call since we
         //       already know we are running alone here...
         ++f_reference_count;
@@ -425,6 +474,108 @@ bool mutex::try_lock()
 }
 
 
+/** \brief Try locking the mutex for a limited amount of time.
+ *
+ * This function tries to lock the mutex. If another thread holds the
+ * lock, the function waits up to \p timeout for the lock to be released.
+ * If it is still locked at that time, the function returns false.
+ *
+ * This is useful to fail fast when the owner of the mutex is stuck
+ * instead of piling up threads waiting on that mutex.
+ *
+ * \exception cppthread_exception_invalid_error
+ * If the lock fails, this exception is raised.
+ *
+ * \param[in] timeout  The maximum amount of time to wait for the lock.
+ *
+ * \return true if the lock succeeded, false if the function timed out.
+ *
+ * \sa try_lock_until()
+ */
+bool mutex::try_lock_for(std::chrono::nanoseconds const & timeout)
+{
+    return try_lock_until(std::chrono::steady_clock::now() + timeout);
+}
+
+
+/** \brief Try locking the mutex until a given date.
+ *
+ * This function tries to lock the mutex. If another thread holds the
+ * lock, the function waits until \p deadline for the lock to be released.
+ * If it is still locked at that time, the function returns false.
+ *
+ * The deadline uses the steady clock (CLOCK_MONOTONIC) so changing the
+ * system date has no effect on the wait.
+ *
+ * \exception cppthread_exception_invalid_error
+ * If the lock fails, this exception is raised.
+ *
+ * \param[in] deadline  The date when the function gives up.
+ *
+ * \return true if the lock succeeded, false if the function timed out.
+ *
+ * \sa try_lock_for()
+ */
+bool mutex::try_lock_until(std::chrono::steady_clock::time_point const & deadline)
+{
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_lock(this);
+#endif
+
+    std::int64_t const ns(std::max(
+              static_cast<std::int64_t>(0)
+            , static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            deadline.time_since_epoch()).count())));
+    timespec const abstime{
+              static_cast<time_t>(ns / 1'000'000'000LL)
+            , static_cast<long>(ns % 1'000'000'000LL)
+        };
+
+    int err(0);
+    if(detail::is_profiled(f_profile))
+    {
+        std::uint64_t const start(detail::profile_lock_start(f_profile));
+        err = pthread_mutex_trylock(&f_mutex);
+        bool const contended(err == EBUSY);
+        if(contended)
+        {
+            err = pthread_mutex_clocklock(&f_mutex, CLOCK_MONOTONIC, &abstime);
+        }
+        if(err == 0)
+        {
+            detail::profile_lock_acquired(f_profile, start, contended);
+        }
+    }
+    else
+    {
+        err = pthread_mutex_clocklock(&f_mutex, CLOCK_MONOTONIC, &abstime);
+    }
+    if(err == ETIMEDOUT)
+    {
+        return false;
+    }
+    if(err != 0)
+    {
+        log << log_level_t::error
+            << "a mutex timed lock generated error #"
+            << err
+            << " -- "
+            << strerror(err)
+            << end;
+        throw invalid_error("pthread_mutex_clocklock() failed");
+    }
+
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_acquired(this);
+#endif
+
+    // note: we do not need an atomic call since we
+    //       already know we are running alone here...
+    ++f_reference_count;
+    return true;
+}
+
+
 /** \brief Unlock a mutex.
  *
  * This function unlock the specified mutex. The function must be called
@@ -457,7 +608,16 @@ void mutex::unlock()
     //       already know we are running alone here...
     --f_reference_count;
 
-    int const err(pthread_mutex_unlock(&f_impl->f_mutex));
+    if(f_profile != nullptr)
+    {
+        detail::profile_unlock(f_profile);
+    }
+
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+    detail::lock_order_unlock(this);
+#endif
+
+    int const err(pthread_mutex_unlock(&f_mutex));
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -508,7 +668,18 @@ void mutex::wait()
     //        << end;
     //    throw exception_not_locked_once_error();
     //}
-    int const err(pthread_cond_wait(&f_impl->f_condition, &f_impl->f_mutex));
+    bool const profiled(detail::is_profiled(f_profile));
+    std::uint32_t depth(0);
+    std::uint64_t start(0);
+    if(profiled)
+    {
+        start = detail::profile_wait_start(f_profile, depth);
+    }
+    int const err(pthread_cond_wait(&f_condition, &f_mutex));
+    if(profiled)
+    {
+        detail::profile_wait_end(f_profile, start, depth);
+    }
     if(err != 0)
     {
         // an error occurred!
@@ -592,10 +763,21 @@ bool mutex::timed_wait(timespec const & nsecs)
     //
     abstime += nsecs;
 
+    bool const profiled(detail::is_profiled(f_profile));
+    std::uint32_t depth(0);
+    std::uint64_t start(0);
+    if(profiled)
+    {
+        start = detail::profile_wait_start(f_profile, depth);
+    }
     err = pthread_cond_timedwait(
-              &f_impl->f_condition
-            , &f_impl->f_mutex
+              &f_condition
+            , &f_mutex
             , &abstime);
+    if(profiled)
+    {
+        detail::profile_wait_end(f_profile, start, depth);
+    }
     if(err != 0)
     {
         if(err == ETIMEDOUT)
@@ -604,7 +786,13 @@ bool mutex::timed_wait(timespec const & nsecs)
         }
 
         // an error occurred!
-        log << log_level_t::fatal
+        //
+        // a broken condition tends to fail on every call, so limit the
+        // number of times we log it
+        //
+        static log_limiter limiter;
+        log << limiter
+            << log_level_t::fatal
             << "a mutex conditional timed wait generated error #"
             << err
             << " -- "
@@ -685,10 +873,21 @@ bool mutex::dated_wait(timespec const & date)
     //    throw exception_not_locked_once_error();
     //}
 
+    bool const profiled(detail::is_profiled(f_profile));
+    std::uint32_t depth(0);
+    std::uint64_t start(0);
+    if(profiled)
+    {
+        start = detail::profile_wait_start(f_profile, depth);
+    }
     int const err(pthread_cond_timedwait(
-              &f_impl->f_condition
-            , &f_impl->f_mutex
+              &f_condition
+            , &f_mutex
             , &date));
+    if(profiled)
+    {
+        detail::profile_wait_end(f_profile, start, depth);
+    }
     if(err != 0)
     {
         if(err == ETIMEDOUT)
@@ -697,7 +896,13 @@ bool mutex::dated_wait(timespec const & date)
         }
 
         // an error occurred!
-        log << log_level_t::error
+        //
+        // a broken condition tends to fail on every call, so limit the
+        // number of times we log it
+        //
+        static log_limiter limiter;
+        log << limiter
+            << log_level_t::error
             << "a mutex conditional wait generated error #"
             << err
             << " -- "
@@ -736,7 +941,7 @@ bool mutex::dated_wait(timespec const & date)
  */
 void mutex::signal()
 {
-    int const err(pthread_cond_signal(&f_impl->f_condition));
+    int const err(pthread_cond_signal(&f_condition));
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -766,7 +971,7 @@ void mutex::safe_signal()
 {
     guard lock(*this);
 
-    int const err(pthread_cond_signal(&f_impl->f_condition));
+    int const err(pthread_cond_signal(&f_condition));
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -800,7 +1005,7 @@ void mutex::safe_broadcast()
 {
     guard lock(*this);
 
-    int const err(pthread_cond_broadcast(&f_impl->f_condition));
+    int const err(pthread_cond_broadcast(&f_condition));
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -839,7 +1044,7 @@ void mutex::broadcast()
 {
     guard lock(*this);
 
-    int const err(pthread_cond_broadcast(&f_impl->f_condition));
+    int const err(pthread_cond_broadcast(&f_condition));
     if(err != 0)
     {
         log << log_level_t::fatal
@@ -932,6 +1137,7 @@ void create_system_mutex()
     }
 
     g_system_mutex = new mutex;
+    g_system_mutex->set_name("cppthread::system");
 }
 
 
@@ -964,11 +1170,39 @@ void create_system_mutex()
  */
 
 
-/** \var mutex::f_impl
- * \brief The pthread mutex implementation.
+/** \var mutex::f_mutex
+ * \brief Mutex to support guards & signals.
+ *
+ * This is the actual system mutex. It is useful to protect areas of code
+ * that only one thread is allowed to access at a time.
+ *
+ * The mutex also supports a condition that it can wait on and signal. This
+ * is useful to signal a new state such as the end of FIFO as any thread
+ * waiting on that FIFO now needs to wake up a give up (no more messages
+ * will be sent to the FIFO).
+ */
+
+
+/** \var mutex::f_condition
+ * \brief Condition linked to the mutex to support signalling.
+ *
+ * We often have to signal that a thread is done in regard to something or
+ * other. That will wake up another thread which can then take over the
+ * next step of the work.
+ *
+ * The condition is used for that purpose as we can wait on it with the
+ * attached mutex.
+ */
+
+
+/** \var mutex::f_profile
+ * \brief The statistics of this mutex.
+ *
+ * When the mutex is given a name, a profile gets allocated and the
+ * lock, unlock, and wait functions record statistics in it while the
+ * profiler is enabled. Unnamed mutexes are never profiled.
  *
- * This variable member holds the actual pthread mutex. The mutex
- * implementation manages this field as required.
+ * \sa mutex::set_name()
  */
 
 
@@ -30,13 +30,25 @@
  */
 
 
+// self
+//
+#include    <cppthread/lockable.h>
+
+
 // C++
 //
+#include    <chrono>
 #include    <cstdint>
 #include    <memory>
+#include    <string>
 #include    <vector>
 
 
+// C
+//
+#include    <pthread.h>
+
+
 
 namespace cppthread
 {
@@ -45,13 +57,14 @@ namespace cppthread
 
 namespace detail
 {
-class mutex_impl;
+class mutex_profile;
 }
 
 
 // a mutex to ensure single threaded work
 //
 class mutex
+    : public lockable
 {
 public:
     typedef std::shared_ptr<mutex>     pointer_t;
@@ -60,13 +73,15 @@ public:
 
                         mutex();
                         mutex(mutex const & rhs) = delete;
-                        ~mutex();
+    virtual             ~mutex();
 
     mutex &             operator = (mutex const & rhs) = delete;
 
-    void                lock();
-    bool                try_lock();
-    void                unlock();
+    virtual void        lock() override;
+    virtual bool        try_lock() override;
+    bool                try_lock_for(std::chrono::nanoseconds const & timeout);
+    bool                try_lock_until(std::chrono::steady_clock::time_point const & deadline);
+    virtual void        unlock() override;
     void                wait();
     bool                timed_wait(std::uint64_t const usec);
     bool                timed_wait(timespec const & nsec);
@@ -77,10 +92,14 @@ public:
     void                broadcast();
     void                safe_broadcast();
 
-private:
-    std::shared_ptr<detail::mutex_impl>
-                        f_impl;
+    void                set_name(std::string const & name);
+    std::string         get_name() const;
 
+private:
+    pthread_mutex_t     f_mutex = pthread_mutex_t();
+    pthread_cond_t      f_condition = pthread_cond_t();
+    detail::mutex_profile *
+                        f_profile = nullptr;
     std::uint32_t       f_reference_count = 0;
 };
 
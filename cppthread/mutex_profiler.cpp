@@ -0,0 +1,734 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the lock contention profiler.
+ *
+ * When a service slows down, one of the first things to check is whether
+ * a mutex is hot: many threads waiting on the same lock. The profiler
+ * gathers the following statistics for each named mutex:
+ *
+ * \li the number of acquisitions (lock() and successful try_lock() calls),
+ * \li the number of contended acquisitions (another thread had the lock),
+ * \li the total and maximum time spent waiting for the lock,
+ * \li the maximum time the lock was held,
+ * \li the number of condition waits and the time spent in them.
+ *
+ * To use the profiler, give a name to the mutexes you are interested in
+ * and enable the profiler:
+ *
+ * \code
+ *     f_sessions_mutex.set_name("sessions");
+ *     ...
+ *     cppthread::enable_mutex_profiling();
+ *     cppthread::set_mutex_profiling_signal(SIGUSR2);
+ * \endcode
+ *
+ * Then `kill -USR2 <pid>` logs a report, or call dump_mutex_profiles()
+ * or get_mutex_profiles() directly.
+ *
+ * When the profiler is disabled, the overhead of a lock is one pointer
+ * test and, for named mutexes, one relaxed atomic load.
+ */
+
+// self
+//
+#include    "cppthread/mutex_profiler.h"
+
+#include    "cppthread/futex.h"
+#include    "cppthread/log.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <chrono>
+#include    <iomanip>
+#include    <set>
+#include    <sstream>
+
+
+// C
+//
+#include    <errno.h>
+#include    <pthread.h>
+#include    <signal.h>
+#include    <string.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace detail
+{
+
+
+
+/** \brief The statistics of one mutex.
+ *
+ * Each named mutex has a profile. The counters are atomic so they can be
+ * read by the dump functions at any time. The depth and lock date are
+ * only accessed by the thread holding the mutex.
+ */
+class mutex_profile
+{
+public:
+    std::string                 f_name = std::string();
+    std::atomic<std::uint64_t>  f_acquisitions = 0;
+    std::atomic<std::uint64_t>  f_contended = 0;
+    std::atomic<std::uint64_t>  f_total_wait_ns = 0;
+    std::atomic<std::uint64_t>  f_max_wait_ns = 0;
+    std::atomic<std::uint64_t>  f_max_hold_ns = 0;
+    std::atomic<std::uint64_t>  f_condition_waits = 0;
+    std::atomic<std::uint64_t>  f_condition_wait_ns = 0;
+
+    std::uint32_t               f_depth = 0;
+    std::uint64_t               f_locked_at = 0;
+};
+
+
+/** \brief Whether the profiler is currently enabled.
+ *
+ * This flag is checked each time a named mutex gets locked. It is only
+ * loaded with a relaxed memory order so it costs next to nothing.
+ */
+std::atomic<bool>           g_mutex_profiling = false;
+
+
+
+} // namespace detail
+
+
+
+namespace
+{
+
+
+
+typedef std::set<detail::mutex_profile *>   profiles_t;
+
+
+/** \brief The mutex protecting the list of profiles.
+ *
+ * We cannot use a cppthread::mutex here since the mutex calls these
+ * functions.
+ */
+pthread_mutex_t             g_profiles_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/** \brief Whether a report was requested by a signal.
+ *
+ * The signal handler only sets this word to 1 and wakes up the reporter
+ * thread which generates the report.
+ */
+std::atomic<std::uint32_t>  g_report_requested = 0;
+
+
+/** \brief Whether the reporter thread was started.
+ *
+ * The reporter thread gets created the first time
+ * set_mutex_profiling_signal() is called.
+ */
+std::atomic<bool>           g_reporter_started = false;
+
+
+/** \brief Retrieve the set of profiles.
+ *
+ * The system mutex gets named while the library is being initialized,
+ * so the set has to be created on first use.
+ *
+ * \return A reference to the set of profiles.
+ */
+profiles_t & get_profiles()
+{
+    static profiles_t * profiles(new profiles_t);
+    return *profiles;
+}
+
+
+class profiles_lock
+{
+public:
+    profiles_lock()
+    {
+        pthread_mutex_lock(&g_profiles_mutex);
+    }
+
+    profiles_lock(profiles_lock const &) = delete;
+    profiles_lock & operator = (profiles_lock const &) = delete;
+
+    ~profiles_lock()
+    {
+        pthread_mutex_unlock(&g_profiles_mutex);
+    }
+};
+
+
+std::uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void update_max(std::atomic<std::uint64_t> & max, std::uint64_t value)
+{
+    std::uint64_t current(max.load(std::memory_order_relaxed));
+    while(value > current
+       && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+
+void report_signal_handler(int sig)
+{
+    static_cast<void>(sig);
+
+    // the futex system call is async-signal-safe, but it may change errno
+    //
+    int const e(errno);
+    g_report_requested.store(1, std::memory_order_release);
+    detail::futex_wake(g_report_requested);
+    errno = e;
+}
+
+
+void log_report()
+{
+    std::stringstream ss;
+    dump_mutex_profiles(ss);
+    log << log_level_t::info
+        << ss.str()
+        << end;
+}
+
+
+/** \brief The reporter thread.
+ *
+ * This thread sleeps until the signal handler requests a report. It
+ * blocks all signals so the handler runs in one of the other threads.
+ *
+ * \param[in] data  Unused.
+ *
+ * \return Never returns.
+ */
+void * reporter(void * data)
+{
+    static_cast<void>(data);
+
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    for(;;)
+    {
+        while(g_report_requested.load(std::memory_order_acquire) == 0)
+        {
+            detail::futex_wait(g_report_requested, 0);
+        }
+        g_report_requested.store(0, std::memory_order_relaxed);
+        log_report();
+    }
+
+    return nullptr;
+}
+
+
+/** \brief Start the reporter thread once.
+ *
+ * \return true if the thread is running.
+ */
+bool start_reporter()
+{
+    if(g_reporter_started.exchange(true))
+    {
+        return true;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t id;
+    int const err(pthread_create(&id, &attr, &reporter, nullptr));
+    pthread_attr_destroy(&attr);
+    if(err != 0)
+    {
+        g_reporter_started.store(false);
+        log << log_level_t::error
+            << "could not start the mutex profiling reporter thread, errno: "
+            << err
+            << " -- "
+            << strerror(err)
+            << end;
+        return false;
+    }
+    pthread_setname_np(id, "mutex_reporter");
+
+    return true;
+}
+
+
+
+} // no name namespace
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Create the profile of a mutex.
+ *
+ * This function is called by mutex::set_name(). It allocates a profile
+ * and registers it so the dump functions can find it.
+ *
+ * \param[in] name  The name of the mutex.
+ *
+ * \return The new profile.
+ */
+mutex_profile * create_mutex_profile(std::string const & name)
+{
+    mutex_profile * profile(new mutex_profile);
+    profile->f_name = name;
+
+    profiles_lock lock;
+    get_profiles().insert(profile);
+    return profile;
+}
+
+
+/** \brief Destroy the profile of a mutex.
+ *
+ * When a named mutex gets destroyed, its profile is removed from the
+ * list and deleted.
+ *
+ * \param[in] profile  The profile to destroy.
+ */
+void destroy_mutex_profile(mutex_profile * profile)
+{
+    {
+        profiles_lock lock;
+        get_profiles().erase(profile);
+    }
+    delete profile;
+}
+
+
+void rename_mutex_profile(mutex_profile * profile, std::string const & name)
+{
+    profiles_lock lock;
+    profile->f_name = name;
+}
+
+
+std::string get_mutex_profile_name(mutex_profile const * profile)
+{
+    profiles_lock lock;
+    return profile->f_name;
+}
+
+
+/** \brief Start profiling a lock.
+ *
+ * This function is called before the mutex gets locked. It returns the
+ * current time used to compute the time spent waiting for the lock.
+ *
+ * \param[in] profile  The profile of the mutex being locked.
+ *
+ * \return The current time in nanoseconds.
+ */
+std::uint64_t profile_lock_start(mutex_profile * profile)
+{
+    static_cast<void>(profile);
+
+    return now();
+}
+
+
+/** \brief Record an acquisition.
+ *
+ * This function is called once the mutex is locked.
+ *
+ * \param[in] profile  The profile of the mutex which was locked.
+ * \param[in] start  The time returned by profile_lock_start().
+ * \param[in] contended  Whether the lock had to wait for another thread.
+ */
+void profile_lock_acquired(mutex_profile * profile, std::uint64_t start, bool contended)
+{
+    std::uint64_t const locked_at(now());
+
+    profile->f_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if(contended)
+    {
+        std::uint64_t const wait(locked_at - start);
+        profile->f_contended.fetch_add(1, std::memory_order_relaxed);
+        profile->f_total_wait_ns.fetch_add(wait, std::memory_order_relaxed);
+        update_max(profile->f_max_wait_ns, wait);
+    }
+
+    ++profile->f_depth;
+    if(profile->f_depth == 1)
+    {
+        profile->f_locked_at = locked_at;
+    }
+}
+
+
+/** \brief Record a release.
+ *
+ * This function is called just before the mutex gets unlocked. When the
+ * last recursive lock is released, the hold time gets computed.
+ *
+ * Locks obtained while the profiler was disabled are not tracked.
+ *
+ * \param[in] profile  The profile of the mutex being unlocked.
+ */
+void profile_unlock(mutex_profile * profile)
+{
+    if(profile->f_depth == 0)
+    {
+        return;
+    }
+
+    --profile->f_depth;
+    if(profile->f_depth == 0)
+    {
+        update_max(profile->f_max_hold_ns, now() - profile->f_locked_at);
+    }
+}
+
+
+/** \brief Start a condition wait.
+ *
+ * While waiting on the condition, the mutex is released. Other threads
+ * can lock it in the meantime so the hold time of the waiting thread
+ * ends here. The depth is saved by the caller and restored by
+ * profile_wait_end().
+ *
+ * The mutex only calls this function when the profiler is enabled, so
+ * a disabled profiler does not read the clock around condition waits.
+ * A lock obtained while the profiler was enabled and waited on after
+ * it got disabled keeps its depth; its hold time then includes the
+ * wait.
+ *
+ * \param[in] profile  The profile of the mutex.
+ * \param[out] depth  The depth to pass to profile_wait_end().
+ *
+ * \return The time the wait started.
+ */
+std::uint64_t profile_wait_start(mutex_profile * profile, std::uint32_t & depth)
+{
+    std::uint64_t const start(now());
+
+    depth = profile->f_depth;
+    if(depth != 0)
+    {
+        update_max(profile->f_max_hold_ns, start - profile->f_locked_at);
+    }
+    profile->f_depth = 0;
+
+    return start;
+}
+
+
+/** \brief End a condition wait.
+ *
+ * The mutex is locked again. The time spent waiting is recorded and the
+ * hold time restarts.
+ *
+ * \param[in] profile  The profile of the mutex.
+ * \param[in] start  The time returned by profile_wait_start().
+ * \param[in] depth  The depth returned by profile_wait_start().
+ */
+void profile_wait_end(mutex_profile * profile, std::uint64_t start, std::uint32_t depth)
+{
+    std::uint64_t const locked_at(now());
+
+    if(g_mutex_profiling.load(std::memory_order_relaxed))
+    {
+        profile->f_condition_waits.fetch_add(1, std::memory_order_relaxed);
+        profile->f_condition_wait_ns.fetch_add(locked_at - start, std::memory_order_relaxed);
+    }
+
+    profile->f_depth = depth;
+    profile->f_locked_at = locked_at;
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Enable or disable the mutex profiler.
+ *
+ * By default, the profiler is disabled. Once enabled, all the named
+ * mutexes (see mutex::set_name()) record statistics each time they get
+ * locked.
+ *
+ * Disabling the profiler does not reset the statistics.
+ *
+ * \param[in] enable  Whether the profiler is enabled.
+ */
+void enable_mutex_profiling(bool enable)
+{
+    detail::g_mutex_profiling.store(enable);
+}
+
+
+/** \brief Check whether the mutex profiler is enabled.
+ *
+ * \return true if the profiler is currently enabled.
+ */
+bool is_mutex_profiling_enabled()
+{
+    return detail::g_mutex_profiling.load();
+}
+
+
+/** \brief Retrieve a copy of the statistics of all the named mutexes.
+ *
+ * The function returns one entry per named mutex currently in existence.
+ * The list is sorted by total wait time, the hottest mutex first.
+ *
+ * Note that several mutexes may have the same name (i.e. all the fifo
+ * objects of a given pool); each is returned separately.
+ *
+ * \return A vector with the profiles.
+ */
+mutex_profiles_t get_mutex_profiles()
+{
+    mutex_profiles_t result;
+
+    {
+        profiles_lock lock;
+        for(auto const * p : get_profiles())
+        {
+            mutex_profile_t profile;
+            profile.f_name = p->f_name;
+            profile.f_acquisitions = p->f_acquisitions.load(std::memory_order_relaxed);
+            profile.f_contended = p->f_contended.load(std::memory_order_relaxed);
+            profile.f_total_wait_ns = p->f_total_wait_ns.load(std::memory_order_relaxed);
+            profile.f_max_wait_ns = p->f_max_wait_ns.load(std::memory_order_relaxed);
+            profile.f_max_hold_ns = p->f_max_hold_ns.load(std::memory_order_relaxed);
+            profile.f_condition_waits = p->f_condition_waits.load(std::memory_order_relaxed);
+            profile.f_condition_wait_ns = p->f_condition_wait_ns.load(std::memory_order_relaxed);
+            result.push_back(profile);
+        }
+    }
+
+    std::sort(
+          result.begin()
+        , result.end()
+        , [](mutex_profile_t const & lhs, mutex_profile_t const & rhs)
+        {
+            if(lhs.f_total_wait_ns != rhs.f_total_wait_ns)
+            {
+                return lhs.f_total_wait_ns > rhs.f_total_wait_ns;
+            }
+            return lhs.f_name < rhs.f_name;
+        });
+
+    return result;
+}
+
+
+/** \brief Reset the statistics of all the named mutexes.
+ *
+ * This function resets all the counters to zero. It can be useful to
+ * profile a specific phase of your service.
+ */
+void reset_mutex_profiles()
+{
+    profiles_lock lock;
+    for(auto * p : get_profiles())
+    {
+        p->f_acquisitions.store(0, std::memory_order_relaxed);
+        p->f_contended.store(0, std::memory_order_relaxed);
+        p->f_total_wait_ns.store(0, std::memory_order_relaxed);
+        p->f_max_wait_ns.store(0, std::memory_order_relaxed);
+        p->f_max_hold_ns.store(0, std::memory_order_relaxed);
+        p->f_condition_waits.store(0, std::memory_order_relaxed);
+        p->f_condition_wait_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+/** \brief Write a report of the mutex statistics.
+ *
+ * This function writes one line per named mutex to the specified output
+ * stream. The hottest mutexes are written first.
+ *
+ * The times are written in microseconds.
+ *
+ * \param[in] out  The stream where the report gets written.
+ */
+void dump_mutex_profiles(std::ostream & out)
+{
+    mutex_profiles_t const profiles(get_mutex_profiles());
+
+    out << "mutex profiles ("
+        << profiles.size()
+        << " named mutexes, profiler "
+        << (is_mutex_profiling_enabled() ? "enabled" : "disabled")
+        << "):\n"
+        << std::left << std::setw(32) << "  name"
+        << std::right
+        << std::setw(14) << "locks"
+        << std::setw(12) << "contended"
+        << std::setw(16) << "wait (us)"
+        << std::setw(14) << "max wait"
+        << std::setw(14) << "max hold"
+        << std::setw(12) << "cond waits"
+        << "\n";
+    for(auto const & p : profiles)
+    {
+        out << "  "
+            << std::left << std::setw(30) << p.f_name
+            << std::right
+            << std::setw(14) << p.f_acquisitions
+            << std::setw(12) << p.f_contended
+            << std::setw(16) << p.f_total_wait_ns / 1'000
+            << std::setw(14) << p.f_max_wait_ns / 1'000
+            << std::setw(14) << p.f_max_hold_ns / 1'000
+            << std::setw(12) << p.f_condition_waits
+            << "\n";
+    }
+}
+
+
+/** \brief Generate a report whenever the process receives a signal.
+ *
+ * This function installs a handler for signal \p sig (i.e. SIGUSR2). When
+ * the signal is received, a report is sent to the logger (see
+ * dump_mutex_profiles()) at the info level.
+ *
+ * The signal handler itself only sets a flag and wakes up a reporter
+ * thread, started by the first call to this function, which generates
+ * the report. This way the report is never generated within a signal
+ * handler nor by a thread trying to lock a mutex.
+ *
+ * \note
+ * The threads started by the cppthread::thread class block all signals,
+ * so the signal is handled by your main thread.
+ *
+ * \exception invalid_error
+ * If the handler cannot be installed, this exception is raised.
+ *
+ * \param[in] sig  The signal used to request a report.
+ */
+void set_mutex_profiling_signal(int sig)
+{
+    if(!start_reporter())
+    {
+        return;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = &report_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if(sigaction(sig, &action, nullptr) != 0)
+    {
+        int const e(errno);
+        log << log_level_t::error
+            << "could not install the mutex profiling signal handler for signal #"
+            << sig
+            << ", errno: "
+            << e
+            << " -- "
+            << strerror(e)
+            << end;
+    }
+}
+
+
+
+/** \struct mutex_profile_t
+ * \brief The statistics of one mutex.
+ *
+ * This structure is returned by the get_mutex_profiles() function. It
+ * holds a copy of the statistics of one named mutex at the time of the
+ * call. All the times are in nanoseconds.
+ */
+
+
+/** \var mutex_profile_t::f_name
+ * \brief The name of the mutex as defined with mutex::set_name().
+ */
+
+
+/** \var mutex_profile_t::f_acquisitions
+ * \brief The number of times the mutex was locked.
+ *
+ * This includes recursive locks and successful calls to try_lock().
+ */
+
+
+/** \var mutex_profile_t::f_contended
+ * \brief The number of times a lock had to wait on another thread.
+ */
+
+
+/** \var mutex_profile_t::f_total_wait_ns
+ * \brief The total amount of time threads waited to obtain the lock.
+ */
+
+
+/** \var mutex_profile_t::f_max_wait_ns
+ * \brief The longest time one thread waited to obtain the lock.
+ */
+
+
+/** \var mutex_profile_t::f_max_hold_ns
+ * \brief The longest time one thread held the lock.
+ *
+ * The time a thread spends in a condition wait does not count since the
+ * mutex is released while waiting.
+ */
+
+
+/** \var mutex_profile_t::f_condition_waits
+ * \brief The number of times a thread waited on the mutex condition.
+ */
+
+
+/** \var mutex_profile_t::f_condition_wait_ns
+ * \brief The total amount of time spent waiting on the mutex condition.
+ */
+
+
+/** \typedef mutex_profiles_t
+ * \brief A list of mutex profiles.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,112 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Lock contention profiler.
+ *
+ * This file declares the functions used to enable the mutex profiler and
+ * retrieve the statistics it gathers. Only mutexes which were given a name
+ * with mutex::set_name() get profiled.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+#include    <iostream>
+#include    <string>
+#include    <vector>
+
+
+
+namespace cppthread
+{
+
+
+
+struct mutex_profile_t
+{
+    std::string         f_name = std::string();
+    std::uint64_t       f_acquisitions = 0;
+    std::uint64_t       f_contended = 0;
+    std::uint64_t       f_total_wait_ns = 0;
+    std::uint64_t       f_max_wait_ns = 0;
+    std::uint64_t       f_max_hold_ns = 0;
+    std::uint64_t       f_condition_waits = 0;
+    std::uint64_t       f_condition_wait_ns = 0;
+};
+
+typedef std::vector<mutex_profile_t>    mutex_profiles_t;
+
+
+void                    enable_mutex_profiling(bool enable = true);
+bool                    is_mutex_profiling_enabled();
+mutex_profiles_t        get_mutex_profiles();
+void                    reset_mutex_profiles();
+void                    dump_mutex_profiles(std::ostream & out);
+void                    set_mutex_profiling_signal(int sig);
+
+
+
+namespace detail
+{
+
+
+class mutex_profile;
+
+
+extern std::atomic<bool>    g_mutex_profiling;
+
+
+mutex_profile *         create_mutex_profile(std::string const & name);
+void                    destroy_mutex_profile(mutex_profile * profile);
+void                    rename_mutex_profile(mutex_profile * profile, std::string const & name);
+std::string             get_mutex_profile_name(mutex_profile const * profile);
+std::uint64_t           profile_lock_start(mutex_profile * profile);
+void                    profile_lock_acquired(mutex_profile * profile, std::uint64_t start, bool contended);
+void                    profile_unlock(mutex_profile * profile);
+std::uint64_t           profile_wait_start(mutex_profile * profile, std::uint32_t & depth);
+void                    profile_wait_end(mutex_profile * profile, std::uint64_t start, std::uint32_t depth);
+
+
+/** \brief Check whether a mutex has to be profiled.
+ *
+ * This function is called on each lock and unlock. It returns true only
+ * when the mutex has a name and the profiler is enabled. When the
+ * profiler is disabled, this is one test and one relaxed atomic load.
+ *
+ * \param[in] profile  The profile of the mutex or nullptr.
+ *
+ * \return true if the lock has to be profiled.
+ */
+inline bool is_profiled(mutex_profile const * profile)
+{
+    return profile != nullptr
+        && g_mutex_profiling.load(std::memory_order_relaxed);
+}
+
+
+} // namespace detail
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -112,6 +112,12 @@ namespace cppthread
  * to the input FIFO. The \p pool_size parameter would then
  * become a \p max_pool_size.
  *
+ * \exception invalid_error
+ * The input FIFO is a null pointer.
+ *
+ * \exception out_of_range
+ * The pool size is 0 or too large.
+ *
  * \param[in] name  The name of the pool.
  * \param[in] pool_size  The number of threads to create.
  * \param[in] in  The input FIFO (where workers receive workload.)
@@ -319,6 +325,88 @@ namespace cppthread
  */
 
 
+/** \fn pool::wait_idle()
+ * \brief Wait until all the work loads were processed.
+ *
+ * This function blocks until the input FIFO is empty and no worker is
+ * processing a work load. Contrary to wait(), the threads are not
+ * stopped so more work can be pushed once the function returns.
+ *
+ * The function sleeps on a futex which the workers only signal when
+ * the last pending work load was processed.
+ *
+ * \code
+ *     for(auto const & v : batch)
+ *     {
+ *         my_pool.push_back(v);
+ *     }
+ *     my_pool.wait_idle();
+ *     ...all of batch was processed...
+ * \endcode
+ *
+ * \sa drain()
+ */
+
+
+/** \fn pool::drain(int64_t usecs)
+ * \brief Wait until all the work loads were processed, with a timeout.
+ *
+ * This function is like wait_idle() but it gives up after \p usecs
+ * microseconds. A value of -1 waits forever and 0 only checks the
+ * current state. The pool remains usable whatever the result.
+ *
+ * While the pool is paused, the work loads left in the input FIFO are
+ * not processed so the function only returns true if the FIFO is empty.
+ *
+ * \param[in] usecs  The maximum number of microseconds to wait.
+ *
+ * \return true if the pool is idle, false if the timeout was reached.
+ *
+ * \sa fifo::wait_idle()
+ */
+
+
+/** \fn pool::pause()
+ * \brief Stop the workers from picking up new work loads.
+ *
+ * The function pauses the input FIFO and then waits for the workers to
+ * finish the work loads they are processing. On return, no worker is
+ * running do_work() until resume() gets called. This is useful to take
+ * a checkpoint of the state shared with the workers without stopping
+ * the threads.
+ *
+ * Work loads can still be pushed while the pool is paused. They get
+ * processed once resume() is called.
+ *
+ * \code
+ *     my_pool.pause();
+ *     save_checkpoint();
+ *     my_pool.resume();
+ * \endcode
+ *
+ * \warning
+ * Do not call this function from one of the workers; it would wait
+ * for itself forever.
+ *
+ * \sa fifo::pause()
+ * \sa fifo::wait_processed()
+ */
+
+
+/** \fn pool::resume()
+ * \brief Let the workers process work loads again.
+ *
+ * \sa pause()
+ */
+
+
+/** \fn pool::is_paused() const
+ * \brief Check whether the pool is paused.
+ *
+ * \return true between calls to pause() and resume().
+ */
+
+
 /** \typedef pool::pointer_t
  * \brief A shared pointer for your pools.
  *
@@ -100,6 +100,15 @@ public:
         , f_in(in)
         , f_out(out)
     {
+        if(f_in == nullptr)
+        {
+            throw invalid_error("a pool object must be given a valid input FIFO");
+        }
+
+        // the workers call task_done() so wait_idle() & co. work
+        //
+        f_in->track_unfinished();
+
         if(pool_size == 0)
         {
             throw out_of_range("the pool size must be a positive number (1 or more)");
@@ -180,6 +189,32 @@ public:
         f_workers.clear();
     }
 
+    void wait_idle()
+    {
+        drain(-1);
+    }
+
+    bool drain(int64_t usecs = -1)
+    {
+        return f_in->wait_idle(usecs);
+    }
+
+    void pause()
+    {
+        f_in->pause();
+        f_in->wait_processed(-1);
+    }
+
+    void resume()
+    {
+        f_in->resume();
+    }
+
+    bool is_paused() const
+    {
+        return f_in->is_paused();
+    }
+
 
 private:
     typedef typename worker_thread_t::vector_t  workers_t;
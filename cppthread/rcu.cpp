@@ -0,0 +1,334 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the read-copy-update functions.
+ *
+ * RCU lets many threads read a shared object without any lock while
+ * another thread replaces it. The writer never modifies the object the
+ * readers are looking at. Instead it publishes a new copy and the old
+ * copy gets deleted once all the readers which could still see it are
+ * done.
+ *
+ * The implementation uses the epoch based reclamation (see epoch.cpp):
+ * a read section is an epoch critical section and the previous versions
+ * of an object are retired in the limbo list of the writer.
+ *
+ * The worker class reports a quiescent state before each do_work() (see
+ * rcu_quiescent_state()). It does not run do_work() in a read section:
+ * a long or blocking task would hold back the reclamation of the whole
+ * process. A do_work() reading rcu_ptr objects creates its own
+ * rcu_read_guard.
+ */
+
+
+// self
+//
+#include    "cppthread/rcu.h"
+
+#include    "cppthread/exception.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class rcu_read_guard
+ * \brief Mark a read section.
+ *
+ * While a read guard exists, the objects published with an rcu_ptr and
+ * read by this thread are not deleted, even if a writer replaces them.
+ *
+ * \code
+ *     cppthread::rcu_ptr<config> g_config;
+ *
+ *     void process()
+ *     {
+ *         cppthread::rcu_read_guard read_section;
+ *         config const * c(g_config.get());
+ *         ...use `c` until the end of the block...
+ *     }
+ * \endcode
+ *
+ * Read guards can be nested. Only the outermost guard has a cost: one
+ * store and one memory fence. The inner guards only increment a thread
+ * local counter.
+ *
+ * \warning
+ * A thread must not wait on another thread while in a read section if
+ * that other thread may call rcu_synchronize(). Also, keep read sections
+ * short: no object retired after the start of a read section can be
+ * deleted before that section ends.
+ */
+
+
+
+/** \brief Enter a read section.
+ *
+ * The read section is an epoch critical section (see epoch_guard).
+ */
+rcu_read_guard::rcu_read_guard()
+{
+}
+
+
+/** \brief Leave a read section.
+ *
+ * When the outermost guard is destroyed, the thread is not reading
+ * anymore and the objects it was looking at may get deleted.
+ */
+rcu_read_guard::~rcu_read_guard()
+{
+}
+
+
+/** \brief Check whether this thread is in a read section.
+ *
+ * \return true if at least one rcu_read_guard exists in this thread.
+ */
+bool rcu_is_reading()
+{
+    return epoch_in_critical_section();
+}
+
+
+/** \brief Report that this thread holds no RCU protected pointer.
+ *
+ * A thread outside of a read section never holds back the reclamation,
+ * so reporting a quiescent state only verifies that the calling thread
+ * did not leave a read section open. The worker class calls this
+ * function between two tasks.
+ *
+ * \exception logic_error
+ * The function cannot be called from within a read section.
+ */
+void rcu_quiescent_state()
+{
+    if(rcu_is_reading())
+    {
+        throw logic_error("rcu_quiescent_state() called from within a read section");
+    }
+}
+
+
+/** \brief Run a callback once all the current readers are done.
+ *
+ * This function saves the callback and runs it once all the threads
+ * which are in a read section at the time of the call left that
+ * section. This is how the rcu_ptr deletes the previous version of
+ * its object.
+ *
+ * The callbacks are processed in batches by the calling thread, or by
+ * another thread once this one exited (see epoch_retire()). They must
+ * not throw.
+ *
+ * \param[in] callback  The function to call later.
+ */
+void rcu_call(rcu_callback_t && callback)
+{
+    epoch_retire(std::move(callback));
+}
+
+
+/** \brief Run the callbacks which can be run now.
+ *
+ * This function runs the callbacks registered by this thread (and by
+ * exited threads) which no reader can still need. It never blocks
+ * waiting on a reader.
+ *
+ * \return The number of callbacks which were run.
+ */
+std::size_t rcu_reclaim()
+{
+    return epoch_reclaim();
+}
+
+
+/** \brief Wait until all the current readers are done.
+ *
+ * This function blocks until all the threads which are currently in a
+ * read section left that section. Then it runs the callbacks registered
+ * by this thread and by exited threads.
+ *
+ * This is useful before destroying objects which readers may still
+ * access, or in tests.
+ *
+ * \exception logic_error
+ * The function cannot be called from within a read section since it
+ * would wait on itself forever.
+ */
+void rcu_synchronize()
+{
+    if(rcu_is_reading())
+    {
+        throw logic_error("rcu_synchronize() called from within a read section");
+    }
+
+    epoch_synchronize();
+}
+
+
+
+/** \var rcu_read_guard::f_section
+ * \brief The epoch critical section protecting the readers.
+ */
+
+
+/** \typedef rcu_callback_t
+ * \brief The type of the functions passed to rcu_call().
+ */
+
+
+/** \class rcu_ptr
+ * \brief A pointer to an object read by many threads and rarely replaced.
+ *
+ * The rcu_ptr is well suited for configurations which are read by all
+ * the workers and reloaded once in a while. The readers do not lock
+ * anything and the writer does not wait for the readers:
+ *
+ * \code
+ *     // reader
+ *     cppthread::rcu_read_guard read_section;
+ *     if(g_config->f_verbose) ...
+ *
+ *     // writer
+ *     g_config.store(std::make_unique<config>(load_config()));
+ *
+ *     // or modify a copy of the current configuration
+ *     g_config.update([](config & c) { c.f_verbose = true; });
+ * \endcode
+ *
+ * The readers only get a const pointer. The object must never be
+ * modified once published.
+ *
+ * The previous object is deleted once all the readers which could see
+ * it left their read section (see rcu_call()).
+ *
+ * \tparam T  The type of object.
+ */
+
+
+/** \fn rcu_ptr::rcu_ptr(T * value)
+ * \brief Initialize the pointer.
+ *
+ * The rcu_ptr takes ownership of \p value.
+ *
+ * \param[in] value  The initial object, can be nullptr.
+ */
+
+
+/** \fn rcu_ptr::~rcu_ptr()
+ * \brief Delete the current object.
+ *
+ * The rcu_ptr must not be destroyed while readers may still access it.
+ */
+
+
+/** \fn T const * rcu_ptr::get() const
+ * \brief Get the current object.
+ *
+ * This function must be called in a read section. The returned pointer
+ * remains valid until that read section ends.
+ *
+ * \return The current object or nullptr.
+ */
+
+
+/** \fn T const * rcu_ptr::operator -> () const
+ * \brief Access the current object.
+ *
+ * \return The current object.
+ */
+
+
+/** \fn T const & rcu_ptr::operator * () const
+ * \brief Access the current object.
+ *
+ * \return A reference to the current object.
+ */
+
+
+/** \fn void rcu_ptr::store(T * value)
+ * \brief Publish a new object.
+ *
+ * The new object is visible to the readers immediately. The previous
+ * object gets deleted once the current readers are done with it.
+ *
+ * The writers are serialized: this function waits for an update()
+ * in progress so the object update() is copying does not get retired
+ * and deleted under its feet.
+ *
+ * \param[in] value  The new object; the rcu_ptr takes ownership of it.
+ */
+
+
+/** \fn void rcu_ptr::store(std::unique_ptr<T> value)
+ * \brief Publish a new object.
+ *
+ * \param[in] value  The new object.
+ */
+
+
+/** \fn void rcu_ptr::update(F f)
+ * \brief Publish a modified copy of the current object.
+ *
+ * This function copies the current object, calls \p f with that copy,
+ * and publishes the result. The writers (update() and store()) are
+ * serialized so no modification is lost and the current object cannot
+ * be retired while it gets copied.
+ *
+ * \tparam F  A function or lambda taking a T reference.
+ * \param[in] f  The function modifying the copy.
+ */
+
+
+/** \typedef rcu_ptr::value_t
+ * \brief The type of object pointed to.
+ */
+
+
+/** \var rcu_ptr::f_ptr
+ * \brief The pointer to the current object.
+ */
+
+
+/** \fn void rcu_ptr::replace(T * value)
+ * \brief Publish a new object and retire the previous one.
+ *
+ * The caller must hold f_writer_mutex.
+ *
+ * \param[in] value  The new object; the rcu_ptr takes ownership of it.
+ */
+
+
+/** \var rcu_ptr::f_writer_mutex
+ * \brief The mutex used to serialize the writers, update() and store().
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
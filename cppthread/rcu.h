@@ -0,0 +1,147 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Read-copy-update.
+ *
+ * This file declares the RCU read guard, the functions used to defer
+ * work until all the readers are done, and the rcu_ptr template.
+ */
+
+
+// self
+//
+#include    <cppthread/epoch.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <functional>
+#include    <memory>
+
+
+
+namespace cppthread
+{
+
+
+
+typedef epoch_callback_t        rcu_callback_t;
+
+
+class rcu_read_guard
+{
+public:
+                        rcu_read_guard();
+                        rcu_read_guard(rcu_read_guard const & rhs) = delete;
+                        ~rcu_read_guard();
+
+    rcu_read_guard &    operator = (rcu_read_guard const & rhs) = delete;
+
+private:
+    epoch_guard         f_section = epoch_guard();
+};
+
+
+bool                    rcu_is_reading();
+void                    rcu_quiescent_state();
+void                    rcu_call(rcu_callback_t && callback);
+std::size_t             rcu_reclaim();
+void                    rcu_synchronize();
+
+
+
+template<class T>
+class rcu_ptr
+{
+public:
+    typedef T           value_t;
+
+    rcu_ptr(T * value = nullptr)
+        : f_ptr(value)
+    {
+    }
+
+    rcu_ptr(rcu_ptr const & rhs) = delete;
+    rcu_ptr & operator = (rcu_ptr const & rhs) = delete;
+
+    ~rcu_ptr()
+    {
+        delete f_ptr.load(std::memory_order_acquire);
+    }
+
+    T const * get() const
+    {
+        return f_ptr.load(std::memory_order_acquire);
+    }
+
+    T const * operator -> () const
+    {
+        return get();
+    }
+
+    T const & operator * () const
+    {
+        return *get();
+    }
+
+    void store(T * value)
+    {
+        guard lock(f_writer_mutex);
+        replace(value);
+    }
+
+    void store(std::unique_ptr<T> value)
+    {
+        store(value.release());
+    }
+
+    template<class F>
+    void update(F f)
+    {
+        guard lock(f_writer_mutex);
+
+        T const * current(get());
+        std::unique_ptr<T> copy(current == nullptr ? std::make_unique<T>() : std::make_unique<T>(*current));
+        f(*copy);
+        replace(copy.release());
+    }
+
+private:
+    void replace(T * value)
+    {
+        T * old(f_ptr.exchange(value, std::memory_order_acq_rel));
+        if(old != nullptr)
+        {
+            rcu_call([old]() { delete old; });
+        }
+    }
+
+    std::atomic<T *>    f_ptr;
+    mutex               f_writer_mutex = mutex();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
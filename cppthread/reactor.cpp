@@ -0,0 +1,640 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the epoll reactor.
+ *
+ * The reactor waits on an epoll file descriptor and calls the callback
+ * attached to each file descriptor which is ready. An eventfd is part
+ * of the set so other threads can wake the loop up, either to run a
+ * posted task or to stop.
+ */
+
+
+// self
+//
+#include    "cppthread/reactor.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/guard.h"
+#include    "cppthread/log.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+
+
+// C
+//
+#include    <errno.h>
+#include    <netinet/in.h>
+#include    <sys/epoll.h>
+#include    <sys/eventfd.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class reactor
+ * \brief A runner waiting on file descriptors with epoll.
+ *
+ * Register file descriptors with add() and the reactor calls their
+ * callback from its thread whenever epoll reports them as ready. The
+ * events are the usual EPOLLIN, EPOLLOUT, etc. flags and, by default,
+ * they are level triggered. Add EPOLLET to the events for edge
+ * triggered notifications.
+ *
+ * \code
+ *     cppthread::reactor::pointer_t r(std::make_shared<cppthread::reactor>("network"));
+ *     cppthread::thread t("network", r);
+ *     t.start();
+ *
+ *     r->add(fd, EPOLLIN, [](int fd, std::uint32_t events)
+ *         {
+ *             ...read from fd...
+ *         });
+ *     ...
+ *     t.stop();    // wakes up the reactor through its eventfd
+ * \endcode
+ *
+ * The reactor is also an executor: other threads can run code on the
+ * reactor thread with post(). This is the way to access state which
+ * belongs to the reactor thread without a lock. The posted tasks run
+ * after the current batch of events, at most MAX_TASKS per turn.
+ *
+ * The add(), modify(), remove() and post() functions can be called from
+ * any thread. Note that a callback removed from another thread may still
+ * be called once if its event was already being handled.
+ */
+
+
+/** \brief Create the epoll and eventfd file descriptors.
+ *
+ * \exception system_error
+ * This exception is raised if the file descriptors cannot be created.
+ *
+ * \param[in] name  The name of the runner.
+ */
+reactor::reactor(std::string const & name)
+    : runner(name)
+{
+    f_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(f_epoll_fd == -1)
+    {
+        throw system_error("reactor: epoll_create1() failed: " + std::string(strerror(errno)));
+    }
+
+    f_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(f_event_fd == -1)
+    {
+        int const e(errno);
+        close(f_epoll_fd);
+        throw system_error("reactor: eventfd() failed: " + std::string(strerror(e)));
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = f_event_fd;
+    if(epoll_ctl(f_epoll_fd, EPOLL_CTL_ADD, f_event_fd, &event) != 0)
+    {
+        int const e(errno);
+        close(f_event_fd);
+        close(f_epoll_fd);
+        throw system_error("reactor: epoll_ctl() failed to add the eventfd: " + std::string(strerror(e)));
+    }
+}
+
+
+/** \brief Close the epoll and eventfd file descriptors.
+ *
+ * The file descriptors added with add() are not closed. They belong to
+ * the caller.
+ */
+reactor::~reactor()
+{
+    close(f_event_fd);
+    close(f_epoll_fd);
+}
+
+
+/** \brief Add a file descriptor to the reactor.
+ *
+ * \exception system_error
+ * This exception is raised if epoll refuses the file descriptor, for
+ * example because it was already added.
+ *
+ * \param[in] fd  The file descriptor to watch.
+ * \param[in] events  The epoll events to wait for (EPOLLIN, EPOLLOUT...).
+ * \param[in] callback  The function called when \p fd is ready.
+ */
+void reactor::add(int fd, std::uint32_t events, fd_callback_t callback)
+{
+    guard lock(f_mutex);
+
+    // save the callback first since epoll may report the fd right away
+    //
+    f_callbacks[fd] = std::make_shared<fd_callback_t>(callback);
+
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if(epoll_ctl(f_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        int const e(errno);
+        f_callbacks.erase(fd);
+        throw system_error("reactor: epoll_ctl() failed to add fd "
+                         + std::to_string(fd)
+                         + ": "
+                         + strerror(e));
+    }
+}
+
+
+/** \brief Change the events of a file descriptor.
+ *
+ * This is used, for example, to add EPOLLOUT while a socket has data to
+ * send and remove it once the buffer is empty.
+ *
+ * \exception system_error
+ * This exception is raised if the file descriptor was not added.
+ *
+ * \param[in] fd  The file descriptor to modify.
+ * \param[in] events  The new set of events.
+ */
+void reactor::modify(int fd, std::uint32_t events)
+{
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if(epoll_ctl(f_epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0)
+    {
+        throw system_error("reactor: epoll_ctl() failed to modify fd "
+                         + std::to_string(fd)
+                         + ": "
+                         + strerror(errno));
+    }
+}
+
+
+/** \brief Remove a file descriptor from the reactor.
+ *
+ * Call this function before closing the file descriptor. Errors are
+ * ignored since closing the file descriptor first already removed it
+ * from epoll.
+ *
+ * \param[in] fd  The file descriptor to remove.
+ */
+void reactor::remove(int fd)
+{
+    guard lock(f_mutex);
+    f_callbacks.erase(fd);
+    epoll_ctl(f_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+
+/** \brief Get the number of file descriptors in the reactor.
+ *
+ * The internal eventfd is not included.
+ *
+ * \return The number of file descriptors added and not yet removed.
+ */
+std::size_t reactor::size() const
+{
+    guard lock(f_mutex);
+    return f_callbacks.size();
+}
+
+
+/** \brief The reactor loop.
+ *
+ * The function waits on epoll and calls the callbacks of the ready file
+ * descriptors until the thread is asked to stop. An exception raised by
+ * a callback or a task is logged and the loop goes on.
+ *
+ * \exception system_error
+ * This exception is raised if epoll_wait() fails.
+ */
+void reactor::run()
+{
+    epoll_event events[MAX_EVENTS];
+    while(continue_running())
+    {
+        int const count(epoll_wait(f_epoll_fd, events, MAX_EVENTS, -1));
+        if(count < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            throw system_error("reactor: epoll_wait() failed: " + std::string(strerror(errno)));
+        }
+
+        for(int idx(0); idx < count; ++idx)
+        {
+            int const fd(events[idx].data.fd);
+            if(fd == f_event_fd)
+            {
+                std::uint64_t value(0);
+                if(read(f_event_fd, &value, sizeof(value)) < 0)
+                {
+                    // EAGAIN, another event already reset the counter
+                }
+                run_posted(MAX_TASKS);
+                continue;
+            }
+
+            callback_pointer_t callback;
+            {
+                guard lock(f_mutex);
+                auto it(f_callbacks.find(fd));
+                if(it == f_callbacks.end())
+                {
+                    // removed by a previous callback of this batch
+                    //
+                    continue;
+                }
+                callback = it->second;
+            }
+            try
+            {
+                (*callback)(fd, events[idx].events);
+            }
+            catch(std::exception const & e)
+            {
+                log << log_level_t::error
+                    << "reactor callback for fd "
+                    << fd
+                    << " exited with an exception: "
+                    << e.what()
+                    << end;
+            }
+            catch(...)
+            {
+                log << log_level_t::error
+                    << "reactor callback for fd "
+                    << fd
+                    << " exited with an unknown exception (a.k.a. non-std::exception)."
+                    << end;
+            }
+        }
+    }
+
+    // the tasks posted before the stop still run
+    //
+    run_posted();
+}
+
+
+/** \brief Interrupt the epoll_wait() call.
+ *
+ * This function writes to the eventfd. It gets called by thread::stop()
+ * and by executor::post().
+ */
+void reactor::wakeup()
+{
+    std::uint64_t const one(1);
+    while(write(f_event_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+
+/** \brief Create a listening socket with SO_REUSEPORT.
+ *
+ * Several sockets listening on the same address with SO_REUSEPORT get
+ * the incoming connections distributed among them by the kernel. Giving
+ * each reactor its own listening socket spreads the connections over
+ * the reactor threads without any lock between them.
+ *
+ * The socket is non-blocking.
+ *
+ * \exception system_error
+ * This exception is raised if the socket cannot be created, bound or
+ * put in listening mode.
+ *
+ * \param[in] address  The address to listen on.
+ * \param[in] length  The size of \p address.
+ * \param[in] backlog  The listen() backlog.
+ *
+ * \return The listening socket.
+ */
+int reactor::listen_reuseport(
+          sockaddr const * address
+        , socklen_t length
+        , int backlog)
+{
+    int const fd(socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if(fd == -1)
+    {
+        throw system_error("reactor: socket() failed: " + std::string(strerror(errno)));
+    }
+
+    int const on(1);
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+    || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0
+    || bind(fd, address, length) != 0
+    || ::listen(fd, backlog) != 0)
+    {
+        int const e(errno);
+        close(fd);
+        throw system_error("reactor: could not create the listening socket: " + std::string(strerror(e)));
+    }
+
+    return fd;
+}
+
+
+/** \class reactor_group
+ * \brief Run several reactors, one per thread.
+ *
+ * One epoll loop uses one core. To handle more connections, a program
+ * runs one reactor per core and distributes the work among them. The
+ * reactor_group creates and starts the reactors and their threads.
+ *
+ * The listen() function creates one SO_REUSEPORT listening socket per
+ * reactor. The kernel spreads the incoming connections among them and
+ * each connection is then handled by the reactor which accepted it, so
+ * the reactors share nothing.
+ *
+ * \code
+ *     cppthread::reactor_group group("http", 4);
+ *     sockaddr_in addr = {};
+ *     addr.sin_family = AF_INET;
+ *     addr.sin_port = htons(8080);
+ *     group.listen(reinterpret_cast<sockaddr *>(&addr), sizeof(addr)
+ *         , [](cppthread::reactor & r, int client)
+ *         {
+ *             r.add(client, EPOLLIN, ...);
+ *         });
+ * \endcode
+ */
+
+
+/** \brief Start \p count reactors.
+ *
+ * \exception out_of_range
+ * The \p count parameter must be at least 1.
+ *
+ * \param[in] name  The name of the reactors and their threads.
+ * \param[in] count  The number of reactors to start.
+ */
+reactor_group::reactor_group(std::string const & name, std::size_t count)
+{
+    if(count == 0)
+    {
+        throw out_of_range("a reactor group needs at least one reactor.");
+    }
+
+    f_reactors.reserve(count);
+    f_threads.reserve(count);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::string const reactor_name(name + " (reactor #" + std::to_string(idx) + ")");
+        f_reactors.push_back(std::make_shared<reactor>(reactor_name));
+        f_threads.push_back(std::make_shared<thread>(reactor_name, f_reactors.back()));
+        f_threads.back()->start();
+    }
+}
+
+
+/** \brief Stop the reactors.
+ *
+ * \sa stop()
+ */
+reactor_group::~reactor_group()
+{
+    stop();
+}
+
+
+/** \brief Get the number of reactors.
+ *
+ * \return The number of reactors in this group.
+ */
+std::size_t reactor_group::size() const
+{
+    return f_reactors.size();
+}
+
+
+/** \brief Get one of the reactors.
+ *
+ * \exception out_of_range
+ * The index must be smaller than size().
+ *
+ * \param[in] idx  The index of the reactor.
+ *
+ * \return A reference to the reactor.
+ */
+reactor & reactor_group::get_reactor(std::size_t idx) const
+{
+    if(idx >= f_reactors.size())
+    {
+        throw out_of_range("reactor_group::get_reactor() called with an index out of bounds.");
+    }
+    return *f_reactors[idx];
+}
+
+
+/** \brief Get the next reactor in a round robin manner.
+ *
+ * This is useful to distribute connections created by the program
+ * itself, such as outgoing connections.
+ *
+ * \return A reference to a reactor.
+ */
+reactor & reactor_group::next()
+{
+    std::size_t const idx(f_next.fetch_add(1, std::memory_order_relaxed));
+    return *f_reactors[idx % f_reactors.size()];
+}
+
+
+/** \brief Listen on \p address with every reactor.
+ *
+ * Each reactor gets its own listening socket. When a connection comes
+ * in, the reactor owning the socket accepts it and calls \p callback
+ * from its thread with the new non-blocking socket. The callback usually
+ * adds that socket to the same reactor.
+ *
+ * If the port in \p address is 0, the first socket gets a port from the
+ * kernel and the other sockets use that same port.
+ *
+ * \param[in] address  The address to listen on.
+ * \param[in] length  The size of \p address.
+ * \param[in] callback  The function called with each new connection.
+ * \param[in] backlog  The listen() backlog of each socket.
+ *
+ * \return The port the sockets listen on.
+ */
+int reactor_group::listen(
+          sockaddr const * address
+        , socklen_t length
+        , accept_callback_t callback
+        , int backlog)
+{
+    sockaddr_storage addr = {};
+    memcpy(&addr, address, std::min<std::size_t>(length, sizeof(addr)));
+    for(auto & r : f_reactors)
+    {
+        int const fd(reactor::listen_reuseport(reinterpret_cast<sockaddr *>(&addr), length, backlog));
+        f_listeners.push_back(fd);
+        if(&r == &f_reactors.front())
+        {
+            socklen_t size(sizeof(addr));
+            getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &size);
+            length = size;
+        }
+
+        reactor * owner(r.get());
+        r->add(fd, EPOLLIN, [owner, callback](int listener, std::uint32_t)
+            {
+                for(;;)
+                {
+                    int const client(accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+                    if(client == -1)
+                    {
+                        return;
+                    }
+                    callback(*owner, client);
+                }
+            });
+    }
+
+    switch(addr.ss_family)
+    {
+    case AF_INET:
+        return ntohs(reinterpret_cast<sockaddr_in *>(&addr)->sin_port);
+
+    case AF_INET6:
+        return ntohs(reinterpret_cast<sockaddr_in6 *>(&addr)->sin6_port);
+
+    }
+    return 0;
+}
+
+
+/** \brief Stop all the reactors.
+ *
+ * Each thread gets stopped, which wakes up its reactor, and then the
+ * listening sockets created by listen() are closed.
+ */
+void reactor_group::stop()
+{
+    for(auto & t : f_threads)
+    {
+        t->stop();
+    }
+    f_threads.clear();
+
+    for(auto const fd : f_listeners)
+    {
+        close(fd);
+    }
+    f_listeners.clear();
+}
+
+
+/** \typedef reactor::pointer_t
+ * \brief A shared pointer to a reactor.
+ */
+
+
+/** \typedef reactor::fd_callback_t
+ * \brief The function called when a file descriptor is ready.
+ *
+ * The function receives the file descriptor and the epoll events.
+ */
+
+
+/** \var reactor::MAX_EVENTS
+ * \brief The maximum number of events handled per epoll_wait() call.
+ */
+
+
+/** \var reactor::MAX_TASKS
+ * \brief The maximum number of posted tasks run per turn of the loop.
+ */
+
+
+/** \typedef reactor::callback_pointer_t
+ * \brief A shared pointer to a callback.
+ *
+ * The callback is copied out of the map before being called so it
+ * remains valid even if it removes itself.
+ */
+
+
+/** \typedef reactor::callback_map_t
+ * \brief The map of file descriptors to callbacks.
+ */
+
+
+/** \var reactor::f_epoll_fd
+ * \brief The epoll file descriptor.
+ */
+
+
+/** \var reactor::f_event_fd
+ * \brief The eventfd used to wake up the loop.
+ */
+
+
+/** \var reactor::f_callbacks
+ * \brief The callbacks of the file descriptors.
+ */
+
+
+/** \typedef reactor_group::accept_callback_t
+ * \brief The function called with each accepted connection.
+ */
+
+
+/** \var reactor_group::f_reactors
+ * \brief The reactors of this group.
+ */
+
+
+/** \var reactor_group::f_threads
+ * \brief The threads running the reactors.
+ */
+
+
+/** \var reactor_group::f_listeners
+ * \brief The listening sockets created by listen().
+ */
+
+
+/** \var reactor_group::f_next
+ * \brief The counter used by next().
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,129 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief An epoll event loop running in a cppthread thread.
+ *
+ * This file declares the reactor runner which calls a callback whenever
+ * one of its file descriptors is ready, and the reactor_group which runs
+ * several reactors, each in its own thread.
+ */
+
+
+// self
+//
+#include    <cppthread/executor.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <functional>
+#include    <memory>
+#include    <unordered_map>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/socket.h>
+
+
+
+namespace cppthread
+{
+
+
+
+class reactor
+    : public runner
+    , public executor
+{
+public:
+    typedef std::shared_ptr<reactor>                    pointer_t;
+    typedef std::function<void(int fd, std::uint32_t events)>
+                                                        fd_callback_t;
+
+    static constexpr int const                          MAX_EVENTS = 64;
+    static constexpr std::size_t const                  MAX_TASKS = 256;
+
+                        reactor(std::string const & name);
+    virtual             ~reactor() override;
+
+    void                add(int fd, std::uint32_t events, fd_callback_t callback);
+    void                modify(int fd, std::uint32_t events);
+    void                remove(int fd);
+    std::size_t         size() const;
+
+    virtual void        run() override;
+    virtual void        wakeup() override;
+
+    static int          listen_reuseport(
+                              sockaddr const * address
+                            , socklen_t length
+                            , int backlog = 128);
+
+private:
+    typedef std::shared_ptr<fd_callback_t>              callback_pointer_t;
+    typedef std::unordered_map<int, callback_pointer_t> callback_map_t;
+
+    int                 f_epoll_fd = -1;
+    int                 f_event_fd = -1;
+    callback_map_t      f_callbacks = callback_map_t();
+};
+
+
+class reactor_group
+{
+public:
+    typedef std::function<void(reactor & r, int fd)>    accept_callback_t;
+
+                        reactor_group(std::string const & name, std::size_t count);
+                        reactor_group(reactor_group const & rhs) = delete;
+                        ~reactor_group();
+
+    reactor_group &     operator = (reactor_group const & rhs) = delete;
+
+    std::size_t         size() const;
+    reactor &           get_reactor(std::size_t idx) const;
+    reactor &           next();
+    int                 listen(
+                              sockaddr const * address
+                            , socklen_t length
+                            , accept_callback_t callback
+                            , int backlog = 128);
+    void                stop();
+
+private:
+    std::vector<reactor::pointer_t>
+                        f_reactors = std::vector<reactor::pointer_t>();
+    std::vector<thread::pointer_t>
+                        f_threads = std::vector<thread::pointer_t>();
+    std::vector<int>    f_listeners = std::vector<int>();
+    std::atomic<std::size_t>
+                        f_next = 0;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
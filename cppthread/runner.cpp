@@ -66,6 +66,8 @@ runner::runner(std::string const & name)
     : f_name(name)
 {
     // TBD: should we forbid starting a runner without a name?
+
+    f_mutex.set_name("runner::" + name);
 }
 
 
@@ -197,6 +199,21 @@ void runner::enter()
 }
 
 
+/** \brief Wake up the run() function so it notices a stop request.
+ *
+ * The thread::stop() function calls this function once the thread is
+ * marked as stopping. A run() function which sleeps in a system call
+ * (epoll_wait(), a read on a pipe, etc.) overrides it to interrupt
+ * that call so it can check continue_running() right away.
+ *
+ * The default does nothing. A runner sleeping on its f_mutex can
+ * override it to signal that mutex.
+ */
+void runner::wakeup()
+{
+}
+
+
 /** \brief Signal that the run() function has returned.
  *
  * This function is called whenever the run() function is done. It may also
@@ -78,6 +78,7 @@ public:
     virtual bool        continue_running() const;
     virtual void        enter();
     virtual void        run() = 0;
+    virtual void        wakeup();
     virtual void        leave(leave_status_t status);
     thread *            get_thread() const;
     pid_t               gettid() const;
@@ -0,0 +1,223 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the semaphore.
+ *
+ * The semaphore counts available resources. Threads acquire a resource
+ * and sleep when none are available.
+ */
+
+
+// self
+//
+#include    "cppthread/semaphore.h"
+
+#include    "cppthread/exception.h"
+#include    "cppthread/futex.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <limits>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \class semaphore
+ * \brief Limit the number of threads accessing a resource.
+ *
+ * A semaphore holds a counter of available resources. The acquire()
+ * function takes one, sleeping until one is available, and release()
+ * gives resources back.
+ *
+ * This is useful to throttle the access to a limited resource such as
+ * a pool of database connections:
+ *
+ * \code
+ *     cppthread::semaphore g_connections(8);
+ *
+ *     void query()
+ *     {
+ *         g_connections.acquire();
+ *         ...use one connection...
+ *         g_connections.release();
+ *     }
+ * \endcode
+ *
+ * When resources are available, acquire() and release() only use atomic
+ * operations. The kernel is only called when a thread has to sleep, or
+ * to wake up a sleeping thread.
+ *
+ * \note
+ * The semaphore is not fair: a thread calling acquire() just after a
+ * release() may get the resource before a thread which was sleeping.
+ */
+
+
+
+/** \brief Initialize the semaphore.
+ *
+ * \param[in] count  The number of resources initially available.
+ */
+semaphore::semaphore(std::uint32_t count)
+    : f_count(count)
+{
+}
+
+
+/** \brief Acquire one resource.
+ *
+ * The function sleeps until a resource is available.
+ */
+void semaphore::acquire()
+{
+    acquire_until(nullptr);
+}
+
+
+/** \brief Acquire one resource if available.
+ *
+ * \return true if a resource was acquired.
+ */
+bool semaphore::try_acquire()
+{
+    std::uint32_t count(f_count.load(std::memory_order_relaxed));
+    while(count > 0)
+    {
+        if(f_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/** \brief Acquire one resource, waiting at most \p timeout.
+ *
+ * \param[in] timeout  The maximum amount of time to wait.
+ *
+ * \return true if a resource was acquired.
+ */
+bool semaphore::try_acquire_for(std::chrono::nanoseconds timeout)
+{
+    std::chrono::steady_clock::time_point const deadline(std::chrono::steady_clock::now() + timeout);
+    return acquire_until(&deadline);
+}
+
+
+/** \brief Give resources back.
+ *
+ * If threads are sleeping in acquire(), up to \p n of them are woken up.
+ *
+ * \exception out_of_range
+ * The counter cannot go over 2^32 - 1.
+ *
+ * \param[in] n  The number of resources to give back.
+ */
+void semaphore::release(std::uint32_t n)
+{
+    std::uint32_t count(f_count.load(std::memory_order_relaxed));
+    do
+    {
+        if(count > std::numeric_limits<std::uint32_t>::max() - n)
+        {
+            throw out_of_range("semaphore::release() would overflow the counter.");
+        }
+    }
+    while(!f_count.compare_exchange_weak(count, count + n, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+    if(f_waiters.load(std::memory_order_seq_cst) != 0)
+    {
+        detail::futex_wake(f_count, static_cast<int>(std::min<std::uint32_t>(n, std::numeric_limits<int>::max())));
+    }
+}
+
+
+/** \brief Get the number of available resources.
+ *
+ * The value may already be out of date by the time the function returns.
+ *
+ * \return The current value of the counter.
+ */
+std::uint32_t semaphore::value() const
+{
+    return f_count.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Acquire one resource.
+ *
+ * \param[in] deadline  When to stop waiting, or nullptr to wait forever.
+ *
+ * \return true if a resource was acquired.
+ */
+bool semaphore::acquire_until(std::chrono::steady_clock::time_point const * deadline)
+{
+    if(try_acquire())
+    {
+        return true;
+    }
+
+    f_waiters.fetch_add(1, std::memory_order_seq_cst);
+    for(;;)
+    {
+        if(try_acquire())
+        {
+            f_waiters.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        if(!detail::futex_wait(f_count, 0, deadline))
+        {
+            f_waiters.fetch_sub(1, std::memory_order_relaxed);
+            return try_acquire();
+        }
+    }
+}
+
+
+/** \var semaphore::f_count
+ * \brief The number of available resources.
+ *
+ * This is also the word the waiting threads sleep on.
+ */
+
+
+/** \var semaphore::f_waiters
+ * \brief The number of threads sleeping in acquire().
+ *
+ * The release() function only calls the kernel if a thread may be
+ * sleeping.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
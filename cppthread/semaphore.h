@@ -0,0 +1,67 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Counting semaphore.
+ *
+ * This file declares the semaphore class.
+ */
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <cstdint>
+
+
+
+namespace cppthread
+{
+
+
+
+class semaphore
+{
+public:
+                        semaphore(std::uint32_t count = 0);
+                        semaphore(semaphore const & rhs) = delete;
+
+    semaphore &         operator = (semaphore const & rhs) = delete;
+
+    void                acquire();
+    bool                try_acquire();
+    bool                try_acquire_for(std::chrono::nanoseconds timeout);
+    void                release(std::uint32_t n = 1);
+    std::uint32_t       value() const;
+
+private:
+    bool                acquire_until(std::chrono::steady_clock::time_point const * deadline);
+
+    std::atomic<std::uint32_t>
+                        f_count;
+    std::atomic<std::uint32_t>
+                        f_waiters = 0;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,185 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Documentation of the seqlock.h file.
+ *
+ * The seqlock.h file is a template so we document that template here.
+ *
+ * A sequence lock protects a small value which is read often and
+ * updated rarely. Readers never write to shared memory so they do not
+ * slow each other down.
+ */
+
+#error "Documentation only file, do not compile."
+
+namespace cppthread
+{
+
+
+
+/** \class seqlock
+ * \brief Protect a small read-mostly value.
+ *
+ * The seqlock holds a copy of a value of type T along a sequence number.
+ * A writer makes the sequence odd, writes the new value, and makes the
+ * sequence even again. A reader reads the sequence, copies the value,
+ * and reads the sequence again. If the sequence was odd or changed, the
+ * copy may be torn and the reader tries again.
+ *
+ * \code
+ *     struct rate_limit_t
+ *     {
+ *         std::uint32_t   f_max_requests = 100;
+ *         std::uint32_t   f_period_ms = 1'000;
+ *     };
+ *
+ *     cppthread::seqlock<rate_limit_t> g_rate_limit;
+ *
+ *     // in the workers
+ *     rate_limit_t const limit(g_rate_limit.load());
+ *
+ *     // in the control thread
+ *     g_rate_limit.store(rate_limit_t{ 200, 1'000 });
+ * \endcode
+ *
+ * Readers never block a writer: the writer does not wait for readers to
+ * be done. The store() of a single writer thread always completes without
+ * waiting. Several writers are supported; they are serialized by the
+ * sequence number. Waiting writers, and readers retrying while a write
+ * is in progress, back off and eventually yield the processor (see
+ * spin_backoff()), so a preempted writer does not get its readers to
+ * burn a whole time slice.
+ *
+ * The value is saved in an array of atomic words so the concurrent reads
+ * and writes are not data races in the C++ sense. This is also why T must
+ * be trivially copyable. Since each word is copied separately, T should be
+ * small (a few words); large values are better protected by a mutex or
+ * by RCU.
+ *
+ * \tparam T  The type of the value, which must be trivially copyable and
+ * default constructible.
+ */
+
+
+/** \fn seqlock::seqlock(T const & value)
+ * \brief Initialize the seqlock.
+ *
+ * \param[in] value  The initial value.
+ */
+
+
+/** \fn seqlock::seqlock(seqlock const & rhs)
+ * \brief The copy operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ */
+
+
+/** \fn seqlock & seqlock::operator = (seqlock const & rhs)
+ * \brief The assignment operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ *
+ * \return A reference to this object.
+ */
+
+
+/** \fn T seqlock::load() const
+ * \brief Read the current value.
+ *
+ * This function returns a consistent copy of the value. If a writer is
+ * updating the value at the same time, the function retries until it
+ * gets a copy which was not modified while being read.
+ *
+ * \return A copy of the current value.
+ */
+
+
+/** \fn bool seqlock::try_load(T & value) const
+ * \brief Try reading the current value once.
+ *
+ * This function makes a single attempt at reading the value. If a writer
+ * was updating the value at the same time, the function returns false
+ * and \p value is not modified.
+ *
+ * \param[out] value  The variable receiving the value.
+ *
+ * \return true if \p value was set.
+ */
+
+
+/** \fn void seqlock::store(T const & value)
+ * \brief Replace the value.
+ *
+ * This function saves a new value. Readers running at the same time
+ * retry their read.
+ *
+ * \param[in] value  The new value.
+ */
+
+
+/** \fn void seqlock::update(F f)
+ * \brief Modify the value in place.
+ *
+ * This function calls \p f with a reference to a copy of the current
+ * value and saves the result. Other writers are blocked while \p f
+ * runs, so several threads can update the same value without losing
+ * any modification:
+ *
+ * \code
+ *     g_counters.update([](counters_t & c) { ++c.f_requests; });
+ * \endcode
+ *
+ * \tparam F  A function or lambda taking a T reference.
+ * \param[in] f  The function modifying the value.
+ */
+
+
+/** \fn std::uint64_t seqlock::sequence() const
+ * \brief Retrieve the sequence number.
+ *
+ * The sequence number is incremented by 2 each time the value changes.
+ * It can be used to cheaply detect that the value changed since the
+ * last time it was read.
+ *
+ * \return The current sequence number.
+ */
+
+
+/** \typedef seqlock::value_t
+ * \brief The type of the value protected by the seqlock.
+ */
+
+
+/** \var seqlock::f_sequence
+ * \brief The sequence number.
+ *
+ * The sequence is odd while a writer is updating the value.
+ */
+
+
+/** \var seqlock::f_data
+ * \brief The value saved as an array of atomic words.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
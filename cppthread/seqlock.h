@@ -0,0 +1,181 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Sequence lock for small read-mostly values.
+ *
+ * This file includes the declaration and implementation of the seqlock
+ * template. The documentation is found in seqlock.cpp.
+ */
+
+
+// self
+//
+#include    <cppthread/spinlock.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+#include    <cstring>
+#include    <type_traits>
+
+
+
+namespace cppthread
+{
+
+
+
+template<class T>
+class seqlock
+{
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "seqlock<T> requires a trivially copyable type T.");
+    static_assert(std::is_default_constructible_v<T>, "seqlock<T> requires a default constructible type T.");
+
+    typedef T                   value_t;
+
+    seqlock(T const & value = T())
+    {
+        write_words(value);
+    }
+
+    seqlock(seqlock const & rhs) = delete;
+    seqlock & operator = (seqlock const & rhs) = delete;
+
+    T load() const
+    {
+        T value;
+        std::uint32_t pauses(1);
+        while(!try_load(value))
+        {
+            spin_backoff(pauses);
+        }
+        return value;
+    }
+
+    bool try_load(T & value) const
+    {
+        std::uint64_t const sequence(f_sequence.load(std::memory_order_acquire));
+        if((sequence & 1) != 0)
+        {
+            return false;
+        }
+
+        T const result(read_words());
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(f_sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            return false;
+        }
+
+        value = result;
+        return true;
+    }
+
+    void store(T const & value)
+    {
+        std::uint64_t const sequence(begin_write());
+        write_words(value);
+        end_write(sequence);
+    }
+
+    template<class F>
+    void update(F f)
+    {
+        std::uint64_t const sequence(begin_write());
+        T value(read_words());
+        f(value);
+        write_words(value);
+        end_write(sequence);
+    }
+
+    std::uint64_t sequence() const
+    {
+        return f_sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    typedef std::uint64_t       word_t;
+
+    static constexpr std::size_t const  WORD_COUNT = (sizeof(T) + sizeof(word_t) - 1) / sizeof(word_t);
+
+    std::uint64_t begin_write()
+    {
+        std::uint64_t sequence(f_sequence.load(std::memory_order_relaxed));
+        std::uint32_t pauses(1);
+        for(;;)
+        {
+            if((sequence & 1) == 0
+            && f_sequence.compare_exchange_weak(
+                      sequence
+                    , sequence + 1
+                    , std::memory_order_acquire
+                    , std::memory_order_relaxed))
+            {
+                std::atomic_thread_fence(std::memory_order_release);
+                return sequence;
+            }
+            if((sequence & 1) != 0)
+            {
+                spin_backoff(pauses);
+                sequence = f_sequence.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void end_write(std::uint64_t sequence)
+    {
+        f_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T read_words() const
+    {
+        word_t words[WORD_COUNT];
+        for(std::size_t idx(0); idx < WORD_COUNT; ++idx)
+        {
+            words[idx] = f_data[idx].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    void write_words(T const & value)
+    {
+        word_t words[WORD_COUNT] = {};
+        std::memcpy(words, &value, sizeof(T));
+        for(std::size_t idx(0); idx < WORD_COUNT; ++idx)
+        {
+            f_data[idx].store(words[idx], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<std::uint64_t>  f_sequence = 0;
+    std::atomic<word_t>         f_data[WORD_COUNT] = {};
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
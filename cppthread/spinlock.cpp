@@ -0,0 +1,342 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the spinning locks.
+ *
+ * The spinlock and ticket_lock classes are alternatives to the mutex
+ * for critical sections of a few instructions, such as incrementing a
+ * counter in a map. They never call the kernel unless they spin for a
+ * long time, in which case they yield the processor.
+ *
+ * The `lock` benchmarks of the cppthread-bench tool compare them with
+ * the mutex.
+ */
+
+
+// self
+//
+#include    "cppthread/spinlock.h"
+
+
+// C
+//
+#include    <sched.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Number of pauses after which a spinning thread yields.
+ *
+ * When the lock holder gets preempted, spinning is a waste of time. After
+ * that many pauses, the waiting thread calls sched_yield() instead.
+ */
+constexpr std::uint32_t     MAX_PAUSES = 64;
+
+
+
+} // no name namespace
+
+
+
+/** \brief Tell the processor that we are in a spin loop.
+ *
+ * This function executes the `pause` instruction on x86 and `yield`
+ * on ARM. It reduces the power used while spinning and gives the
+ * resources of the core to the other hyperthread.
+ *
+ * On other processors, the function does nothing.
+ */
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+
+/** \brief Wait a little before trying again in a spin loop.
+ *
+ * This function pauses \p pauses times and doubles \p pauses so the
+ * waiting thread backs off exponentially. Once \p pauses goes over
+ * MAX_PAUSES, the thread calls sched_yield() instead. This is useful
+ * when the thread we are waiting on got preempted.
+ *
+ * Start with \p pauses set to 1.
+ *
+ * \param[in,out] pauses  The number of pauses of this round.
+ */
+void spin_backoff(std::uint32_t & pauses)
+{
+    if(pauses > MAX_PAUSES)
+    {
+        sched_yield();
+        return;
+    }
+    for(std::uint32_t idx(0); idx < pauses; ++idx)
+    {
+        cpu_relax();
+    }
+    pauses *= 2;
+}
+
+
+
+/** \class spinlock
+ * \brief A test-and-test-and-set spinlock.
+ *
+ * This lock is a single atomic flag. A thread trying to obtain the lock
+ * first reads the flag and only attempts the atomic exchange when the
+ * flag looks free. This way the waiting threads spin in their own cache
+ * instead of bouncing the cache line between cores.
+ *
+ * While the lock is busy, the waiting threads back off exponentially
+ * and eventually yield the processor.
+ *
+ * The spinlock is not fair: a thread which just released the lock is
+ * likely to get it again. If fairness matters, use the ticket_lock.
+ *
+ * \warning
+ * The spinlock is not recursive. Locking it twice from the same thread
+ * deadlocks.
+ */
+
+
+
+/** \brief Initialize the spinlock.
+ *
+ * The spinlock starts unlocked.
+ */
+spinlock::spinlock()
+{
+}
+
+
+/** \brief Lock the spinlock.
+ *
+ * This function spins until the lock is obtained.
+ */
+void spinlock::lock()
+{
+    std::uint32_t pauses(1);
+    for(;;)
+    {
+        if(!f_locked.exchange(true, std::memory_order_acquire))
+        {
+            return;
+        }
+        while(f_locked.load(std::memory_order_relaxed))
+        {
+            spin_backoff(pauses);
+        }
+    }
+}
+
+
+/** \brief Try to lock the spinlock.
+ *
+ * This function makes one attempt at obtaining the lock.
+ *
+ * \return true if the lock was obtained.
+ */
+bool spinlock::try_lock()
+{
+    return !f_locked.load(std::memory_order_relaxed)
+        && !f_locked.exchange(true, std::memory_order_acquire);
+}
+
+
+/** \brief Unlock the spinlock.
+ *
+ * This function releases the lock.
+ */
+void spinlock::unlock()
+{
+    f_locked.store(false, std::memory_order_release);
+}
+
+
+
+/** \class ticket_lock
+ * \brief A fair spinning lock.
+ *
+ * The ticket lock works like the ticket dispenser at a counter: each
+ * thread takes the next ticket and waits until that ticket is being
+ * served. The threads obtain the lock in the order they asked for it
+ * so no thread can starve.
+ *
+ * Fairness has a cost: when the thread next in line is not running, all
+ * the threads behind it wait too. The ticket lock is best when there are
+ * fewer threads than processors.
+ *
+ * \warning
+ * The ticket_lock is not recursive. Locking it twice from the same thread
+ * deadlocks.
+ */
+
+
+
+/** \brief Initialize the ticket lock.
+ *
+ * The ticket lock starts unlocked.
+ */
+ticket_lock::ticket_lock()
+{
+}
+
+
+/** \brief Lock the ticket lock.
+ *
+ * This function takes a ticket and spins until it is served. The time
+ * spent pausing is proportional to the number of threads in front of
+ * this one. After spinning for a while, the thread yields the processor
+ * on each check instead.
+ */
+void ticket_lock::lock()
+{
+    std::uint32_t const ticket(f_next_ticket.fetch_add(1, std::memory_order_relaxed));
+    std::uint32_t spins(0);
+    for(;;)
+    {
+        std::uint32_t const serving(f_now_serving.load(std::memory_order_acquire));
+        if(serving == ticket)
+        {
+            return;
+        }
+
+        // the thread being served may not be running, after a while
+        // give it a chance to get a processor
+        //
+        ++spins;
+        std::uint32_t const ahead(ticket - serving);
+        if(ahead > MAX_PAUSES
+        || spins > MAX_PAUSES)
+        {
+            sched_yield();
+            continue;
+        }
+        for(std::uint32_t idx(0); idx < ahead * 8; ++idx)
+        {
+            cpu_relax();
+        }
+    }
+}
+
+
+/** \brief Try to lock the ticket lock.
+ *
+ * The function only takes a ticket if that ticket would be served
+ * immediately.
+ *
+ * \return true if the lock was obtained.
+ */
+bool ticket_lock::try_lock()
+{
+    std::uint32_t serving(f_now_serving.load(std::memory_order_acquire));
+    std::uint32_t expected(serving);
+    return f_next_ticket.compare_exchange_strong(
+                  expected
+                , serving + 1
+                , std::memory_order_acquire
+                , std::memory_order_relaxed);
+}
+
+
+/** \brief Unlock the ticket lock.
+ *
+ * This function serves the next ticket.
+ */
+void ticket_lock::unlock()
+{
+    // only the thread holding the lock writes to f_now_serving
+    //
+    f_now_serving.store(
+              f_now_serving.load(std::memory_order_relaxed) + 1
+            , std::memory_order_release);
+}
+
+
+
+
+/** \fn spinlock::spinlock(spinlock const & rhs)
+ * \brief The copy operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ */
+
+
+/** \fn spinlock & spinlock::operator = (spinlock const & rhs)
+ * \brief The assignment operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ *
+ * \return A reference to this object.
+ */
+
+
+/** \var spinlock::f_locked
+ * \brief Whether the spinlock is currently locked.
+ */
+
+
+/** \fn ticket_lock::ticket_lock(ticket_lock const & rhs)
+ * \brief The copy operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ */
+
+
+/** \fn ticket_lock & ticket_lock::operator = (ticket_lock const & rhs)
+ * \brief The assignment operator is deleted.
+ *
+ * \param[in] rhs  The right hand side.
+ *
+ * \return A reference to this object.
+ */
+
+
+/** \var ticket_lock::f_next_ticket
+ * \brief The ticket given to the next thread calling lock().
+ */
+
+
+/** \var ticket_lock::f_now_serving
+ * \brief The ticket of the thread currently holding the lock.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,94 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Spinning locks.
+ *
+ * This file declares the spinlock and ticket_lock classes. These locks
+ * never go to sleep in the kernel so they are only useful for very short
+ * critical sections.
+ */
+
+
+// self
+//
+#include    <cppthread/lockable.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+
+
+
+namespace cppthread
+{
+
+
+
+void                    cpu_relax();
+void                    spin_backoff(std::uint32_t & pauses);
+
+
+
+class spinlock final
+    : public lockable
+{
+public:
+                        spinlock();
+                        spinlock(spinlock const & rhs) = delete;
+
+    spinlock &          operator = (spinlock const & rhs) = delete;
+
+    virtual void        lock() override;
+    virtual bool        try_lock() override;
+    virtual void        unlock() override;
+
+private:
+    std::atomic<bool>   f_locked = false;
+};
+
+
+
+class ticket_lock final
+    : public lockable
+{
+public:
+                        ticket_lock();
+                        ticket_lock(ticket_lock const & rhs) = delete;
+
+    ticket_lock &       operator = (ticket_lock const & rhs) = delete;
+
+    virtual void        lock() override;
+    virtual bool        try_lock() override;
+    virtual void        unlock() override;
+
+private:
+    std::atomic<std::uint32_t>
+                        f_next_ticket = 0;
+    std::atomic<std::uint32_t>
+                        f_now_serving = 0;
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
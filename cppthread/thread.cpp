@@ -28,6 +28,7 @@
 //
 #include    "cppthread/thread.h"
 
+#include    "cppthread/epoch.h"
 #include    "cppthread/exception.h"
 #include    "cppthread/guard.h"
 #include    "cppthread/log.h"
@@ -159,6 +160,8 @@ void thread::init()
     }
 
     f_runner->f_thread = this;
+
+    f_mutex.set_name("thread::" + f_name);
 }
 
 
@@ -307,6 +310,9 @@ void * func_internal_start(void * system_thread)
  * The function marks the thread as started which allows the parent start()
  * function to return.
  *
+ * The thread is registered with the epoch based memory reclamation on
+ * entry and unregistered on exit (see epoch_register_thread()).
+ *
  * \note
  * The function catches standard exceptions thrown by any of the functions
  * called by the thread. When that happens, the thread returns early after
@@ -319,6 +325,8 @@ void thread::internal_thread()
 {
     try
     {
+        epoch_register_thread();
+
         {
             guard lock(f_mutex);
             f_tid = gettid();
@@ -405,6 +413,11 @@ void thread::internal_thread()
         throw;
     }
 
+    // hand the memory this thread retired and could not yet release
+    // over to the other threads
+    //
+    epoch_unregister_thread();
+
     // marked we are done (outside of the try/catch because if this one
     // fails, we have a big problem... (i.e. invalid mutex or more unlocks
     // than locks)
@@ -493,9 +506,13 @@ bool thread::internal_run()
         //
         f_exception = std::current_exception();
 
+        // pools may restart many threads failing the same way
+        //
+        static log_limiter limiter;
         if(f_log_all_exceptions)
         {
-            log << log_level_t::fatal
+            log << limiter
+                << log_level_t::fatal
                 << "thread internal_run() got exception: \""
                 << e.what()
                 << "\", exiting thread now."
@@ -649,6 +666,10 @@ bool thread::start()
  * is then removed from the thread (i.e. it won't re-throw a second time
  * and a call to get_exception() returns a null pointer).
  *
+ * Once the thread is marked as stopping, the function calls the
+ * runner::wakeup() function so a runner sleeping in a system call can
+ * notice the request.
+ *
  * \param[in] callback  A function to call after the thread is marked as
  * stopping but before calling join. Useful to send a signal to the child
  * if you could not have done so earlier.
@@ -672,6 +693,8 @@ void thread::stop(std::function<void(thread *)> callback)
         f_stopping = true;
     }
 
+    f_runner->wakeup();
+
     if(callback != nullptr)
     {
         callback(this);
@@ -0,0 +1,244 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Implementation of the timer queue.
+ *
+ * The timer queue runs one thread which sleeps until the next callback
+ * is due and then calls it.
+ */
+
+
+// self
+//
+#include    "cppthread/timer_queue.h"
+
+#include    "cppthread/guard.h"
+#include    "cppthread/runner.h"
+
+
+// C++
+//
+#include    <map>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace cppthread
+{
+
+
+
+/** \brief The runner of the timer queue thread.
+ *
+ * The callbacks are sorted by due time. The runner sleeps on its mutex
+ * condition until the first one is due or a new callback is added.
+ */
+class timer_queue::timer_runner
+    : public runner
+{
+public:
+    typedef std::multimap<std::chrono::steady_clock::time_point, callback_t>
+                                    timers_t;
+
+    timer_runner(std::string const & name)
+        : runner(name)
+    {
+    }
+
+    void add(std::chrono::steady_clock::time_point when, callback_t && callback)
+    {
+        guard lock(f_mutex);
+        bool const first(f_timers.empty() || when < f_timers.begin()->first);
+        f_timers.emplace(when, std::move(callback));
+        if(first)
+        {
+            f_mutex.signal();
+        }
+    }
+
+    std::size_t size() const
+    {
+        guard lock(f_mutex);
+        return f_timers.size();
+    }
+
+    virtual void wakeup() override
+    {
+        guard lock(f_mutex);
+        f_mutex.signal();
+    }
+
+    virtual void run() override
+    {
+        for(;;)
+        {
+            callback_t callback;
+            {
+                guard lock(f_mutex);
+
+                // check under the lock so wakeup() cannot be missed
+                //
+                if(!continue_running())
+                {
+                    return;
+                }
+                if(f_timers.empty())
+                {
+                    f_mutex.wait();
+                    continue;
+                }
+                auto it(f_timers.begin());
+                std::chrono::steady_clock::time_point const now(std::chrono::steady_clock::now());
+                if(it->first > now)
+                {
+                    std::uint64_t const usecs(std::chrono::ceil<std::chrono::microseconds>(it->first - now).count());
+                    f_mutex.timed_wait(usecs);
+                    continue;
+                }
+                callback = std::move(it->second);
+                f_timers.erase(it);
+            }
+
+            callback();
+        }
+    }
+
+private:
+    timers_t                        f_timers = timers_t();
+};
+
+
+
+/** \class timer_queue
+ * \brief Call functions at a given time.
+ *
+ * The timer queue owns a thread which calls the registered callbacks
+ * once they are due. The callbacks are called one at a time, in order
+ * of their due time, so they are expected to be short: a typical
+ * callback pushes an item in a fifo so a worker does the actual work.
+ *
+ * \code
+ *     cppthread::timer_queue::get_default().call_after(
+ *               std::chrono::milliseconds(250)
+ *             , [&my_pool]() { my_pool.push_back(retry_work_load); });
+ * \endcode
+ *
+ * The callbacks which are not yet due when the timer queue gets
+ * destroyed are dropped without being called.
+ */
+
+
+
+/** \brief Start the timer queue thread.
+ *
+ * \param[in] name  The name of the thread.
+ */
+timer_queue::timer_queue(std::string const & name)
+    : f_runner(std::make_shared<timer_runner>(name))
+    , f_thread(std::make_shared<thread>(name, f_runner))
+{
+    f_thread->start();
+}
+
+
+/** \brief Stop the timer queue thread.
+ *
+ * The pending callbacks are not called.
+ */
+timer_queue::~timer_queue()
+{
+    f_thread->stop();
+}
+
+
+/** \brief Call \p callback at time \p when.
+ *
+ * If \p when is in the past, the callback is called as soon as possible.
+ * The callback is called from the timer queue thread. It must not throw.
+ *
+ * \param[in] when  The time when the callback is due.
+ * \param[in] callback  The function to call.
+ */
+void timer_queue::call_at(std::chrono::steady_clock::time_point when, callback_t && callback)
+{
+    f_runner->add(when, std::move(callback));
+}
+
+
+/** \brief Call \p callback once \p delay elapsed.
+ *
+ * \param[in] delay  The amount of time to wait before calling the callback.
+ * \param[in] callback  The function to call.
+ *
+ * \sa call_at()
+ */
+void timer_queue::call_after(std::chrono::nanoseconds delay, callback_t && callback)
+{
+    call_at(std::chrono::steady_clock::now() + delay, std::move(callback));
+}
+
+
+/** \brief Get the number of callbacks not yet called.
+ *
+ * \return The number of pending callbacks.
+ */
+std::size_t timer_queue::size() const
+{
+    return f_runner->size();
+}
+
+
+/** \brief Get the process wide timer queue.
+ *
+ * The default timer queue is created the first time this function is
+ * called. It is used by the coroutine sleep_for() and sleep_until()
+ * awaitables when no other timer queue is specified.
+ *
+ * \return A reference to the default timer queue.
+ */
+timer_queue & timer_queue::get_default()
+{
+    static timer_queue g_default_timer_queue("default timer_queue");
+    return g_default_timer_queue;
+}
+
+
+/** \typedef timer_queue::callback_t
+ * \brief The type of the functions called by the timer queue.
+ */
+
+
+/** \var timer_queue::f_runner
+ * \brief The runner sleeping until the next callback is due.
+ */
+
+
+/** \var timer_queue::f_thread
+ * \brief The thread running f_runner.
+ */
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
@@ -0,0 +1,76 @@
+// Copyright (c) 2013-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Run callbacks at a given time.
+ *
+ * This file declares the timer_queue class.
+ */
+
+
+// self
+//
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <chrono>
+#include    <functional>
+#include    <memory>
+#include    <string>
+
+
+
+namespace cppthread
+{
+
+
+
+class timer_queue
+{
+public:
+    typedef std::function<void()>   callback_t;
+
+                        timer_queue(std::string const & name = "timer_queue");
+                        timer_queue(timer_queue const & rhs) = delete;
+                        ~timer_queue();
+
+    timer_queue &       operator = (timer_queue const & rhs) = delete;
+
+    void                call_at(std::chrono::steady_clock::time_point when, callback_t && callback);
+    void                call_after(std::chrono::nanoseconds delay, callback_t && callback);
+    std::size_t         size() const;
+
+    static timer_queue &
+                        get_default();
+
+private:
+    class timer_runner;
+
+    std::shared_ptr<timer_runner>
+                        f_runner = std::shared_ptr<timer_runner>();
+    thread::pointer_t   f_thread = thread::pointer_t();
+};
+
+
+
+} // namespace cppthread
+// vim: ts=4 sw=4 et
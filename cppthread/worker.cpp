@@ -153,6 +153,17 @@ namespace cppthread
  * It takes care of waiting for more data and run your process
  * by calling the do_work() function.
  *
+ * Before calling do_work(), the function reports a quiescent state (see
+ * rcu_quiescent_state()). The do_work() function is not called within
+ * a read section; if it reads rcu_ptr objects, it creates its own
+ * rcu_read_guard.
+ *
+ * Once do_work() returns, the function calls fifo::task_done() on the
+ * input FIFO when that FIFO tracks its unfinished items (see
+ * fifo::track_unfinished(), which the pool calls) so pool::wait_idle()
+ * knows when all the work was processed. If you reimplement the loop,
+ * make sure to do the same.
+ *
  * You may reimplement this function if you need to do some
  * initialization or clean up as follow:
  *
@@ -27,6 +27,7 @@
 // self
 //
 #include    <cppthread/fifo.h>
+#include    <cppthread/rcu.h>
 #include    <cppthread/runner.h>
 
 
@@ -102,7 +103,23 @@ public:
                     // note: if do_work() throws, then f_working remains
                     //       set to 'true' which should not matter
                     //
-                    if(do_work())
+                    // between two tasks the worker holds no RCU pointer;
+                    // do_work() is not run in a read section so it can
+                    // block or call rcu_synchronize(), it creates its own
+                    // rcu_read_guard to read rcu_ptr objects
+                    //
+                    bool done(false);
+                    try
+                    {
+                        rcu_quiescent_state();
+                        done = do_work();
+                    }
+                    catch(...)
+                    {
+                        f_in->task_done();
+                        throw;
+                    }
+                    if(done)
                     {
                         if(f_out != nullptr)
                         {
@@ -115,6 +132,10 @@ public:
                         f_working = false;
                     }
                 }
+
+                // let pool::wait_idle() know this item was handled
+                //
+                f_in->task_done();
             }
             else
             {
@@ -0,0 +1,184 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/actor.h>
+
+#include    <cppthread/exception.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+namespace
+{
+
+
+std::atomic<int>    g_errors(0);
+
+
+class counter
+    : public cppthread::actor<int>
+{
+public:
+    counter(cppthread::actor_system & system)
+        : actor<int>(system)
+    {
+    }
+
+    virtual void handle(int & n) override
+    {
+        if(++f_inside != 1)
+        {
+            ++g_errors;
+        }
+
+        // messages are handled in order
+        //
+        if(n != f_count + 1)
+        {
+            ++g_errors;
+        }
+        ++f_count;
+
+        --f_inside;
+    }
+
+    int count() const
+    {
+        return f_count;
+    }
+
+private:
+    std::atomic<int>    f_inside = 0;
+    int                 f_count = 0;
+};
+
+
+class forwarder
+    : public cppthread::actor<int>
+{
+public:
+    forwarder(cppthread::actor_system & system, counter::pointer_t next)
+        : actor<int>(system)
+        , f_next(next)
+    {
+    }
+
+    virtual void handle(int & n) override
+    {
+        if(n == -2)
+        {
+            throw n;
+        }
+        if(n < 0)
+        {
+            throw cppthread::invalid_error("negative message");
+        }
+        f_next->send(n);
+    }
+
+private:
+    counter::pointer_t  f_next;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("actor", "[actor]")
+{
+    CATCH_START_SECTION("actor: many actors on a few workers")
+    {
+        constexpr int const ACTORS = 10'000;
+        constexpr int const MESSAGES = 20;
+
+        g_errors = 0;
+        cppthread::actor_system system("actors", 3);
+        CATCH_REQUIRE(system.size() == 3);
+
+        std::vector<std::shared_ptr<counter>> actors;
+        actors.reserve(ACTORS);
+        for(int i(0); i < ACTORS; ++i)
+        {
+            actors.push_back(std::make_shared<counter>(system));
+        }
+        for(int m(1); m <= MESSAGES; ++m)
+        {
+            for(auto & a : actors)
+            {
+                a->send(m);
+            }
+        }
+        CATCH_REQUIRE(system.drain(60'000'000));
+
+        CATCH_REQUIRE(g_errors == 0);
+        for(auto const & a : actors)
+        {
+            CATCH_REQUIRE(a->count() == MESSAGES);
+            CATCH_REQUIRE(a->mailbox_size() == 0);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("actor: long mailboxes are processed in batches")
+    {
+        g_errors = 0;
+        cppthread::actor_system system("actors", 2);
+
+        auto a(std::make_shared<counter>(system));
+        auto b(std::make_shared<counter>(system));
+        for(int m(1); m <= 1'000; ++m)
+        {
+            a->send(m);
+            b->send(m);
+        }
+        CATCH_REQUIRE(system.drain(10'000'000));
+        CATCH_REQUIRE(g_errors == 0);
+        CATCH_REQUIRE(a->count() == 1'000);
+        CATCH_REQUIRE(b->count() == 1'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("actor: actors send to actors and survive exceptions")
+    {
+        g_errors = 0;
+        cppthread::actor_system system("actors", 2);
+
+        auto last(std::make_shared<counter>(system));
+        auto first(std::make_shared<forwarder>(system, last));
+        first->send(1);
+        first->send(-1);
+        first->send(2);
+        first->send(-2);
+        first->send(3);
+        CATCH_REQUIRE(system.drain(10'000'000));
+        CATCH_REQUIRE(g_errors == 0);
+        CATCH_REQUIRE(last->count() == 3);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
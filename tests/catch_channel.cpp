@@ -0,0 +1,237 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/channel.h>
+
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+class lambda_runner
+    : public cppthread::runner
+{
+public:
+    lambda_runner(std::function<void()> f)
+        : runner("channel-runner")
+        , f_function(f)
+    {
+    }
+
+    virtual void run() override
+    {
+        f_function();
+    }
+
+private:
+    std::function<void()>
+                        f_function;
+};
+
+
+class runners
+{
+public:
+    void start(std::function<void()> f)
+    {
+        f_runners.push_back(std::make_shared<lambda_runner>(f));
+        f_threads.push_back(std::make_shared<cppthread::thread>("channel-runner", f_runners.back()));
+        f_threads.back()->start();
+    }
+
+    void stop()
+    {
+        for(auto & t : f_threads)
+        {
+            t->stop();
+        }
+    }
+
+private:
+    std::vector<std::shared_ptr<lambda_runner>>     f_runners = {};
+    std::vector<std::shared_ptr<cppthread::thread>> f_threads = {};
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("channel", "[channel]")
+{
+    CATCH_START_SECTION("channel: send, receive and close")
+    {
+        cppthread::channel<int> ch;
+        CATCH_REQUIRE(ch.send(1));
+        CATCH_REQUIRE(ch.send(2));
+        CATCH_REQUIRE_FALSE(ch.is_closed());
+
+        ch.close();
+        CATCH_REQUIRE(ch.is_closed());
+        CATCH_REQUIRE_FALSE(ch.send(3));
+
+        // the items sent before close() can still be received
+        //
+        int v(0);
+        CATCH_REQUIRE(ch.receive(v));
+        CATCH_REQUIRE(v == 1);
+        CATCH_REQUIRE(ch.receive(v));
+        CATCH_REQUIRE(v == 2);
+        CATCH_REQUIRE_FALSE(ch.receive(v));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("channel: select without waiting")
+    {
+        cppthread::channel<int> a;
+        cppthread::channel<std::string> b;
+        int i(0);
+        std::string s;
+
+        cppthread::select_status r(cppthread::select(0, cppthread::on_receive(a, i), cppthread::on_receive(b, s)));
+        CATCH_REQUIRE(r.timed_out());
+
+        r = cppthread::select(1'000, cppthread::on_receive(a, i), cppthread::on_receive(b, s));
+        CATCH_REQUIRE(r.timed_out());
+
+        b.send("ready");
+        r = cppthread::select(-1, cppthread::on_receive(a, i), cppthread::on_receive(b, s));
+        CATCH_REQUIRE(r.index() == 1);
+        CATCH_REQUIRE(r.received());
+        CATCH_REQUIRE(s == "ready");
+
+        a.close();
+        r = cppthread::select(-1, cppthread::on_receive(a, i), cppthread::on_receive(b, s));
+        CATCH_REQUIRE(r.index() == 0);
+        CATCH_REQUIRE_FALSE(r.received());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("channel: select wakes up on the first channel ready")
+    {
+        cppthread::channel<int> a;
+        cppthread::channel<int> b;
+        cppthread::channel<int> c;
+
+        runners r;
+        r.start([&]()
+            {
+                usleep(10'000);
+                b.send(42);
+            });
+
+        int va(0);
+        int vb(0);
+        int vc(0);
+        cppthread::select_status const status(cppthread::select(
+                  10'000'000
+                , cppthread::on_receive(a, va)
+                , cppthread::on_receive(b, vb)
+                , cppthread::on_receive(c, vc)));
+        r.stop();
+
+        CATCH_REQUIRE(status.index() == 1);
+        CATCH_REQUIRE(status.received());
+        CATCH_REQUIRE(vb == 42);
+
+        // the waiters registered on the other channels were removed
+        //
+        a.send(1);
+        CATCH_REQUIRE(a.size() == 1);
+        CATCH_REQUIRE(va == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("channel: no item lost when several channels are ready")
+    {
+        constexpr int const COUNT = 5'000;
+
+        cppthread::channel<int> a;
+        cppthread::channel<int> b;
+
+        runners r;
+        r.start([&]()
+            {
+                for(int i(1); i <= COUNT; ++i)
+                {
+                    a.send(i);
+                }
+                a.close();
+            });
+        r.start([&]()
+            {
+                for(int i(1); i <= COUNT; ++i)
+                {
+                    b.send(i);
+                }
+                b.close();
+            });
+
+        std::int64_t sum(0);
+        int received(0);
+        int va(0);
+        int vb(0);
+        for(;;)
+        {
+            cppthread::select_status const status(cppthread::select(
+                      -1
+                    , cppthread::on_receive(a, va)
+                    , cppthread::on_receive(b, vb)));
+            if(!status.received())
+            {
+                // one channel is closed, empty the other one
+                //
+                cppthread::channel<int> & other(status.index() == 0 ? b : a);
+                int v(0);
+                while(other.receive(v))
+                {
+                    sum += v;
+                    ++received;
+                }
+                break;
+            }
+            sum += status.index() == 0 ? va : vb;
+            ++received;
+        }
+        r.stop();
+
+        CATCH_REQUIRE(received == COUNT * 2);
+        CATCH_REQUIRE(sum == static_cast<std::int64_t>(COUNT) * (COUNT + 1));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,215 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/concurrent_map.h>
+
+#include    <cppthread/runner.h>
+#include    <cppthread/spinlock.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <set>
+
+
+
+namespace
+{
+
+
+typedef cppthread::concurrent_map<int, int, cppthread::spinlock>   map_t;
+
+
+class map_runner
+    : public cppthread::runner
+{
+public:
+    map_runner(map_t & map, int id, int count)
+        : runner("map-runner")
+        , f_map(map)
+        , f_id(id)
+        , f_count(count)
+    {
+    }
+
+    virtual void run() override
+    {
+        // each thread owns its own range of keys and they all share
+        // the counter at key -1
+        //
+        int const base(f_id * f_count);
+        for(int i(0); i < f_count; ++i)
+        {
+            f_map.insert(base + i, i);
+            f_map.upsert(-1, [](int & v) { ++v; });
+        }
+        for(int i(0); i < f_count; ++i)
+        {
+            int value(0);
+            if(!f_map.find(base + i, value)
+            || value != i)
+            {
+                ++f_errors;
+            }
+            if((i & 1) != 0)
+            {
+                if(!f_map.erase(base + i))
+                {
+                    ++f_errors;
+                }
+            }
+        }
+    }
+
+    std::uint64_t       f_errors = 0;
+
+private:
+    map_t &             f_map;
+    int                 f_id;
+    int                 f_count;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("concurrent_map", "[map]")
+{
+    CATCH_START_SECTION("concurrent_map: basic functions")
+    {
+        cppthread::concurrent_map<std::string, int> map;
+        CATCH_REQUIRE(map.shards() == 64);
+        CATCH_REQUIRE(map.empty());
+        CATCH_REQUIRE(map.size() == 0);
+
+        CATCH_REQUIRE(map.insert("one", 1));
+        CATCH_REQUIRE_FALSE(map.insert("one", 10));
+        CATCH_REQUIRE(map.insert("two", 2));
+        CATCH_REQUIRE_FALSE(map.empty());
+        CATCH_REQUIRE(map.size() == 2);
+
+        int value(0);
+        CATCH_REQUIRE(map.find("one", value));
+        CATCH_REQUIRE(value == 1);
+        CATCH_REQUIRE_FALSE(map.find("three", value));
+        CATCH_REQUIRE(value == 1);
+        CATCH_REQUIRE(map.contains("two"));
+        CATCH_REQUIRE_FALSE(map.contains("three"));
+
+        CATCH_REQUIRE_FALSE(map.insert_or_assign("one", 11));
+        CATCH_REQUIRE(map.insert_or_assign("three", 3));
+        CATCH_REQUIRE(map.find("one", value));
+        CATCH_REQUIRE(value == 11);
+
+        CATCH_REQUIRE(map.update("two", [](int & v) { v *= 10; }));
+        CATCH_REQUIRE_FALSE(map.update("four", [](int & v) { v = 4; }));
+        CATCH_REQUIRE(map.find("two", value));
+        CATCH_REQUIRE(value == 20);
+        CATCH_REQUIRE_FALSE(map.contains("four"));
+
+        map.upsert("four", [](int & v) { v += 4; });
+        map.upsert("four", [](int & v) { v += 4; });
+        CATCH_REQUIRE(map.find("four", value));
+        CATCH_REQUIRE(value == 8);
+
+        int sum(0);
+        std::set<std::string> keys;
+        map.for_each([&sum, &keys](std::string const & key, int v)
+            {
+                sum += v;
+                keys.insert(key);
+            });
+        CATCH_REQUIRE(keys == std::set<std::string>({ "four", "one", "three", "two" }));
+        CATCH_REQUIRE(sum == 11 + 20 + 3 + 8);
+
+        CATCH_REQUIRE(map.erase("three"));
+        CATCH_REQUIRE_FALSE(map.erase("three"));
+        CATCH_REQUIRE(map.size() == 3);
+
+        map.clear();
+        CATCH_REQUIRE(map.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("concurrent_map: number of shards")
+    {
+        cppthread::concurrent_map<int, int> single(1);
+        CATCH_REQUIRE(single.shards() == 1);
+        single.reserve(1'000);
+        for(int i(0); i < 1'000; ++i)
+        {
+            CATCH_REQUIRE(single.insert(i, i * 3));
+        }
+        CATCH_REQUIRE(single.size() == 1'000);
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (cppthread::concurrent_map<int, int>(0))
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: the number of shards in a concurrent_map must be a power of two."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (cppthread::concurrent_map<int, int>(48))
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: the number of shards in a concurrent_map must be a power of two."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("concurrent_map: many threads")
+    {
+        map_t map(16);
+
+        std::vector<std::shared_ptr<map_runner>> runners;
+        std::vector<std::shared_ptr<cppthread::thread>> threads;
+        for(int i(0); i < 4; ++i)
+        {
+            runners.push_back(std::make_shared<map_runner>(map, i, 10'000));
+            threads.push_back(std::make_shared<cppthread::thread>("map-runner", runners.back()));
+            threads.back()->start();
+        }
+        for(auto & t : threads)
+        {
+            t->stop();
+        }
+
+        for(auto const & r : runners)
+        {
+            CATCH_REQUIRE(r->f_errors == 0);
+        }
+
+        int counter(0);
+        CATCH_REQUIRE(map.find(-1, counter));
+        CATCH_REQUIRE(counter == 40'000);
+        CATCH_REQUIRE(map.size() == 4 * 5'000 + 1);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
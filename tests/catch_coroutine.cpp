@@ -0,0 +1,407 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/coroutine.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/spinlock.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <thread>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+cppthread::task<int> answer()
+{
+    co_return 42;
+}
+
+
+cppthread::task<int> add(int a)
+{
+    int const b(co_await answer());
+    co_return a + b;
+}
+
+
+cppthread::task<> fail()
+{
+    throw cppthread::invalid_error("coroutine failed");
+    co_return;
+}
+
+
+cppthread::task<std::thread::id> hop(cppthread::coroutine_pool & p)
+{
+    co_await cppthread::schedule_on(p);
+    co_return std::this_thread::get_id();
+}
+
+
+cppthread::task<> sleeper(cppthread::coroutine_pool & p, cppthread::latch & done)
+{
+    co_await cppthread::schedule_on(p);
+    co_await cppthread::sleep_for(p, std::chrono::milliseconds(20));
+    done.count_down();
+}
+
+
+cppthread::task<int> consume(cppthread::coroutine_pool & p, cppthread::fifo<int> & f)
+{
+    co_await cppthread::schedule_on(p);
+
+    int sum(0);
+    int v(0);
+    while(co_await cppthread::async_pop_front(p, f, v))
+    {
+        sum += v;
+    }
+    co_return sum;
+}
+
+
+template<typename L>
+cppthread::task<bool> locker(cppthread::coroutine_pool & p, L & m, std::atomic<bool> & locked)
+{
+    co_await cppthread::schedule_on(p);
+    co_await cppthread::async_lock(p, m);
+    locked = true;
+    m.unlock();
+    co_return true;
+}
+
+
+cppthread::task<> critical(
+          cppthread::coroutine_pool & p
+        , cppthread::async_mutex & m
+        , int & inside
+        , int & errors
+        , cppthread::latch & done)
+{
+    co_await cppthread::schedule_on(p);
+    {
+        cppthread::async_guard lock(co_await cppthread::async_scoped_lock(p, m));
+        if(++inside != 1)
+        {
+            ++errors;
+        }
+
+        // the async_mutex can be held across a suspension
+        //
+        co_await cppthread::schedule_on(p);
+        --inside;
+    }
+    done.count_down();
+}
+
+
+cppthread::task<> queued_locker(
+          cppthread::coroutine_pool & p
+        , cppthread::async_mutex & m
+        , int id
+        , std::vector<int> & order
+        , cppthread::latch & done)
+{
+    co_await cppthread::async_lock(p, m);
+    order.push_back(id);
+    m.unlock();
+    done.count_down();
+}
+
+
+cppthread::task<> queued_popper(
+          cppthread::coroutine_pool & p
+        , cppthread::fifo<int> & f
+        , int * result
+        , cppthread::latch & done)
+{
+    int v(0);
+    if(co_await cppthread::async_pop_front(p, f, v))
+    {
+        *result = v;
+    }
+    else
+    {
+        *result = -1;
+    }
+    done.count_down();
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("coroutine", "[coroutine]")
+{
+    CATCH_START_SECTION("coroutine: task results and exceptions")
+    {
+        CATCH_REQUIRE(cppthread::sync_wait(add(8)) == 50);
+
+        cppthread::task<int> t(answer());
+        CATCH_REQUIRE_FALSE(t.is_ready());
+        CATCH_REQUIRE(cppthread::sync_wait(std::move(t)) == 42);
+        CATCH_REQUIRE(t.is_ready());
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::sync_wait(fail())
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: coroutine failed"));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("coroutine: resume on a pool worker")
+    {
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 2, in, nullptr);
+
+        std::thread::id const id(cppthread::sync_wait(hop(p)));
+        CATCH_REQUIRE(id != std::this_thread::get_id());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("coroutine: many sleeping tasks on a few workers")
+    {
+        constexpr std::uint32_t const COUNT = 1'000;
+
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 2, in, nullptr);
+
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        cppthread::latch done(COUNT);
+        for(std::uint32_t i(0); i < COUNT; ++i)
+        {
+            cppthread::spawn(sleeper(p, done));
+        }
+        CATCH_REQUIRE(done.wait_for(std::chrono::seconds(30)));
+
+        // the sleeps overlap instead of blocking the two workers
+        //
+        CATCH_REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+        p.wait_idle();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("coroutine: pop from a fifo and take a spinlock")
+    {
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 1, in, nullptr);
+
+        cppthread::fifo<int> f;
+        cppthread::task<int> sum(consume(p, f));
+        cppthread::latch sum_done(1);
+        cppthread::spawn([](cppthread::task<int> & t, cppthread::latch & l) -> cppthread::task<>
+            {
+                co_await t.when_ready();
+                l.count_down();
+            }(sum, sum_done));
+        for(int i(1); i <= 10; ++i)
+        {
+            f.push_back(i);
+            usleep(1'000);
+        }
+        f.done(false);
+        CATCH_REQUIRE(sum_done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(sum.result() == 55);
+
+        cppthread::spinlock m;
+        std::atomic<bool> locked(false);
+        m.lock();
+        cppthread::task<bool> l(locker(p, m, locked));
+        cppthread::latch lock_done(1);
+        cppthread::spawn([](cppthread::task<bool> & t, cppthread::latch & d) -> cppthread::task<>
+            {
+                co_await t.when_ready();
+                d.count_down();
+            }(l, lock_done));
+        usleep(10'000);
+        CATCH_REQUIRE_FALSE(locked);
+        m.unlock();
+        CATCH_REQUIRE(lock_done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(locked);
+        CATCH_REQUIRE(l.result());
+
+        // a ticket_lock works the same way
+        //
+        cppthread::ticket_lock t;
+        std::atomic<bool> ticket_locked(false);
+        t.lock();
+        cppthread::task<bool> tl(locker(p, t, ticket_locked));
+        cppthread::latch ticket_done(1);
+        cppthread::spawn([](cppthread::task<bool> & t, cppthread::latch & d) -> cppthread::task<>
+            {
+                co_await t.when_ready();
+                d.count_down();
+            }(tl, ticket_done));
+        usleep(10'000);
+        CATCH_REQUIRE_FALSE(ticket_locked);
+        t.unlock();
+        CATCH_REQUIRE(ticket_done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(ticket_locked);
+        CATCH_REQUIRE(tl.result());
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("async_mutex", "[coroutine]")
+{
+    CATCH_START_SECTION("async_mutex: mutual exclusion across suspensions")
+    {
+        constexpr std::uint32_t const COUNT = 200;
+
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 3, in, nullptr);
+
+        cppthread::async_mutex m;
+        int inside(0);
+        int errors(0);
+        cppthread::latch done(COUNT);
+        for(std::uint32_t i(0); i < COUNT; ++i)
+        {
+            cppthread::spawn(critical(p, m, inside, errors, done));
+        }
+        CATCH_REQUIRE(done.wait_for(std::chrono::seconds(30)));
+        CATCH_REQUIRE(errors == 0);
+        CATCH_REQUIRE(inside == 0);
+        CATCH_REQUIRE_FALSE(m.is_locked());
+        p.wait_idle();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("async_mutex: waiters get the mutex in order")
+    {
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 2, in, nullptr);
+
+        cppthread::async_mutex m;
+        CATCH_REQUIRE(m.try_lock());
+        CATCH_REQUIRE_FALSE(m.try_lock());
+
+        // the coroutines queue themselves before spawn() returns
+        //
+        std::vector<int> order;
+        cppthread::latch done(5);
+        for(int i(0); i < 5; ++i)
+        {
+            cppthread::spawn(queued_locker(p, m, i, order, done));
+        }
+        CATCH_REQUIRE(order.empty());
+
+        m.unlock();
+        CATCH_REQUIRE(done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(order == std::vector<int>({ 0, 1, 2, 3, 4 }));
+        CATCH_REQUIRE_FALSE(m.is_locked());
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  m.unlock()
+                , cppthread::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: async_mutex::unlock() called on an unlocked mutex."));
+        p.wait_idle();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("async_mutex: fifo waiters receive items in order")
+    {
+        cppthread::coroutine_pool::worker_fifo_t::pointer_t in(std::make_shared<cppthread::coroutine_pool::worker_fifo_t>());
+        cppthread::coroutine_pool p("coroutines", 2, in, nullptr);
+
+        cppthread::fifo<int> f;
+        int results[4] = { 0, 0, 0, 0 };
+        cppthread::latch three(3);
+        cppthread::latch last(1);
+        for(int i(0); i < 3; ++i)
+        {
+            cppthread::spawn(queued_popper(p, f, results + i, three));
+        }
+        cppthread::spawn(queued_popper(p, f, results + 3, last));
+
+        f.push_back(10);
+        f.push_back(20);
+        f.push_back(30);
+        CATCH_REQUIRE(three.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(results[0] == 10);
+        CATCH_REQUIRE(results[1] == 20);
+        CATCH_REQUIRE(results[2] == 30);
+        CATCH_REQUIRE(f.empty());
+        CATCH_REQUIRE_FALSE(last.try_wait());
+
+        // the last waiter is released when the fifo is done
+        //
+        f.done(false);
+        CATCH_REQUIRE(last.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(results[3] == -1);
+        p.wait_idle();
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("timer_queue", "[coroutine]")
+{
+    CATCH_START_SECTION("timer_queue: callbacks run in order")
+    {
+        cppthread::mutex m;
+        std::vector<int> order;
+        cppthread::latch done(3);
+
+        // the timer thread may still hold m when done gets released, so
+        // timers must be destroyed (joined) first
+        //
+        cppthread::timer_queue timers("test timers");
+
+        timers.call_after(std::chrono::milliseconds(30), [&]() { cppthread::guard lock(m); order.push_back(3); done.count_down(); });
+        timers.call_after(std::chrono::milliseconds(10), [&]() { cppthread::guard lock(m); order.push_back(1); done.count_down(); });
+        timers.call_after(std::chrono::milliseconds(20), [&]() { cppthread::guard lock(m); order.push_back(2); done.count_down(); });
+        timers.call_after(std::chrono::hours(1), []() {});
+
+        CATCH_REQUIRE(done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(order == std::vector<int>({ 1, 2, 3 }));
+
+        // the callback due in one hour is dropped by the destructor
+        //
+        CATCH_REQUIRE(timers.size() == 1);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,289 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/epoch.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <atomic>
+
+
+
+namespace
+{
+
+
+std::atomic<int>    g_nodes(0);
+
+
+struct node_t
+{
+    node_t(int value)
+        : f_value(value)
+    {
+        ++g_nodes;
+    }
+
+    ~node_t()
+    {
+        // make a use after free visible
+        //
+        f_value = -1;
+        --g_nodes;
+    }
+
+    node_t *            f_next = nullptr;
+    int                 f_value = 0;
+};
+
+
+/** \brief A lock-free stack releasing its nodes with epoch_delete().
+ *
+ * Without the epoch reclamation, a pop() could read the f_next field of
+ * a node already deleted by another pop().
+ */
+class stack
+{
+public:
+    ~stack()
+    {
+        node_t * n(f_head.load());
+        while(n != nullptr)
+        {
+            node_t * next(n->f_next);
+            delete n;
+            n = next;
+        }
+    }
+
+    void push(int value)
+    {
+        node_t * n(new node_t(value));
+        n->f_next = f_head.load();
+        while(!f_head.compare_exchange_weak(n->f_next, n))
+        {
+        }
+    }
+
+    bool pop(int & value)
+    {
+        cppthread::epoch_guard section;
+        node_t * n(f_head.load());
+        while(n != nullptr
+           && !f_head.compare_exchange_weak(n, n->f_next))
+        {
+        }
+        if(n == nullptr)
+        {
+            return false;
+        }
+        value = n->f_value;
+        cppthread::epoch_delete(n);
+        return true;
+    }
+
+private:
+    std::atomic<node_t *>   f_head = nullptr;
+};
+
+
+class stack_runner
+    : public cppthread::runner
+{
+public:
+    stack_runner(stack & s, int count)
+        : runner("epoch-stack")
+        , f_stack(s)
+        , f_count(count)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < f_count; ++i)
+        {
+            f_stack.push(i);
+            int value(0);
+            if(f_stack.pop(value))
+            {
+                if(value < 0 || value >= f_count)
+                {
+                    ++f_errors;
+                }
+            }
+        }
+    }
+
+    std::uint64_t       f_errors = 0;
+
+private:
+    stack &             f_stack;
+    int                 f_count;
+};
+
+
+class retire_runner
+    : public cppthread::runner
+{
+public:
+    retire_runner(int count)
+        : runner("epoch-retire")
+        , f_count(count)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < f_count; ++i)
+        {
+            cppthread::epoch_delete(new node_t(i));
+        }
+        f_pending = cppthread::epoch_pending();
+    }
+
+    std::size_t         f_pending = 0;
+
+private:
+    int                 f_count;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("epoch", "[epoch]")
+{
+    CATCH_START_SECTION("epoch: retire, reclaim and synchronize")
+    {
+        cppthread::epoch_synchronize();
+        int const nodes(g_nodes);
+
+        node_t * n(new node_t(5));
+        {
+            cppthread::epoch_guard section;
+            CATCH_REQUIRE(cppthread::epoch_in_critical_section());
+            {
+                cppthread::epoch_guard nested;
+                CATCH_REQUIRE(cppthread::epoch_in_critical_section());
+            }
+            CATCH_REQUIRE(cppthread::epoch_in_critical_section());
+
+            cppthread::epoch_delete(n);
+            CATCH_REQUIRE(cppthread::epoch_pending() == 1);
+
+            // we are in a critical section, `n` must survive
+            //
+            CATCH_REQUIRE(cppthread::epoch_reclaim() == 0);
+            CATCH_REQUIRE(g_nodes == nodes + 1);
+            CATCH_REQUIRE(n->f_value == 5);
+
+            CATCH_REQUIRE_THROWS_MATCHES(
+                      cppthread::epoch_synchronize()
+                    , cppthread::logic_error
+                    , Catch::Matchers::ExceptionMessage(
+                              "logic_error: epoch_synchronize() called from within a critical section"));
+        }
+        CATCH_REQUIRE_FALSE(cppthread::epoch_in_critical_section());
+
+        std::uint64_t const epoch(cppthread::epoch_current());
+        CATCH_REQUIRE(cppthread::epoch_reclaim() == 1);
+        CATCH_REQUIRE(cppthread::epoch_current() > epoch);
+        CATCH_REQUIRE(cppthread::epoch_pending() == 0);
+        CATCH_REQUIRE(g_nodes == nodes);
+
+        // nullptr is ignored
+        //
+        cppthread::epoch_delete<node_t>(nullptr);
+        CATCH_REQUIRE(cppthread::epoch_pending() == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("epoch: memory retired by an exited thread is released")
+    {
+        cppthread::epoch_synchronize();
+        int const nodes(g_nodes);
+
+        retire_runner r(10);
+        {
+            // our critical section prevents the thread from releasing
+            // the nodes before it exits
+            //
+            cppthread::epoch_guard section;
+
+            cppthread::thread t("epoch-retire", &r);
+            t.start();
+            t.stop();
+
+            CATCH_REQUIRE(r.f_pending == 10);
+            CATCH_REQUIRE(g_nodes == nodes + 10);
+        }
+
+        cppthread::epoch_synchronize();
+        CATCH_REQUIRE(g_nodes == nodes);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("epoch: lock-free stack")
+    {
+        cppthread::epoch_synchronize();
+        int const nodes(g_nodes);
+
+        {
+            stack s;
+
+            std::vector<std::shared_ptr<stack_runner>> runners;
+            std::vector<std::shared_ptr<cppthread::thread>> threads;
+            for(int i(0); i < 4; ++i)
+            {
+                runners.push_back(std::make_shared<stack_runner>(s, 20'000));
+                threads.push_back(std::make_shared<cppthread::thread>("epoch-stack", runners.back()));
+                threads.back()->start();
+            }
+            for(auto & t : threads)
+            {
+                t->stop();
+            }
+
+            for(auto const & r : runners)
+            {
+                CATCH_REQUIRE(r->f_errors == 0);
+            }
+        }
+
+        cppthread::epoch_synchronize();
+        CATCH_REQUIRE(g_nodes == nodes);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,213 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/executor.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <thread>
+
+
+
+namespace
+{
+
+
+class counting_executor
+    : public cppthread::executor
+{
+public:
+    virtual void wakeup() override
+    {
+        ++f_wakeups;
+    }
+
+    int             f_wakeups = 0;
+};
+
+
+class loop_runner
+    : public cppthread::runner
+    , public cppthread::executor
+{
+public:
+    loop_runner()
+        : runner("loop")
+    {
+    }
+
+    virtual void run() override
+    {
+        for(;;)
+        {
+            {
+                cppthread::guard lock(f_mutex);
+                if(!continue_running())
+                {
+                    break;
+                }
+                if(!has_posted())
+                {
+                    f_mutex.wait();
+                    continue;
+                }
+            }
+
+            // small batches so the loop gets back here often
+            //
+            std::size_t const count(run_posted(64));
+            if(count > f_largest_batch)
+            {
+                f_largest_batch = count;
+            }
+        }
+        run_posted();
+    }
+
+    virtual void wakeup() override
+    {
+        cppthread::guard lock(f_mutex);
+        f_mutex.signal();
+    }
+
+    // only accessed from the loop thread
+    //
+    std::vector<int>    f_last = std::vector<int>(4, -1);
+    int                 f_errors = 0;
+    int                 f_total = 0;
+    std::size_t         f_largest_batch = 0;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("executor", "[executor]")
+{
+    CATCH_START_SECTION("executor: wakeups and batches")
+    {
+        counting_executor e;
+        CATCH_REQUIRE_FALSE(e.has_posted());
+        CATCH_REQUIRE(e.run_posted() == 0);
+
+        int sum(0);
+        for(int i(1); i <= 10; ++i)
+        {
+            e.post([&sum, i]() { sum += i; });
+        }
+
+        // only the first post wakes the executor up
+        //
+        CATCH_REQUIRE(e.f_wakeups == 1);
+        CATCH_REQUIRE(e.has_posted());
+
+        // stopping early calls wakeup() again so the rest is not forgotten
+        //
+        CATCH_REQUIRE(e.run_posted(4) == 4);
+        CATCH_REQUIRE(sum == 1 + 2 + 3 + 4);
+        CATCH_REQUIRE(e.f_wakeups == 2);
+
+        CATCH_REQUIRE(e.run_posted() == 6);
+        CATCH_REQUIRE(sum == 55);
+        CATCH_REQUIRE_FALSE(e.has_posted());
+
+        // a post after a drain wakes it up again
+        //
+        e.post([]() { throw cppthread::invalid_error("task failed"); });
+        e.post([&sum]() { sum = 0; });
+        CATCH_REQUIRE(e.f_wakeups == 3);
+        CATCH_REQUIRE(e.run_posted() == 2);
+        CATCH_REQUIRE(sum == 0);
+
+        // anything thrown is caught and the task gets released
+        //
+        e.post([]() { throw 7; });
+        e.post([&sum]() { sum = 2; });
+        CATCH_REQUIRE(e.run_posted() == 2);
+        CATCH_REQUIRE(sum == 2);
+
+        // pending tasks are dropped by the destructor
+        //
+        e.post([&sum]() { sum = 1; });
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("executor: many producers post to a runner loop")
+    {
+        constexpr int const PRODUCERS = 4;
+        constexpr int const POSTS = 20'000;
+
+        std::shared_ptr<loop_runner> r(std::make_shared<loop_runner>());
+        cppthread::thread t("loop", r);
+        CATCH_REQUIRE(t.start());
+
+        std::vector<std::thread> producers;
+        for(int p(0); p < PRODUCERS; ++p)
+        {
+            producers.emplace_back([r, p]()
+                {
+                    for(int i(0); i < POSTS; ++i)
+                    {
+                        r->post([r, p, i]()
+                            {
+                                // each producer's posts run in order
+                                //
+                                if(r->f_last[p] + 1 != i)
+                                {
+                                    ++r->f_errors;
+                                }
+                                r->f_last[p] = i;
+                                ++r->f_total;
+                            });
+                    }
+                });
+        }
+        for(auto & p : producers)
+        {
+            p.join();
+        }
+
+        // stop() calls wakeup() and the loop runs what is left
+        //
+        t.stop();
+
+        CATCH_REQUIRE(r->f_errors == 0);
+        CATCH_REQUIRE(r->f_total == PRODUCERS * POSTS);
+        CATCH_REQUIRE(r->f_largest_batch <= 64);
+        CATCH_REQUIRE_FALSE(r->has_posted());
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
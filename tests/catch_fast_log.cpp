@@ -0,0 +1,295 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/fast_log.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <chrono>
+#include    <mutex>
+#include    <thread>
+
+
+
+namespace
+{
+
+
+enum class char_enum_t : char
+{
+    CHAR_ENUM_A = 'a',
+    CHAR_ENUM_B = 'b',
+};
+
+
+enum class int_enum_t
+{
+    INT_ENUM_ONE = 1,
+    INT_ENUM_TWO = 2,
+};
+
+
+std::mutex                  g_messages_mutex;
+std::vector<std::string>    g_messages;
+
+
+void collect_messages(cppthread::log_level_t level, std::string const & message)
+{
+    std::lock_guard<std::mutex> lock(g_messages_mutex);
+    g_messages.push_back(cppthread::to_string(level) + ": " + message);
+}
+
+
+std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+// remove the "[seconds.nanoseconds] " prefix of a message after checking
+// that the time is within [start, end]
+//
+std::string strip_time(std::string const & msg, std::uint64_t start, std::uint64_t end)
+{
+    unsigned long long seconds(0);
+    unsigned long long nanoseconds(0);
+    int length(0);
+    std::string::size_type const pos(msg.find('['));
+    CATCH_REQUIRE(pos != std::string::npos);
+    CATCH_REQUIRE(sscanf(msg.c_str() + pos, "[%llu.%9llu] %n", &seconds, &nanoseconds, &length) == 2);
+    CATCH_REQUIRE(msg.compare(pos + length - 2, 2, "] ") == 0);
+    std::uint64_t const time_ns(seconds * 1'000'000'000ULL + nanoseconds);
+    CATCH_REQUIRE(time_ns >= start);
+    CATCH_REQUIRE(time_ns <= end);
+    return msg.substr(0, pos) + msg.substr(pos + length);
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("fast_log", "[log]")
+{
+    CATCH_START_SECTION("fast_log: arguments get formatted on flush")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::fast_log_flush();
+
+        static cppthread::fast_log_site const numbers(
+                  cppthread::log_level_t::info
+                , "int {} unsigned {} double {} char {} bool {}");
+        static cppthread::fast_log_site const strings(
+                  cppthread::log_level_t::warning
+                , "[{}] [{}] [{}]");
+        static cppthread::fast_log_site const extra(
+                  cppthread::log_level_t::error
+                , "extra:"
+                , __FILE__
+                , __LINE__);
+
+        std::string const name("std::string");
+        char const * missing(nullptr);
+        std::uint64_t const start(now_ns());
+        cppthread::fast_log(numbers, -33, 45u, 1.5, 'q', true);
+        cppthread::fast_log(strings, "literal", name, missing);
+        cppthread::fast_log(extra, 1, std::string_view("two"), false);
+        cppthread::fast_log(numbers, 7);
+        std::uint64_t const end(now_ns());
+
+        // nothing gets formatted until the rings are flushed, the messages
+        // still show the time of the fast_log() calls
+        //
+        CATCH_REQUIRE(g_messages.empty());
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CATCH_REQUIRE(cppthread::fast_log_flush() == 4);
+
+        for(auto & msg : g_messages)
+        {
+            msg = strip_time(msg, start, end);
+        }
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "info: int -33 unsigned 45 double 1.5 char q bool true"
+                , "warning: [literal] [std::string] [(null)]"
+                , "error: extra: 1 two false"
+                , "info: int 7 unsigned {} double {} char {} bool {}"
+            }));
+        CATCH_REQUIRE(extra.get_line() != 0);
+        CATCH_REQUIRE(cppthread::fast_log_site::get_site(extra.get_id()) == &extra);
+
+        CATCH_REQUIRE(cppthread::fast_log_flush() == 0);
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fast_log: enumerations use their underlying type")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::fast_log_flush();
+
+        static cppthread::fast_log_site const enums(
+                  cppthread::log_level_t::info
+                , "char {} int {} after {} {}");
+
+        // the space reserved matches what gets encoded
+        //
+        CATCH_REQUIRE(cppthread::detail::fast_log_size(char_enum_t::CHAR_ENUM_B) == 1 + 1);
+        CATCH_REQUIRE(cppthread::detail::fast_log_size(int_enum_t::INT_ENUM_TWO) == 1 + 8);
+
+        std::uint64_t const start(now_ns());
+        cppthread::fast_log(
+                  enums
+                , char_enum_t::CHAR_ENUM_B
+                , int_enum_t::INT_ENUM_TWO
+                , 3
+                , "four");
+        cppthread::fast_log(enums, char_enum_t::CHAR_ENUM_A, "end");
+        std::uint64_t const end(now_ns());
+        CATCH_REQUIRE(cppthread::fast_log_flush() == 2);
+
+        for(auto & msg : g_messages)
+        {
+            msg = strip_time(msg, start, end);
+        }
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "info: char b int 2 after 3 four"
+                , "info: char a int end after {} {}"
+            }));
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fast_log: the writer formats messages from many threads")
+    {
+        constexpr int const THREADS = 4;
+        constexpr int const MESSAGES = 500;
+
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        std::uint64_t const dropped(cppthread::fast_log_dropped());
+
+        static cppthread::fast_log_site const site(
+                  cppthread::log_level_t::debug
+                , "thread {} message {}");
+
+        {
+            cppthread::fast_log_writer writer(std::chrono::milliseconds(1));
+
+            std::vector<std::thread> threads;
+            for(int t(0); t < THREADS; ++t)
+            {
+                threads.emplace_back([t]()
+                    {
+                        for(int m(0); m < MESSAGES; ++m)
+                        {
+                            cppthread::fast_log(site, t, m);
+                        }
+                    });
+            }
+            for(auto & t : threads)
+            {
+                t.join();
+            }
+
+            // the writer flushes the messages left over when destroyed
+        }
+
+        CATCH_REQUIRE(cppthread::fast_log_dropped() == dropped);
+
+        // the writer thread also logs its own start and stop
+        //
+        std::vector<int> next(THREADS, 0);
+        for(auto const & msg : g_messages)
+        {
+            int t(-1);
+            int m(-1);
+            if(sscanf(msg.c_str(), "debug: [%*u.%*u] thread %d message %d", &t, &m) != 2)
+            {
+                continue;
+            }
+            CATCH_REQUIRE(t >= 0);
+            CATCH_REQUIRE(t < THREADS);
+            CATCH_REQUIRE(m == next[t]);
+            ++next[t];
+        }
+        CATCH_REQUIRE(next == std::vector<int>(THREADS, MESSAGES));
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("fast_log: a full ring drops messages")
+    {
+        constexpr int const MESSAGES = 10'000;
+
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::fast_log_flush();
+        std::uint64_t const dropped(cppthread::fast_log_dropped());
+
+        static cppthread::fast_log_site const site(
+                  cppthread::log_level_t::info
+                , "{} {}");
+
+        std::uint64_t const start(now_ns());
+        for(int m(0); m < MESSAGES; ++m)
+        {
+            cppthread::fast_log(site, m, "a string to fill the ring faster");
+        }
+        std::uint64_t const end(now_ns());
+        std::size_t const count(cppthread::fast_log_flush());
+
+        CATCH_REQUIRE(count < MESSAGES);
+        CATCH_REQUIRE(count + cppthread::fast_log_dropped() - dropped == MESSAGES);
+        CATCH_REQUIRE(g_messages.size() == count);
+        CATCH_REQUIRE(strip_time(g_messages[0], start, end) == "info: 0 a string to fill the ring faster");
+
+        // once flushed there is room again, including after the padding
+        // record at the end of the buffer
+        //
+        for(int m(0); m < 10; ++m)
+        {
+            std::uint64_t const before(now_ns());
+            cppthread::fast_log(site, m, m + 1);
+            std::uint64_t const after(now_ns());
+            CATCH_REQUIRE(cppthread::fast_log_flush() == 1);
+            CATCH_REQUIRE(strip_time(g_messages.back(), before, after)
+                            == "info: " + std::to_string(m) + " " + std::to_string(m + 1));
+        }
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,148 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/io_executor.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+void read_and_write(cppthread::io_executor & io)
+{
+    constexpr int const BLOCKS = 100;
+    constexpr std::size_t const BLOCK_SIZE = 512;
+
+    char filename[] = "/tmp/cppthread-io-executor-XXXXXX";
+    int const fd(mkstemp(filename));
+    CATCH_REQUIRE(fd != -1);
+    unlink(filename);
+
+    // write all the blocks at once, in reverse order
+    //
+    std::vector<std::vector<char>> blocks(BLOCKS);
+    std::vector<std::future<std::int64_t>> writes;
+    for(int b(BLOCKS - 1); b >= 0; --b)
+    {
+        blocks[b].resize(BLOCK_SIZE, static_cast<char>('A' + b % 26));
+        writes.push_back(io.write(fd, blocks[b].data(), BLOCK_SIZE, b * BLOCK_SIZE));
+    }
+    for(auto & w : writes)
+    {
+        CATCH_REQUIRE(w.get() == static_cast<std::int64_t>(BLOCK_SIZE));
+    }
+    CATCH_REQUIRE(io.fsync(fd).get() == 0);
+
+    // read them back with completions going to a fifo
+    //
+    cppthread::io_request::fifo_t::pointer_t completed(std::make_shared<cppthread::io_request::fifo_t>());
+    std::vector<std::vector<char>> read_back(BLOCKS, std::vector<char>(BLOCK_SIZE));
+    for(int b(0); b < BLOCKS; ++b)
+    {
+        cppthread::io_request::pointer_t r(std::make_shared<cppthread::io_request>(
+                  cppthread::io_operation_t::IO_OPERATION_READ
+                , fd
+                , read_back[b].data()
+                , BLOCK_SIZE
+                , b * BLOCK_SIZE));
+        r->set_completion_fifo(completed);
+        io.submit(r);
+    }
+    for(int b(0); b < BLOCKS; ++b)
+    {
+        cppthread::io_request::pointer_t r;
+        CATCH_REQUIRE(completed->pop_front(r, 10'000'000));
+        CATCH_REQUIRE(r->is_done());
+        CATCH_REQUIRE(r->get_result() == static_cast<std::int64_t>(BLOCK_SIZE));
+    }
+    CATCH_REQUIRE(io.drain(10'000'000));
+    CATCH_REQUIRE(read_back == blocks);
+
+    // reading past the end returns 0
+    //
+    char c(0);
+    CATCH_REQUIRE(io.read(fd, &c, 1, BLOCKS * BLOCK_SIZE).get() == 0);
+
+    close(fd);
+
+    // errors are returned as a negated errno
+    //
+    CATCH_REQUIRE(io.read(fd, &c, 1, 0).get() == -EBADF);
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("io_executor", "[io_executor]")
+{
+    CATCH_START_SECTION("io_executor: read and write with io_uring if available")
+    {
+        cppthread::io_executor io("io", 8);
+        read_and_write(io);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("io_executor: read and write with the thread pool")
+    {
+        cppthread::io_executor io("io", 8, 2, false);
+        CATCH_REQUIRE_FALSE(io.is_io_uring());
+        read_and_write(io);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("io_executor: pending requests run before the executor exits")
+    {
+        int const fd(open("/dev/null", O_WRONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd != -1);
+        char const buffer[16] = {};
+        std::vector<std::future<std::int64_t>> writes;
+        {
+            cppthread::io_executor io("io", 4);
+            for(int i(0); i < 50; ++i)
+            {
+                writes.push_back(io.write(fd, buffer, sizeof(buffer), 0));
+            }
+        }
+        for(auto & w : writes)
+        {
+            CATCH_REQUIRE(w.get() == static_cast<std::int64_t>(sizeof(buffer)));
+        }
+        close(fd);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
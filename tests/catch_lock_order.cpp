@@ -0,0 +1,194 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// the lock order checker only exists in Debug builds with the
+// CPPTHREAD_LOCK_ORDER_CHECK option turned on
+//
+#ifdef CPPTHREAD_LOCK_ORDER_CHECK
+
+// cppthread lib
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/log.h>
+#include    <cppthread/mutex.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <sstream>
+
+
+
+namespace
+{
+
+
+std::vector<std::string>    g_errors;
+
+
+void collect_errors(cppthread::log_level_t level, std::string && message)
+{
+    if(level == cppthread::log_level_t::error
+    && message.find("lock order inversion") != std::string::npos)
+    {
+        g_errors.push_back(message);
+    }
+}
+
+
+std::string lock_name(cppthread::mutex const & m)
+{
+    std::stringstream ss;
+    ss << '"' << m.get_name() << "\" (" << static_cast<void const *>(&m) << ')';
+    return ss.str();
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("lock_order", "[mutex]")
+{
+    CATCH_START_SECTION("lock_order: same order does not get reported")
+    {
+        g_errors.clear();
+        cppthread::set_log_callback(collect_errors);
+
+        cppthread::mutex a;
+        a.set_name("order::a");
+        cppthread::mutex b;
+        b.set_name("order::b");
+
+        for(int i(0); i < 3; ++i)
+        {
+            cppthread::guard lock_a(a);
+            cppthread::guard lock_b(b);
+        }
+
+        CATCH_REQUIRE(g_errors.empty());
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("lock_order: A -> B then B -> A is an inversion")
+    {
+        g_errors.clear();
+        cppthread::set_log_callback(collect_errors);
+
+        cppthread::mutex a;
+        a.set_name("inversion::a");
+        cppthread::mutex b;
+        b.set_name("inversion::b");
+
+        {
+            cppthread::guard lock_a(a);
+            cppthread::guard lock_b(b);
+        }
+        CATCH_REQUIRE(g_errors.empty());
+
+        // no deadlock happens since a single thread is involved, the
+        // checker still detects the inversion
+        //
+        {
+            cppthread::guard lock_b(b);
+            cppthread::guard lock_a(a);
+        }
+
+        CATCH_REQUIRE(g_errors == std::vector<std::string>({
+                  "lock order inversion: locking "
+                + lock_name(a)
+                + " while holding "
+                + lock_name(b)
+                + " can deadlock; cycle: "
+                + lock_name(b)
+                + " -> "
+                + lock_name(a)
+                + " -> "
+                + lock_name(b)
+            }));
+
+        // each inversion is reported only once
+        //
+        {
+            cppthread::guard lock_b(b);
+            cppthread::guard lock_a(a);
+        }
+        CATCH_REQUIRE(g_errors.size() == 1);
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("lock_order: A -> B -> C -> A is a cycle")
+    {
+        g_errors.clear();
+        cppthread::set_log_callback(collect_errors);
+
+        cppthread::mutex a;
+        a.set_name("cycle::a");
+        cppthread::mutex b;
+        b.set_name("cycle::b");
+        cppthread::mutex c;
+        c.set_name("cycle::c");
+
+        {
+            cppthread::guard lock_a(a);
+            cppthread::guard lock_b(b);
+        }
+        {
+            cppthread::guard lock_b(b);
+            cppthread::guard lock_c(c);
+        }
+        CATCH_REQUIRE(g_errors.empty());
+
+        {
+            cppthread::guard lock_c(c);
+            cppthread::guard lock_a(a);
+        }
+
+        CATCH_REQUIRE(g_errors == std::vector<std::string>({
+                  "lock order inversion: locking "
+                + lock_name(a)
+                + " while holding "
+                + lock_name(c)
+                + " can deadlock; cycle: "
+                + lock_name(c)
+                + " -> "
+                + lock_name(a)
+                + " -> "
+                + lock_name(b)
+                + " -> "
+                + lock_name(c)
+            }));
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+}
+
+
+#endif
+// vim: ts=4 sw=4 et
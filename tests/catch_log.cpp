@@ -0,0 +1,328 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/log.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/latch.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <mutex>
+#include    <thread>
+
+
+
+namespace
+{
+
+
+std::mutex                  g_messages_mutex;
+std::vector<std::string>    g_messages;
+
+
+void collect_messages(cppthread::log_level_t level, std::string const & message)
+{
+    std::lock_guard<std::mutex> lock(g_messages_mutex);
+    g_messages.push_back(cppthread::to_string(level) + ": " + message);
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("log", "[log]")
+{
+    CATCH_START_SECTION("log: threads build their messages in parallel")
+    {
+        constexpr int const THREADS = 4;
+        constexpr int const MESSAGES = 1'000;
+
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::log.reset_counters();
+
+        std::vector<std::thread> threads;
+        for(int t(0); t < THREADS; ++t)
+        {
+            threads.emplace_back([t]()
+                {
+                    for(int m(0); m < MESSAGES; ++m)
+                    {
+                        cppthread::log << cppthread::log_level_t::debug
+                                       << "thread "
+                                       << t;
+                        std::this_thread::yield();
+                        cppthread::log << " message "
+                                       << m
+                                       << cppthread::end;
+                    }
+                });
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+
+        CATCH_REQUIRE(g_messages.size() == THREADS * MESSAGES);
+        CATCH_REQUIRE(cppthread::log.get_counter(cppthread::log_level_t::debug) == THREADS * MESSAGES);
+
+        // the parts of a message never get mixed with another thread's
+        //
+        std::vector<int> next(THREADS, 0);
+        for(auto const & msg : g_messages)
+        {
+            int t(-1);
+            int m(-1);
+            CATCH_REQUIRE(sscanf(msg.c_str(), "debug: thread %d message %d", &t, &m) == 2);
+            CATCH_REQUIRE(t >= 0);
+            CATCH_REQUIRE(t < THREADS);
+            CATCH_REQUIRE(m == next[t]);
+            ++next[t];
+        }
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: a half built message does not block other threads")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::log.reset_counters();
+
+        cppthread::latch started(1);
+        cppthread::latch resume(1);
+        std::thread slow([&]()
+            {
+                cppthread::log << cppthread::log_level_t::warning << "slow ";
+                started.count_down();
+                resume.wait();
+                cppthread::log << "message" << cppthread::end;
+            });
+        started.wait();
+
+        cppthread::log << cppthread::log_level_t::error << "fast message" << cppthread::end;
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({ "error: fast message" }));
+
+        resume.count_down();
+        slow.join();
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({ "error: fast message", "warning: slow message" }));
+        CATCH_REQUIRE(cppthread::log.get_errors() == 1);
+        CATCH_REQUIRE(cppthread::log.get_warnings() == 1);
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: repeated messages get folded")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::log.reset_counters();
+        cppthread::logger::set_fold_repeated(true);
+
+        for(int i(0); i < 5; ++i)
+        {
+            cppthread::log << cppthread::log_level_t::error << "disk is full" << cppthread::end;
+        }
+        cppthread::log << cppthread::log_level_t::warning << "disk is full" << cppthread::end;
+        cppthread::log << cppthread::log_level_t::info << "disk was cleaned" << cppthread::end;
+
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "error: disk is full"
+                , "error: last message repeated 4 times."
+                , "warning: disk is full"
+                , "info: disk was cleaned"
+            }));
+        CATCH_REQUIRE(cppthread::log.get_repeated() == 4);
+
+        // only the messages sent out are counted
+        //
+        CATCH_REQUIRE(cppthread::log.get_errors() == 1);
+        CATCH_REQUIRE(cppthread::log.get_warnings() == 1);
+        CATCH_REQUIRE(cppthread::log.get_counter(cppthread::log_level_t::info) == 1);
+
+        // folding is off by default
+        //
+        g_messages.clear();
+        cppthread::logger::set_fold_repeated(false);
+        cppthread::log << cppthread::log_level_t::info << "disk was cleaned" << cppthread::end;
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({ "info: disk was cleaned" }));
+        CATCH_REQUIRE(cppthread::log.get_repeated() == 4);
+        CATCH_REQUIRE(cppthread::log.get_counter(cppthread::log_level_t::info) == 2);
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: a call site can be rate limited")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::log.reset_counters();
+
+        cppthread::log_limiter limiter(3, std::chrono::hours(1));
+        for(int i(0); i < 10; ++i)
+        {
+            cppthread::log << limiter
+                           << cppthread::log_level_t::error
+                           << "limited message #"
+                           << i
+                           << cppthread::end;
+        }
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "error: limited message #0"
+                , "error: limited message #1"
+                , "error: limited message #2"
+            }));
+        CATCH_REQUIRE(limiter.get_suppressed() == 7);
+        CATCH_REQUIRE(cppthread::log.get_rate_limited() == 7);
+        CATCH_REQUIRE(cppthread::log.get_errors() == 3);
+
+        // once a token is available again, the next message says how
+        // many were suppressed
+        //
+        g_messages.clear();
+        cppthread::log_limiter fast(1, std::chrono::milliseconds(200));
+        for(int i(0); i < 4; ++i)
+        {
+            cppthread::log << fast
+                           << cppthread::log_level_t::warning
+                           << "fast message #"
+                           << i
+                           << cppthread::end;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        cppthread::log << fast
+                       << cppthread::log_level_t::warning
+                       << "fast message #4"
+                       << cppthread::end;
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "warning: fast message #0"
+                , "warning: fast message #4 (3 similar messages suppressed)"
+            }));
+        CATCH_REQUIRE(fast.get_suppressed() == 3);
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: the callback can capture state and take the message")
+    {
+        std::vector<std::pair<cppthread::log_level_t, std::string>> received;
+        cppthread::set_log_callback(
+            [&received](cppthread::log_level_t level, std::string && message)
+            {
+                received.emplace_back(level, std::move(message));
+            });
+
+        cppthread::log << cppthread::log_level_t::info << "captured #" << 1 << cppthread::end;
+        cppthread::log << cppthread::log_level_t::error << "captured #" << 2 << cppthread::end;
+
+        CATCH_REQUIRE(received.size() == 2);
+        CATCH_REQUIRE(received[0].first == cppthread::log_level_t::info);
+        CATCH_REQUIRE(received[0].second == "captured #1");
+        CATCH_REQUIRE(received[1].first == cppthread::log_level_t::error);
+        CATCH_REQUIRE(received[1].second == "captured #2");
+
+        // a callback can replace itself while running
+        //
+        int calls(0);
+        cppthread::set_log_callback(
+            [&calls](cppthread::log_level_t, std::string &&)
+            {
+                ++calls;
+                cppthread::set_log_callback(nullptr);
+            });
+        cppthread::log << cppthread::log_level_t::debug << "replace the callback" << cppthread::end;
+        cppthread::log << cppthread::log_level_t::debug << "sent to std::cerr" << cppthread::end;
+        CATCH_REQUIRE(calls == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: a thread can have its own callback")
+    {
+        g_messages.clear();
+        cppthread::set_log_callback(collect_messages);
+        cppthread::logger::set_fold_repeated(true);
+
+        std::vector<std::string> mine;
+        std::thread t([&mine]()
+            {
+                cppthread::set_thread_log_callback(
+                    [&mine](cppthread::log_level_t, std::string && message)
+                    {
+                        mine.push_back(std::move(message));
+
+                        // messages logged by the thread callback go to
+                        // the global callback
+                        //
+                        cppthread::log << cppthread::log_level_t::debug
+                                       << "forwarded "
+                                       << mine.back()
+                                       << cppthread::end;
+                    });
+                cppthread::log << cppthread::log_level_t::info << "thread message #1" << cppthread::end;
+                cppthread::log << cppthread::log_level_t::info << "thread message #1" << cppthread::end;
+
+                cppthread::set_thread_log_callback(nullptr);
+                cppthread::log << cppthread::log_level_t::info << "thread message #2" << cppthread::end;
+            });
+        t.join();
+        cppthread::log << cppthread::log_level_t::info << "main thread message" << cppthread::end;
+
+        cppthread::logger::set_fold_repeated(false);
+
+        // the thread callback gets every message, even repeated ones
+        //
+        CATCH_REQUIRE(mine == std::vector<std::string>({ "thread message #1", "thread message #1" }));
+        CATCH_REQUIRE(g_messages == std::vector<std::string>({
+                  "debug: forwarded thread message #1"
+                , "debug: last message repeated 1 time."
+                , "info: thread message #2"
+                , "info: main thread message"
+            }));
+
+        cppthread::set_log_callback(nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("log: invalid limiter")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::log_limiter(0)
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: log_limiter: the rate must be at least 1."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
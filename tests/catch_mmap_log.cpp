@@ -0,0 +1,234 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/mmap_log.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <thread>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+std::string temporary_file()
+{
+    char filename[] = "/tmp/cppthread-mmap-log-XXXXXX";
+    int const fd(mkstemp(filename));
+    CATCH_REQUIRE(fd != -1);
+    close(fd);
+    return filename;
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("mmap_log", "[log]")
+{
+    CATCH_START_SECTION("mmap_log: messages can be read back")
+    {
+        std::string const filename(temporary_file());
+
+        {
+            cppthread::mmap_log_sink sink(filename, 4096);
+            CATCH_REQUIRE(sink.get_filename() == filename);
+            CATCH_REQUIRE(sink.get_size() == 4096);
+
+            sink.append(cppthread::log_level_t::info, "first message");
+            sink.append(cppthread::log_level_t::error, "second message");
+            sink.append(cppthread::log_level_t::debug, std::string());
+            sink.sync();
+
+            // the file can be read while the sink is still open
+            //
+            cppthread::mmap_log_entries_t const entries(cppthread::read_mmap_log(filename));
+            CATCH_REQUIRE(entries.size() == 3);
+            CATCH_REQUIRE(entries[0].f_level == cppthread::log_level_t::info);
+            CATCH_REQUIRE(entries[0].f_message == "first message");
+            CATCH_REQUIRE(entries[1].f_level == cppthread::log_level_t::error);
+            CATCH_REQUIRE(entries[1].f_message == "second message");
+            CATCH_REQUIRE(entries[2].f_level == cppthread::log_level_t::debug);
+            CATCH_REQUIRE(entries[2].f_message.empty());
+            for(auto const & e : entries)
+            {
+                CATCH_REQUIRE(e.f_complete);
+                CATCH_REQUIRE(e.f_tid == cppthread::gettid());
+                CATCH_REQUIRE(e.f_time_ns != 0);
+            }
+        }
+
+        // opening the file again keeps the existing messages
+        //
+        {
+            cppthread::mmap_log_sink sink(filename, 4096);
+            sink.append(cppthread::log_level_t::warning, "after reopening");
+        }
+        cppthread::mmap_log_entries_t const entries(cppthread::read_mmap_log(filename));
+        CATCH_REQUIRE(entries.size() == 4);
+        CATCH_REQUIRE(entries[0].f_message == "first message");
+        CATCH_REQUIRE(entries[3].f_message == "after reopening");
+
+        // a different size starts a new log
+        //
+        {
+            cppthread::mmap_log_sink sink(filename, 8192);
+        }
+        CATCH_REQUIRE(cppthread::read_mmap_log(filename).empty());
+
+        unlink(filename.c_str());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mmap_log: threads append to a wrapping ring")
+    {
+        constexpr int const THREADS = 4;
+        constexpr int const MESSAGES = 1'000;
+
+        std::string const filename(temporary_file());
+        cppthread::mmap_log_sink sink(filename, 16 * 1024);
+
+        std::vector<std::thread> threads;
+        for(int t(0); t < THREADS; ++t)
+        {
+            threads.emplace_back([t, &sink]()
+                {
+                    for(int m(0); m < MESSAGES; ++m)
+                    {
+                        sink.append(
+                              cppthread::log_level_t::info
+                            , "thread " + std::to_string(t) + " message " + std::to_string(m));
+                    }
+                });
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+        sink.append(cppthread::log_level_t::info, "done");
+
+        // only the most recent messages remain, in order for each thread
+        //
+        cppthread::mmap_log_entries_t const entries(cppthread::read_mmap_log(filename));
+        CATCH_REQUIRE(entries.size() > 100);
+        CATCH_REQUIRE(entries.size() < THREADS * MESSAGES);
+        CATCH_REQUIRE(entries.back().f_message == "done");
+
+        std::vector<int> last(THREADS, -1);
+        std::uint64_t position(0);
+        for(std::size_t idx(0); idx < entries.size() - 1; ++idx)
+        {
+            cppthread::mmap_log_entry const & e(entries[idx]);
+            CATCH_REQUIRE(e.f_complete);
+            CATCH_REQUIRE(e.f_position >= position);
+            position = e.f_position;
+
+            int t(-1);
+            int m(-1);
+            CATCH_REQUIRE(sscanf(e.f_message.c_str(), "thread %d message %d", &t, &m) == 2);
+            CATCH_REQUIRE(t >= 0);
+            CATCH_REQUIRE(t < THREADS);
+            CATCH_REQUIRE(m > last[t]);
+            last[t] = m;
+        }
+
+        // the thread which finished last has its last message in the ring
+        //
+        CATCH_REQUIRE(std::find(last.begin(), last.end(), MESSAGES - 1) != last.end());
+
+        unlink(filename.c_str());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mmap_log: install the sink as the log callback")
+    {
+        std::string const filename(temporary_file());
+
+        {
+            cppthread::mmap_log_sink sink(filename, 4096);
+            sink.install();
+            cppthread::log << cppthread::log_level_t::warning
+                           << "sent to the file "
+                           << 123
+                           << cppthread::end;
+
+            // destroying the sink uninstalls it
+        }
+        cppthread::log << cppthread::log_level_t::debug
+                       << "not sent to the file"
+                       << cppthread::end;
+
+        cppthread::mmap_log_entries_t const entries(cppthread::read_mmap_log(filename));
+        CATCH_REQUIRE(entries.size() == 1);
+        CATCH_REQUIRE(entries[0].f_level == cppthread::log_level_t::warning);
+        CATCH_REQUIRE(entries[0].f_message == "sent to the file 123");
+
+        unlink(filename.c_str());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mmap_log: errors")
+    {
+        std::string const filename(temporary_file());
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::mmap_log_sink(filename, 5000)
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: mmap_log_sink: the size (5000) must be a power of two of at least 4096."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::read_mmap_log(filename)
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: read_mmap_log: \"" + filename + "\" is not a log file."));
+
+        unlink(filename.c_str());
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::read_mmap_log(filename)
+                , cppthread::system_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: read_mmap_log: could not open \"" + filename + "\": No such file or directory"));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,399 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/mutex.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/log.h>
+#include    <cppthread/multi_guard.h>
+#include    <cppthread/mutex_profiler.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++ lib
+//
+#include    <sstream>
+
+
+// C lib
+//
+#include    <signal.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+cppthread::mutex_profile_t find_profile(std::string const & name)
+{
+    cppthread::mutex_profiles_t const profiles(cppthread::get_mutex_profiles());
+    for(auto const & p : profiles)
+    {
+        if(p.f_name == name)
+        {
+            return p;
+        }
+    }
+    return cppthread::mutex_profile_t();
+}
+
+
+class hold_runner
+    : public cppthread::runner
+{
+public:
+    hold_runner(cppthread::mutex & m)
+        : runner("hold-runner")
+        , f_held_mutex(m)
+    {
+    }
+
+    virtual void run() override
+    {
+        cppthread::guard lock(f_held_mutex);
+        f_locked = true;
+        usleep(100'000);
+    }
+
+    cppthread::mutex &  f_held_mutex;
+    std::atomic<bool>   f_locked = false;
+};
+
+
+class transfer_runner
+    : public cppthread::runner
+{
+public:
+    transfer_runner(cppthread::mutex & from, cppthread::mutex & to, int & counter)
+        : runner("transfer-runner")
+        , f_from(from)
+        , f_to(to)
+        , f_counter(counter)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < 10'000; ++i)
+        {
+            cppthread::multi_guard lock(f_from, f_to);
+            ++f_counter;
+        }
+    }
+
+    cppthread::mutex &  f_from;
+    cppthread::mutex &  f_to;
+    int &               f_counter;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("mutex_profiler", "[mutex]")
+{
+    CATCH_START_SECTION("mutex_profiler: name a mutex")
+    {
+        cppthread::mutex m;
+        CATCH_REQUIRE(m.get_name().empty());
+
+        m.set_name("test::name");
+        CATCH_REQUIRE(m.get_name() == "test::name");
+        CATCH_REQUIRE(find_profile("test::name").f_name == "test::name");
+
+        m.set_name("test::renamed");
+        CATCH_REQUIRE(m.get_name() == "test::renamed");
+        CATCH_REQUIRE(find_profile("test::name").f_name.empty());
+        CATCH_REQUIRE(find_profile("test::renamed").f_name == "test::renamed");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_profiler: a destroyed mutex is not listed anymore")
+    {
+        {
+            cppthread::mutex m;
+            m.set_name("test::destroyed");
+            CATCH_REQUIRE(find_profile("test::destroyed").f_name == "test::destroyed");
+        }
+        CATCH_REQUIRE(find_profile("test::destroyed").f_name.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_profiler: disabled profiler does not count")
+    {
+        CATCH_REQUIRE_FALSE(cppthread::is_mutex_profiling_enabled());
+
+        cppthread::mutex m;
+        m.set_name("test::disabled");
+        for(int i(0); i < 10; ++i)
+        {
+            cppthread::guard lock(m);
+        }
+        {
+            cppthread::guard lock(m);
+            CATCH_REQUIRE_FALSE(m.timed_wait(1'000));
+        }
+        CATCH_REQUIRE(find_profile("test::disabled").f_acquisitions == 0);
+        CATCH_REQUIRE(find_profile("test::disabled").f_condition_waits == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_profiler: count acquisitions and waits")
+    {
+        cppthread::mutex m;
+        m.set_name("test::acquisitions");
+
+        cppthread::enable_mutex_profiling();
+        CATCH_REQUIRE(cppthread::is_mutex_profiling_enabled());
+
+        for(int i(0); i < 10; ++i)
+        {
+            cppthread::guard lock(m);
+        }
+        CATCH_REQUIRE(m.try_lock());
+        m.unlock();
+        {
+            cppthread::guard lock(m);
+            CATCH_REQUIRE_FALSE(m.timed_wait(1'000));
+        }
+
+        cppthread::enable_mutex_profiling(false);
+
+        cppthread::mutex_profile_t profile(find_profile("test::acquisitions"));
+        CATCH_REQUIRE(profile.f_acquisitions == 12);
+        CATCH_REQUIRE(profile.f_contended == 0);
+        CATCH_REQUIRE(profile.f_total_wait_ns == 0);
+        CATCH_REQUIRE(profile.f_condition_waits == 1);
+        CATCH_REQUIRE(profile.f_condition_wait_ns >= 1'000'000);
+
+        std::stringstream ss;
+        cppthread::dump_mutex_profiles(ss);
+        CATCH_REQUIRE(ss.str().find("test::acquisitions") != std::string::npos);
+
+        cppthread::reset_mutex_profiles();
+        profile = find_profile("test::acquisitions");
+        CATCH_REQUIRE(profile.f_acquisitions == 0);
+        CATCH_REQUIRE(profile.f_condition_waits == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_profiler: contended lock")
+    {
+        cppthread::mutex m;
+        m.set_name("test::contended");
+
+        cppthread::enable_mutex_profiling();
+
+        hold_runner r(m);
+        cppthread::thread t("hold-thread", &r);
+        t.start();
+        while(!r.f_locked)
+        {
+            usleep(1'000);
+        }
+        {
+            cppthread::guard lock(m);
+        }
+        t.stop();
+
+        cppthread::enable_mutex_profiling(false);
+
+        cppthread::mutex_profile_t const profile(find_profile("test::contended"));
+        CATCH_REQUIRE(profile.f_acquisitions == 2);
+        CATCH_REQUIRE(profile.f_contended == 1);
+        CATCH_REQUIRE(profile.f_total_wait_ns > 0);
+        CATCH_REQUIRE(profile.f_max_wait_ns == profile.f_total_wait_ns);
+        CATCH_REQUIRE(profile.f_max_hold_ns >= 50'000'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_profiler: a signal gets the reporter thread to log a report")
+    {
+        cppthread::mutex m;
+        m.set_name("test::signal");
+
+        std::atomic<bool> reported(false);
+        cppthread::set_log_callback(
+            [&reported](cppthread::log_level_t level, std::string && message)
+            {
+                if(level == cppthread::log_level_t::info
+                && message.find("test::signal") != std::string::npos)
+                {
+                    reported = true;
+                }
+            });
+
+        cppthread::set_mutex_profiling_signal(SIGUSR2);
+        CATCH_REQUIRE(raise(SIGUSR2) == 0);
+
+        // no mutex gets locked here, the report comes from another thread
+        //
+        for(int i(0); i < 5'000 && !reported; ++i)
+        {
+            usleep(1'000);
+        }
+        CATCH_REQUIRE(reported);
+
+        cppthread::set_log_callback(nullptr);
+        signal(SIGUSR2, SIG_DFL);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("mutex_timed_lock", "[mutex][guard]")
+{
+    CATCH_START_SECTION("mutex_timed_lock: lock available")
+    {
+        cppthread::mutex m;
+        CATCH_REQUIRE(m.try_lock_for(std::chrono::milliseconds(10)));
+        m.unlock();
+
+        CATCH_REQUIRE(m.try_lock_until(std::chrono::steady_clock::now()));
+        m.unlock();
+
+        {
+            cppthread::guard lock(m, std::chrono::milliseconds(10));
+            CATCH_REQUIRE(lock.is_locked());
+        }
+        CATCH_REQUIRE(m.try_lock());
+        m.unlock();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("mutex_timed_lock: lock held by another thread")
+    {
+        cppthread::mutex m;
+
+        hold_runner r(m);
+        cppthread::thread t("hold-thread", &r);
+        t.start();
+        while(!r.f_locked)
+        {
+            usleep(1'000);
+        }
+
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        CATCH_REQUIRE_FALSE(m.try_lock_for(std::chrono::milliseconds(10)));
+        CATCH_REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+
+        {
+            cppthread::guard lock(m, std::chrono::milliseconds(1));
+            CATCH_REQUIRE_FALSE(lock.is_locked());
+            lock.lock();
+            CATCH_REQUIRE_FALSE(lock.is_locked());
+        }
+
+        // the runner holds the lock for 100ms
+        //
+        CATCH_REQUIRE(m.try_lock_for(std::chrono::seconds(5)));
+        m.unlock();
+
+        t.stop();
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("multi_guard", "[mutex][guard]")
+{
+    CATCH_START_SECTION("multi_guard: lock and unlock several mutexes")
+    {
+        cppthread::mutex a;
+        cppthread::mutex b;
+        cppthread::mutex c;
+        {
+            cppthread::multi_guard lock({ &c, &a, &b, &a });
+            CATCH_REQUIRE(lock.is_locked());
+
+            lock.unlock();
+            CATCH_REQUIRE_FALSE(lock.is_locked());
+            lock.unlock();
+            CATCH_REQUIRE_FALSE(lock.is_locked());
+
+            lock.lock();
+            CATCH_REQUIRE(lock.is_locked());
+            lock.lock();
+            CATCH_REQUIRE(lock.is_locked());
+        }
+
+        // the destructor unlocked all the mutexes exactly once
+        //
+        CATCH_REQUIRE(a.try_lock());
+        a.unlock();
+        CATCH_REQUIRE(b.try_lock());
+        b.unlock();
+        CATCH_REQUIRE(c.try_lock());
+        c.unlock();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("multi_guard: opposite orders do not deadlock")
+    {
+        cppthread::mutex a;
+        cppthread::mutex b;
+        int counter(0);
+
+        transfer_runner r1(a, b, counter);
+        transfer_runner r2(b, a, counter);
+        cppthread::thread t1("transfer-1", &r1);
+        cppthread::thread t2("transfer-2", &r2);
+        t1.start();
+        t2.start();
+        t1.stop();
+        t2.stop();
+
+        CATCH_REQUIRE(counter == 20'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("multi_guard: invalid parameters")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::multi_guard(cppthread::multi_guard::mutexes_t())
+                , cppthread::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: multi_guard() requires at least one mutex"));
+
+        cppthread::mutex a;
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::multi_guard({ &a, nullptr })
+                , cppthread::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: mutex missing in multi_guard() constructor"));
+        CATCH_REQUIRE(a.try_lock());
+        a.unlock();
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,335 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/pool.h>
+
+#include    <cppthread/worker.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+struct work_t
+{
+    int                 f_value = 0;
+};
+
+
+std::atomic<int>    g_processed(0);
+
+
+class counting_worker
+    : public cppthread::worker<work_t>
+{
+public:
+    counting_worker(
+              std::string const & name
+            , std::size_t position
+            , cppthread::fifo<work_t>::pointer_t in
+            , cppthread::fifo<work_t>::pointer_t out)
+        : worker<work_t>(name, position, in, out)
+    {
+    }
+
+    virtual bool do_work() override
+    {
+        if((f_workload.f_value & 7) == 0)
+        {
+            usleep(100);
+        }
+        f_workload.f_value *= 2;
+        ++g_processed;
+        return true;
+    }
+};
+
+
+typedef cppthread::pool<counting_worker>    counting_pool_t;
+
+
+class int_waiter
+    : public cppthread::fifo<int>::pop_waiter
+{
+public:
+    virtual void ready() override
+    {
+        f_ready = true;
+    }
+
+    bool is_ready() const
+    {
+        return f_ready;
+    }
+
+    int get_item() const
+    {
+        return f_item;
+    }
+
+private:
+    bool                f_ready = false;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("pool", "[pool]")
+{
+    CATCH_START_SECTION("pool: wait until idle and reuse")
+    {
+        g_processed = 0;
+
+        counting_pool_t::worker_fifo_t::pointer_t in(std::make_shared<counting_pool_t::worker_fifo_t>());
+        counting_pool_t::worker_fifo_t::pointer_t out(std::make_shared<counting_pool_t::worker_fifo_t>());
+        counting_pool_t p("counting", 3, in, out);
+
+        // the pool tracks its input FIFO only
+        //
+        CATCH_REQUIRE(in->is_tracking_unfinished());
+        CATCH_REQUIRE_FALSE(out->is_tracking_unfinished());
+
+        // the output FIFO is not consumed by a worker; track it to verify
+        // our own task_done() calls below
+        //
+        out->track_unfinished();
+
+        // nothing pushed yet, we are already idle
+        //
+        p.wait_idle();
+        CATCH_REQUIRE(in->unfinished() == 0);
+
+        for(int round(1); round <= 3; ++round)
+        {
+            for(int i(0); i < 100; ++i)
+            {
+                p.push_back(work_t{ i });
+            }
+            p.wait_idle();
+
+            CATCH_REQUIRE(g_processed == round * 100);
+            CATCH_REQUIRE(in->empty());
+            CATCH_REQUIRE(in->unfinished() == 0);
+            CATCH_REQUIRE(out->size() == 100);
+            CATCH_REQUIRE(out->unfinished() == 100);
+
+            int sum(0);
+            work_t w;
+            while(p.pop_front(w, 0))
+            {
+                sum += w.f_value;
+                out->task_done();
+            }
+            CATCH_REQUIRE(sum == 99 * 100);
+            CATCH_REQUIRE(out->wait_idle(0));
+        }
+
+        p.stop(false);
+        p.wait();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pool: pause, resume and drain")
+    {
+        g_processed = 0;
+
+        counting_pool_t::worker_fifo_t::pointer_t in(std::make_shared<counting_pool_t::worker_fifo_t>());
+        counting_pool_t p("counting", 3, in, nullptr);
+        CATCH_REQUIRE(p.drain(0));
+        CATCH_REQUIRE_FALSE(p.is_paused());
+
+        for(int i(0); i < 100; ++i)
+        {
+            p.push_back(work_t{ i });
+        }
+        p.pause();
+        CATCH_REQUIRE(p.is_paused());
+
+        // once pause() returns, no worker is busy
+        //
+        for(std::size_t idx(0); idx < p.size(); ++idx)
+        {
+            CATCH_REQUIRE_FALSE(p.get_worker(idx).is_working());
+        }
+        CATCH_REQUIRE(in->unfinished() == in->size());
+
+        int const processed(g_processed);
+        for(int i(0); i < 10; ++i)
+        {
+            p.push_back(work_t{ i });
+        }
+        usleep(10'000);
+        CATCH_REQUIRE(g_processed == processed);
+        CATCH_REQUIRE(in->size() == static_cast<std::size_t>(110 - processed));
+        CATCH_REQUIRE_FALSE(p.drain(1'000));
+
+        p.resume();
+        CATCH_REQUIRE_FALSE(p.is_paused());
+        CATCH_REQUIRE(p.drain(10'000'000));
+        CATCH_REQUIRE(g_processed == 110);
+        CATCH_REQUIRE(in->empty());
+
+        // the pool is still usable after a drain
+        //
+        p.pause();
+        p.push_back(work_t{ 1 });
+        p.resume();
+        CATCH_REQUIRE(p.drain());
+        CATCH_REQUIRE(g_processed == 111);
+
+        // a paused pool still exits once stopped
+        //
+        p.pause();
+        p.push_back(work_t{ 2 });
+        p.stop(false);
+        p.wait();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pool: wait_idle() timeout and task_done() errors")
+    {
+        cppthread::fifo<int> f;
+        CATCH_REQUIRE(f.wait_idle(0));
+
+        // by default a FIFO does not count its items and task_done()
+        // does nothing
+        //
+        f.push_back(1);
+        CATCH_REQUIRE_FALSE(f.is_tracking_unfinished());
+        CATCH_REQUIRE(f.unfinished() == 0);
+        f.task_done();
+        CATCH_REQUIRE(f.unfinished() == 0);
+
+        // the items already in the FIFO get counted
+        //
+        f.track_unfinished();
+        CATCH_REQUIRE(f.is_tracking_unfinished());
+        CATCH_REQUIRE(f.unfinished() == 1);
+
+        f.push_back(2);
+        CATCH_REQUIRE(f.unfinished() == 2);
+        CATCH_REQUIRE_FALSE(f.wait_idle(0));
+        CATCH_REQUIRE_FALSE(f.wait_idle(1'000));
+
+        int v(0);
+        CATCH_REQUIRE(f.pop_front(v, 0));
+        f.task_done();
+        CATCH_REQUIRE(f.unfinished() == 1);
+
+        // clearing the FIFO also removes the unfinished items
+        //
+        f.clear();
+        CATCH_REQUIRE(f.unfinished() == 0);
+        CATCH_REQUIRE(f.wait_idle(0));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  f.task_done()
+                , cppthread::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: fifo::task_done() called more times than items were pushed."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pool: a standalone worker on a plain FIFO")
+    {
+        g_processed = 0;
+
+        counting_pool_t::worker_fifo_t::pointer_t in(std::make_shared<counting_pool_t::worker_fifo_t>());
+        counting_pool_t::worker_fifo_t::pointer_t out(std::make_shared<counting_pool_t::worker_fifo_t>());
+        counting_worker w("standalone", 0, in, out);
+        cppthread::thread t("standalone", &w);
+        CATCH_REQUIRE(t.start());
+
+        for(int i(0); i < 10; ++i)
+        {
+            in->push_back(work_t{ i });
+        }
+        in->done(false);
+
+        int sum(0);
+        for(int i(0); i < 10; ++i)
+        {
+            work_t item;
+            CATCH_REQUIRE(out->pop_front(item, -1));
+            sum += item.f_value;
+        }
+        CATCH_REQUIRE(sum == 9 * 10);
+
+        t.stop();
+        CATCH_REQUIRE(t.get_exception() == nullptr);
+        CATCH_REQUIRE(g_processed == 10);
+        CATCH_REQUIRE_FALSE(in->is_tracking_unfinished());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pool: a null input FIFO")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  counting_pool_t("no_input", 3, nullptr, nullptr)
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: a pool object must be given a valid input FIFO"));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pool: items handed to a waiter are finished")
+    {
+        cppthread::fifo<int> f;
+        f.track_unfinished();
+
+        // an item available right away
+        //
+        f.push_back(1);
+        CATCH_REQUIRE(f.unfinished() == 1);
+        int_waiter w1;
+        CATCH_REQUIRE(f.pop_front_or_wait(w1));
+        CATCH_REQUIRE(w1.get_item() == 1);
+        CATCH_REQUIRE(f.unfinished() == 0);
+        CATCH_REQUIRE(f.wait_idle(0));
+
+        // an item pushed while the waiter is queued
+        //
+        int_waiter w2;
+        CATCH_REQUIRE_FALSE(f.pop_front_or_wait(w2));
+        f.push_back(2);
+        CATCH_REQUIRE(w2.is_ready());
+        CATCH_REQUIRE(w2.get_item() == 2);
+        CATCH_REQUIRE(f.unfinished() == 0);
+        CATCH_REQUIRE(f.wait_idle(0));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
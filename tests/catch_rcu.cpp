@@ -0,0 +1,388 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/rcu.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/pool.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+#include    <cppthread/worker.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C
+//
+#include    <sched.h>
+
+
+
+namespace
+{
+
+
+std::atomic<int>    g_alive(0);
+
+
+struct config_t
+{
+    config_t()
+    {
+        ++g_alive;
+    }
+
+    config_t(config_t const & rhs)
+        : f_a(rhs.f_a)
+        , f_b(rhs.f_b)
+    {
+        ++g_alive;
+    }
+
+    ~config_t()
+    {
+        // make a use after free visible
+        //
+        f_a = -1;
+        f_b = -1;
+        --g_alive;
+    }
+
+    int                 f_a = 0;
+    int                 f_b = 0;
+};
+
+
+class reader_runner
+    : public cppthread::runner
+{
+public:
+    reader_runner(cppthread::rcu_ptr<config_t> & config, std::atomic<bool> & done)
+        : runner("rcu-reader")
+        , f_config(config)
+        , f_done(done)
+    {
+    }
+
+    virtual void run() override
+    {
+        while(!f_done)
+        {
+            cppthread::rcu_read_guard read_section;
+            config_t const * c(f_config.get());
+            int const a(c->f_a);
+            sched_yield();
+            if(c->f_b != a * 2 || a < 0)
+            {
+                ++f_errors;
+            }
+            ++f_reads;
+        }
+    }
+
+    std::uint64_t       f_reads = 0;
+    std::uint64_t       f_errors = 0;
+
+private:
+    cppthread::rcu_ptr<config_t> &
+                        f_config;
+    std::atomic<bool> & f_done;
+};
+
+
+class writer_runner
+    : public cppthread::runner
+{
+public:
+    writer_runner(cppthread::rcu_ptr<config_t> & config, int count)
+        : runner("rcu-writer")
+        , f_config(config)
+        , f_count(count)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < f_count; ++i)
+        {
+            f_config.update([](config_t & c)
+                {
+                    ++c.f_a;
+                    c.f_b = c.f_a * 2;
+                });
+        }
+    }
+
+private:
+    cppthread::rcu_ptr<config_t> &
+                        f_config;
+    int                 f_count;
+};
+
+
+struct job_t
+{
+    int                 f_value = 0;
+};
+
+
+std::atomic<int>    g_reading_jobs(0);
+
+
+class synchronizing_worker
+    : public cppthread::worker<job_t>
+{
+public:
+    synchronizing_worker(
+              std::string const & name
+            , std::size_t position
+            , cppthread::fifo<job_t>::pointer_t in
+            , cppthread::fifo<job_t>::pointer_t out)
+        : worker<job_t>(name, position, in, out)
+    {
+    }
+
+    virtual bool do_work() override
+    {
+        if(cppthread::rcu_is_reading())
+        {
+            ++g_reading_jobs;
+        }
+
+        // a task may wait for the readers
+        //
+        cppthread::rcu_synchronize();
+        return true;
+    }
+};
+
+
+typedef cppthread::pool<synchronizing_worker>   synchronizing_pool_t;
+
+
+}
+
+
+
+CATCH_TEST_CASE("rcu", "[rcu]")
+{
+    CATCH_START_SECTION("rcu: store, update and reclaim")
+    {
+        cppthread::rcu_synchronize();
+        int const alive(g_alive);
+
+        {
+            cppthread::rcu_ptr<config_t> config(new config_t);
+            CATCH_REQUIRE(g_alive == alive + 1);
+            CATCH_REQUIRE(config->f_a == 0);
+
+            config.update([](config_t & c) { c.f_a = 5; });
+            CATCH_REQUIRE(config->f_a == 5);
+            CATCH_REQUIRE((*config).f_a == 5);
+
+            // nobody is reading, the old version can go
+            //
+            cppthread::rcu_reclaim();
+            CATCH_REQUIRE(g_alive == alive + 1);
+
+            config_t const * first(nullptr);
+            {
+                cppthread::rcu_read_guard read_section;
+                CATCH_REQUIRE(cppthread::rcu_is_reading());
+                first = config.get();
+
+                {
+                    cppthread::rcu_read_guard nested;
+                    CATCH_REQUIRE(cppthread::rcu_is_reading());
+                }
+                CATCH_REQUIRE(cppthread::rcu_is_reading());
+
+                std::unique_ptr<config_t> replacement(std::make_unique<config_t>());
+                replacement->f_a = 7;
+                config.store(std::move(replacement));
+                CATCH_REQUIRE(config->f_a == 7);
+
+                // we are still reading, `first` must survive
+                //
+                CATCH_REQUIRE(cppthread::rcu_reclaim() == 0);
+                CATCH_REQUIRE(g_alive == alive + 2);
+                CATCH_REQUIRE(first->f_a == 5);
+
+                CATCH_REQUIRE_THROWS_MATCHES(
+                          cppthread::rcu_synchronize()
+                        , cppthread::logic_error
+                        , Catch::Matchers::ExceptionMessage(
+                                  "logic_error: rcu_synchronize() called from within a read section"));
+                CATCH_REQUIRE_THROWS_MATCHES(
+                          cppthread::rcu_quiescent_state()
+                        , cppthread::logic_error
+                        , Catch::Matchers::ExceptionMessage(
+                                  "logic_error: rcu_quiescent_state() called from within a read section"));
+            }
+            cppthread::rcu_quiescent_state();
+            CATCH_REQUIRE_FALSE(cppthread::rcu_is_reading());
+
+            cppthread::rcu_synchronize();
+            CATCH_REQUIRE(g_alive == alive + 1);
+        }
+        CATCH_REQUIRE(g_alive == alive);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("rcu: rcu_call() waits for the readers")
+    {
+        cppthread::rcu_synchronize();
+
+        int called(0);
+        {
+            cppthread::rcu_read_guard read_section;
+            cppthread::rcu_call([&called]() { ++called; });
+            CATCH_REQUIRE(cppthread::rcu_reclaim() == 0);
+            CATCH_REQUIRE(called == 0);
+        }
+        CATCH_REQUIRE(cppthread::rcu_reclaim() == 1);
+        CATCH_REQUIRE(called == 1);
+
+        // with epoch based reclamation, a read section started after the
+        // call holds it back too (the epoch cannot move two steps ahead
+        // of that reader) but only until that section ends
+        //
+        cppthread::rcu_call([&called]() { ++called; });
+        {
+            cppthread::rcu_read_guard read_section;
+            CATCH_REQUIRE(cppthread::rcu_reclaim() == 0);
+            CATCH_REQUIRE(called == 1);
+        }
+
+        // threads of other tests may still be in a read section for a
+        // moment, so give them a bounded amount of time
+        //
+        std::size_t reclaimed(0);
+        for(int retry(0); retry < 1'000 && reclaimed == 0; ++retry)
+        {
+            reclaimed = cppthread::rcu_reclaim();
+            if(reclaimed == 0)
+            {
+                sched_yield();
+            }
+        }
+        CATCH_REQUIRE(reclaimed == 1);
+        CATCH_REQUIRE(called == 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("rcu: workers do not run their tasks in a read section")
+    {
+        g_reading_jobs = 0;
+
+        synchronizing_pool_t::worker_fifo_t::pointer_t in(std::make_shared<synchronizing_pool_t::worker_fifo_t>());
+        synchronizing_pool_t p("synchronizing", 2, in, nullptr);
+        for(int i(0); i < 20; ++i)
+        {
+            p.push_back(job_t{ i });
+        }
+        p.wait_idle();
+
+        CATCH_REQUIRE(g_reading_jobs == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("rcu: readers never see a deleted version")
+    {
+        cppthread::rcu_synchronize();
+        int const alive(g_alive);
+
+        {
+            cppthread::rcu_ptr<config_t> config(new config_t);
+            std::atomic<bool> done(false);
+
+            std::vector<std::shared_ptr<reader_runner>> readers;
+            std::vector<std::shared_ptr<cppthread::thread>> threads;
+            for(int i(0); i < 3; ++i)
+            {
+                readers.push_back(std::make_shared<reader_runner>(config, done));
+                threads.push_back(std::make_shared<cppthread::thread>("rcu-reader", readers.back()));
+                threads.back()->start();
+            }
+
+            writer_runner writer(config, 20'000);
+            cppthread::thread writer_thread("rcu-writer", &writer);
+            writer_thread.start();
+            writer_thread.stop();
+
+            done = true;
+            for(auto & t : threads)
+            {
+                t->stop();
+            }
+
+            for(auto const & r : readers)
+            {
+                CATCH_REQUIRE(r->f_reads > 0);
+                CATCH_REQUIRE(r->f_errors == 0);
+            }
+            CATCH_REQUIRE(config->f_a == 20'000);
+
+            cppthread::rcu_synchronize();
+            CATCH_REQUIRE(g_alive == alive + 1);
+        }
+        CATCH_REQUIRE(g_alive == alive);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("rcu: store() does not retire the object update() copies")
+    {
+        cppthread::rcu_synchronize();
+        int const alive(g_alive);
+
+        {
+            cppthread::rcu_ptr<config_t> config(new config_t);
+
+            writer_runner writer(config, 2'000);
+            cppthread::thread writer_thread("rcu-writer", &writer);
+            writer_thread.start();
+
+            // the writers are serialized, so the object copied by update()
+            // cannot be retired and reclaimed by this thread meanwhile
+            //
+            for(int i(0); i < 2'000; ++i)
+            {
+                config.store(std::make_unique<config_t>());
+                cppthread::rcu_reclaim();
+            }
+            writer_thread.stop();
+
+            CATCH_REQUIRE(config->f_a >= 0);
+            CATCH_REQUIRE(config->f_b == config->f_a * 2);
+
+            cppthread::rcu_synchronize();
+            CATCH_REQUIRE(g_alive == alive + 1);
+        }
+        CATCH_REQUIRE(g_alive == alive);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
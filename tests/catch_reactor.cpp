@@ -0,0 +1,228 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/reactor.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/latch.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <thread>
+
+
+// C
+//
+#include    <arpa/inet.h>
+#include    <netinet/in.h>
+#include    <sys/epoll.h>
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("reactor", "[reactor]")
+{
+    CATCH_START_SECTION("reactor: file descriptor callbacks and posted tasks")
+    {
+        cppthread::reactor::pointer_t r(std::make_shared<cppthread::reactor>("reactor"));
+        cppthread::thread t("reactor", r);
+        CATCH_REQUIRE(t.start());
+
+        int pipes[2];
+        CATCH_REQUIRE(pipe(pipes) == 0);
+
+        std::string received;
+        cppthread::latch got_data(1);
+        r->add(pipes[0], EPOLLIN, [&](int fd, std::uint32_t events)
+            {
+                CATCH_REQUIRE((events & EPOLLIN) != 0);
+                char buf[256];
+                ssize_t const size(read(fd, buf, sizeof(buf)));
+                if(size > 0)
+                {
+                    received.append(buf, size);
+                    if(received.length() >= 5)
+                    {
+                        got_data.count_down();
+                    }
+                }
+            });
+        CATCH_REQUIRE(r->size() == 1);
+
+        CATCH_REQUIRE(write(pipes[1], "hello", 5) == 5);
+        CATCH_REQUIRE(got_data.wait_for(std::chrono::seconds(10)));
+
+        // the tasks run on the reactor thread, so they can read
+        // "received" without a lock
+        //
+        std::thread::id task_thread;
+        std::string copy;
+        cppthread::latch task_done(1);
+        r->post([&]()
+            {
+                task_thread = std::this_thread::get_id();
+                copy = received;
+                task_done.count_down();
+            });
+        CATCH_REQUIRE(task_done.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(task_thread != std::this_thread::get_id());
+        CATCH_REQUIRE(copy == "hello");
+
+        // an exception in a task is logged and the loop goes on
+        //
+        cppthread::latch after_error(1);
+        r->post([]() { throw cppthread::invalid_error("task failed"); });
+        r->post([&]() { after_error.count_down(); });
+        CATCH_REQUIRE(after_error.wait_for(std::chrono::seconds(10)));
+
+        // a callback throwing something other than an std::exception
+        // does not stop the reactor either
+        //
+        int throwing[2];
+        CATCH_REQUIRE(pipe(throwing) == 0);
+        cppthread::latch thrown(1);
+        r->add(throwing[0], EPOLLIN, [&](int fd, std::uint32_t)
+            {
+                char buf[16];
+                CATCH_REQUIRE(read(fd, buf, sizeof(buf)) == 1);
+                thrown.count_down();
+                throw 42;
+            });
+        CATCH_REQUIRE(write(throwing[1], "x", 1) == 1);
+        CATCH_REQUIRE(thrown.wait_for(std::chrono::seconds(10)));
+        cppthread::latch after_unknown(1);
+        r->post([&]() { after_unknown.count_down(); });
+        CATCH_REQUIRE(after_unknown.wait_for(std::chrono::seconds(10)));
+        CATCH_REQUIRE(t.is_running());
+        r->remove(throwing[0]);
+        close(throwing[0]);
+        close(throwing[1]);
+
+        r->remove(pipes[0]);
+        CATCH_REQUIRE(r->size() == 0);
+        close(pipes[0]);
+        close(pipes[1]);
+
+        // stop() wakes the reactor up through its eventfd
+        //
+        t.stop();
+        CATCH_REQUIRE_FALSE(t.is_running());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("reactor: invalid file descriptor")
+    {
+        cppthread::reactor r("reactor");
+        CATCH_REQUIRE_THROWS_AS(
+                  r.add(-1, EPOLLIN, [](int, std::uint32_t) {})
+                , cppthread::system_error);
+        CATCH_REQUIRE(r.size() == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("reactor_group", "[reactor]")
+{
+    CATCH_START_SECTION("reactor_group: echo server sharded with SO_REUSEPORT")
+    {
+        constexpr int const CLIENTS = 30;
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::reactor_group("empty", 0)
+                , cppthread::out_of_range
+                , Catch::Matchers::ExceptionMessage(
+                          "out_of_range: a reactor group needs at least one reactor."));
+
+        cppthread::reactor_group group("echo", 3);
+        CATCH_REQUIRE(group.size() == 3);
+
+        std::atomic<int> accepted(0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int const port(group.listen(
+                  reinterpret_cast<sockaddr *>(&addr)
+                , sizeof(addr)
+                , [&accepted](cppthread::reactor & r, int client)
+                {
+                    ++accepted;
+                    r.add(client, EPOLLIN, [&r](int fd, std::uint32_t)
+                        {
+                            char buf[256];
+                            ssize_t const size(read(fd, buf, sizeof(buf)));
+                            if(size <= 0)
+                            {
+                                r.remove(fd);
+                                close(fd);
+                                return;
+                            }
+                            CATCH_REQUIRE(write(fd, buf, size) == size);
+                        });
+                }));
+        CATCH_REQUIRE(port > 0);
+
+        addr.sin_port = htons(port);
+        for(int i(0); i < CLIENTS; ++i)
+        {
+            int const s(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+            CATCH_REQUIRE(s != -1);
+            CATCH_REQUIRE(connect(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+
+            std::string const msg("ping #" + std::to_string(i));
+            CATCH_REQUIRE(write(s, msg.c_str(), msg.length()) == static_cast<ssize_t>(msg.length()));
+            char buf[256];
+            std::string reply;
+            while(reply.length() < msg.length())
+            {
+                ssize_t const size(read(s, buf, sizeof(buf)));
+                CATCH_REQUIRE(size > 0);
+                reply.append(buf, size);
+            }
+            CATCH_REQUIRE(reply == msg);
+            close(s);
+        }
+        CATCH_REQUIRE(accepted == CLIENTS);
+
+        std::size_t count(0);
+        for(std::size_t idx(0); idx < group.size(); ++idx)
+        {
+            // the listening socket of each reactor is still registered
+            //
+            CATCH_REQUIRE(group.get_reactor(idx).size() >= 1);
+            ++count;
+        }
+        CATCH_REQUIRE(count == 3);
+        CATCH_REQUIRE(&group.next() != &group.next());
+
+        group.stop();
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
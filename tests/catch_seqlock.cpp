@@ -0,0 +1,247 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/seqlock.h>
+
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+namespace
+{
+
+
+struct snapshot_t
+{
+    std::uint64_t       f_a = 0;
+    std::uint64_t       f_b = 0;
+    std::uint64_t       f_c = 0;
+    std::uint32_t       f_d = 0;
+};
+
+
+class reader_runner
+    : public cppthread::runner
+{
+public:
+    reader_runner(cppthread::seqlock<snapshot_t> & value, std::atomic<bool> & done)
+        : runner("seqlock-reader")
+        , f_value(value)
+        , f_done(done)
+    {
+    }
+
+    virtual void run() override
+    {
+        std::uint64_t previous(0);
+        while(!f_done)
+        {
+            snapshot_t const s(f_value.load());
+            if(s.f_b != s.f_a * 2
+            || s.f_c != s.f_a * 3
+            || s.f_d != static_cast<std::uint32_t>(s.f_a))
+            {
+                ++f_torn;
+            }
+            if(s.f_a < previous)
+            {
+                ++f_backward;
+            }
+            previous = s.f_a;
+            ++f_reads;
+        }
+    }
+
+    std::uint64_t       f_reads = 0;
+    std::uint64_t       f_torn = 0;
+    std::uint64_t       f_backward = 0;
+
+private:
+    cppthread::seqlock<snapshot_t> &
+                        f_value;
+    std::atomic<bool> & f_done;
+};
+
+
+class writer_runner
+    : public cppthread::runner
+{
+public:
+    writer_runner(cppthread::seqlock<snapshot_t> & value, std::uint64_t count)
+        : runner("seqlock-writer")
+        , f_value(value)
+        , f_count(count)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(std::uint64_t i(1); i <= f_count; ++i)
+        {
+            f_value.store(snapshot_t{ i, i * 2, i * 3, static_cast<std::uint32_t>(i) });
+        }
+    }
+
+private:
+    cppthread::seqlock<snapshot_t> &
+                        f_value;
+    std::uint64_t       f_count;
+};
+
+
+class increment_runner
+    : public cppthread::runner
+{
+public:
+    increment_runner(cppthread::seqlock<snapshot_t> & value)
+        : runner("seqlock-increment")
+        , f_value(value)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < 10'000; ++i)
+        {
+            f_value.update([](snapshot_t & s)
+                {
+                    ++s.f_a;
+                    s.f_b += 2;
+                    s.f_c += 3;
+                    ++s.f_d;
+                });
+        }
+    }
+
+private:
+    cppthread::seqlock<snapshot_t> &
+                        f_value;
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("seqlock", "[seqlock]")
+{
+    CATCH_START_SECTION("seqlock: load, store, update")
+    {
+        cppthread::seqlock<snapshot_t> value(snapshot_t{ 1, 2, 3, 1 });
+        CATCH_REQUIRE(value.sequence() == 0);
+
+        snapshot_t s(value.load());
+        CATCH_REQUIRE(s.f_a == 1);
+        CATCH_REQUIRE(s.f_b == 2);
+        CATCH_REQUIRE(s.f_c == 3);
+        CATCH_REQUIRE(s.f_d == 1);
+
+        value.store(snapshot_t{ 5, 10, 15, 5 });
+        CATCH_REQUIRE(value.sequence() == 2);
+        CATCH_REQUIRE(value.try_load(s));
+        CATCH_REQUIRE(s.f_a == 5);
+        CATCH_REQUIRE(s.f_b == 10);
+        CATCH_REQUIRE(s.f_c == 15);
+        CATCH_REQUIRE(s.f_d == 5);
+
+        value.update([](snapshot_t & v) { v.f_a = 7; });
+        CATCH_REQUIRE(value.sequence() == 4);
+        s = value.load();
+        CATCH_REQUIRE(s.f_a == 7);
+        CATCH_REQUIRE(s.f_b == 10);
+
+        cppthread::seqlock<int> small(33);
+        CATCH_REQUIRE(small.load() == 33);
+        small.store(-5);
+        CATCH_REQUIRE(small.load() == -5);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("seqlock: readers never see a torn value")
+    {
+        cppthread::seqlock<snapshot_t> value;
+        std::atomic<bool> done(false);
+
+        std::vector<std::shared_ptr<reader_runner>> readers;
+        std::vector<std::shared_ptr<cppthread::thread>> threads;
+        for(int i(0); i < 4; ++i)
+        {
+            readers.push_back(std::make_shared<reader_runner>(value, done));
+            threads.push_back(std::make_shared<cppthread::thread>("seqlock-reader", readers.back()));
+            threads.back()->start();
+        }
+
+        writer_runner writer(value, 200'000);
+        cppthread::thread writer_thread("seqlock-writer", &writer);
+        writer_thread.start();
+        writer_thread.stop();
+
+        done = true;
+        for(auto & t : threads)
+        {
+            t->stop();
+        }
+
+        for(auto const & r : readers)
+        {
+            CATCH_REQUIRE(r->f_reads > 0);
+            CATCH_REQUIRE(r->f_torn == 0);
+            CATCH_REQUIRE(r->f_backward == 0);
+        }
+        CATCH_REQUIRE(value.load().f_a == 200'000);
+        CATCH_REQUIRE(value.sequence() == 400'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("seqlock: concurrent updates are not lost")
+    {
+        cppthread::seqlock<snapshot_t> value;
+
+        increment_runner r1(value);
+        increment_runner r2(value);
+        increment_runner r3(value);
+        cppthread::thread t1("seqlock-increment-1", &r1);
+        cppthread::thread t2("seqlock-increment-2", &r2);
+        cppthread::thread t3("seqlock-increment-3", &r3);
+        t1.start();
+        t2.start();
+        t3.start();
+        t1.stop();
+        t2.stop();
+        t3.stop();
+
+        snapshot_t const s(value.load());
+        CATCH_REQUIRE(s.f_a == 30'000);
+        CATCH_REQUIRE(s.f_b == 60'000);
+        CATCH_REQUIRE(s.f_c == 90'000);
+        CATCH_REQUIRE(s.f_d == 30'000);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
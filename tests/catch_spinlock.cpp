@@ -0,0 +1,148 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/spinlock.h>
+
+#include    <cppthread/guard.h>
+#include    <cppthread/multi_guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+namespace
+{
+
+
+class increment_runner
+    : public cppthread::runner
+{
+public:
+    increment_runner(cppthread::lockable & l, int & counter)
+        : runner("increment-runner")
+        , f_lock(l)
+        , f_counter(counter)
+    {
+    }
+
+    virtual void run() override
+    {
+        for(int i(0); i < 100'000; ++i)
+        {
+            cppthread::guard lock(f_lock);
+            ++f_counter;
+        }
+    }
+
+private:
+    cppthread::lockable &   f_lock;
+    int &                   f_counter;
+};
+
+
+void verify_lock(cppthread::lockable & l)
+{
+    CATCH_REQUIRE(l.try_lock());
+    CATCH_REQUIRE_FALSE(l.try_lock());
+    l.unlock();
+
+    {
+        cppthread::guard lock(l);
+        CATCH_REQUIRE(lock.is_locked());
+        CATCH_REQUIRE_FALSE(l.try_lock());
+
+        lock.unlock(false);
+        CATCH_REQUIRE_FALSE(lock.is_locked());
+        CATCH_REQUIRE(l.try_lock());
+        l.unlock();
+
+        lock.lock();
+        CATCH_REQUIRE(lock.is_locked());
+        lock.lock();
+        CATCH_REQUIRE(lock.is_locked());
+    }
+    CATCH_REQUIRE(l.try_lock());
+    l.unlock();
+
+    int counter(0);
+    increment_runner r1(l, counter);
+    increment_runner r2(l, counter);
+    increment_runner r3(l, counter);
+    cppthread::thread t1("increment-1", &r1);
+    cppthread::thread t2("increment-2", &r2);
+    cppthread::thread t3("increment-3", &r3);
+    t1.start();
+    t2.start();
+    t3.start();
+    t1.stop();
+    t2.stop();
+    t3.stop();
+    CATCH_REQUIRE(counter == 300'000);
+}
+
+
+}
+
+
+
+CATCH_TEST_CASE("spinlock", "[spinlock][guard]")
+{
+    CATCH_START_SECTION("spinlock: lock, try_lock, guard and threads")
+    {
+        cppthread::spinlock s;
+        verify_lock(s);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ticket_lock: lock, try_lock, guard and threads")
+    {
+        cppthread::ticket_lock t;
+        verify_lock(t);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("spinlock: multi_guard with mixed locks")
+    {
+        cppthread::mutex m;
+        cppthread::spinlock s;
+        cppthread::ticket_lock t;
+        {
+            cppthread::multi_guard lock({ &m, &s, &t });
+            CATCH_REQUIRE(lock.is_locked());
+            CATCH_REQUIRE_FALSE(s.try_lock());
+            CATCH_REQUIRE_FALSE(t.try_lock());
+        }
+        CATCH_REQUIRE(s.try_lock());
+        s.unlock();
+        CATCH_REQUIRE(t.try_lock());
+        t.unlock();
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,316 @@
+// Copyright (c) 2006-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// cppthread lib
+//
+#include    <cppthread/barrier.h>
+#include    <cppthread/latch.h>
+#include    <cppthread/semaphore.h>
+
+#include    <cppthread/exception.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+namespace
+{
+
+
+class lambda_runner
+    : public cppthread::runner
+{
+public:
+    lambda_runner(std::function<void()> f)
+        : runner("sync-runner")
+        , f_function(f)
+    {
+    }
+
+    virtual void run() override
+    {
+        f_function();
+    }
+
+private:
+    std::function<void()>
+                        f_function;
+};
+
+
+class runners
+{
+public:
+    void start(std::size_t count, std::function<void(std::size_t)> f)
+    {
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            f_runners.push_back(std::make_shared<lambda_runner>([f, idx]() { f(idx); }));
+            f_threads.push_back(std::make_shared<cppthread::thread>("sync-runner", f_runners.back()));
+            f_threads.back()->start();
+        }
+    }
+
+    void stop()
+    {
+        for(auto & t : f_threads)
+        {
+            t->stop();
+        }
+    }
+
+private:
+    std::vector<std::shared_ptr<lambda_runner>>     f_runners = {};
+    std::vector<std::shared_ptr<cppthread::thread>> f_threads = {};
+};
+
+
+}
+
+
+
+CATCH_TEST_CASE("latch", "[sync]")
+{
+    CATCH_START_SECTION("latch: count down and wait")
+    {
+        cppthread::latch l(3);
+        CATCH_REQUIRE_FALSE(l.try_wait());
+        CATCH_REQUIRE_FALSE(l.wait_for(std::chrono::milliseconds(1)));
+
+        l.count_down();
+        l.count_down(2);
+        CATCH_REQUIRE(l.try_wait());
+        CATCH_REQUIRE(l.wait_for(std::chrono::milliseconds(1)));
+        l.wait();
+
+        cppthread::latch open(0);
+        CATCH_REQUIRE(open.try_wait());
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  l.count_down()
+                , cppthread::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: latch::count_down() called with a number larger than the current count."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("latch: threads wait for the main thread")
+    {
+        cppthread::latch start(1);
+        cppthread::latch ready(4);
+        std::atomic<int> started(0);
+
+        runners r;
+        r.start(4, [&](std::size_t)
+            {
+                ready.count_down();
+                start.wait();
+                ++started;
+            });
+
+        ready.wait();
+        CATCH_REQUIRE(started == 0);
+        start.count_down();
+        r.stop();
+        CATCH_REQUIRE(started == 4);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("latch: the waiter destroys the latch as soon as it opens")
+    {
+        // this is what sync_wait() does with its latch on the stack; run
+        // with a memory checker, an access to the latch by count_down()
+        // after the last decrement may get reported
+        //
+        std::atomic<cppthread::latch *> current(nullptr);
+        std::atomic<bool> done(false);
+
+        runners r;
+        r.start(1, [&](std::size_t)
+            {
+                while(!done)
+                {
+                    cppthread::latch * l(current.exchange(nullptr));
+                    if(l != nullptr)
+                    {
+                        l->count_down();
+                    }
+                }
+            });
+
+        for(int i(0); i < 1'000; ++i)
+        {
+            std::unique_ptr<cppthread::latch> l(std::make_unique<cppthread::latch>(1));
+            current = l.get();
+            l->wait();
+        }
+
+        done = true;
+        r.stop();
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("barrier", "[sync]")
+{
+    CATCH_START_SECTION("barrier: phases with a completion")
+    {
+        constexpr std::size_t const THREADS = 4;
+        constexpr int const PHASES = 100;
+
+        std::atomic<int> arrived(0);
+        std::atomic<int> errors(0);
+        int completions(0);
+        cppthread::barrier b(THREADS, [&]()
+            {
+                if(arrived != THREADS)
+                {
+                    ++errors;
+                }
+                arrived = 0;
+                ++completions;
+            });
+        CATCH_REQUIRE(b.phase() == 0);
+
+        runners r;
+        r.start(THREADS, [&](std::size_t)
+            {
+                for(int i(0); i < PHASES; ++i)
+                {
+                    ++arrived;
+                    b.arrive_and_wait();
+                }
+            });
+        r.stop();
+
+        CATCH_REQUIRE(errors == 0);
+        CATCH_REQUIRE(completions == PHASES);
+        CATCH_REQUIRE(b.phase() == PHASES);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("barrier: drop out of the group")
+    {
+        int completions(0);
+        cppthread::barrier b(3, [&completions]() { ++completions; });
+
+        runners r;
+        r.start(1, [&](std::size_t)
+            {
+                b.arrive_and_drop();
+            });
+        r.start(1, [&](std::size_t)
+            {
+                for(int i(0); i < 10; ++i)
+                {
+                    b.arrive_and_wait();
+                }
+            });
+        for(int i(0); i < 10; ++i)
+        {
+            b.arrive_and_wait();
+        }
+        r.stop();
+
+        CATCH_REQUIRE(completions == 10);
+        CATCH_REQUIRE(b.phase() == 10);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("barrier: count must be positive")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cppthread::barrier(0)
+                , cppthread::invalid_error
+                , Catch::Matchers::ExceptionMessage(
+                          "cppthread_exception: a barrier must be created with a count of at least 1."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("semaphore", "[sync]")
+{
+    CATCH_START_SECTION("semaphore: acquire and release")
+    {
+        cppthread::semaphore s(2);
+        CATCH_REQUIRE(s.value() == 2);
+        CATCH_REQUIRE(s.try_acquire());
+        s.acquire();
+        CATCH_REQUIRE(s.value() == 0);
+        CATCH_REQUIRE_FALSE(s.try_acquire());
+        CATCH_REQUIRE_FALSE(s.try_acquire_for(std::chrono::milliseconds(1)));
+
+        s.release(2);
+        CATCH_REQUIRE(s.value() == 2);
+        CATCH_REQUIRE(s.try_acquire_for(std::chrono::milliseconds(1)));
+        CATCH_REQUIRE(s.value() == 1);
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  s.release(std::numeric_limits<std::uint32_t>::max())
+                , cppthread::out_of_range
+                , Catch::Matchers::ExceptionMessage(
+                          "out_of_range: semaphore::release() would overflow the counter."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("semaphore: limit concurrent access")
+    {
+        constexpr int const MAX = 2;
+        cppthread::semaphore s(MAX);
+        std::atomic<int> inside(0);
+        std::atomic<int> errors(0);
+        std::atomic<int> total(0);
+
+        runners r;
+        r.start(6, [&](std::size_t)
+            {
+                for(int i(0); i < 1'000; ++i)
+                {
+                    s.acquire();
+                    if(++inside > MAX)
+                    {
+                        ++errors;
+                    }
+                    if((i & 15) == 0)
+                    {
+                        sched_yield();
+                    }
+                    --inside;
+                    ++total;
+                    s.release();
+                }
+            });
+        r.stop();
+
+        CATCH_REQUIRE(errors == 0);
+        CATCH_REQUIRE(total == 6'000);
+        CATCH_REQUIRE(s.value() == MAX);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
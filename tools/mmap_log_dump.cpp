@@ -0,0 +1,127 @@
+// Copyright (c) 2020-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/cppthread
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Dump the messages of a memory mapped log file.
+ *
+ * This tool reads a file written by the cppthread::mmap_log_sink class,
+ * for example after a crash, and prints its messages from the oldest to
+ * the most recent.
+ */
+
+// cppthread
+//
+#include    <cppthread/mmap_log.h>
+
+
+// libexcept
+//
+#include    <libexcept/file_inheritance.h>
+
+
+// C++
+//
+#include    <iomanip>
+#include    <iostream>
+
+
+// C
+//
+#include    <string.h>
+#include    <time.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+int main(int argc, char * argv[])
+{
+    libexcept::verify_inherited_files();
+
+    std::vector<std::string> filenames;
+    for(int i(1); i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--help") == 0
+        || strcmp(argv[i], "-h") == 0)
+        {
+            std::cerr << "Usage: " << argv[0] << " [--opts] <log file> ..." << std::endl;
+            std::cerr << "where --opts is one of:" << std::endl;
+            std::cerr << "  --help | -h     print out this help screen" << std::endl;
+            return 3;
+        }
+        else if(argv[i][0] == '-')
+        {
+            std::cerr << argv[0] << ":error: unexpected command line option \"" << argv[i] << "\"." << std::endl;
+            return 1;
+        }
+        else
+        {
+            filenames.push_back(argv[i]);
+        }
+    }
+    if(filenames.empty())
+    {
+        std::cerr << argv[0] << ":error: at least one log file is expected." << std::endl;
+        return 1;
+    }
+
+    int result(0);
+    for(auto const & f : filenames)
+    {
+        try
+        {
+            cppthread::mmap_log_entries_t const entries(cppthread::read_mmap_log(f));
+            for(auto const & e : entries)
+            {
+                time_t const seconds(e.f_time_ns / 1'000'000'000);
+                struct tm t = {};
+                gmtime_r(&seconds, &t);
+                char date[32];
+                strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &t);
+
+                std::cout << date
+                          << '.'
+                          << std::setw(9)
+                          << std::setfill('0')
+                          << e.f_time_ns % 1'000'000'000
+                          << std::setfill(' ')
+                          << " ["
+                          << e.f_tid
+                          << "] "
+                          << cppthread::to_string(e.f_level)
+                          << ": "
+                          << e.f_message
+                          << (e.f_complete ? "" : " [incomplete]")
+                          << std::endl;
+            }
+        }
+        catch(std::exception const & e)
+        {
+            std::cerr << argv[0] << ":error: " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+// vim: ts=4 sw=4 et